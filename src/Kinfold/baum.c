@@ -52,9 +52,15 @@ static short *aliasList = NULL;
 static baum *rl = NULL;         /* ringlist */
 static baum *wurzl = NULL;      /* virtualroot of ringlist-tree */
 static char **ptype = NULL;
+static baum *changed[4];        /* loops changed by update_tree() */
+static int num_changed = 0;
+#ifdef _OPENMP
+#pragma omp threadprivate(pairList, typeList, aliasList, rl, wurzl, ptype, changed, num_changed)
+#endif
 
 static int comp_struc(const void *A, const void *B);
 /* PUBLIC FUNCTIONES */
+void ini_start_stop (void);
 void ini_or_reset_rl (void);
 void move_it (void);
 void update_tree (int i, int j);
@@ -73,6 +79,7 @@ static void inb_nolp (baum *root);
 static void dnb (baum *rli);
 static void dnb_nolp (baum *rli);
 static void fnb (baum *rli);
+static void invalidate_loop (baum *root);
 static void make_ptypes(const short *S);
 /* debugging tool(s) */
 #if 0
@@ -204,6 +211,48 @@ static void ini_ringlist(void) {
 
 }
 
+/* energies of start and stop structure(s), called once before the simulations */
+void ini_start_stop(void) {
+
+#if HAVE_LIBRNA_API3
+  GSV.startE = vrna_eval_structure(GAV.vc, GAV.startform);
+#else
+  GSV.startE = energy_of_structure(GAV.farbe, GAV.startform, 0);
+#endif
+
+  /* stop structure(s) */
+  if ( GTV.stop )  {
+    int i;
+
+    qsort(GAV.stopform, GSV.maxS, sizeof(char *), comp_struc);
+    for (i = 0; i< GSV.maxS; i++)
+#if HAVE_LIBRNA_API3
+      GAV.sE[i] = vrna_eval_structure(GAV.vc, GAV.stopform[i]);
+#else
+      GAV.sE[i] = energy_of_structure(GAV.farbe_full, GAV.stopform[i], 0);
+#endif
+  }
+  else {
+#if HAVE_LIBRNA_API3
+    /* fold sequence to get Minimum free energy structure (Mfe) */
+    GAV.sE[0] = vrna_mfe_dimer(GAV.vc, GAV.stopform[0]);
+    vrna_mx_mfe_free(GAV.vc);
+    /* revaluate energy of Mfe (maye differ if --logML=logarthmic */
+    GAV.sE[0] = vrna_eval_structure(GAV.vc, GAV.stopform[0]);
+#else
+    if(GTV.noLP)
+      noLonelyPairs=1;
+    initialize_cofold(GSV.len);
+    /* fold sequence to get Minimum free energy structure (Mfe) */
+    GAV.sE[0] = cofold(GAV.farbe_full, GAV.stopform[0]);
+    free_arrays();
+    /* revaluate energy of Mfe (maye differ if --logML=logarthmic */
+    GAV.sE[0] = energy_of_structure(GAV.farbe_full, GAV.stopform[0], 0);
+#endif
+  }
+  GSV.stopE = GAV.sE[0];
+}
+
 /**/
 void ini_or_reset_rl(void) {
 
@@ -219,57 +268,7 @@ void ini_or_reset_rl(void) {
     GSV.currE = GSV.startE = energy_of_structure(GAV.farbe, GAV.startform, 0);
 #endif
 
-    /* stop structure(s) */
-    if ( GTV.stop )  {
-      int i;
-
-      qsort(GAV.stopform, GSV.maxS, sizeof(char *), comp_struc);
-#if HAVE_LIBRNA_API3
-      /*
-        note that we need to hack the full length into GAV.vc again,
-        in case it was shortened due to chain growth simulation
-      */
-      unsigned int n, tmp_n;
-      n     = strlen(GAV.farbe_full);
-      tmp_n = GAV.vc->length;
-      GAV.vc->length = n;
-      for (i = 0; i< GSV.maxS; i++)
-        GAV.sE[i] = vrna_eval_structure(GAV.vc, GAV.stopform[i]);
-      GAV.vc->length = tmp_n;
-#else
-      for (i = 0; i< GSV.maxS; i++)
-	GAV.sE[i] = energy_of_structure(GAV.farbe_full, GAV.stopform[i], 0);
-#endif
-    }
-    else {
-#if HAVE_LIBRNA_API3
-      /* fold sequence to get Minimum free energy structure (Mfe) */
-      /*
-        note that we need to hack the full length into GAV.vc again,
-        in case it was shortened due to chain growth simulation
-      */
-      unsigned int n, tmp_n;
-      n     = strlen(GAV.farbe_full);
-      tmp_n = GAV.vc->length;
-      GAV.vc->length = n;
-      GAV.sE[0] = vrna_mfe_dimer(GAV.vc, GAV.stopform[0]);
-      vrna_mx_mfe_free(GAV.vc);
-      /* revaluate energy of Mfe (maye differ if --logML=logarthmic */
-      GAV.sE[0] = vrna_eval_structure(GAV.vc, GAV.stopform[0]);
-      GAV.vc->length = tmp_n;
-#else
-      if(GTV.noLP)
-	noLonelyPairs=1;
-      initialize_cofold(GSV.len);
-      /* fold sequence to get Minimum free energy structure (Mfe) */
-      GAV.sE[0] = cofold(GAV.farbe_full, GAV.stopform[0]);
-      free_arrays();
-      /* revaluate energy of Mfe (maye differ if --logML=logarthmic */
-      GAV.sE[0] = energy_of_structure(GAV.farbe_full, GAV.stopform[0], 0);
-#endif
-    }
-    GSV.stopE = GAV.sE[0];
-    ini_nbList(strlen(GAV.farbe_full)*strlen(GAV.farbe_full));
+    ini_nbList(strlen(GAV.farbe_full));
   }
   else {
     /* reset ringlist-tree to start conditions */
@@ -279,6 +278,8 @@ void ini_or_reset_rl(void) {
       GSV.currE = GSV.startE;
     }
   }
+  /* all neighbours have to be generated from scratch */
+  reset_nbList();
 }
 
 /**/
@@ -293,17 +294,22 @@ static void reset_ringlist(void) {
     rl[i].next = &rl[i + 1];
     rl[i].prev = ((i == 0) ? &rl[GSV.len] : &rl[i - 1]);
     rl[i].up = rl[i].down = NULL;
+    rl[i].loop_energy = 0;
   }
   rl[i].next = &rl[0];
   rl[i].prev = &rl[i-1];
   rl[i].up = wurzl;
+  /* loop energies of the open chain, as after ini_ringlist() */
+  rl[i].loop_energy = wurzl->loop_energy = 0;
 }
 
 /* update ringlist-tree */
 void update_tree(int i, int j) {
 
+  int k;
   baum *rli, *rlj, *tempb;
 
+  num_changed = 0;
   if ( abs(i) < GSV.len) { /* >> single basepair move */
     if ((i > 0) && (j > 0)) { /* insert */
       rli = &rl[i-1];
@@ -351,6 +357,37 @@ void update_tree(int i, int j) {
     }
   } /* << double basepair move */
 
+  /* neighbours of all other loops remain valid */
+  for (k = 0; k < num_changed; k++)
+    invalidate_loop(changed[k]);
+}
+
+/*
+  mark the moves that depend on a changed loop for regeneration. moves of
+  the pair closing a loop also depend on the enclosing loop, with --noLP
+  also on the loops one more level up and down
+*/
+static void invalidate_loop(baum *root) {
+
+  baum *stop, *r, *s;
+
+  invalidate_nbList((root == wurzl) ? 0 : root->nummer+1);
+  /* base pair was opened */
+  if ((root != wurzl) && (root->typ != 'p')) return;
+
+  stop = root->down;
+  for (r = stop->next; r != stop; r = r->next) {
+    if (r->typ != 'p') continue;
+    invalidate_nbList(r->nummer+1);
+    if ( GTV.noLP )
+      for (s = r->down->next; s != r->down; s = s->next)
+	if (s->typ == 'p') invalidate_nbList(s->nummer+1);
+  }
+
+  if ( GTV.noLP && (root != wurzl) ) {
+    for (r = root->next; r->up == NULL; r = r->next);
+    if (r->up != wurzl) invalidate_nbList(r->up->nummer+1);
+  }
 }
 
 /* open a particular base pair */
@@ -747,9 +784,10 @@ static void fnb(baum *rli) {
 }
 
 /* for a given tree (structure),
-   generate all neighbours according to moveset */
+   generate all neighbours according to moveset.
+   only loops changed since the last step are regenerated */
 void move_it (void) {
-  int i;
+  int g;
   
 #if HAVE_LIBRNA_API3
   GSV.currE = (float)vrna_eval_structure_pt(GAV.vc, pairList)/100.;
@@ -758,26 +796,24 @@ void move_it (void) {
     energy_of_struct_pt_par(GAV.farbe, pairList, typeList, aliasList, GAV.params, 0)/100.;
 #endif
   
-  if ( GTV.noLP ) { /* canonical neighbours only */
-    inb_nolp(wurzl);
-    for (i = 0; i < GSV.len; i++) {
-      
-      if (pairList[i+1]>i+1) {
-	inb_nolp(rl+i);      /* insert pair neighbours */
-	dnb_nolp(rl+i);  /* delete pair neighbour */
+  while ((g = next_invalid_nbList()) >= 0) {
+    begin_nbList(g);
+    if ( GTV.noLP ) { /* canonical neighbours only */
+      if (g == 0) inb_nolp(wurzl);
+      else if (pairList[g]>g) {
+	inb_nolp(rl+g-1);      /* insert pair neighbours */
+	dnb_nolp(rl+g-1);  /* delete pair neighbour */
       }
     }
-  }
-  else { /* all neighbours */
-    inb(wurzl);
-    for (i = 0; i < GSV.len; i++) {
-      
-      if (pairList[i+1]>i+1) {
-	inb(rl+i); 	 /* insert pair neighbours */
-	dnb(rl+i);  /* delete pair neighbour */
-	if ( GTV.noShift == 0 ) fnb(rl+i);
+    else { /* all neighbours */
+      if (g == 0) inb(wurzl);
+      else if (pairList[g]>g) {
+	inb(rl+g-1); 	 /* insert pair neighbours */
+	dnb(rl+g-1);  /* delete pair neighbour */
+	if ( GTV.noShift == 0 ) fnb(rl+g-1);
       }
     }
+    end_nbList();
   }
 }
 
@@ -785,6 +821,7 @@ void move_it (void) {
 /**/
 void clean_up_rl(void) {
   int i;
+  if (wurzl == NULL) return;
   free(pairList); pairList=NULL;
   free(typeList); typeList = NULL;
   free(aliasList); aliasList = NULL;
@@ -852,6 +889,7 @@ static void close_bp_en (baum *i, baum *j) {
   /* close bp and update energy */
   baum *r;
   close_bp(i,j);
+  changed[num_changed++] = i;
 
 #if HAVE_LIBRNA_API3
   i->loop_energy = vrna_eval_loop_pt(GAV.vc, i->nummer+1, pairList);
@@ -860,6 +898,7 @@ static void close_bp_en (baum *i, baum *j) {
 #endif
 
   for (r=i->next; r->up==NULL; r=r->next);
+  changed[num_changed++] = r->up;
 
 #if HAVE_LIBRNA_API3
   r->up->loop_energy = vrna_eval_loop_pt(GAV.vc, r->up->nummer+1, pairList);
@@ -873,7 +912,9 @@ static void open_bp_en (baum *i) {
   baum *r;
   i->loop_energy=0;
   open_bp(i);
+  changed[num_changed++] = i;
   for (r=i->next; r->up==NULL; r=r->next);
+  changed[num_changed++] = r->up;
 #if HAVE_LIBRNA_API3
   r->up->loop_energy = vrna_eval_loop_pt(GAV.vc, r->up->nummer+1, pairList);
 #else
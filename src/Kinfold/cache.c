@@ -18,128 +18,300 @@
 #include <utils.h>
 #endif
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "cache_util.h"
 
-#ifdef __GNUC__
-# define INLINE inline
-#else
-# define INLINE
-#endif
+/*
+  modify the typedef of cache_entry in cache_utils.h
+  to suit your application
+*/
 
 /*
-  modify cache_f(), cache_comp() and the typedef of cache_entry
-  in cache_utils.h to suit your application
+  The cache holds at most a fixed number of entries, which are spread
+  over independently locked stripes. Each stripe is a chained hash table
+  plus a ring of its entries that is swept by the hand of the CLOCK
+  eviction policy: an entry that was used since the last sweep gets a
+  second chance, the first one that was not is replaced.
 */
 
+/* maximum number of stripes, must be a power of 2 */
+#define MAX_STRIPES 64
+
+typedef struct {
+  cache_entry **slots;      /* entries in the order of the clock */
+  cache_entry **buckets;    /* hash chains */
+  unsigned int size;        /* maximum number of entries */
+  unsigned int fill;        /* number of entries */
+  unsigned int mask;        /* number of buckets - 1 */
+  unsigned int hand;        /* next slot the clock looks at */
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+#ifdef _OPENMP
+  omp_lock_t lock;
+#endif
+} cache_stripe;
+
 /* PUBLIC FUNCTIONES */
+void initialize_cache(unsigned int size, int jobs);
 cache_entry *lookup_cache (char *x);
-int write_cache (cache_entry *x);
-/*  void delete_cache (cache_entry *x); */
-void kill_cache();
-void initialize_cache();
+void release_cache(cache_entry *c);
+int write_cache (char *x, cache_entry *c);
+void log_cache(FILE *fp);
+void kill_cache(void);
 
 /* PRIVATE FUNCTIONES */
-/*  static int cache_comp(cache_entry *x, cache_entry *y); */
-INLINE static unsigned cache_f (char *x);
-
-/* #define CACHESIZE 67108864 -1 */ /* 2^26 -1   must be power of 2 -1 */
-/* #define CACHESIZE 33554432 -1 */ /* 2^25 -1   must be power of 2 -1 */
-/* #define CACHESIZE 16777216 -1 */ /* 2^24 -1   must be power of 2 -1 */ 
-/* #define CACHESIZE  4194304 -1 */ /* 2^22 -1   must be power of 2 -1 */
-#define CACHESIZE  1048576 -1  /* 2^20 -1   must be power of 2 -1 */
-/* #define CACHESIZE   262144 -1 */ /* 2^18 -1   must be power of 2 -1 */
-/* next is default */
-/* #define CACHESIZE    65536 -1 */ /* 2^16 -1   must be power of 2 -1 */
-/* #define CACHESIZE    16384 -1 */ /* 2^14 -1   must be power of 2 -1 */
-/* #define CACHESIZE     4096 -1 */ /* 2^12 -1   must be power of 2 -1 */
-
-static cache_entry *cachetab[CACHESIZE+1];
+static unsigned int cache_f(const char *key, int length);
+static cache_entry *find_entry(cache_stripe *s, const char *key, int length, unsigned int hash);
+static void evict_entry(cache_stripe *s, cache_entry *c);
+static void free_entry(cache_entry *c);
+static char *pack(const char *x);
+
+static cache_stripe *stripes = NULL;
+static unsigned int num_stripes = 0;
+static unsigned int cache_size = 0;
+
 static char UNUSED rcsid[] ="$Id: cache.c,v 1.3 2006/10/04 12:45:12 xtof Exp $";
-unsigned long collisions=0;
-
-/* stolen from perl source */
-char coeff[] = {
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1};
-
-/* key must not be longer than 128 */
-INLINE static unsigned cache_f(char *x) { 
-  register char *s;
-  register int i;
-  register unsigned cache;
-
-  s = x;
-
-  for (i=0,    cache = 0;
-       /* while */ *s;
-       s++,           i++ , cache *= 5 ) {
-    cache += *s * coeff[i];
+
+/* one-at-a-time hash of a packed structure and its length */
+static unsigned int cache_f(const char *key, int length) {
+  const unsigned char *s;
+  unsigned int hash = (unsigned int)length;
+
+  for (s = (const unsigned char *)key; *s; s++) {
+    hash += *s;
+    hash += hash << 10;
+    hash ^= hash >> 6;
   }
+  hash += hash << 3;
+  hash ^= hash >> 11;
+  hash += hash << 15;
 
-   /* divide through CACHESIZE for normalization */
-  return ((cache) & (CACHESIZE));
+  return hash;
 }
 
+/* the stripe is selected by the high bits of the hash, the bucket by the low bits */
+#define STRIPE(h) (stripes + ((h) >> 24) % num_stripes)
 
-/* returns NULL unless x is in the cache */
-cache_entry *lookup_cache (char *x) {
-  int cacheval;
+#ifdef _OPENMP
+# define LOCK(s)   omp_set_lock(&((s)->lock))
+# define UNLOCK(s) omp_unset_lock(&((s)->lock))
+#else
+# define LOCK(s)
+# define UNLOCK(s)
+#endif
+
+/**/
+static char *pack(const char *x) {
+  char *key;
+
+#if HAVE_LIBRNA_API3
+  key = vrna_db_pack(x);
+#else
+  key = pack_structure(x);
+#endif
+  if (key == NULL) {
+    fprintf(stderr, "can't pack structure %s\n", x); exit(255);
+  }
+  return key;
+}
+
+/*
+  set up a cache for at most size entries. for more than one job, the
+  entries are spread over several stripes to reduce lock contention
+*/
+void initialize_cache(unsigned int size, int jobs) {
+  unsigned int i, n, b;
+
+  if (stripes != NULL) kill_cache();
+  cache_size = size;
+  if (size == 0) return;
+
+  for (num_stripes = 1;
+       (jobs > 1) && (num_stripes < MAX_STRIPES) && (2 * num_stripes <= size);
+       num_stripes *= 2);
+
+  stripes = (cache_stripe *) calloc(num_stripes, sizeof(cache_stripe));
+  if (stripes == NULL) {
+    fprintf(stderr, "out of memory\n"); exit(255);
+  }
+
+  for (i = 0; i < num_stripes; i++) {
+    cache_stripe *s = stripes + i;
+
+    /* distribute the remainder over the first stripes */
+    n = size / num_stripes + ((i < size % num_stripes) ? 1 : 0);
+    for (b = 1; b < n; b *= 2);
+
+    s->size    = n;
+    s->mask    = b - 1;
+    s->slots   = (cache_entry **) calloc(n, sizeof(cache_entry *));
+    s->buckets = (cache_entry **) calloc(b, sizeof(cache_entry *));
+    if ((s->slots == NULL) || (s->buckets == NULL)) {
+      fprintf(stderr, "out of memory\n"); exit(255);
+    }
+#ifdef _OPENMP
+    omp_init_lock(&(s->lock));
+#endif
+  }
+}
+
+/**/
+static cache_entry *find_entry(cache_stripe *s, const char *key, int length, unsigned int hash) {
   cache_entry *c;
 
-  cacheval=cache_f(x);
-  if ((c=cachetab[cacheval]))
-    if (strcmp(c->structure,x)==0) return c;
-  
+  for (c = s->buckets[hash & s->mask]; c; c = c->next)
+    if ((c->hash == hash) && (c->length == length) && (strcmp(c->structure, key) == 0))
+      return c;
+
   return NULL;
 }
 
-/* returns 1 if x already was in the cache */
-int write_cache (cache_entry *x) {
-  int cacheval;
+/*
+  returns NULL unless x is in the cache. a returned entry stays locked
+  until it is handed back by release_cache()
+*/
+cache_entry *lookup_cache (char *x) {
+  int length;
+  unsigned int hash;
+  char *key;
+  cache_stripe *s;
   cache_entry *c;
-  
-  cacheval=cache_f(x->structure);
-  if ((c=cachetab[cacheval])) {
-    free(c->structure);
-    free(c->neighbors);
-    free(c->rates);
-    free(c->energies);
-    free(c);
+
+  if (stripes == NULL) return NULL;
+
+  key    = pack(x);
+  length = strlen(x);
+  hash   = cache_f(key, length);
+  s      = STRIPE(hash);
+
+  LOCK(s);
+  c = find_entry(s, key, length, hash);
+  free(key);
+
+  if (c) {
+    c->used = 1;
+    s->hits++;
+    return c;
   }
-  cachetab[cacheval]=x;
-  return 0;
+
+  s->misses++;
+  UNLOCK(s);
+  return NULL;
 }
 
 /**/
-void initialize_cache () { }
+void release_cache(cache_entry *c) {
+  UNLOCK(STRIPE(c->hash));
+}
 
-/**/
-void kill_cache () {
-  int i;
-  
-  for (i=0;i<CACHESIZE+1;i++) {
-    if ( cachetab[i] ) {
-      free (cachetab[i]->structure);
-      free (cachetab[i]->neighbors);
-      free (cachetab[i]->rates);
-      free (cachetab[i]->energies);
-      free (cachetab[i]);
+/*
+  store entry c for structure x, the cache takes over c. returns 1 if
+  x already was in the cache, e.g. because another trajectory put it there
+*/
+int write_cache (char *x, cache_entry *c) {
+  cache_stripe *s;
+  cache_entry *v;
+
+  if (stripes == NULL) {
+    c->structure = NULL;
+    free_entry(c);
+    return 0;
+  }
+
+  c->structure = pack(x);
+  c->length    = strlen(x);
+  c->hash      = cache_f(c->structure, c->length);
+  c->used      = 1;
+  s            = STRIPE(c->hash);
+
+  LOCK(s);
+  if (find_entry(s, c->structure, c->length, c->hash)) {
+    UNLOCK(s);
+    free_entry(c);
+    return 1;
+  }
+
+  if (s->fill < s->size) {
+    s->slots[s->fill++] = c;
+  }
+  else {
+    /* CLOCK, give recently used entries a second chance */
+    while ((v = s->slots[s->hand])->used) {
+      v->used = 0;
+      s->hand = (s->hand + 1) % s->size;
     }
-    cachetab[i]=NULL;
+    evict_entry(s, v);
+    s->slots[s->hand] = c;
+    s->hand = (s->hand + 1) % s->size;
   }
+
+  c->next = s->buckets[c->hash & s->mask];
+  s->buckets[c->hash & s->mask] = c;
+  UNLOCK(s);
+
+  return 0;
+}
+
+/* remove entry c from its hash chain and free it */
+static void evict_entry(cache_stripe *s, cache_entry *c) {
+  cache_entry **p;
+
+  for (p = s->buckets + (c->hash & s->mask); *p != c; p = &((*p)->next));
+  *p = c->next;
+  free_entry(c);
+  s->evictions++;
 }
 
-#if 0
 /**/
-static int cache_comp(cache_entry *x, cache_entry *y) {
-  return strcmp(((cache_entry *)x)->structure, ((cache_entry *)y)->structure);
+static void free_entry(cache_entry *c) {
+  free(c->structure);
+  free(c->offsets);
+  free(c->neighbors);
+  free(c->rates);
+  free(c->dE);
+  free(c);
+}
+
+/* usage statistics of the cache go to the log */
+void log_cache(FILE *fp) {
+  unsigned int i, fill = 0;
+  unsigned long hits = 0, misses = 0, evictions = 0;
+
+  for (i = 0; i < num_stripes && stripes; i++) {
+    fill      += stripes[i].fill;
+    hits      += stripes[i].hits;
+    misses    += stripes[i].misses;
+    evictions += stripes[i].evictions;
+  }
+
+  fprintf(fp, "#Cache: size=%u entries=%u hits=%lu misses=%lu evictions=%lu",
+          cache_size, fill, hits, misses, evictions);
+  if (hits + misses > 0)
+    fprintf(fp, " hit_rate=%.3f", (double)hits / (hits + misses));
+  fprintf(fp, "\n");
 }
+
+/**/
+void kill_cache () {
+  unsigned int i, j;
+
+  if (stripes == NULL) return;
+  for (i = 0; i < num_stripes; i++) {
+    for (j = 0; j < stripes[i].fill; j++)
+      free_entry(stripes[i].slots[j]);
+    free(stripes[i].slots);
+    free(stripes[i].buckets);
+#ifdef _OPENMP
+    omp_destroy_lock(&(stripes[i].lock));
 #endif
+  }
+  free(stripes);
+  stripes = NULL;
+  num_stripes = 0;
+}
 
 /* End of file */
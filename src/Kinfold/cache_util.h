@@ -9,25 +9,33 @@
 #ifndef CACHE_UTIL_H
 #define CACHE_UTIL_H
 
+#include <stdio.h>
+
 #ifdef __GNUC__
 #define UNUSED __attribute__ ((unused))
 #else
 #define UNUSED
 #endif
 
-typedef struct {
-  char *structure;
+typedef struct cache_entry_s {
+  char *structure;   /* packed structure, see vrna_db_pack() */
+  int length;        /* length of the structure */
+  unsigned int hash;
+  int used;          /* used since the last sweep of the clock */
+  struct cache_entry_s *next; /* next entry in hash chain */
   int top;           /* number of neighbors */
-  int lmin;          /* is a local minimum ? */
-  double flux;       /* sum of rates */
   double energy;     /* energy of this structure */
-  short *neighbors;  
+  int *offsets;      /* first neighbor of each loop, see nachbar.c */
+  short *neighbors;
   float *rates;
-  double *energies;
+  int *dE;           /* energy changes of neighbors in dcal/mol */
 } cache_entry;
 
+extern void initialize_cache(unsigned int size, int jobs);
 extern cache_entry *lookup_cache (char *x);
-extern int write_cache (cache_entry *x);
+extern void release_cache(cache_entry *c);
+extern int write_cache (char *x, cache_entry *c);
+extern void log_cache(FILE *fp);
 void kill_cache(void);
 
 #endif
@@ -29,6 +29,9 @@
 GlobVars GSV;
 GlobArrays GAV;
 GlobToggles GTV;
+#ifdef _OPENMP
+#pragma omp threadprivate(GSV, GAV)
+#endif
 
 /* forward declarations privat functions */
 static void ini_globs(void);
@@ -375,6 +378,16 @@ static void process_options_gg (int argc, char *argv[]) {
   }
   GSV.time = args_info.time_arg;
   GSV.num = args_info.num_arg;
+  GSV.jobs = args_info.jobs_arg;
+  if (GSV.jobs < 0) {
+    fprintf(stderr, "Value of --jobs must be >= 0 >%d<\n", GSV.jobs);
+    exit(EXIT_FAILURE);
+  }
+  GSV.cacheSize = args_info.cacheSize_arg;
+  if (GSV.cacheSize < 0) {
+    fprintf(stderr, "Value of --cacheSize must be >= 0 >%d<\n", GSV.cacheSize);
+    exit(EXIT_FAILURE);
+  }
   strncpy(GAV.BaseName, args_info.log_arg, 255);
   GSV.cut = args_info.cut_arg;
   GSV.grow = args_info.grow_arg;
@@ -553,6 +566,8 @@ static void ini_gtoggles(void) {
 static void ini_gvars(void) {
   GSV.len = 0;
   GSV.num = 1;
+  GSV.jobs = 1;
+  GSV.cacheSize = 1048576;
   GSV.maxS = 99;
   GSV.cut = 20;
   GSV.Temp = 37.0;
@@ -581,6 +596,8 @@ static void ini_garrays(void) {
   GAV.startform = NULL;
   GAV.currform = NULL;
   GAV.prevform = NULL;
+  GAV.outFP = stdout;
+  GAV.logFP = NULL;
   GAV.phi_bounds[0] = 0.1;
   GAV.phi_bounds[1] = 0.1;
   GAV.phi_bounds[2] = 2.0;
@@ -16,6 +16,7 @@
 #endif
 
 #include "config.h"
+#include <stdio.h>
 
 #if HAVE_LIBRNA_API3
 #include <ViennaRNA/model.h>
@@ -28,6 +29,8 @@
 typedef struct _GlobVars {
   int len;
   int num;
+  int jobs;            /* number of trajectories simulated in parallel */
+  int cacheSize;       /* maximum number of structures in the cache */
   int maxS;
   int steps;
   float cut;
@@ -40,6 +43,7 @@ typedef struct _GlobVars {
   double time;
   double phi;
   double simTime;
+  int    rect;     /* start structure not yet seen by current trajectory (--rect) */
 } GlobVars;
 
 typedef struct _GlobArrays {
@@ -55,6 +59,9 @@ typedef struct _GlobArrays {
   float *sE;           /* energy(s) of stop structure(s) */
   double phi_bounds[3];   /* phi_min, phi_inc, phi_max */
   unsigned short subi[3]; /* seeds for random-number-generator */
+  unsigned short rng[3];  /* random-number-generator of current trajectory */
+  FILE *outFP;            /* output of current trajectory */
+  FILE *logFP;            /* log of current trajectory */
 
 #if HAVE_LIBRNA_API3
   vrna_md_t md;
@@ -93,6 +100,11 @@ extern GlobVars GSV;
 extern GlobArrays GAV;
 extern GlobToggles GTV;
 
+/* each thread simulates its own trajectories */
+#ifdef _OPENMP
+#pragma omp threadprivate(GSV, GAV)
+#endif
+
 #endif
 
 
@@ -12,6 +12,8 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <math.h>
+#include <stdint.h>
 #include <unistd.h>
 
 #if HAVE_LIBRNA_API3
@@ -19,6 +21,7 @@
 #include <ViennaRNA/fold_vars.h> /* contains global variable cut_point */
 #include <ViennaRNA/utils.h>
 #include <ViennaRNA/string_utils.h>
+#include <ViennaRNA/datastructures/stream_output.h>
 #else
 #include <fold_vars.h>
 #include <fold.h>
@@ -30,19 +33,55 @@
 #include "cache_util.h"
 #include "globals.h"
 
+/* parallel trajectories need OpenMP, the ordered output stream of RNAlib v3.0 and erand48() */
+#if defined(_OPENMP) && HAVE_LIBRNA_API3 && HAVE_ERAND48
+# include <omp.h>
+# define WITH_JOBS 1
+/* number of trajectories per thread whose output may be buffered */
+# define OUTPUT_PER_JOB 4
+#else
+# define WITH_JOBS 0
+#endif
+
 static char UNUSED rcsid[] ="$Id: main.c,v 1.5 2008/08/28 09:40:55 ivo Exp $";
 extern void  read_parameter_file(const char fname[]);
 extern void get_from_cache(cache_entry *c);
 
+/* output of a trajectory simulated in parallel */
+typedef struct {
+  FILE *out;
+  FILE *log;
+#if HAVE_OPEN_MEMSTREAM
+  char *out_buf;
+  char *log_buf;
+  size_t out_size;
+  size_t log_size;
+#endif
+} traj_output;
+
 /* PRIVAT FUNCTIONS */
 static void ini_energy_model(void);
 static void read_data(void);
 static void clean_up(void);
+static void trajectory_seed(unsigned short subi[3], const unsigned short seed[3], int i);
+static void simulate(int i, const char *start, const unsigned short seed[3]);
+static void log_statistics(const traj_stats *stats);
+#if WITH_JOBS
+static void simulate_parallel(const char *start, const unsigned short seed[3],
+                              traj_stats *stats);
+static char *copy_buffer(const char *s);
+static void ini_thread(void);
+static void clean_up_thread(void);
+static traj_output *open_output(void);
+static void flush_output(void *auxdata, unsigned int i, void *data);
+#endif
 
 /**/
 int main(int argc, char *argv[]) {
   int i;
-  char * start, *tmp;
+  char * start, *tmp, logFN[256];
+  unsigned short seed[3];
+  traj_stats *stats;
   
   /*
     process command-line optiones
@@ -70,65 +109,330 @@ int main(int argc, char *argv[]) {
   free(tmp);
 #endif
 
+  /*
+    energies of start and stop structure(s)
+  */
+  ini_start_stop();
+
+  /* open log-file */
+  GAV.logFP = fopen(strcat(strcpy(logFN, GAV.BaseName), ".log"), "a+");
+  assert(GAV.logFP != NULL);
+
+  /* log initial condition */
+  log_prog_params(GAV.logFP);
+  log_start_stop(GAV.logFP);
+
+#if WITH_JOBS
+  if (GSV.jobs == 0) GSV.jobs = omp_get_num_procs();
+#else
+  if (GSV.jobs != 1)
+    fprintf(stderr, "WARNING: Kinfold was compiled without support for --jobs, "
+                    "simulating trajectories one after another\n");
+  GSV.jobs = 1;
+#endif
+
+  /* all trajectories share the cache of neighbourhoods */
+  initialize_cache(GSV.cacheSize, GSV.jobs);
+
   /*
     perform GSV.num simulations
   */
-    
   start = strdup(GAV.startform); /* remember startform for next run */
-  int rect; rect = GTV.rect; /* Backup and reset the recurrence time option for every simulation.  */
-  for (i = 0; i < GSV.num; i++) {
-    GTV.rect = rect;
-    /*
-      initialize or reset ringlist to start conditions
-    */
-    ini_or_reset_rl();
-    if (GSV.grow>0) {
-      if (strlen(GAV.farbe)>GSV.glen) {
-        start[GSV.glen] = '\0';
-        GAV.farbe[GSV.glen] = '\0';
-        strcpy(GAV.startform,start);
-        strcpy(GAV.currform,start);
-        GSV.len=GSV.glen;
-#if HAVE_LIBRNA_API3
-        GAV.vc->length = GSV.len;
-#endif
-      }
-      clean_up_rl();
-      ini_or_reset_rl();
-    }
+  memcpy(seed, GAV.subi, sizeof(seed));
+  stats = (traj_stats *)calloc(GSV.num > 0 ? GSV.num : 1, sizeof(traj_stats));
+  assert(stats != NULL);
 
-    /*
-      perform simulation
-    */
-    for (GSV.steps = 1;; GSV.steps++) {
-      cache_entry *c;
-
-      /*
-	take neighbourhood of current structure from cache if there
-	else generate it from scratch
-      */
-      if ( (c = lookup_cache(GAV.currform)) ) get_from_cache(c);
-      else move_it();
-	
-      /*
-	select a structure from neighbourhood of current structure
-	and make it to the new current structure.
-	stop simulation if stop condition is met.
-      */
-      if ( sel_nb() > 0 ) break;
-
-      /* if (GSV.grow>0) grow_chain(); */
-    }
+#if WITH_JOBS
+  if ((GSV.jobs > 1) && (GSV.num > 1))
+    simulate_parallel(start, seed, stats);
+  else
+#endif
+  for (i = 0; i < GSV.num; i++) {
+    simulate(i, start, seed);
+    last_trajectory(stats + i);
   }
+
+  log_statistics(stats);
+  log_cache(GAV.logFP);
   
   /*
     clean up memory
   */
+  free(stats);
   free(start);
   clean_up();
   return(0);
 }
 
+/*
+  random number seed of trajectory i. the first trajectory uses the
+  seed as given, all others a seed derived from it and the trajectory
+  number, so results do not depend on the number of parallel jobs
+*/
+static void trajectory_seed(unsigned short subi[3], const unsigned short seed[3], int i) {
+  uint64_t x;
+
+  if (i == 0) {
+    memcpy(subi, seed, 3*sizeof(unsigned short));
+    return;
+  }
+
+  /* splitmix64 */
+  x = (uint64_t)seed[0] | ((uint64_t)seed[1] << 16) | ((uint64_t)seed[2] << 32);
+  x += (uint64_t)i * 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+
+  subi[0] = (unsigned short)x;
+  subi[1] = (unsigned short)(x >> 16);
+  subi[2] = (unsigned short)(x >> 32);
+}
+
+/* simulate trajectory i */
+static void simulate(int i, const char *start, const unsigned short seed[3]) {
+
+  trajectory_seed(GAV.subi, seed, i);
+  memcpy(GAV.rng, GAV.subi, sizeof(GAV.rng));
+#if !HAVE_ERAND48
+  xsubi[0] = GAV.subi[0];
+  xsubi[1] = GAV.subi[1];
+  xsubi[2] = GAV.subi[2];
+#endif
+
+  /* reset the recurrence time option for every simulation */
+  GSV.rect = GTV.rect;
+  /*
+    initialize or reset ringlist to start conditions
+  */
+  if (GSV.grow>0) {
+    /* the last trajectory may have stopped right after the chain grew */
+    clean_up_rl();
+    if (strlen(GAV.farbe)>GSV.glen) {
+      GAV.farbe[GSV.glen] = '\0';
+      strncpy(GAV.startform, start, GSV.glen);
+      GAV.startform[GSV.glen] = '\0';
+      strcpy(GAV.currform, GAV.startform);
+      GSV.len=GSV.glen;
+#if HAVE_LIBRNA_API3
+      GAV.vc->length = GSV.len;
+#endif
+    }
+  }
+  ini_or_reset_rl();
+
+  /*
+    perform simulation
+  */
+  for (GSV.steps = 1;; GSV.steps++) {
+    cache_entry *c;
+
+    /*
+      take neighbourhood of current structure from cache if there
+      else generate it from scratch
+    */
+    if ( (c = lookup_cache(GAV.currform)) ) {
+      get_from_cache(c);
+      release_cache(c);
+    }
+    else move_it();
+
+    /*
+      select a structure from neighbourhood of current structure
+      and make it to the new current structure.
+      stop simulation if stop condition is met.
+    */
+    if ( sel_nb() > 0 ) break;
+
+    /* if (GSV.grow>0) grow_chain(); */
+  }
+}
+
+/* statistics over all trajectories go to the log */
+static void log_statistics(const traj_stats *stats) {
+  int i, n = 0;
+  double mean = 0.0, var = 0.0, sumK = 0.0, sumKK = 0.0, sumD = 0.0, time = 0.0;
+
+  for (i = 0; i < GSV.num; i++) {
+    if (stats[i].stop > 0) {
+      n++;
+      mean += stats[i].time;
+    }
+    time  += stats[i].time;
+    sumK  += stats[i].sumK;
+    sumKK += stats[i].sumKK;
+    sumD  += stats[i].sumD;
+  }
+
+  if (n > 0) {
+    mean /= n;
+    for (i = 0; i < GSV.num; i++)
+      if (stats[i].stop > 0)
+        var += (stats[i].time - mean) * (stats[i].time - mean);
+    var = (n > 1) ? var / (n - 1) : 0.0;
+  }
+
+  fprintf(GAV.logFP, "#Statistics: num=%d reached=%d", GSV.num, n);
+  if (n > 0) fprintf(GAV.logFP, " fpt_mean=%.3f fpt_sd=%.3f", mean, sqrt(var));
+  fprintf(GAV.logFP, "\n");
+
+  /* laplace stuff, pooled over all trajectories */
+  if (GTV.phi && (time > 0)) {
+    double K, KK, N;
+    K = sumK/time;
+    KK = sumKK/time;
+    N = sumD/time;
+    fprintf(GAV.logFP, "#Statistics: phi=%g sigma=%7.5f\n",
+            GSV.phi, -1.0*sqrt((KK-K*K)/N)/(K/N));
+  }
+}
+
+#if WITH_JOBS
+/*
+  simulate trajectories in parallel. each thread has its own copy of the
+  global state, the output of each trajectory is buffered and printed in
+  the order of trajectories. at most OUTPUT_PER_JOB * jobs trajectories
+  are buffered, a thread that runs too far ahead waits in
+  vrna_ostream_request() until the output of earlier trajectories has
+  been printed. without thread support in the library the stream can't
+  block, so all trajectories are requested up front instead
+*/
+static void simulate_parallel(const char *start, const unsigned short seed[3],
+                              traj_stats *stats) {
+  int i, bounded;
+  FILE *outFP, *logFP;
+  vrna_ostream_t queue;
+
+  outFP = GAV.outFP;
+  logFP = GAV.logFP;
+  bounded = vrna_ostream_threadsafe();
+  queue = vrna_ostream_init_bounded(&flush_output, (void *)logFP,
+                                    bounded ? OUTPUT_PER_JOB * GSV.jobs : GSV.num);
+  if (!bounded)
+    for (i = 0; i < GSV.num; i++)
+      vrna_ostream_request(queue, i);
+
+#pragma omp parallel num_threads(GSV.jobs) copyin(GSV, GAV)
+  {
+    int j;
+    traj_output *o;
+
+    if (omp_get_thread_num() > 0) ini_thread();
+    /* the master thread must not modify its buffers before all threads copied them */
+#pragma omp barrier
+
+#pragma omp for schedule(dynamic, 1)
+    for (j = 0; j < GSV.num; j++) {
+      /* the earliest unprinted trajectory is always running, so this can't deadlock */
+      if (bounded)
+        vrna_ostream_request(queue, j);
+      o = open_output();
+      GAV.outFP = o->out;
+      GAV.logFP = o->log;
+      simulate(j, start, seed);
+      last_trajectory(stats + j);
+#pragma omp critical (kinfold_output)
+      vrna_ostream_provide(queue, j, (void *)o);
+    }
+
+    clean_up_rl();
+    clean_up_nbList();
+    if (omp_get_thread_num() > 0) clean_up_thread();
+  }
+
+  vrna_ostream_free(queue);
+  GAV.outFP = outFP;
+  GAV.logFP = logFP;
+}
+
+/* full length copy of a sequence or structure buffer */
+static char *copy_buffer(const char *s) {
+  char *c;
+
+  c = (char *)calloc(strlen(GAV.farbe_full)+1, sizeof(char));
+  assert(c != NULL);
+  strcpy(c, s);
+  return c;
+}
+
+/* private copies of the data a thread modifies during simulation */
+static void ini_thread(void) {
+  char *tmp;
+
+  GAV.farbe     = copy_buffer(GAV.farbe);
+  GAV.startform = copy_buffer(GAV.startform);
+  GAV.currform  = copy_buffer(GAV.currform);
+  GAV.prevform  = copy_buffer(GAV.prevform);
+
+  tmp     = vrna_cut_point_insert(GAV.farbe, cut_point);
+  GAV.vc  = vrna_fold_compound(tmp, &(GAV.md), VRNA_OPTION_EVAL_ONLY);
+  free(tmp);
+}
+
+/**/
+static void clean_up_thread(void) {
+  free(GAV.farbe);
+  free(GAV.startform);
+  free(GAV.currform);
+  free(GAV.prevform);
+  vrna_fold_compound_free(GAV.vc);
+}
+
+/**/
+static traj_output *open_output(void) {
+  traj_output *o;
+
+  o = (traj_output *)calloc(1, sizeof(traj_output));
+  assert(o != NULL);
+#if HAVE_OPEN_MEMSTREAM
+  o->out = open_memstream(&(o->out_buf), &(o->out_size));
+  o->log = open_memstream(&(o->log_buf), &(o->log_size));
+#else
+  o->out = tmpfile();
+  o->log = tmpfile();
+#endif
+  if ((o->out == NULL) || (o->log == NULL)) {
+    fprintf(stderr, "failed to create temporary output stream\n");
+    exit(EXIT_FAILURE);
+  }
+  return o;
+}
+
+/* print buffered output of trajectory i to stdout and the log-file */
+static void flush_output(void *auxdata, unsigned int i, void *data) {
+  traj_output *o = (traj_output *)data;
+  FILE *logFP = (FILE *)auxdata;
+
+  if (o == NULL) return;
+
+#if HAVE_OPEN_MEMSTREAM
+  fclose(o->out);
+  fclose(o->log);
+  fwrite(o->out_buf, sizeof(char), o->out_size, stdout);
+  fwrite(o->log_buf, sizeof(char), o->log_size, logFP);
+  free(o->out_buf);
+  free(o->log_buf);
+#else
+  {
+    char buf[4096];
+    size_t n;
+
+    rewind(o->out);
+    while ((n = fread(buf, sizeof(char), sizeof(buf), o->out)) > 0)
+      fwrite(buf, sizeof(char), n, stdout);
+    rewind(o->log);
+    while ((n = fread(buf, sizeof(char), sizeof(buf), o->log)) > 0)
+      fwrite(buf, sizeof(char), n, logFP);
+    fclose(o->out);
+    fclose(o->log);
+  }
+#endif
+  fflush(stdout);
+  fflush(logFP);
+  free(o);
+}
+#endif
+
 /**/
 static void ini_energy_model(void) {
 
@@ -255,6 +559,8 @@ static void read_data(void) {
 
 /**/
 void clean_up(void) {
+  fprintf(GAV.logFP,"\n");
+  fclose(GAV.logFP);
   clean_up_globals();
   clean_up_rl();
   clean_up_nbList();
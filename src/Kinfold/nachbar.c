@@ -26,12 +26,35 @@
 
 #include "cache_util.h"
 #include "baum.h"
+#include "nachbar.h"
 
 static char UNUSED rcsid[]="$Id: nachbar.c,v 1.8 2008/06/03 21:55:11 ivo Exp $";
 
+/*
+  moves are kept per loop, i.e. group 0 holds the moves of the exterior
+  loop and group i the moves of the loop closed by the pair (i,j), see
+  move_it() in baum.c. Concatenating the groups yields the neighbor list
+  in its usual order. Only the groups of loops that changed in the last
+  step are regenerated, and the next move is selected through a binary
+  indexed tree over the total rates of the groups.
+*/
+typedef struct {
+  int num;        /* number of moves */
+  int size;       /* allocated number of moves */
+  short *moves;   /* move coding, 2 entries per move */
+  int *dE;        /* energy changes in dcal/mol */
+  float *rates;   /* rates of the moves */
+  double *cum;    /* cumulative rates */
+  double sum_dE;  /* sum of energy changes (laplace stuff) */
+  int neg;        /* number of moves with dE < 0 */
+  int zero;       /* number of moves with dE == 0 */
+  int invalid;    /* moves need to be regenerated ? */
+} nb_group;
+
 /* arrays */
-static short *neighbor_list=NULL;
-static float *bmf=NULL; /* boltzmann weight of structure */
+static nb_group *groups=NULL;
+static double *fenwick=NULL;   /* binary indexed tree of group fluxes */
+static int *invalid=NULL;      /* stack of groups to be regenerated */
 static const char *costring(const char *str);
 
 /* globals for laplace stuff */
@@ -41,83 +64,133 @@ static double sumT = 0.0;
 static double sumK = 0.0;
 static double sumKK = 0.0;
 static double sumD = 0.0;
-static double *energies=NULL; /* energies of neighbors */
 
 /* variables */
 /*  static double highestE = -1000.0; */
 /*  static double OhighestE = -1000.0; */
 /*  static char *highestS, *OhighestS; */
 static int lmin = 1;
-static int top = 0;
+static int top = 0;            /* total number of moves */
+static int neg = 0;            /* total number of moves with dE < 0 */
+static int zero = 0;           /* total number of moves with dE == 0 */
+static double sum_dE = 0.0;    /* total sum of energy changes */
+static int max_groups = 0;
+static int num_groups = 0;
+static int fenwick_step = 0;   /* highest power of 2 <= num_groups */
+static int num_invalid = 0;
+static nb_group *curr = NULL;  /* group currently (re)generated */
+static int currE = 0;          /* energy of current structure in dcal/mol */
 static int is_from_cache = 0;
 /*  static double meanE = 0.0; */
 static double totalflux = 0.0;
 static double Zeit = 0.0;
 static double zeitInc = 0.0;
 static double _RT = 0.6;
+static traj_stats last;        /* summary of last trajectory */
+#ifdef _OPENMP
+#pragma omp threadprivate(groups, fenwick, invalid, L, D, sumT, sumK, sumKK, sumD, \
+                          lmin, top, neg, zero, sum_dE, max_groups, num_groups, fenwick_step, \
+                          num_invalid, curr, currE, is_from_cache, totalflux, Zeit, zeitInc, _RT, last)
+#endif
 
 /* public functiones */
-void ini_nbList(int chords);
+void ini_nbList(int n);
+void reset_nbList(void);
+void invalidate_nbList(int g);
+int next_invalid_nbList(void);
+void begin_nbList(int g);
 void update_nbList(int i, int j, int iE);
+void end_nbList(void);
 int sel_nb(void);
 void clean_up_nbList(void);
+void last_trajectory(traj_stats *t);
 extern void update_tree(int i, int j);
 
 /* privat functiones */
-static void reset_nbList(void);
-static void grow_chain(void);
-static FILE *logFP=NULL;
+static void add_move(int i, int j, int dE, float p);
+static double group_flux(int g);
+static void update_fenwick(int g);
+static double total_flux(void);
+static short *select_move(double x);
+static int grow_chain(void);
+static double traj_urn(void);
 
 /**/
-void ini_nbList(int chords) {
-  char logFN[256];
+void ini_nbList(int n) {
 
   _RT = (((temperature + K0) * GASCONST) / 1000.0);
-  if (neighbor_list!=NULL) return;
+  if (groups!=NULL) return;
   /*
-    list for move coding
-    make room for 2*chords neighbors (safe bet)
+    one group of moves for the exterior loop and
+    one for each possible pair (i,j), n is the maximal sequence length
   */
-  if (chords == 0) chords = 1;
-  neighbor_list = (short *)calloc(4*chords, sizeof(short));
-  assert(neighbor_list != NULL);
-  /*
-    list for Boltzmann-factors
-  */
-  bmf = (float *)calloc(2*chords, sizeof(double));
-  assert(bmf != NULL);
+  max_groups = n+1;
+  groups = (nb_group *)calloc(max_groups, sizeof(nb_group));
+  assert(groups != NULL);
+  fenwick = (double *)calloc(max_groups+1, sizeof(double));
+  assert(fenwick != NULL);
+  invalid = (int *)calloc(max_groups, sizeof(int));
+  assert(invalid != NULL);
+}
 
-  /* list of neighbor energies */
-  energies = (double*)calloc(2*chords, sizeof(double));
-  assert(energies != NULL);
-  
-  /* open log-file */
-  logFP = fopen(strcat(strcpy(logFN, GAV.BaseName), ".log"), "a+");
-  assert(logFP != NULL);
+/* forget all moves, e.g. for a new start structure */
+void reset_nbList(void) {
+  int g;
+
+  num_groups = GSV.len+1;
+  assert(num_groups <= max_groups);
+  for (fenwick_step = 1; 2*fenwick_step <= num_groups; fenwick_step *= 2);
+
+  for (g = 0; g < num_groups; g++) {
+    groups[g].num = groups[g].neg = groups[g].zero = 0;
+    groups[g].sum_dE = 0.0;
+    groups[g].invalid = 0;
+    fenwick[g+1] = 0.0;
+  }
+  top = neg = zero = 0;
+  sum_dE = 0.0;
+  lmin = 1;
+  num_invalid = 0;
+
+  for (g = 0; g < num_groups; g++) invalidate_nbList(g);
+}
+
+/* mark the moves of loop g for regeneration */
+void invalidate_nbList(int g) {
+  if (groups[g].invalid) return;
+  groups[g].invalid = 1;
+  invalid[num_invalid++] = g;
+}
+
+/* returns next group to be regenerated or -1 */
+int next_invalid_nbList(void) {
+  int g;
+
+  if (num_invalid == 0) return -1;
+  g = invalid[--num_invalid];
+  groups[g].invalid = 0;
+  return g;
+}
 
-  /* log initial condition */
-  log_prog_params(logFP);
-  log_start_stop(logFP);
+/* start to (re)generate the moves of loop g */
+void begin_nbList(int g) {
+  curr = &groups[g];
+  top    -= curr->num;
+  neg    -= curr->neg;
+  zero   -= curr->zero;
+  sum_dE -= curr->sum_dE;
+  curr->num = curr->neg = curr->zero = 0;
+  curr->sum_dE = 0.0;
+  currE = (int) (GSV.currE*100 + ((GSV.currE<0)?-0.4:0.4));
 }
 
 /**/
 void update_nbList(int i, int j, int iE) {
-  double E, dE, p;
+  double dE, p;
 
-  E = (double)iE/100.;
-  neighbor_list[2*top] = (short )i;
-  neighbor_list[2*top+1] = (short )j;
-  
-  /* compute rates and some statistics */
-  /*    meanE += E; */
-  dE = E-GSV.currE;
+  /* compute rates */
+  dE = (double)(iE-currE)/100.;
 
-  /* laplace stuff */
-  energies[top] = E;
-  L += GSV.currE-E;
-  D++;
-  /* fprintf(stderr, ">>%g %g<<\n", L, D); */
-  
   if( GTV.mc ) {
     /* metropolis rule */
     if (dE < 0) p = 1;
@@ -126,45 +199,149 @@ void update_nbList(int i, int j, int iE) {
   else  /* kawasaki rule */
     p = exp(-0.5 * (dE / _RT*GSV.phi));
 
-  totalflux += p;
-  bmf[top++] = (float )p;
-  if (dE < 0) lmin = 0;
-  if ((dE == 0) && (lmin==1)) lmin = 2;
+  add_move(i, j, iE-currE, (float )p);
+}
+
+/* finish the group started by begin_nbList() */
+void end_nbList(void) {
+  int g;
+
+  g = curr - groups;
+  top    += curr->num;
+  neg    += curr->neg;
+  zero   += curr->zero;
+  sum_dE += curr->sum_dE;
+  update_fenwick(g);
+  curr = NULL;
+}
+
+/**/
+static void add_move(int i, int j, int dE, float p) {
+  int k;
+
+  if (curr->num == curr->size) {
+    curr->size = (curr->size > 0) ? 2*curr->size : 16;
+    curr->moves = (short *)realloc(curr->moves, 2*curr->size*sizeof(short));
+    curr->dE = (int *)realloc(curr->dE, curr->size*sizeof(int));
+    curr->rates = (float *)realloc(curr->rates, curr->size*sizeof(float));
+    curr->cum = (double *)realloc(curr->cum, curr->size*sizeof(double));
+    assert(curr->moves && curr->dE && curr->rates && curr->cum);
+  }
+
+  k = curr->num++;
+  curr->moves[2*k] = (short )i;
+  curr->moves[2*k+1] = (short )j;
+  curr->dE[k] = dE;
+  curr->rates[k] = p;
+  curr->cum[k] = ((k > 0) ? curr->cum[k-1] : 0.0) + p;
+
+  /* some statistics */
+  curr->sum_dE += dE;
+  if (dE < 0) curr->neg++;
+  if (dE == 0) curr->zero++;
+}
+
+/**/
+static double group_flux(int g) {
+  return (groups[g].num > 0) ? groups[g].cum[groups[g].num-1] : 0.0;
+}
+
+/*
+  update flux of group g in the binary indexed tree. the nodes are summed
+  up from their children rather than updated by differences, so rounding
+  errors do not accumulate over many steps
+*/
+static void update_fenwick(int g) {
+  int k, c;
+  double s;
+
+  for (k = g+1; k <= num_groups; k += k & -k) {
+    s = group_flux(k-1);
+    for (c = 1; c < (k & -k); c *= 2) s += fenwick[k-c];
+    fenwick[k] = s;
+  }
+}
+
+/* sum of all rates */
+static double total_flux(void) {
+  int k;
+  double s = 0.0;
+
+  for (k = num_groups; k > 0; k -= k & -k) s += fenwick[k];
+  return s;
+}
+
+/* select move with cumulative rate > x, returns NULL if there is none */
+static short *select_move(double x) {
+  int g, k, lo, hi, pos = 0, step;
+  nb_group *grp;
+
+  /* find group ... */
+  for (step = fenwick_step; step > 0; step /= 2) {
+    if ((pos+step <= num_groups) && (fenwick[pos+step] <= x)) {
+      pos += step;
+      x -= fenwick[pos];
+    }
+  }
+
+  /* ... in case of rounding errors take the last move */
+  if (pos == num_groups) {
+    for (g = num_groups-1; (g >= 0) && (groups[g].num == 0); g--);
+    if (g < 0) return NULL;
+    return groups[g].moves + 2*(groups[g].num-1);
+  }
+
+  /* ... and move within the group */
+  grp = &groups[pos];
+  for (lo = 0, hi = grp->num-1; lo < hi;) {
+    k = (lo+hi)/2;
+    if (grp->cum[k] > x) hi = k;
+    else lo = k+1;
+  }
+  return grp->moves + 2*lo;
 }
 
 /**/
 void get_from_cache(cache_entry *c) {
-  top = c->top;
-  totalflux = c->flux;
+  int g, k;
+
   GSV.currE = c->energy;
-  lmin = c->lmin;
-  memcpy(neighbor_list, c->neighbors, 2*top*sizeof(short));
-  memcpy(bmf, c->rates, top*sizeof(float));
-  memcpy(energies, c->energies, top*sizeof(double));
+  /* restore the groups of loops that changed in the last step */
+  while ((g = next_invalid_nbList()) >= 0) {
+    begin_nbList(g);
+    for (k = c->offsets[g]; k < c->offsets[g+1]; k++)
+      add_move(c->neighbors[2*k], c->neighbors[2*k+1], c->dE[k], c->rates[k]);
+    end_nbList();
+  }
   is_from_cache = 1;
 }
 
 /**/
 void put_in_cache(void) {
   cache_entry *c;
+  nb_group *grp;
+  int g, k;
 
   if ((c = (cache_entry *) malloc(sizeof(cache_entry)))==NULL) {
     fprintf(stderr, "out of memory\n"); exit(255);
   }
-/*    c->structure = strdup(GAV.currform); */
-  c->structure = (char *) calloc(GSV.len+1, sizeof(char));
-  strcpy(c->structure, GAV.currform);
+  c->offsets = (int *) malloc((num_groups+1)*sizeof(int));
   c->neighbors = (short *) malloc(top*2*sizeof(short));
-  memcpy(c->neighbors,neighbor_list,top*2*sizeof(short));
   c->rates = (float *) malloc(top*sizeof(float));
-  memcpy(c->rates, bmf, top*sizeof(float));
-  c->energies = (double*)malloc(top*sizeof(double));
-  memcpy(c->energies, energies, top*sizeof(double));
+  c->dE = (int *) malloc(top*sizeof(int));
+  for (k = 0, g = 0; g < num_groups; g++) {
+    grp = &groups[g];
+    c->offsets[g] = k;
+    if (grp->num == 0) continue;
+    memcpy(c->neighbors+2*k, grp->moves, grp->num*2*sizeof(short));
+    memcpy(c->rates+k, grp->rates, grp->num*sizeof(float));
+    memcpy(c->dE+k, grp->dE, grp->num*sizeof(int));
+    k += grp->num;
+  }
+  c->offsets[num_groups] = k;
   c->top = top;
-  c->lmin = lmin;
-  c->flux = totalflux;
   c->energy = GSV.currE;
-  write_cache(c);
+  write_cache(GAV.currform, c);
 }
 
 /*============*/
@@ -172,24 +349,25 @@ void put_in_cache(void) {
 int sel_nb(void) {
 
   char trans, **s;
-  int next, i;
-  double pegel = 0.0, schwelle = 0.0, zufall = 0.0;
-  int found_stop=0;
+  short *next;
+  double schwelle = 0.0, zufall = 0.0;
+  int found_stop=0, grown=0;
 
   /* before we select a move, store current conformation in cache */
   /* ... unless it just came from there */
   if ( !is_from_cache ) put_in_cache();
-  else
-    /* laplace stuff */
-    for (i=0; i<top; i++) {
-      L += (GSV.currE - energies[i]);
-      D++;
-    }
   is_from_cache = 0;
 
+  totalflux = total_flux();
+  lmin = (neg > 0) ? 0 : ((zero > 0) ? 2 : 1);
+
+  /* laplace stuff */
+  L -= sum_dE/100.;
+  D += top;
+
   /* draw 2 different a random number */
-  schwelle = urn();
-  while ( zufall==0 ) zufall = urn();
+  schwelle = traj_urn();
+  while ( zufall==0 ) zufall = traj_urn();
 
   /* advance internal clock */
   if (totalflux>0)
@@ -206,21 +384,15 @@ int sel_nb(void) {
   sumKK += L*L*zeitInc;
   sumD  += D*zeitInc;
   
-  if (GSV.grow>0 && GSV.len < strlen(GAV.farbe_full)) grow_chain();
+  if (GSV.grow>0 && GSV.len < strlen(GAV.farbe_full)) grown = grow_chain();
 
   /* meanE /= (double)top; */
 
   /* normalize boltzmann weights */
   schwelle *=totalflux;
 
-  /* and choose a neighbour structure next */
-  for (next = 0; next < top; next++) {
-    pegel += bmf[next];
-    if (pegel > schwelle) break;
-  }
-
-  /* in case of rounding errors */
-  if (next==top) next=top-1;
+  /* and choose a neighbour structure next, unless the chain has grown */
+  next = (grown) ? NULL : select_move(schwelle);
 
   /*
     process termination contitiones
@@ -234,8 +406,8 @@ int sel_nb(void) {
   }
 
   /* Recurrence time: Ignore when you observe the start structure for the first time. */
-  if ((found_stop > 0) && (GTV.rect == 1) && (strcmp(GAV.startform, GAV.currform) == 0)) {
-    GTV.rect = 0; found_stop = 0;
+  if ((found_stop > 0) && (GSV.rect == 1) && (strcmp(GAV.startform, GAV.currform) == 0)) {
+    GSV.rect = 0; found_stop = 0;
   }
 
   if ( ((found_stop > 0) && (GTV.fpt == 1)) || (Zeit > GSV.time) ) {
@@ -251,47 +423,49 @@ int sel_nb(void) {
     
     /* this goes to stdout */
     if ( !GTV.silent ) {
-      printf("%s  %6.2f %10.3f", costring(GAV.currform), GSV.currE, Zeit);
+      fprintf(GAV.outFP, "%s  %6.2f %10.3f", costring(GAV.currform), GSV.currE, Zeit);
 
       /* laplace stuff*/
-      if (GTV.phi) printf(" %8.3f %8.3f %3g", zeitInc, L, D); 
+      if (GTV.phi) fprintf(GAV.outFP, " %8.3f %8.3f %3g", zeitInc, L, D); 
 
-      if (GTV.verbose) printf(" %4d _ %d", top, lmin);
-      if (found_stop) printf(" X%d\n", found_stop);/* found a stop structure */
-      else printf(" O\n"); /* time for simulation is exceeded */
+      if (GTV.verbose) fprintf(GAV.outFP, " %4d _ %d", top, lmin);
+      if (found_stop) fprintf(GAV.outFP, " X%d\n", found_stop);/* found a stop structure */
+      else fprintf(GAV.outFP, " O\n"); /* time for simulation is exceeded */
 
       /* laplace stuff */
-      if (GTV.phi) printf("Curvature fluctuation sigma = %7.5f\n", sigma);
+      if (GTV.phi) fprintf(GAV.outFP, "Curvature fluctuation sigma = %7.5f\n", sigma);
 
-      fflush(stdout);
+      fflush(GAV.outFP);
     }
 
     /* this goes to log */
-    fprintf(logFP, "(%5hu %5hu %5hu)", GAV.subi[0], GAV.subi[1], GAV.subi[2]);
+    fprintf(GAV.logFP, "(%5hu %5hu %5hu)", GAV.subi[0], GAV.subi[1], GAV.subi[2]);
     /* comment log steps of simulation as well !!! %6.2f  round */
     if ( found_stop ) {
-      fprintf(logFP," X%02d %12.3f", found_stop, Zeit);
+      fprintf(GAV.logFP," X%02d %12.3f", found_stop, Zeit);
 
       /* laplace stuff */
-      if (GTV.phi) fprintf(logFP, " %3g %7.5f", GSV.phi, sigma);
+      if (GTV.phi) fprintf(GAV.logFP, " %3g %7.5f", GSV.phi, sigma);
 
-      fprintf(logFP,"\n");
+      fprintf(GAV.logFP,"\n");
     }
     else {
-      fprintf(logFP," O   %12.3f", Zeit);
+      fprintf(GAV.logFP," O   %12.3f", Zeit);
 
       /* laplace stuff */
-      if (GTV.phi) fprintf(logFP, " %3g %7.5f", GSV.phi, sigma);      
+      if (GTV.phi) fprintf(GAV.logFP, " %3g %7.5f", GSV.phi, sigma);      
 
-      fprintf(logFP," %d %s\n", lmin, costring(GAV.currform));
+      fprintf(GAV.logFP," %d %s\n", lmin, costring(GAV.currform));
     }
-    fflush(logFP);
+    fflush(GAV.logFP);
+
+    /* keep summary for statistics over all trajectories */
+    last.stop = (found_stop && GTV.fpt) ? found_stop : 0;
+    last.time = Zeit;
+    last.sumK = sumK;
+    last.sumKK = sumKK;
+    last.sumD = sumD;
 
-    /* set random number for next round */
-    GAV.subi[0] = xsubi[0];
-    GAV.subi[1] = xsubi[1];
-    GAV.subi[2] = xsubi[2];
-    
     Zeit = 0.0;
 
     /* reset laplace stuff for next trajectory */
@@ -303,7 +477,6 @@ int sel_nb(void) {
     D = 0.0;
     
     /*  highestE = OhighestE = -1000.0; */
-    reset_nbList();
     costring(NULL);
     return(1);
   }
@@ -316,21 +489,21 @@ int sel_nb(void) {
 	char format[64];
 	flag = 1;
 	sprintf(format, "%%-%ds %%6.2f %%10.3f", strlen(GAV.farbe_full)+1);
-	printf(format, costring(GAV.currform), GSV.currE, Zeit);
+	fprintf(GAV.outFP, format, costring(GAV.currform), GSV.currE, Zeit);
       }
 
       /* laplace stuff */
       if (GTV.phi) {
-	printf(" %8.3f %8.3f %3g", zeitInc, L, D);
+	fprintf(GAV.outFP, " %8.3f %8.3f %3g", zeitInc, L, D);
 	L = D = 0.0; /* reset L and D for next structure */
       }
 
       if ( flag && GTV.verbose ) {
 	int ii, jj;
-	if (next<0) trans='g'; /* growth */
+	if (next==NULL) trans='g'; /* growth */
 	else {
-	  ii = neighbor_list[2*next];
-	  jj = neighbor_list[2*next+1];
+	  ii = next[0];
+	  jj = next[1];
 	  if (abs(ii) < GSV.len) {
 	    if ((ii > 0) && (jj > 0)) trans = 'i';
 	    else if ((ii < 0) && (jj < 0)) trans = 'd';
@@ -341,9 +514,9 @@ int sel_nb(void) {
 	    else trans = 'D';
 	  }
 	}
-	printf(" %4d %c %d", top, trans, lmin);
+	fprintf(GAV.outFP, " %4d %c %d", top, trans, lmin);
       }
-      if (flag) printf("\n");
+      if (flag) fprintf(GAV.outFP, "\n");
     }
   }
 
@@ -380,42 +553,51 @@ int sel_nb(void) {
   }
 #endif
 
-  if (next>=0) update_tree(neighbor_list[2*next], neighbor_list[2*next+1]);
+  if (next!=NULL) update_tree(next[0], next[1]);
   else {
     clean_up_rl(); ini_or_reset_rl();
   }
 
-  reset_nbList();
   return(0);
 }
 
-/*==========================*/
-static void reset_nbList(void) {
+/*======================*/
+void clean_up_nbList(void){
+  int g;
 
-  top = 0;
-  totalflux = 0.0;
-  /*    meanE = 0.0; */
-  lmin = 1;
+  for (g = 0; g < max_groups; g++) {
+    free(groups[g].moves);
+    free(groups[g].dE);
+    free(groups[g].rates);
+    free(groups[g].cum);
+  }
+  free(groups); groups=NULL;
+  free(fenwick); fenwick=NULL;
+  free(invalid); invalid=NULL;
+  max_groups = 0;
 }
 
-/*======================*/
-void clean_up_nbList(void){
+/* summary of the last trajectory */
+void last_trajectory(traj_stats *t) {
+  *t = last;
+}
 
-  free(neighbor_list);
-  free(bmf);
-  free(energies);
-  fprintf(logFP,"\n");
-  fclose(logFP);
+/* uniform random number from the stream of the current trajectory */
+static double traj_urn(void) {
+#if HAVE_ERAND48
+  return erand48(GAV.rng);
+#else
+  return urn();
+#endif
 }
 
 /*======================*/
-static void grow_chain(void){
+static int grow_chain(void){
   int newl;
   /* note Zeit=0 corresponds to chain length GSV.glen */
-  if (Zeit<(GSV.len+1-GSV.glen) * GSV.grow) return;
+  if (Zeit<(GSV.len+1-GSV.glen) * GSV.grow) return 0;
   newl = GSV.len+1;
   Zeit = (newl-GSV.glen) * GSV.grow;
-  top=0; /* prevent structure move in sel_nb */
 
   if (GSV.len<newl) {
     strncpy(GAV.farbe, GAV.farbe_full, newl);
@@ -429,11 +611,15 @@ static void grow_chain(void){
     GAV.vc->length = newl;
 #endif
   }
+  return 1;
 }
 
 static const char *costring(const char *str) {
   static char* buffer=NULL;
   static int size=0;
+#ifdef _OPENMP
+#pragma omp threadprivate(buffer, size)
+#endif
   int n;
   if (str==NULL) {
     if (buffer) {
@@ -10,12 +10,26 @@
 #define NACHBAR_H
 
 /* used in baum.c */
-extern void ini_nbList(int chords);
+extern void ini_nbList(int n);
+extern void reset_nbList(void);
+extern void invalidate_nbList(int g);
+extern int next_invalid_nbList(void);
+extern void begin_nbList(int g);
 extern void update_nbList(int i,int j, int iE);
+extern void end_nbList(void);
+
+/* summary of a finished trajectory */
+typedef struct {
+  int stop;        /* number of stop structure reached, 0 if none */
+  double time;     /* simulation time */
+  double sumK;     /* laplace stuff */
+  double sumKK;
+  double sumD;
+} traj_stats;
 
 /* used in main.c */
 extern int sel_nb(void);
 extern void clean_up_nbList(void);
+extern void last_trajectory(traj_stats *t);
 
-extern void grow_chain(void);
 #endif
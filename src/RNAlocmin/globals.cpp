@@ -86,6 +86,11 @@ int Options::Init(gengetopt_args_info &args_info)
     ret = -1;
   }
 
+  if (args_info.numThreads_arg<=0) {
+    fprintf(stderr, "Number of threads should be positive integer\n");
+    ret = -1;
+  }
+
   if (args_info.minh_arg<0.0) {
     fprintf(stderr, "Depth of findpath search should be non-negative number\n");
     ret = -1;
@@ -454,18 +454,48 @@ int main(int argc, char **argv)
       }
 
       // findpath:
-      for (set<int>::iterator it=to_findpath.begin(); it!=to_findpath.end(); it++) {
-        set<int>::iterator it2=it;
-        it2++;
-        for (; it2!=to_findpath.end(); it2++) {
-          if (args_info.pseudoknots_flag) energy_barr[(*it2)*num+(*it)] = energy_barr[(*it)*num+(*it2)] = find_saddle_pk(seq, output_str[*it].c_str(), output_str[*it2].c_str(), args_info.depth_arg)/100.0;
-          else energy_barr[(*it2)*num+(*it)] = energy_barr[(*it)*num+(*it2)] = find_saddle(seq, output_str[*it].c_str(), output_str[*it2].c_str(), args_info.depth_arg)/100.0;
-          findpath_barr[(*it2)*num+(*it)] = findpath_barr[(*it)*num+(*it2)] = true;
-          if (args_info.verbose_lvl_arg>0 && findpath %10000==0){
-            fprintf(stderr, "Findpath:%7d/%7d\n", findpath, (int)(to_findpath.size()*(to_findpath.size()-1)/2));
+      if (args_info.pseudoknots_flag) {
+        for (set<int>::iterator it=to_findpath.begin(); it!=to_findpath.end(); it++) {
+          set<int>::iterator it2=it;
+          it2++;
+          for (; it2!=to_findpath.end(); it2++) {
+            energy_barr[(*it2)*num+(*it)] = energy_barr[(*it)*num+(*it2)] = find_saddle_pk(seq, output_str[*it].c_str(), output_str[*it2].c_str(), args_info.depth_arg)/100.0;
+            findpath_barr[(*it2)*num+(*it)] = findpath_barr[(*it)*num+(*it2)] = true;
+            if (args_info.verbose_lvl_arg>0 && findpath %10000==0){
+              fprintf(stderr, "Findpath:%7d/%7d\n", findpath, (int)(to_findpath.size()*(to_findpath.size()-1)/2));
+            }
+            findpath++;
+          }
+        }
+      } else if (to_findpath.size() > 1) {
+        // saddles of all pairs at once, possibly in parallel
+        vector<int> minima(to_findpath.begin(), to_findpath.end());
+        vector<const char*> structures;
+        for (unsigned int k=0; k<minima.size(); k++) structures.push_back(output_str[minima[k]].c_str());
+
+        model_detailsT md;
+        set_model_details(&md);
+        md.num_threads = args_info.numThreads_arg;
+
+        char *sequence = vrna_cut_point_insert(seq, cut_point);
+        vrna_fold_compound_t *fc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
+        free(sequence);
+
+        int m = (int)minima.size();
+        int *saddles = vrna_path_findpath_saddle_matrix(fc, &structures[0], m, args_info.depth_arg, VRNA_PATH_SADDLE_MATRIX_SYMMETRIC);
+
+        if (saddles) {
+          for (int a=0; a<m; a++) {
+            for (int b=a+1; b<m; b++) {
+              energy_barr[minima[b]*num+minima[a]] = energy_barr[minima[a]*num+minima[b]] = saddles[a*m+b]/100.0;
+              findpath_barr[minima[b]*num+minima[a]] = findpath_barr[minima[a]*num+minima[b]] = true;
+              findpath++;
+            }
           }
-          findpath++;
+          free(saddles);
         }
+
+        vrna_fold_compound_free(fc);
       }
 
       // debug output
@@ -37,6 +37,12 @@
  #################################
  */
 
+/* chunks for parallel scans span between CHUNK_MIN and CHUNK_MAX times their lead-in */
+#define PROBS_WINDOW_CHUNK_MIN    4
+#define PROBS_WINDOW_CHUNK_MAX    16
+/* number of nucleotides a chunk extends beyond the last window it is responsible for */
+#define PROBS_WINDOW_CHUNK_TAIL   2
+
 typedef struct {
   int           bpp_print;  /* 1 if pairing probabilities should be written to file-handle, 0 if they are returned as vrna_ep_t */
   int           up_print;   /* 1 if unpaired probabilities should be written to file-handle, 0 if they are returned as array */
@@ -64,6 +70,24 @@ typedef struct {
   double      **pUH;
 } helper_arrays;
 
+/* a single callback execution of a chunk, buffered for ordered replay */
+typedef struct {
+  unsigned int  type;
+  int           step;   /* iteration of the sliding window scan that emitted the data */
+  int           size;
+  int           i;
+  int           max;
+  int           first;  /* index of the first entry stored in pr */
+  FLT_OR_DBL    *pr;
+} chunk_record;
+
+typedef struct {
+  int           step;
+  chunk_record  *records;
+  size_t        num;
+  size_t        max_num;
+} chunk_buffer;
+
 /* soft constraint contributions function (interior-loops) */
 typedef FLT_OR_DBL (*sc_int)(vrna_fold_compound_t *,
                             int,
@@ -121,6 +145,42 @@ free_helper_arrays(vrna_fold_compound_t *vc,
                    unsigned int         options);
 
 
+PRIVATE int
+probs_window(vrna_fold_compound_t *vc,
+             int                  ulength,
+             unsigned int         options,
+             vrna_probs_window_f  cb,
+             void                 *data,
+             int                  *step);
+
+
+#ifdef _OPENMP
+
+PRIVATE int
+probs_window_chunk_threads(vrna_fold_compound_t *vc,
+                           int                  ulength);
+
+
+PRIVATE int
+probs_window_chunked(vrna_fold_compound_t *vc,
+                     int                  ulength,
+                     unsigned int         options,
+                     vrna_probs_window_f  cb,
+                     void                 *data,
+                     int                  num_threads);
+
+
+PRIVATE void
+buffer_chunk_callback(FLT_OR_DBL    *pr,
+                      int           pr_size,
+                      int           i,
+                      int           max,
+                      unsigned int  type,
+                      void          *data);
+
+
+#endif
+
 PRIVATE void
 compute_probs(vrna_fold_compound_t        *vc,
               int                         j,
@@ -678,6 +738,44 @@ vrna_probs_window(vrna_fold_compound_t        *vc,
                   unsigned int                options,
                   vrna_probs_window_f  cb,
                   void                        *data)
+{
+#ifdef _OPENMP
+  int num_threads;
+#endif
+
+  if ((!vc) || (!cb))
+    return 0; /* failure */
+
+  if (!vrna_fold_compound_prepare(vc, VRNA_OPTION_PF | VRNA_OPTION_WINDOW)) {
+    vrna_message_warning("vrna_probs_window: "
+                         "Failed to prepare vrna_fold_compound");
+    return 0; /* failure */
+  }
+
+#ifdef _OPENMP
+  num_threads = probs_window_chunk_threads(vc, ulength);
+
+  if (num_threads > 1)
+    return probs_window_chunked(vc, ulength, options, cb, data, num_threads);
+
+#endif
+
+  return probs_window(vc, ulength, options, cb, data, NULL);
+}
+
+
+/*
+ *  The actual sliding window scan. If step is not NULL, the current
+ *  iteration is reported through it, such that the chunked driver can
+ *  decide which chunk is responsible for the data passed to the callback.
+ */
+PRIVATE int
+probs_window(vrna_fold_compound_t *vc,
+             int                  ulength,
+             unsigned int         options,
+             vrna_probs_window_f  cb,
+             void                 *data,
+             int                  *step)
 {
   unsigned char       hc_decompose;
   int                 n, i, j, k, maxl, ov, winSize, pairSize, turn;
@@ -694,15 +792,6 @@ vrna_probs_window(vrna_fold_compound_t        *vc,
   ov    = 0;
   Qmax  = 0;
 
-  if ((!vc) || (!cb))
-    return 0; /* failure */
-
-  if (!vrna_fold_compound_prepare(vc, VRNA_OPTION_PF | VRNA_OPTION_WINDOW)) {
-    vrna_message_warning("vrna_probs_window: "
-                         "Failed to prepare vrna_fold_compound");
-    return 0; /* failure */
-  }
-
   /* here space for initializing everything */
 
   n         = vc->length;
@@ -763,6 +852,9 @@ vrna_probs_window(vrna_fold_compound_t        *vc,
 
   /* start recursions */
   for (j = 2; j <= n + winSize; j++) {
+    if (step)
+      *step = j;
+
     if (j <= n) {
       vrna_exp_E_ext_fast_update(vc, j, aux_mx_el);
       for (i = j - 1; i >= MAX2(1, (j - winSize + 1)); i--) {
@@ -900,6 +992,9 @@ vrna_probs_window(vrna_fold_compound_t        *vc,
   }   /* end for j */
 
   /* finish output */
+  if (step)
+    *step = n + winSize + 1;
+
   if (options & VRNA_PROBS_WINDOW_UP)
     for (j = MAX2(1, n - MAXLOOP); j <= n; j++)
       compute_pU(vc, j, ulength, &aux_arrays, cb, data, options);
@@ -953,6 +1048,215 @@ vrna_probs_window(vrna_fold_compound_t        *vc,
 }
 
 
+#ifdef _OPENMP
+
+/*
+ *  For parallel scans, the sequence is split into chunks that are processed
+ *  independently. Each chunk is responsible for a consecutive range of
+ *  iterations of the serial scan and is extended upstream by a lead-in that
+ *  covers all windows the probabilities reported in these iterations depend
+ *  on. Since the lead-in reproduces the very same windows, the data reported
+ *  by a chunk is identical to that of a serial scan. It is buffered and passed
+ *  to the callback in the same order as it would have been in serial mode.
+ */
+PRIVATE INLINE int
+chunk_lead(vrna_fold_compound_t *fc,
+           int                  ulength)
+{
+  return 3 * fc->window_size + MAXLOOP + MAX2(ulength, 0) + 2;
+}
+
+
+PRIVATE INLINE int
+chunk_span(vrna_fold_compound_t *fc,
+           int                  ulength,
+           int                  num_threads)
+{
+  int lead, span;
+
+  lead  = chunk_lead(fc, ulength);
+  span  = ((int)fc->length + num_threads - 1) / num_threads;
+  /* limit the amount of buffered data while keeping the overhead of the lead-in low */
+  span  = MIN2(span, PROBS_WINDOW_CHUNK_MAX * lead);
+  span  = MAX2(span, PROBS_WINDOW_CHUNK_MIN * lead);
+
+  return span;
+}
+
+
+PRIVATE int
+probs_window_chunk_threads(vrna_fold_compound_t *vc,
+                           int                  ulength)
+{
+  vrna_md_t *md = &(vc->exp_params->model_details);
+
+  /* constraints are specified in global coordinates and can't be distributed among chunks */
+  if ((md->num_threads > 1) &&
+      (vc->type == VRNA_FC_TYPE_SINGLE) &&
+      (vc->strands == 1) &&
+      (!vc->sc) &&
+      (!((vc->hc) && (vc->hc->depot))) &&
+      (!vc->domains_up) &&
+      (!vc->domains_struc) &&
+      ((int)vc->length > chunk_span(vc, ulength, md->num_threads) + chunk_lead(vc, ulength)))
+    return md->num_threads;
+
+  return 1;
+}
+
+
+PRIVATE int
+probs_window_chunked(vrna_fold_compound_t *vc,
+                     int                  ulength,
+                     unsigned int         options,
+                     vrna_probs_window_f  cb,
+                     void                 *data,
+                     int                  num_threads)
+{
+  char                  *seq;
+  int                   n, c, lead, span, num_chunks, failed, r, first_step, last_step,
+                        start, end, offset, step;
+  size_t                k;
+  FLT_OR_DBL            *pr;
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc;
+  chunk_buffer          buf;
+  chunk_record          *rec;
+
+  n           = (int)vc->length;
+  lead        = chunk_lead(vc, ulength);
+  span        = chunk_span(vc, ulength, num_threads);
+  num_chunks  = (n + span - 1) / span;
+  failed      = 0;
+
+  /* chunks are processed serially, each one by a single thread */
+  vrna_md_copy(&md, &(vc->exp_params->model_details));
+  md.num_threads = 1;
+
+#pragma omp parallel for ordered private(seq, r, first_step, last_step, start, end, offset, step, k, pr, fc, buf, rec) num_threads(num_threads) schedule(dynamic, 1)
+  for (c = 0; c < num_chunks; c++) {
+    /* chunk c is responsible for iterations first_step < j <= last_step of the serial scan */
+    first_step  = 1 + c * span;
+    last_step   = (c + 1 < num_chunks) ? 1 + (c + 1) * span : n + vc->window_size + 1;
+    start       = MAX2(1, first_step - lead);
+    end         = (c + 1 < num_chunks) ? MIN2(n, last_step + PROBS_WINDOW_CHUNK_TAIL) : n;
+    offset      = start - 1;
+
+    buf.step    = 0;
+    buf.records = NULL;
+    buf.num     = 0;
+    buf.max_num = 0;
+
+    seq = (char *)vrna_alloc(sizeof(char) * (end - start + 2));
+    memcpy(seq, vc->sequence + offset, sizeof(char) * (end - start + 1));
+
+    r   = 0;
+    fc  = vrna_fold_compound(seq, &md, VRNA_OPTION_WINDOW);
+
+    if (fc) {
+      /* use the exact same Boltzmann factors and scaling as the serial scan */
+      vrna_exp_params_subst(fc, vc->exp_params);
+
+      if (vrna_fold_compound_prepare(fc, VRNA_OPTION_PF | VRNA_OPTION_WINDOW))
+        r = probs_window(fc,
+                         ulength,
+                         options,
+                         &buffer_chunk_callback,
+                         (void *)&buf,
+                         &(buf.step));
+
+      vrna_fold_compound_free(fc);
+    }
+
+    free(seq);
+
+#pragma omp ordered
+    {
+      if (!r)
+        failed = 1;
+
+      for (k = 0; (!failed) && (k < buf.num); k++) {
+        rec   = buf.records + k;
+        step  = rec->step + offset;
+
+        if ((step > first_step) &&
+            (step <= last_step)) {
+          if (rec->type & VRNA_PROBS_WINDOW_UP) {
+            cb(rec->pr, rec->size, rec->i + offset, rec->max, rec->type, data);
+          } else {
+            pr = rec->pr - (rec->first + offset);
+            cb(pr,
+               (rec->type & VRNA_PROBS_WINDOW_STACKP) ? rec->size : rec->size + offset,
+               rec->i + offset,
+               rec->max,
+               rec->type,
+               data);
+          }
+        }
+      }
+    }
+
+    for (k = 0; k < buf.num; k++)
+      free(buf.records[k].pr);
+
+    free(buf.records);
+  }
+
+  return !failed;
+}
+
+
+PRIVATE void
+buffer_chunk_callback(FLT_OR_DBL    *pr,
+                      int           pr_size,
+                      int           i,
+                      int           max,
+                      unsigned int  type,
+                      void          *data)
+{
+  int           first, last;
+  chunk_buffer  *buf;
+  chunk_record  *rec;
+
+  buf = (chunk_buffer *)data;
+
+  if (buf->num == buf->max_num) {
+    buf->max_num  = 2 * buf->max_num + 64;
+    buf->records  = (chunk_record *)vrna_realloc(buf->records,
+                                                 sizeof(chunk_record) * buf->max_num);
+  }
+
+  /* determine the range of data passed through pr */
+  if (type & VRNA_PROBS_WINDOW_UP) {
+    first = 0;
+    last  = pr_size;
+  } else if (type & VRNA_PROBS_WINDOW_STACKP) {
+    first = i + 1;
+    last  = i + pr_size;
+  } else {
+    first = i;
+    last  = pr_size;
+  }
+
+  rec         = buf->records + buf->num++;
+  rec->type   = type;
+  rec->step   = buf->step;
+  rec->size   = pr_size;
+  rec->i      = i;
+  rec->max    = max;
+  rec->first  = first;
+  rec->pr     = NULL;
+
+  if (last >= first) {
+    rec->pr = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (last - first + 1));
+    memcpy(rec->pr, pr + first, sizeof(FLT_OR_DBL) * (last - first + 1));
+  }
+}
+
+
+#endif
+
+
 PRIVATE FLT_OR_DBL
 sc_contribution(vrna_fold_compound_t  *vc,
                 int                   i,
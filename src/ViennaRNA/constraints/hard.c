@@ -1006,6 +1006,13 @@ prepare_hc_bp(vrna_fold_compound_t  *fc,
           i         = ss[s] + actual_i - 1;         /* constraint position in current strand order */
           j         = ss[strand_j] + actual_j - 1;  /* constraint position in current strand order */
 
+          /* banded MFE matrices do not provide memory for pairs outside the band */
+          if ((fc->matrices) &&
+              (fc->matrices->type == VRNA_MX_BANDED) &&
+              (i < j) &&
+              (j - i >= fc->matrices->band))
+            continue;
+
           if (i < j) {
             /* apply the constraint */
             hc->mx[n * i + j] = option & VRNA_CONSTRAINT_CONTEXT_ALL_LOOPS;
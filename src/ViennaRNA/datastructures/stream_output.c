@@ -7,82 +7,202 @@
 #include <string.h>
 
 #if VRNA_WITH_PTHREADS
-# include <pthread.h>
+# include <sched.h>
+# include <time.h>
 #endif
 
 #include "ViennaRNA/utils/basic.h"
 #include "ViennaRNA/datastructures/stream_output.h"
 
-#ifdef __GNUC__
-# define INLINE inline
+/* maximum number of records passed to the output callback in one go */
+#define FLUSH_BATCH_SIZE  64
+
+/* number of yields before a producer waiting for a free slot starts to sleep */
+#define SPIN_LIMIT        64
+
+/*
+ *  Requesting, providing, and flushing data is done without locks. Since
+ *  the ordering of stores to the ring and the flusher flag is essential
+ *  to never miss a flush, we use sequentially consistent atomics throughout.
+ */
+#if VRNA_WITH_PTHREADS
+# define ATOMIC_LOAD(p)         __atomic_load_n((p), __ATOMIC_SEQ_CST)
+# define ATOMIC_STORE(p, v)     __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+# define ATOMIC_CAS(p, e, v)    __atomic_compare_exchange_n((p), (e), (v), 0, \
+                                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
 #else
-# define INLINE
+# define ATOMIC_LOAD(p)         (*(p))
+# define ATOMIC_STORE(p, v)     (*(p) = (v))
+# define ATOMIC_CAS(p, e, v)    ((*(p) == *(e)) ? (*(p) = (v), 1) : (*(e) = *(p), 0))
 #endif
 
-#define QUEUE_OVERHEAD  32
+
+struct stream_slot {
+  void  *data;                              /* data passed to the callback */
+  int   provided;                           /* whether the data is available */
+};
 
 
 struct vrna_ordered_stream_s {
-  unsigned int                start;      /* first element index in queue, i.e. start of queue */
-  unsigned int                end;        /* last element index in queue */
-  unsigned int                size;       /* available memory size for 'data' and 'provided' */
-  unsigned int                shift;      /* pointer offset for 'data' and 'provided' */
-
-  vrna_stream_output_f output;    /* callback to execute if consecutive elements from head are available */
-  void                        **data;     /* actual data passed to the callback */
-  unsigned char               *provided;  /* for simplicity we use unsigned char instead of single bits per element */
-  void                        *auxdata;   /* auxiliary data passed to the callback */
-#if VRNA_WITH_PTHREADS
-  pthread_mutex_t             mtx;        /* semaphore to provide concurrent access */
-#endif
+  vrna_stream_output_f  output;             /* callback to execute if consecutive elements from head are available */
+  void                  *auxdata;           /* auxiliary data passed to the callback */
+
+  struct stream_slot    *ring;              /* ring buffer of in-flight elements */
+  unsigned int          size;               /* size of the ring buffer, a power of 2 */
+  unsigned int          mask;               /* size - 1, to map element indices to ring positions */
+  unsigned int          max_in_flight;      /* maximum number of requested but not yet flushed elements */
+
+  unsigned int          start;              /* first element index in queue, i.e. start of queue */
+  unsigned int          end;                /* one past the last requested element index */
+  int                   flushing;           /* whether any thread currently flushes the queue */
 };
 
 
-PRIVATE INLINE void
+/*
+ *  Flush all consecutive blocks available from the start of queue.
+ *  Only one thread at a time becomes the flusher, all others simply
+ *  return and leave their data to the current flusher.
+ */
+PRIVATE void
 flush_output(struct vrna_ordered_stream_s *queue)
 {
-  unsigned int j;
+  int                 idle;
+  unsigned int        j, n, start, limit;
+  void                *batch[FLUSH_BATCH_SIZE];
+  struct stream_slot  *slot;
+
+  do {
+    start = ATOMIC_LOAD(&queue->start);
+
+    /* nothing to do if the start of queue is not yet available */
+    if (!ATOMIC_LOAD(&(queue->ring[start & queue->mask].provided)))
+      return;
+
+    idle = 0;
+    if (!ATOMIC_CAS(&queue->flushing, &idle, 1))
+      return;
+
+    /* we are the flusher now, process batches of consecutive elements */
+    limit = MIN2(FLUSH_BATCH_SIZE, queue->size);
+
+    do {
+      start = queue->start;
+
+      for (n = 0; n < limit; n++) {
+        slot = queue->ring + ((start + n) & queue->mask);
+        if (!ATOMIC_LOAD(&(slot->provided)))
+          break;
+
+        batch[n] = slot->data;
+      }
+
+      if (queue->output)
+        for (j = 0; j < n; j++)
+          queue->output(queue->auxdata, start + j, batch[j]);
 
-  /* flush all consecutive blocks available from the start of queue */
+      /* release the ring slots before the new start is published */
+      for (j = 0; j < n; j++) {
+        slot       = queue->ring + ((start + j) & queue->mask);
+        slot->data = NULL;
+        ATOMIC_STORE(&(slot->provided), 0);
+      }
+
+      ATOMIC_STORE(&queue->start, start + n);
+    } while (n == limit);
+
+    ATOMIC_STORE(&queue->flushing, 0);
+
+    /*
+     *  Another thread may have provided the new start of queue while
+     *  we were still flushing, so check again after dropping the flag
+     */
+  } while (1);
+}
 
-  /* 1. process output callback */
-  if (queue->output)
-    for (j = queue->start; (j <= queue->end) && (queue->provided[j]); j++)
-      queue->output(queue->auxdata, j, queue->data[j]);
 
-  /* 2. move start of queue */
-  while ((queue->start <= queue->end) && (queue->provided[queue->start]))
-    queue->start++;
+#if VRNA_WITH_PTHREADS
+PRIVATE void
+wait_for_slot(struct vrna_ordered_stream_s  *queue,
+              unsigned int                  num)
+{
+  unsigned int    spins;
+  struct timespec pause;
+
+  pause.tv_sec  = 0;
+  pause.tv_nsec = 50000;
 
-  /* 3. set empty queue condition if necessary */
-  if (queue->end < queue->start) {
-    queue->provided[queue->start] = 0;
-    queue->end                    = queue->start;
+  for (spins = 0; num - ATOMIC_LOAD(&queue->start) >= queue->max_in_flight; spins++) {
+    if (spins < SPIN_LIMIT)
+      sched_yield();
+    else
+      nanosleep(&pause, NULL);
   }
 }
 
 
-PUBLIC struct vrna_ordered_stream_s *
-vrna_ostream_init(vrna_stream_output_f output,
-                  void                        *auxdata)
+#else
+/*
+ *  Without threads, nobody else could ever flush the stream while we
+ *  wait for a free slot, so we enlarge the ring instead
+ */
+PRIVATE void
+grow_ring(struct vrna_ordered_stream_s  *queue,
+          unsigned int                  num)
 {
-  struct vrna_ordered_stream_s *queue;
+  unsigned int        i, size;
+  struct stream_slot  *ring;
 
-  queue = (struct vrna_ordered_stream_s *)vrna_alloc(sizeof(struct vrna_ordered_stream_s));
+  for (size = queue->size; size <= num - queue->start; size <<= 1);
+
+  ring = (struct stream_slot *)vrna_alloc(sizeof(struct stream_slot) * size);
+
+  for (i = queue->start; i != queue->end; i++)
+    ring[i & (size - 1)] = queue->ring[i & queue->mask];
+
+  free(queue->ring);
+
+  queue->ring = ring;
+  queue->size = size;
+  queue->mask = size - 1;
+}
 
-  queue->start    = 0;
-  queue->end      = 0;
-  queue->size     = QUEUE_OVERHEAD;
-  queue->shift    = 0;
-  queue->output   = output;
-  queue->auxdata  = auxdata;
-  queue->data     = (void **)vrna_alloc(sizeof(void *) * QUEUE_OVERHEAD);
-  queue->provided = (unsigned char *)vrna_alloc(sizeof(unsigned char) * QUEUE_OVERHEAD);
 
-#if VRNA_WITH_PTHREADS
-  pthread_mutex_init(&queue->mtx, NULL);
 #endif
 
+
+PUBLIC struct vrna_ordered_stream_s *
+vrna_ostream_init(vrna_stream_output_f  output,
+                  void                  *auxdata)
+{
+  return vrna_ostream_init_bounded(output, auxdata, VRNA_OSTREAM_DEFAULT_MAX_IN_FLIGHT);
+}
+
+
+PUBLIC struct vrna_ordered_stream_s *
+vrna_ostream_init_bounded(vrna_stream_output_f  output,
+                          void                  *auxdata,
+                          unsigned int          max_in_flight)
+{
+  unsigned int                  size;
+  struct vrna_ordered_stream_s  *queue;
+
+  if (max_in_flight == 0)
+    max_in_flight = VRNA_OSTREAM_DEFAULT_MAX_IN_FLIGHT;
+
+  for (size = 1; size < max_in_flight; size <<= 1);
+
+  queue = (struct vrna_ordered_stream_s *)vrna_alloc(sizeof(struct vrna_ordered_stream_s));
+
+  queue->output         = output;
+  queue->auxdata        = auxdata;
+  queue->ring           = (struct stream_slot *)vrna_alloc(sizeof(struct stream_slot) * size);
+  queue->size           = size;
+  queue->mask           = size - 1;
+  queue->max_in_flight  = max_in_flight;
+  queue->start          = 0;
+  queue->end            = 0;
+  queue->flushing       = 0;
+
   return queue;
 }
 
@@ -91,21 +211,9 @@ PUBLIC void
 vrna_ostream_free(struct vrna_ordered_stream_s *queue)
 {
   if (queue) {
-#if VRNA_WITH_PTHREADS
-    pthread_mutex_lock(&queue->mtx);
-#endif
-
     flush_output(queue);
 
-#if VRNA_WITH_PTHREADS
-    pthread_mutex_unlock(&queue->mtx);
-#endif
-
-    /* free remaining memory */
-    queue->data     += queue->shift;
-    queue->provided += queue->shift;
-    free(queue->data);
-    free(queue->provided);
+    free(queue->ring);
 
     /* free ostream itself */
     free(queue);
@@ -124,75 +232,39 @@ vrna_ostream_threadsafe(void)
 }
 
 
+PUBLIC unsigned int
+vrna_ostream_max_in_flight(vrna_ostream_t queue)
+{
+  return (queue) ? queue->max_in_flight : 0;
+}
+
+
 PUBLIC void
 vrna_ostream_request(struct vrna_ordered_stream_s *queue,
                      unsigned int                 num)
 {
-  unsigned int i;
+  unsigned int end;
 
   if (queue) {
-#if VRNA_WITH_PTHREADS
-    pthread_mutex_lock(&queue->mtx);
-#endif
-    if (num >= queue->end) {
-      /* check whether we have to increase memory */
-      unsigned int new_size = num - queue->shift + 1;
-
-      if (queue->size < new_size + 1) {
-        /*
-         *  Check whether we can simply move data around to get more space.
-         *  We do this only, if more than half of the first buffer is empty.
-         *  Otherwise, we simply increase the buffer to fit incoming data.
-         */
-        unsigned int mem_unavail = queue->start - queue->shift;
-        if ((mem_unavail > (queue->size / 2)) &&
-            (new_size - mem_unavail < queue->size + 1)) {
-          /* reset pointer shift */
-          queue->data     += queue->shift;
-          queue->provided += queue->shift;
-
-          /* move remaining data to the front */
-          queue->data = memmove(queue->data,
-                                queue->data + mem_unavail,
-                                sizeof(void *) * (queue->end - queue->start + 1));
-
-          /* move provider bitmask to the front */
-          queue->provided = memmove(queue->provided,
-                                    queue->provided + mem_unavail,
-                                    sizeof(unsigned char) * (queue->end - queue->start + 1));
-
-          /* reset start and pointer shifts */
-          queue->shift    = queue->start;
-          queue->data     -= queue->start;
-          queue->provided -= queue->start;
-        } else {
-          /* increase stream buffer size */
-          new_size += QUEUE_OVERHEAD;
-          /* reset pointer shift */
-          queue->data     += queue->shift;
-          queue->provided += queue->shift;
-
-          /* reallocate memory blocks */
-          queue->data     = (void **)vrna_realloc(queue->data, sizeof(void *) * new_size);
-          queue->provided =
-            (unsigned char *)vrna_realloc(queue->provided, sizeof(void *) * new_size);
-          queue->size = new_size;
-
-          /* restore pointer shift */
-          queue->data     -= queue->shift;
-          queue->provided -= queue->shift;
-        }
-      }
-
-      for (i = queue->end + 1; i <= num; i++)
-        queue->provided[i] = 0;
+    end = ATOMIC_LOAD(&queue->end);
 
-      queue->end = num;
-    }
+    if (num < end)
+      return;
 
 #if VRNA_WITH_PTHREADS
-    pthread_mutex_unlock(&queue->mtx);
+    /* back-pressure, wait until enough elements have been flushed */
+    if (num - ATOMIC_LOAD(&queue->start) >= queue->max_in_flight)
+      wait_for_slot(queue, num);
+
+#else
+    if (num - queue->start >= queue->size)
+      grow_ring(queue, num);
+
 #endif
+
+    /* ring slots are released by the flusher, so we only need to move the end */
+    while ((num >= end) &&
+           (!ATOMIC_CAS(&queue->end, &end, num + 1)));
   }
 }
 
@@ -202,29 +274,28 @@ vrna_ostream_provide(struct vrna_ordered_stream_s *queue,
                      unsigned int                 i,
                      void                         *data)
 {
+  unsigned int        start, end;
+  struct stream_slot  *slot;
+
   if (queue) {
-#if VRNA_WITH_PTHREADS
-    pthread_mutex_lock(&queue->mtx);
-#endif
-    if ((queue->end < i) || (i < queue->start)) {
+    start = ATOMIC_LOAD(&queue->start);
+    end   = ATOMIC_LOAD(&queue->end);
+
+    if ((end <= i) || (i < start)) {
       vrna_message_warning(
-        "vrna_ostream_provide(): data position (%d) out of range [%d:%d]!",
+        "vrna_ostream_provide(): data position (%u) out of range [%u:%u]!",
         i,
-        queue->start,
-        queue->end);
+        start,
+        end);
       return;
     }
 
     /* store data */
-    queue->data[i]      = data;
-    queue->provided[i]  = 1;
+    slot        = queue->ring + (i & queue->mask);
+    slot->data  = data;
+    ATOMIC_STORE(&(slot->provided), 1);
 
     /* process all consecutive blocks available from the start */
-    if (i == queue->start)
-      flush_output(queue);
-
-#if VRNA_WITH_PTHREADS
-    pthread_mutex_unlock(&queue->mtx);
-#endif
+    flush_output(queue);
   }
 }
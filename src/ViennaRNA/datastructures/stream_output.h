@@ -27,8 +27,21 @@
  *  @{
  */
 
+/**
+ *  @brief  Default maximum number of requested but not yet processed elements in an ordered output stream
+ *
+ *  @see  vrna_ostream_init(), vrna_ostream_init_bounded()
+ */
+#define VRNA_OSTREAM_DEFAULT_MAX_IN_FLIGHT  1024
+
 /**
  *  @brief  An ordered output stream structure with unordered insert capabilities
+ *
+ *  The stream is implemented as a lock-free ring buffer. Threads that provide data
+ *  only store it in the ring, whereas the thread that provides the first element of
+ *  the stream processes all consecutive elements available in batches. Requesting
+ *  an index blocks until the number of in-flight elements drops below the maximum
+ *  set at initialization.
  */
 typedef struct vrna_ordered_stream_s *vrna_ostream_t;
 
@@ -58,7 +71,11 @@ DEPRECATED(typedef void (vrna_callback_stream_output)(void         *auxdata,
 /**
  *  @brief  Get an initialized ordered output stream
  *
- *  @see  vrna_ostream_free(), vrna_ostream_request(), vrna_ostream_provide()
+ *  At most #VRNA_OSTREAM_DEFAULT_MAX_IN_FLIGHT elements may be in flight, i.e.
+ *  requested but not yet processed by the @p output callback.
+ *
+ *  @see  vrna_ostream_init_bounded(), vrna_ostream_free(), vrna_ostream_request(),
+ *        vrna_ostream_provide()
  *
  *  @param  output    A callback function that processes and releases data in the stream
  *  @param  auxdata   A pointer to auxiliary data passed as first argument to the @p output callback
@@ -69,6 +86,26 @@ vrna_ostream_init(vrna_stream_output_f output,
                   void                        *auxdata);
 
 
+/**
+ *  @brief  Get an initialized ordered output stream with a limited number of elements in flight
+ *
+ *  Same as vrna_ostream_init() but at most @p max_in_flight elements may have been
+ *  requested and not yet processed. This serves as back-pressure for producers
+ *  that are faster than the consumers of the stream.
+ *
+ *  @see  vrna_ostream_init(), vrna_ostream_request()
+ *
+ *  @param  output        A callback function that processes and releases data in the stream
+ *  @param  auxdata       A pointer to auxiliary data passed as first argument to the @p output callback
+ *  @param  max_in_flight The maximum number of elements in flight (0 for the default)
+ *  @return               An initialized ordered output stream
+ */
+vrna_ostream_t
+vrna_ostream_init_bounded(vrna_stream_output_f  output,
+                          void                  *auxdata,
+                          unsigned int          max_in_flight);
+
+
 /**
  *  @brief  Free an initialized ordered output stream
  *
@@ -84,6 +121,16 @@ int
 vrna_ostream_threadsafe(void);
 
 
+/**
+ *  @brief  Get the maximum number of elements in flight of an ordered output stream
+ *
+ *  @param  dat   The output stream
+ *  @return       The maximum number of requested but not yet processed elements
+ */
+unsigned int
+vrna_ostream_max_in_flight(vrna_ostream_t dat);
+
+
 /**
  *  @brief  Request index in ordered output stream
  *
@@ -91,6 +138,14 @@ vrna_ostream_threadsafe(void);
  *  indicate that data associted with a certain index number is expected
  *  to be inserted into the stream in the future.
  *
+ *  @note If @p num is too far ahead of the first unprocessed element of the
+ *        stream, this function blocks until enough elements have been processed.
+ *        Thus, a thread must never request more elements in advance than
+ *        the stream allows to be in flight, unless other threads provide the
+ *        data for the pending elements. If the library has been built without
+ *        thread support (see vrna_ostream_threadsafe()), the stream never blocks
+ *        but enlarges its buffer instead.
+ *
  *  @see vrna_ostream_init(), vrna_ostream_provide(), vrna_ostream_free()
  *
  *  @param  dat   The output stream for which the index is requested
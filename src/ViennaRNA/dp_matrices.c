@@ -25,6 +25,8 @@
 #include "ViennaRNA/model.h"
 #include "ViennaRNA/utils/basic.h"
 #include "ViennaRNA/gquad.h"
+#include "ViennaRNA/alphabet.h"
+#include "ViennaRNA/constraints/hard.h"
 #include "ViennaRNA/dp_matrices.h"
 
 /*
@@ -54,6 +56,11 @@
 #define ALLOC_PF_WO_PROBS         (ALLOC_F | ALLOC_C | ALLOC_FML)
 #define ALLOC_PF_DEFAULT          (ALLOC_PF_WO_PROBS | ALLOC_PROBS | ALLOC_AUX)
 
+/* number of adjacent columns that form a panel of tiled MFE matrices */
+#define MX_TILE_WIDTH             64
+/* number of int entries per cache line, tiled MFE matrix columns start at multiples thereof */
+#define MX_CACHE_LINE_INTS        16
+
 /*
  #################################
  # GLOBAL VARIABLES              #
@@ -91,6 +98,10 @@ PRIVATE void
 mfe_matrices_free_default(vrna_mx_mfe_t *self);
 
 
+PRIVATE void
+mfe_matrices_free_custom_layout(vrna_fold_compound_t *fc);
+
+
 PRIVATE void
 mfe_matrices_free_window(vrna_mx_mfe_t  *self,
                          unsigned int   length,
@@ -139,6 +150,40 @@ init_mx_mfe_default(vrna_fold_compound_t  *fc,
                     unsigned int          alloc_vector);
 
 
+PRIVATE vrna_mx_mfe_t *
+init_mx_mfe_banded(vrna_fold_compound_t *fc,
+                   unsigned int         alloc_vector);
+
+
+PRIVATE vrna_mx_mfe_t *
+init_mx_mfe_tiled(vrna_fold_compound_t  *fc,
+                  unsigned int          alloc_vector);
+
+
+PRIVATE int
+custom_layout_supported(vrna_fold_compound_t *fc);
+
+
+PRIVATE char *
+get_ptypes_custom_layout(vrna_fold_compound_t *fc,
+                         int                  *indx,
+                         unsigned int         size,
+                         unsigned int         w);
+
+
+PRIVATE int *
+alloc_mx_aligned(size_t size);
+
+
+PRIVATE unsigned int
+get_band_width(vrna_fold_compound_t *fc);
+
+
+PRIVATE void
+prohibit_out_of_band(vrna_fold_compound_t *fc,
+                     unsigned int         w);
+
+
 PRIVATE vrna_mx_mfe_t *
 init_mx_mfe_window(vrna_fold_compound_t *fc,
                    unsigned int         alloc_vector);
@@ -188,6 +233,12 @@ vrna_mx_mfe_free(vrna_fold_compound_t *vc)
           mfe_matrices_free_default(self);
           break;
 
+        case VRNA_MX_BANDED:
+        /* fallthrough */
+        case VRNA_MX_TILED:
+          mfe_matrices_free_custom_layout(vc);
+          break;
+
         case VRNA_MX_WINDOW:
           mfe_matrices_free_window(self, vc->length, vc->window_size);
           break;
@@ -323,9 +374,17 @@ vrna_mx_prepare(vrna_fold_compound_t  *vc,
       /* prepare for MFE computation */
       if (options & VRNA_OPTION_WINDOW) /* Windowing approach, a.k.a. locally optimal */
         mx_type = VRNA_MX_WINDOW;
+      else if ((vc->matrices) &&
+               ((vc->matrices->type == VRNA_MX_BANDED) ||
+                (vc->matrices->type == VRNA_MX_TILED)))  /* keep banded/tiled matrices requested by the user */
+        mx_type = vc->matrices->type;
       else                              /* default is regular MFE */
         mx_type = VRNA_MX_DEFAULT;
 
+      if (((mx_type == VRNA_MX_BANDED) || (mx_type == VRNA_MX_TILED)) &&
+          (!custom_layout_supported(vc)))
+        return 0;
+
       if (vc->strands > 1)
         options |= VRNA_OPTION_HYBRID;
 
@@ -333,6 +392,13 @@ vrna_mx_prepare(vrna_fold_compound_t  *vc,
 
       if (!vc->matrices || (vc->matrices->type != mx_type) || (vc->matrices->length < vc->length)) {
         realloc = 1;
+      } else if ((mx_type == VRNA_MX_BANDED) &&
+                 ((vc->matrices->length != vc->length) ||
+                  (vc->matrices->band != get_band_width(vc)))) {
+        realloc = 1;
+      } else if ((mx_type == VRNA_MX_TILED) &&
+                 (vc->matrices->length != vc->length)) {
+        realloc = 1;
       } else {
         mx_alloc_vector =
           get_mx_alloc_vector(vc, mx_type, options);
@@ -343,6 +409,8 @@ vrna_mx_prepare(vrna_fold_compound_t  *vc,
 
       if (realloc) /* Add DP matrices, if not they are not present */
         ret &= vrna_mx_mfe_add(vc, mx_type, options);
+      else if (mx_type == VRNA_MX_BANDED) /* hard constraints may have changed since */
+        prohibit_out_of_band(vc, vc->matrices->band);
     }
 
     if (options & VRNA_OPTION_PF) {
@@ -350,6 +418,17 @@ vrna_mx_prepare(vrna_fold_compound_t  *vc,
       if (!vc->exp_params) /* return failure if exp_params data is not present */
         return 0;
 
+      /*
+       *  the partition function recursions are not aware of the
+       *  index that comes with banded or tiled MFE matrices
+       */
+      if ((vc->matrices) &&
+          ((vc->matrices->type == VRNA_MX_BANDED) ||
+           (vc->matrices->type == VRNA_MX_TILED))) {
+        vrna_mx_mfe_free(vc);
+        vrna_ptypes_prepare(vc, options);
+      }
+
       if (options & VRNA_OPTION_WINDOW) /* Windowing approach, a.k.a. locally optimal */
         mx_type = VRNA_MX_WINDOW;
       else                              /* default is regular MFE */
@@ -404,6 +483,10 @@ get_mx_mfe_alloc_vector_current(vrna_mx_mfe_t   *mx,
   if (mx) {
     switch (mx_type) {
       case VRNA_MX_DEFAULT:
+      /* fallthrough */
+      case VRNA_MX_BANDED:
+      /* fallthrough */
+      case VRNA_MX_TILED:
         if (mx->f5)
           mx_alloc_vector |= ALLOC_F5;
 
@@ -535,6 +618,14 @@ add_mfe_matrices(vrna_fold_compound_t *vc,
         vc->matrices = init_mx_mfe_default(vc, alloc_vector);
         break;
 
+      case VRNA_MX_BANDED:
+        vc->matrices = init_mx_mfe_banded(vc, alloc_vector);
+        break;
+
+      case VRNA_MX_TILED:
+        vc->matrices = init_mx_mfe_tiled(vc, alloc_vector);
+        break;
+
       case VRNA_MX_WINDOW:
         vc->matrices = init_mx_mfe_window(vc, alloc_vector);
         break;
@@ -648,6 +739,20 @@ mfe_matrices_free_default(vrna_mx_mfe_t *self)
 }
 
 
+PRIVATE void
+mfe_matrices_free_custom_layout(vrna_fold_compound_t *fc)
+{
+  mfe_matrices_free_default(fc->matrices);
+
+  /* restore the default index, the pair type array is re-created on demand */
+  free(fc->jindx);
+  fc->jindx = vrna_idx_col_wise(fc->length);
+
+  free(fc->ptype);
+  fc->ptype = NULL;
+}
+
+
 PRIVATE void
 mfe_matrices_free_window(vrna_mx_mfe_t  *self,
                          unsigned int   length,
@@ -1350,6 +1455,296 @@ init_mx_mfe_default(vrna_fold_compound_t  *fc,
 }
 
 
+PRIVATE vrna_mx_mfe_t *
+init_mx_mfe_banded(vrna_fold_compound_t *fc,
+                   unsigned int         alloc_vector)
+{
+  char          *ptype;
+  unsigned int  n, w, j, lo, size, lin_size;
+  int           *indx;
+  vrna_mx_mfe_t *mx;
+  vrna_mx_mfe_t init = {
+    .type = VRNA_MX_BANDED
+  };
+
+  if (!custom_layout_supported(fc))
+    return NULL;
+
+  n     = fc->length;
+  w     = get_band_width(fc);
+
+  if ((double)n * (double)w >= (double)INT_MAX) {
+    vrna_message_warning("init_mx_mfe_banded(): "
+                         "sequence length %d exceeds addressable range",
+                         n);
+    return NULL;
+  }
+
+  /*
+   *  column j stores the subsegments [i, j] with j - w < i <= j only. The
+   *  index is chosen such that c[indx[j] + i] addresses the same cell as
+   *  for the default column-wise layout. For i outside the band, i.e.
+   *  i <= j - w, c[indx[j] + i] still lies within the allocated memory but
+   *  aliases an in-band cell of a preceding column, so its value carries
+   *  no meaning. Such cells are read, e.g. by the exterior loop stem
+   *  contributions that scan all i < j, but their values are always
+   *  discarded: base pairs with a span of w or more are prohibited in the
+   *  hard constraints, here and whenever the matrices are re-used by
+   *  vrna_mx_prepare(), and every reader evaluates the hard
+   *  constraints before it uses a value. Readers that bypass the hard
+   *  constraints must restrict themselves to j - mx->band < i <= j.
+   */
+  indx  = (int *)vrna_alloc(sizeof(int) * (n + 1));
+  size  = 1;
+  for (j = 1; j <= n; j++) {
+    lo      = (j > w) ? j - w + 1 : 1;
+    indx[j] = (int)size - (int)lo;
+    size    += j - lo + 1;
+  }
+
+  prohibit_out_of_band(fc, w);
+
+  /* banded pair type array */
+  ptype = get_ptypes_custom_layout(fc, indx, size, w);
+
+  mx = vrna_alloc(sizeof(vrna_mx_mfe_t));
+
+  if (mx) {
+    memcpy(mx, &init, sizeof(vrna_mx_mfe_t));
+    nullify_mfe(mx);
+
+    lin_size    = n + 2;
+    mx->length  = n;
+    mx->strands = fc->strands;
+    mx->band    = w;
+
+    if (alloc_vector & ALLOC_F5)
+      mx->f5 = (int *)vrna_alloc(sizeof(int) * lin_size);
+
+    if (alloc_vector & ALLOC_C)
+      mx->c = (int *)vrna_alloc(sizeof(int) * size);
+
+    if (alloc_vector & ALLOC_FML)
+      mx->fML = (int *)vrna_alloc(sizeof(int) * size);
+
+    if (alloc_vector & ALLOC_UNIQ)
+      mx->fM1 = (int *)vrna_alloc(sizeof(int) * size);
+
+    free(fc->jindx);
+    free(fc->ptype);
+    fc->jindx = indx;
+    fc->ptype = ptype;
+  } else {
+    free(indx);
+    free(ptype);
+  }
+
+  return mx;
+}
+
+
+PRIVATE vrna_mx_mfe_t *
+init_mx_mfe_tiled(vrna_fold_compound_t  *fc,
+                  unsigned int          alloc_vector)
+{
+  char          *ptype;
+  unsigned int  n, j, size, lin_size;
+  int           *indx;
+  vrna_mx_mfe_t *mx;
+  vrna_mx_mfe_t init = {
+    .type = VRNA_MX_TILED
+  };
+
+  if (!custom_layout_supported(fc))
+    return NULL;
+
+  n = fc->length;
+
+  if ((double)n * (double)(n + MX_CACHE_LINE_INTS) / 2. >= (double)INT_MAX) {
+    vrna_message_warning("init_mx_mfe_tiled(): "
+                         "sequence length %d exceeds addressable range",
+                         n);
+    return NULL;
+  }
+
+  /*
+   *  column j still stores the subsegments [i, j] for all 1 <= i <= j
+   *  contiguously, such that the split point loops of the recursions can
+   *  access c[indx[j] + i] and fML[indx[j] + i] as usual. However, each
+   *  column starts at a cache line boundary and is padded to a multiple
+   *  of the cache line size. Together with the tile-wise traversal in
+   *  vrna_mfe() a panel of adjacent columns then occupies a minimal number
+   *  of cache lines.
+   */
+  indx  = (int *)vrna_alloc(sizeof(int) * (n + 1));
+  size  = 0;
+  for (j = 1; j <= n; j++) {
+    indx[j] = (int)size - 1;
+    size    += ((j + MX_CACHE_LINE_INTS - 1) / MX_CACHE_LINE_INTS) * MX_CACHE_LINE_INTS;
+  }
+
+  ptype = get_ptypes_custom_layout(fc, indx, size, n);
+
+  mx = vrna_alloc(sizeof(vrna_mx_mfe_t));
+
+  if (mx) {
+    memcpy(mx, &init, sizeof(vrna_mx_mfe_t));
+    nullify_mfe(mx);
+
+    lin_size    = n + 2;
+    mx->length  = n;
+    mx->strands = fc->strands;
+    mx->tile    = MX_TILE_WIDTH;
+
+    if (alloc_vector & ALLOC_F5)
+      mx->f5 = (int *)vrna_alloc(sizeof(int) * lin_size);
+
+    if (alloc_vector & ALLOC_C)
+      mx->c = alloc_mx_aligned(size);
+
+    if (alloc_vector & ALLOC_FML)
+      mx->fML = alloc_mx_aligned(size);
+
+    if (alloc_vector & ALLOC_UNIQ)
+      mx->fM1 = alloc_mx_aligned(size);
+
+    free(fc->jindx);
+    free(fc->ptype);
+    fc->jindx = indx;
+    fc->ptype = ptype;
+  } else {
+    free(indx);
+    free(ptype);
+  }
+
+  return mx;
+}
+
+
+PRIVATE int
+custom_layout_supported(vrna_fold_compound_t *fc)
+{
+  vrna_md_t *md = &(fc->params->model_details);
+
+  if ((fc->type != VRNA_FC_TYPE_SINGLE) ||
+      (fc->strands > 1) ||
+      (fc->sc) ||
+      (fc->domains_up) ||
+      (md->circ) ||
+      (md->gquad)) {
+    vrna_message_warning("banded and tiled DP matrices are only available for single, linear sequences "
+                         "without soft constraints, unstructured domains, or G-Quadruplexes");
+    return 0;
+  }
+
+  return 1;
+}
+
+
+/*
+ *  pair type array for a custom index, same rules as in vrna_ptypes()
+ *  but restricted to subsegments [i, j] with j - i < w
+ */
+PRIVATE char *
+get_ptypes_custom_layout(vrna_fold_compound_t *fc,
+                         int                  *indx,
+                         unsigned int         size,
+                         unsigned int         w)
+{
+  short         *S;
+  char          *ptype;
+  unsigned int  n, i, j, k, l, turn;
+  int           type;
+  vrna_md_t     *md;
+
+  n     = fc->length;
+  md    = &(fc->params->model_details);
+  turn  = md->min_loop_size;
+  S     = fc->sequence_encoding2;
+  ptype = (char *)vrna_alloc(sizeof(char) * (size + 1));
+
+  for (k = 1; k + turn < n; k++)
+    for (l = 1; l <= 2; l++) {
+      int ntype = 0, otype = 0;
+      i = k;
+      j = i + turn + l;
+      if ((j > n) ||
+          (j - i >= w))
+        continue;
+
+      type = md->pair[S[i]][S[j]];
+      while ((i >= 1) && (j <= n) && (j - i < w)) {
+        if ((i > 1) && (j < n))
+          ntype = md->pair[S[i - 1]][S[j + 1]];
+
+        if (md->noLP && (!otype) && (!ntype))
+          type = 0; /* i.j can only form isolated pairs */
+
+        ptype[indx[j] + i]  = (char)type;
+        otype               = type;
+        type                = ntype;
+        i--;
+        j++;
+      }
+    }
+
+  return ptype;
+}
+
+
+/* zero-initialized DP matrix that starts at a cache line boundary, release with free() */
+PRIVATE int *
+alloc_mx_aligned(size_t size)
+{
+  int *mx;
+
+#ifdef HAVE_POSIX_MEMALIGN
+  void *mem = NULL;
+
+  if (posix_memalign(&mem, sizeof(int) * MX_CACHE_LINE_INTS, sizeof(int) * size) != 0)
+    vrna_message_error("alloc_mx_aligned(): out of memory");
+
+  mx = (int *)mem;
+  memset(mx, 0, sizeof(int) * size);
+#else
+  mx = (int *)vrna_alloc(sizeof(int) * size);
+#endif
+
+  return mx;
+}
+
+
+PRIVATE unsigned int
+get_band_width(vrna_fold_compound_t *fc)
+{
+  int span = fc->params->model_details.max_bp_span;
+
+  if ((span <= 0) ||
+      (span > (int)fc->length))
+    span = (int)fc->length;
+
+  return (unsigned int)span;
+}
+
+
+/* prohibit pairs outside the band, e.g. due to previously applied hard constraints */
+PRIVATE void
+prohibit_out_of_band(vrna_fold_compound_t *fc,
+                     unsigned int         w)
+{
+  unsigned int  i, j, n;
+  unsigned char *hc_mx;
+
+  n     = fc->length;
+  hc_mx = (fc->hc) ? fc->hc->mx : NULL;
+
+  if (hc_mx)
+    for (i = 1; i <= n; i++)
+      for (j = i + w; j <= n; j++)
+        hc_mx[n * i + j] = hc_mx[n * j + i] = VRNA_CONSTRAINT_CONTEXT_NONE;
+}
+
+
 PRIVATE vrna_mx_mfe_t *
 init_mx_mfe_window(vrna_fold_compound_t *fc,
                    unsigned int         alloc_vector)
@@ -1511,6 +1906,10 @@ nullify_mfe(vrna_mx_mfe_t *mx)
 
     switch (mx->type) {
       case VRNA_MX_DEFAULT:
+      /* fallthrough */
+      case VRNA_MX_BANDED:
+      /* fallthrough */
+      case VRNA_MX_TILED:
         mx->c     = NULL;
         mx->f5    = NULL;
         mx->f3    = NULL;
@@ -1524,6 +1923,8 @@ nullify_mfe(vrna_mx_mfe_t *mx)
         mx->FcH   = INF;
         mx->FcI   = INF;
         mx->FcM   = INF;
+        mx->band  = 0;
+        mx->tile  = 0;
         break;
 
       case VRNA_MX_WINDOW:
@@ -1923,6 +2324,9 @@ nullify_pf(vrna_mx_pf_t *mx)
         mx->Q_cM_rem    = 0.;
 
         break;
+
+      default:
+        break;
     }
   }
 }
@@ -36,9 +36,45 @@ typedef enum {
                      *    window approach.
                      *    @see    vrna_mfe_window(), vrna_mfe_window_zscore(), pfl_fold()
                      */
-  VRNA_MX_2DFOLD    /**<  @brief  DP matrices suitable for distance class partitioned structure prediction
+  VRNA_MX_2DFOLD,   /**<  @brief  DP matrices suitable for distance class partitioned structure prediction
                      *    @see  vrna_mfe_TwoD(), vrna_pf_TwoD()
                      */
+  VRNA_MX_BANDED,   /**<  @brief  Default MFE DP matrices that only store the band of subsegments
+                     *            @f$[i,j]@f$ with @f$ j - i < @f$ #vrna_md_t.max_bp_span
+                     *
+                     *    The matrices use the same recursions and data fields as #VRNA_MX_DEFAULT,
+                     *    but memory requirements scale with @f$ O(n \cdot L) @f$ instead of
+                     *    @f$ O(n^2) @f$, where @f$ L @f$ denotes the maximum base pair span.
+                     *    To keep the existing access pattern @p c[jindx[j] + i], the
+                     *    #vrna_fold_compound_t.jindx and #vrna_fold_compound_t.ptype
+                     *    arrays are replaced by banded versions as long as the matrices
+                     *    are attached. Only available for MFE prediction and backtracking
+                     *    of single, linear sequences without soft constraints, unstructured
+                     *    domains, or G-Quadruplexes.
+                     *    @see  vrna_mx_mfe_add(), vrna_mfe()
+                     */
+  VRNA_MX_TILED     /**<  @brief  Default MFE DP matrices with cache line aligned columns that are
+                     *            filled tile-wise
+                     *
+                     *    The matrices use the same recursions and data fields as #VRNA_MX_DEFAULT,
+                     *    and each column @f$ j @f$ still stores all subsegments @f$ [i, j] @f$
+                     *    contiguously. However, columns start at cache line boundaries and the
+                     *    matrices are filled in panels of adjacent columns. Together with row-wise
+                     *    copies of the multibranch loop matrix, both operands of the split point
+                     *    loops are traversed contiguously and remain in the cache for consecutive
+                     *    rows of a panel. This reduces cache misses for long sequences at the cost
+                     *    of additional memory during the fill: two row-wise triangular @p int
+                     *    matrices (copies of @p fML and its split point minima), plus a third one
+                     *    for canonical structures if #vrna_md_t.noLP is set. Each of them takes
+                     *    about @f$ n^2 / 2 @f$ integers, i.e. the fill requires roughly twice
+                     *    (2.5 times with @p noLP) the memory of the @p c and @p fML matrices
+                     *    alone, e.g. about 200MB per auxiliary matrix for @f$ n = 10^4 @f$. The
+                     *    auxiliary matrices are released as soon as the fill is done. As for
+                     *    #VRNA_MX_BANDED, the #vrna_fold_compound_t.jindx and
+                     *    #vrna_fold_compound_t.ptype arrays are replaced while the matrices are
+                     *    attached and the same restrictions apply.
+                     *    @see  vrna_mx_mfe_add(), vrna_mfe()
+                     */
 } vrna_mx_type_e;
 
 /**
@@ -78,6 +114,8 @@ struct vrna_mx_mfe_s {
   int FcH;          /**<  @brief  Minimum Free Energy of hairpin loop cases in circular RNA */
   int FcI;          /**<  @brief  Minimum Free Energy of internal loop cases in circular RNA */
   int FcM;          /**<  @brief  Minimum Free Energy of multibranch loop cases in circular RNA */
+  unsigned int band; /**<  @brief  Width of the band along the main diagonal (#VRNA_MX_BANDED only) */
+  unsigned int tile; /**<  @brief  Number of adjacent columns that are filled together (#VRNA_MX_TILED only) */
   /**
    * @}
    */
@@ -24,9 +24,11 @@
 #include "ViennaRNA/pair_mat.h"
 #include "ViennaRNA/params/basic.h"
 #include "ViennaRNA/alifold.h"
+#include "ViennaRNA/alphabet.h"
 #include "ViennaRNA/subopt.h"
 #include "ViennaRNA/loops/all.h"
 #include "ViennaRNA/duplex.h"
+#include "ViennaRNA/duplex_intern.h"
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -121,13 +123,11 @@ duplexfold_cu(const char  *s1,
               const char  *s2,
               int         clean_up)
 {
-  int       i, j, Emin = INF, i_min = 0, j_min = 0;
-  char      *struc;
-  duplexT   mfe;
-  vrna_md_t md;
-
-  n1  = (int)strlen(s1);
-  n2  = (int)strlen(s2);
+  int               Emin, i_min, j_min;
+  char              *struc;
+  duplexT           mfe;
+  vrna_md_t         md;
+  vrna_duplex_dat_t dat;
 
   set_model_details(&md);
   if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
@@ -138,19 +138,110 @@ duplexfold_cu(const char  *s1,
     make_pair_matrix();
   }
 
-  c = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
-  for (i = 1; i <= n1; i++)
-    c[i] = (int *)vrna_alloc(sizeof(int) * (n2 + 1));
+  vrna_duplex_dat_init(&dat, s1, s2, P);
+
+  Emin = vrna_duplex_fill(&dat, &i_min, &j_min);
+
+  /* backtracking and duplex_subopt() still use the static globals */
+  n1  = dat.n1;
+  n2  = dat.n2;
+  c   = dat.c;
+  S1  = dat.S1;
+  S2  = dat.S2;
+  SS1 = dat.SS1;
+  SS2 = dat.SS2;
+
+  struc = backtrack(i_min, j_min);
+  if (i_min < n1)
+    i_min++;
+
+  if (j_min > 1)
+    j_min--;
+
+  mfe.i         = i_min;
+  mfe.j         = j_min;
+  mfe.energy    = (float)Emin / 100.;
+  mfe.structure = struc;
+  if (clean_up)
+    vrna_duplex_dat_free(&dat);
 
-  S1  = encode_sequence(s1, 0);
-  S2  = encode_sequence(s2, 0);
-  SS1 = encode_sequence(s1, 1);
-  SS2 = encode_sequence(s2, 1);
+  return mfe;
+}
+
+
+PUBLIC void
+vrna_duplex_dat_init(vrna_duplex_dat_t  *dat,
+                     const char         *s1,
+                     const char         *s2,
+                     vrna_param_t       *P)
+{
+  int       i;
+  vrna_md_t *md;
+
+  md = &(P->model_details);
+
+  dat->P    = P;
+  dat->n1   = (int)strlen(s1);
+  dat->n2   = (int)strlen(s2);
+  dat->S1   = vrna_seq_encode_simple(s1, md);
+  dat->S2   = vrna_seq_encode_simple(s2, md);
+  dat->SS1  = vrna_seq_encode(s1, md);
+  dat->SS2  = vrna_seq_encode(s2, md);
+
+  dat->c = (int **)vrna_alloc(sizeof(int *) * (dat->n1 + 1));
+  for (i = 1; i <= dat->n1; i++)
+    dat->c[i] = (int *)vrna_alloc(sizeof(int) * (dat->n2 + 1));
+}
+
+
+PUBLIC void
+vrna_duplex_dat_free(vrna_duplex_dat_t *dat)
+{
+  int i;
+
+  if (dat->c) {
+    for (i = 1; i <= dat->n1; i++)
+      free(dat->c[i]);
+    free(dat->c);
+  }
+
+  free(dat->S1);
+  free(dat->S2);
+  free(dat->SS1);
+  free(dat->SS2);
+
+  dat->c    = NULL;
+  dat->S1   = dat->S2 = dat->SS1 = dat->SS2 = NULL;
+}
+
+
+PUBLIC int
+vrna_duplex_fill(vrna_duplex_dat_t  *dat,
+                 int                *i_min,
+                 int                *j_min)
+{
+  int           i, j, k, l, n1, n2, type, type2, E, Emin, **c;
+  short         *S1, *S2, *SS1, *SS2;
+  vrna_param_t  *P;
+  vrna_md_t     *md;
+
+  P     = dat->P;
+  md    = &(P->model_details);
+  n1    = dat->n1;
+  n2    = dat->n2;
+  S1    = dat->S1;
+  S2    = dat->S2;
+  SS1   = dat->SS1;
+  SS2   = dat->SS2;
+  c     = dat->c;
+  Emin  = INF;
+
+  *i_min  = 0;
+  *j_min  = 0;
 
   for (i = 1; i <= n1; i++) {
     for (j = n2; j > 0; j--) {
-      int type, type2, E, k, l;
-      type    = pair[S1[i]][S2[j]];
+      type    = md->pair[S1[i]][S2[j]];
       c[i][j] = type ? P->DuplexInit : INF;
       if (!type)
         continue;
@@ -161,47 +252,26 @@ duplexfold_cu(const char  *s1,
           if (i - k + l - j - 2 > MAXLOOP)
             break;
 
-          type2 = pair[S1[k]][S2[l]];
+          type2 = md->pair[S1[k]][S2[l]];
           if (!type2)
             continue;
 
-          E = E_IntLoop(i - k - 1, l - j - 1, type2, rtype[type],
+          E = E_IntLoop(i - k - 1, l - j - 1, type2, md->rtype[type],
                         SS1[k + 1], SS2[l - 1], SS1[i - 1], SS2[j + 1], P);
           c[i][j] = MIN2(c[i][j], c[k][l] + E);
         }
       }
       E = c[i][j];
-      E += vrna_E_ext_stem(rtype[type], (j > 1) ? SS2[j - 1] : -1, (i < n1) ? SS1[i + 1] : -1, P);
+      E += vrna_E_ext_stem(md->rtype[type], (j > 1) ? SS2[j - 1] : -1, (i < n1) ? SS1[i + 1] : -1, P);
       if (E < Emin) {
-        Emin  = E;
-        i_min = i;
-        j_min = j;
+        Emin    = E;
+        *i_min  = i;
+        *j_min  = j;
       }
     }
   }
 
-  struc = backtrack(i_min, j_min);
-  if (i_min < n1)
-    i_min++;
-
-  if (j_min > 1)
-    j_min--;
-
-  mfe.i         = i_min;
-  mfe.j         = j_min;
-  mfe.energy    = (float)Emin / 100.;
-  mfe.structure = struc;
-  if (clean_up) {
-    for (i = 1; i <= n1; i++)
-      free(c[i]);
-    free(c);
-    free(S1);
-    free(S2);
-    free(SS1);
-    free(SS2);
-  }
-
-  return mfe;
+  return Emin;
 }
 
 
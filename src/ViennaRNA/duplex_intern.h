@@ -0,0 +1,52 @@
+#ifndef VIENNA_RNA_PACKAGE_DUPLEX_INTERN_H
+#define VIENNA_RNA_PACKAGE_DUPLEX_INTERN_H
+
+#include "ViennaRNA/params/basic.h"
+
+/*
+ *  The state of the RNAduplex recursions for two strands. Nothing in
+ *  here is global, so independent fills may run concurrently.
+ */
+typedef struct {
+  vrna_param_t  *P;       /* energy parameters, pairs are taken from P->model_details */
+  int           n1;       /* length of the first strand */
+  int           n2;       /* length of the second strand */
+  short         *S1;      /* simple encoding of the first strand */
+  short         *S2;      /* simple encoding of the second strand */
+  short         *SS1;     /* encoding of the first strand that includes the alias */
+  short         *SS2;     /* encoding of the second strand that includes the alias */
+  int           **c;      /* c[i][j] energy of the duplex given that i and j pair */
+} vrna_duplex_dat_t;
+
+
+/*
+ *  Prepare the sequence encodings and the energy array for the
+ *  duplex of s1 and s2 using the parameters P
+ */
+void
+vrna_duplex_dat_init(vrna_duplex_dat_t  *dat,
+                     const char         *s1,
+                     const char         *s2,
+                     vrna_param_t       *P);
+
+
+/*
+ *  Release the sequence encodings and the energy array, but not the
+ *  energy parameters
+ */
+void
+vrna_duplex_dat_free(vrna_duplex_dat_t *dat);
+
+
+/*
+ *  Fill the energy array and return the minimum free energy of the
+ *  duplex in dcal/mol. The pair (i_min, j_min) closes the optimal
+ *  duplex at its 3' end of the first strand.
+ */
+int
+vrna_duplex_fill(vrna_duplex_dat_t  *dat,
+                 int                *i_min,
+                 int                *j_min);
+
+
+#endif
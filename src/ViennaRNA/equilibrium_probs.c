@@ -16,6 +16,10 @@
 #include <float.h>    /* #defines FLT_MAX ... */
 #include <limits.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/utils/basic.h"
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/fold_vars.h"
@@ -60,6 +64,8 @@ typedef struct {
   FLT_OR_DBL  *prm_l;
   FLT_OR_DBL  *prm_l1;
   FLT_OR_DBL  *prml;
+  FLT_OR_DBL  *prmt1;
+  FLT_OR_DBL  *prm_MLb;
 
   int         ud_max_size;
   FLT_OR_DBL  **pmlu;
@@ -143,6 +149,10 @@ wrap_mean_bp_distance(FLT_OR_DBL  *p,
                       int         *index);
 
 
+PRIVATE INLINE int
+bpp_num_threads(vrna_fold_compound_t *fc);
+
+
 PRIVATE helper_arrays *
 get_ml_helper_arrays(vrna_fold_compound_t *fc);
 
@@ -931,6 +941,24 @@ pf_create_bppm(vrna_fold_compound_t *vc,
 }
 
 
+PRIVATE INLINE int
+bpp_num_threads(vrna_fold_compound_t *fc)
+{
+#ifdef _OPENMP
+  vrna_md_t *md = &(fc->exp_params->model_details);
+
+  /* probability corrections for auxiliary base pairs must be collected in order */
+  if ((md->num_threads > 1) &&
+      (fc->strands == 1) &&
+      (!((fc->sc) && (fc->sc->bt))))
+    return md->num_threads;
+
+#endif
+
+  return 1;
+}
+
+
 PRIVATE helper_arrays *
 get_ml_helper_arrays(vrna_fold_compound_t *fc)
 {
@@ -948,6 +976,8 @@ get_ml_helper_arrays(vrna_fold_compound_t *fc)
   ml_helpers->prm_l   = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
   ml_helpers->prm_l1  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
   ml_helpers->prml    = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  ml_helpers->prmt1   = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  ml_helpers->prm_MLb = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
 
   ml_helpers->ud_max_size = 0;
   ml_helpers->pmlu        = NULL;
@@ -984,6 +1014,8 @@ free_ml_helper_arrays(helper_arrays *ml_helpers)
   free(ml_helpers->prm_l);
   free(ml_helpers->prm_l1);
   free(ml_helpers->prml);
+  free(ml_helpers->prmt1);
+  free(ml_helpers->prm_MLb);
 
   if (ml_helpers->pmlu) {
     for (u = 0; u <= ml_helpers->ud_max_size; u++)
@@ -1212,7 +1244,7 @@ compute_bpp_internal(vrna_fold_compound_t *fc,
   char                  *ptype;
   short                 *S1;
   int                   i, j, k, n, ij, kl, u1, u2, *my_iindx, *jindx, *rtype,
-                        with_ud, *hc_up_int;
+                        with_ud, *hc_up_int, num_threads;
   FLT_OR_DBL            temp, tmp2, *qb, *probs, *scale;
   double                max_real;
   vrna_exp_param_t      *pf_params;
@@ -1246,9 +1278,17 @@ compute_bpp_internal(vrna_fold_compound_t *fc,
   probs = fc->exp_matrices->probs;
   scale = fc->exp_matrices->scale;
 
-  max_real = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
+  max_real    = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
+  num_threads = bpp_num_threads(fc);
 
-  /* 2. bonding k,l as substem of 2:loop enclosed by i,j */
+  /*
+   *  2. bonding k,l as substem of 2:loop enclosed by i,j
+   *  each pair (k,l) only receives contributions from pairs (i,j) with j > l,
+   *  so all k can be processed independently
+   */
+#ifdef _OPENMP
+#pragma omp parallel for private(type, type_2, i, j, ij, kl, u1, u2, temp, tmp2) num_threads(num_threads) if (num_threads > 1) schedule(dynamic, 8)
+#endif
   for (k = 1; k < l; k++) {
     kl = my_iindx[k] - l;
 
@@ -1346,6 +1386,13 @@ compute_bpp_internal(vrna_fold_compound_t *fc,
         }
       }
     }
+  }
+
+  for (k = 1; k < l; k++) {
+    kl = my_iindx[k] - l;
+
+    if (qb[kl] == 0.)
+      continue;
 
     if (probs[kl] > (*Qmax)) {
       (*Qmax) = probs[kl];
@@ -1504,7 +1551,7 @@ compute_bpp_multibranch(vrna_fold_compound_t  *fc,
   short                     *S, *S1, s5, s3;
   unsigned int              *sn;
   int                       cnt, i, j, k, n, u, ii, ij, kl, lj, *my_iindx, *jindx,
-                            *rtype, with_gquad, with_ud;
+                            *rtype, with_gquad, with_ud, num_threads;
   FLT_OR_DBL                temp, ppp, prm_MLb, prmt, prmt1, *qb, *probs, *qm, *G, *scale,
                             *expMLbase, expMLclosing, expMLstem;
   double                    max_real;
@@ -1550,8 +1597,17 @@ compute_bpp_multibranch(vrna_fold_compound_t  *fc,
     for (i = 0; i <= n; i++)
       ml_helpers->prm_l[i] = 0;
   } else {
+    num_threads = bpp_num_threads(fc);
+
+    /*
+     *  (k,l) as left-most stem of a multiloop closed by (k - 1, j), j > l.
+     *  These contributions only depend on probabilities of pairs (i,j) with
+     *  j > l and can be computed independently for each k
+     */
+#ifdef _OPENMP
+#pragma omp parallel for private(i, j, ij, lj, ii, s3, tt, ppp, prmt, prmt1) num_threads(num_threads) if (num_threads > 1) schedule(dynamic, 8)
+#endif
     for (k = 2; k < l; k++) {
-      kl    = my_iindx[k] - l;
       i     = k - 1;
       prmt  = prmt1 = 0.0;
 
@@ -1599,7 +1655,15 @@ compute_bpp_multibranch(vrna_fold_compound_t  *fc,
 
       prmt *= expMLclosing;
 
-      ml_helpers->prml[i] = prmt;
+      ml_helpers->prml[i]   = prmt;
+      ml_helpers->prmt1[i]  = prmt1;
+    }
+
+    /* linear recursions along k for the unpaired stretches of the multiloop */
+    for (k = 2; k < l; k++) {
+      kl    = my_iindx[k] - l;
+      i     = k - 1;
+      prmt1 = ml_helpers->prmt1[i];
 
       /* l+1 is unpaired */
       if (hc_eval(k, l + 1, k, l, VRNA_DECOMP_ML_ML, hc_dat)) {
@@ -1683,7 +1747,8 @@ compute_bpp_multibranch(vrna_fold_compound_t  *fc,
           ml_helpers->prm_MLbu[0] = ml_helpers->prml[i];
       }
 
-      ml_helpers->prml[i] = ml_helpers->prml[i] + ml_helpers->prm_l[i];
+      ml_helpers->prml[i]     = ml_helpers->prml[i] + ml_helpers->prm_l[i];
+      ml_helpers->prm_MLb[k]  = prm_MLb;
 
       tt = ptype[jindx[l] + k];
 
@@ -1696,7 +1761,28 @@ compute_bpp_multibranch(vrna_fold_compound_t  *fc,
           continue;
       }
 
-      temp = prm_MLb;
+      /* rotate prm_MLbu entries required for unstructured domain feature */
+      rotate_ml_helper_arrays_inner(ml_helpers);
+    }
+
+    /* (k,l) as any other stem of the multiloop, again independent for each k */
+#ifdef _OPENMP
+#pragma omp parallel for private(i, kl, s5, s3, tt, temp) num_threads(num_threads) if (num_threads > 1) schedule(dynamic, 8)
+#endif
+    for (k = 2; k < l; k++) {
+      kl  = my_iindx[k] - l;
+      tt  = ptype[jindx[l] + k];
+
+      if (with_gquad) {
+        if ((!tt) &&
+            (G[kl] == 0.))
+          continue;
+      } else {
+        if (qb[kl] == 0.)
+          continue;
+      }
+
+      temp = ml_helpers->prm_MLb[k];
 
       if (sn[k] == sn[k - 1]) {
         if (sc_wrapper->decomp_ml) {
@@ -1730,6 +1816,20 @@ compute_bpp_multibranch(vrna_fold_compound_t  *fc,
 
       probs[kl] += temp *
                    scale[2];
+    }
+
+    for (k = 2; k < l; k++) {
+      kl  = my_iindx[k] - l;
+      tt  = ptype[jindx[l] + k];
+
+      if (with_gquad) {
+        if ((!tt) &&
+            (G[kl] == 0.))
+          continue;
+      } else {
+        if (qb[kl] == 0.)
+          continue;
+      }
 
       if (probs[kl] > (*Qmax)) {
         (*Qmax) = probs[kl];
@@ -1742,10 +1842,7 @@ compute_bpp_multibranch(vrna_fold_compound_t  *fc,
         (*ov)++;
         probs[kl] = FLT_MAX;
       }
-
-      /* rotate prm_MLbu entries required for unstructured domain feature */
-      rotate_ml_helper_arrays_inner(ml_helpers);
-    } /* end for (k=..) */
+    }
   }
 
   rotate_ml_helper_arrays_outer(ml_helpers);
@@ -88,6 +88,11 @@ add_params(vrna_fold_compound_t *fc,
            unsigned int         options);
 
 
+PRIVATE int
+md_equal(const vrna_md_t  *md1,
+         const vrna_md_t  *md2);
+
+
 PRIVATE vrna_fold_compound_t *
 init_fc_single(void);
 
@@ -100,6 +105,16 @@ PRIVATE INLINE void
 nullify(vrna_fold_compound_t *fc);
 
 
+PRIVATE int
+batch_process(vrna_fold_compound_t  **fc,
+              const char            *sequence,
+              unsigned int          i,
+              const vrna_md_t       *md,
+              unsigned int          options,
+              vrna_batch_f          cb,
+              void                  *data);
+
+
 /*
  #################################
  # BEGIN OF FUNCTION DEFINITIONS #
@@ -265,6 +280,177 @@ vrna_fold_compound(const char       *sequence,
 }
 
 
+PUBLIC int
+vrna_fold_compound_reset(vrna_fold_compound_t *fc,
+                         const char           *sequence,
+                         const vrna_md_t      *md_p,
+                         unsigned int         options)
+{
+  unsigned int  length, aux_options;
+  vrna_md_t     md, md_current;
+
+  if ((!fc) ||
+      (!sequence) ||
+      (fc->type != VRNA_FC_TYPE_SINGLE) ||
+      (!fc->params) ||
+      (options & (VRNA_OPTION_WINDOW | VRNA_OPTION_EVAL_ONLY)))
+    return 0;
+
+  length = strlen(sequence);
+  if ((length == 0) ||
+      (length > vrna_sequence_length_max(options)))
+    return 0;
+
+  if (md_p)
+    md = *md_p;
+  else
+    vrna_md_set_default(&md);
+
+  /*
+   *  keep the energy parameters if the model only differs in the
+   *  settings that are derived from the sequence length
+   */
+  md_current              = fc->params->model_details;
+  md_current.window_size  = md.window_size;
+  md_current.max_bp_span  = md.max_bp_span;
+
+  if (!md_equal(&md, &md_current)) {
+    free(fc->params);
+    free(fc->exp_params);
+    fc->params      = NULL;
+    fc->exp_params  = NULL;
+    add_params(fc, &md, options);
+  } else {
+    fc->params->model_details.window_size = md.window_size;
+    fc->params->model_details.max_bp_span = md.max_bp_span;
+  }
+
+  /* release all sequence dependent data */
+  vrna_hc_free(fc->hc);
+  vrna_sc_free(fc->sc);
+  vrna_ud_remove(fc);
+  vrna_sequence_remove_all(fc);
+  free(fc->sequence);
+  free(fc->sequence_encoding);
+  free(fc->sequence_encoding2);
+  free(fc->ptype);
+  free(fc->ptype_pf_compat);
+  free(fc->iindx);
+  free(fc->jindx);
+
+  fc->hc                  = NULL;
+  fc->sc                  = NULL;
+  fc->sequence_encoding   = NULL;
+  fc->sequence_encoding2  = NULL;
+  fc->ptype               = NULL;
+  fc->ptype_pf_compat     = NULL;
+  fc->iindx               = NULL;
+  fc->jindx               = NULL;
+  fc->cutpoint            = -1;
+
+  fc->length    = length;
+  fc->sequence  = strdup(sequence);
+
+  sanitize_bp_span(fc, options);
+
+  if (fc->exp_params) {
+    fc->exp_params->model_details.window_size = fc->params->model_details.window_size;
+    fc->exp_params->model_details.max_bp_span = fc->params->model_details.max_bp_span;
+  }
+
+  vrna_params_prepare(fc, options);
+
+  aux_options = WITH_PTYPE;
+
+  if (options & VRNA_OPTION_PF)
+    aux_options |= WITH_PTYPE_COMPAT;
+
+  set_fold_compound(fc, options, aux_options);
+
+  vrna_hc_init(fc);
+
+  /*
+   *  DP matrices that are large enough stay where they are, only the
+   *  sequence dependent G-quadruplex energies need to be re-computed
+   */
+  if (fc->matrices) {
+    if ((fc->matrices->type != VRNA_MX_DEFAULT) ||
+        (fc->matrices->length < length)) {
+      vrna_mx_mfe_free(fc);
+    } else if (fc->matrices->ggg) {
+      free(fc->matrices->ggg);
+      fc->matrices->ggg = (fc->params->model_details.gquad) ?
+                          get_gquad_matrix(fc->sequence_encoding2, fc->params) :
+                          NULL;
+    }
+  }
+
+  if ((fc->exp_matrices) &&
+      ((fc->exp_matrices->type != VRNA_MX_DEFAULT) ||
+       (fc->exp_matrices->length < length)))
+    vrna_mx_pf_free(fc);
+
+  return vrna_mx_prepare(fc, options);
+}
+
+
+PUBLIC int
+vrna_fold_compound_batch(const char       **sequences,
+                         unsigned int     num,
+                         const vrna_md_t  *md_p,
+                         unsigned int     options,
+                         vrna_batch_f     cb,
+                         void             *data)
+{
+  int                   cnt, num_threads;
+  unsigned int          i;
+  vrna_fold_compound_t  *fc;
+  vrna_md_t             md;
+
+  if ((!sequences) ||
+      (!cb))
+    return 0;
+
+  if (md_p)
+    md = *md_p;
+  else
+    vrna_md_set_default(&md);
+
+  cnt         = 0;
+  num_threads = md.num_threads;
+
+#ifdef _OPENMP
+  if (num_threads > 1) {
+    /* distribute sequences among threads instead of parallelizing each single fill */
+    md.num_threads = 1;
+
+#pragma omp parallel private(i, fc) num_threads(num_threads) reduction(+:cnt)
+    {
+      fc = NULL;
+
+#pragma omp for schedule(dynamic)
+      for (i = 0; i < num; i++)
+        cnt += batch_process(&fc, sequences[i], i, &md, options, cb, data);
+
+      vrna_fold_compound_free(fc);
+    }
+
+    return cnt;
+  }
+
+#endif
+
+  fc = NULL;
+
+  for (i = 0; i < num; i++)
+    cnt += batch_process(&fc, sequences[i], i, &md, options, cb, data);
+
+  vrna_fold_compound_free(fc);
+
+  return cnt;
+}
+
+
 PUBLIC vrna_fold_compound_t *
 vrna_fold_compound_comparative(const char   **sequences,
                                vrna_md_t    *md_p,
@@ -842,6 +1028,55 @@ make_pscores(vrna_fold_compound_t *fc)
 }
 
 
+/*
+ *  Compare two sets of model details member by member. In contrast to
+ *  memcmp(), this ignores the padding bytes of the structure that may
+ *  hold arbitrary values, e.g. for a vrna_md_t on the stack
+ */
+PRIVATE int
+md_equal(const vrna_md_t  *md1,
+         const vrna_md_t  *md2)
+{
+  return (md1->temperature == md2->temperature) &&
+         (md1->betaScale == md2->betaScale) &&
+         (md1->pf_smooth == md2->pf_smooth) &&
+         (md1->dangles == md2->dangles) &&
+         (md1->special_hp == md2->special_hp) &&
+         (md1->noLP == md2->noLP) &&
+         (md1->noGU == md2->noGU) &&
+         (md1->noGUclosure == md2->noGUclosure) &&
+         (md1->logML == md2->logML) &&
+         (md1->circ == md2->circ) &&
+         (md1->gquad == md2->gquad) &&
+         (md1->uniq_ML == md2->uniq_ML) &&
+         (md1->energy_set == md2->energy_set) &&
+         (md1->backtrack == md2->backtrack) &&
+         (md1->backtrack_type == md2->backtrack_type) &&
+         (md1->compute_bpp == md2->compute_bpp) &&
+         (strncmp(md1->nonstandards, md2->nonstandards, 64) == 0) &&
+         (md1->max_bp_span == md2->max_bp_span) &&
+         (md1->min_loop_size == md2->min_loop_size) &&
+         (md1->window_size == md2->window_size) &&
+         (md1->oldAliEn == md2->oldAliEn) &&
+         (md1->ribo == md2->ribo) &&
+         (md1->cv_fact == md2->cv_fact) &&
+         (md1->nc_fact == md2->nc_fact) &&
+         (md1->sfact == md2->sfact) &&
+         (memcmp(md1->rtype, md2->rtype, sizeof(md1->rtype)) == 0) &&
+         (memcmp(md1->alias, md2->alias, sizeof(md1->alias)) == 0) &&
+         (memcmp(md1->pair, md2->pair, sizeof(md1->pair)) == 0) &&
+         (memcmp(md1->pair_dist, md2->pair_dist, sizeof(md1->pair_dist)) == 0) &&
+         (md1->salt == md2->salt) &&
+         (md1->saltMLLower == md2->saltMLLower) &&
+         (md1->saltMLUpper == md2->saltMLUpper) &&
+         (md1->saltDPXInit == md2->saltDPXInit) &&
+         (md1->saltDPXInitFact == md2->saltDPXInitFact) &&
+         (md1->helical_rise == md2->helical_rise) &&
+         (md1->backbone_length == md2->backbone_length) &&
+         (md1->num_threads == md2->num_threads);
+}
+
+
 PRIVATE vrna_fold_compound_t *
 init_fc_single(void)
 {
@@ -956,3 +1191,33 @@ nullify(vrna_fold_compound_t *fc)
 #endif
   }
 }
+
+
+PRIVATE int
+batch_process(vrna_fold_compound_t  **fc,
+              const char            *sequence,
+              unsigned int          i,
+              const vrna_md_t       *md,
+              unsigned int          options,
+              vrna_batch_f          cb,
+              void                  *data)
+{
+  if (!sequence)
+    return 0;
+
+  if ((*fc) &&
+      (!vrna_fold_compound_reset(*fc, sequence, md, options))) {
+    vrna_fold_compound_free(*fc);
+    *fc = NULL;
+  }
+
+  if (!(*fc))
+    *fc = vrna_fold_compound(sequence, md, options);
+
+  if (!(*fc))
+    return 0;
+
+  cb(*fc, i, data);
+
+  return 1;
+}
@@ -93,6 +93,30 @@ DEPRECATED(typedef void (vrna_callback_free_auxdata)(void *data),
 typedef void (*vrna_recursion_status_f)(unsigned char status,
                                               void          *data);
 
+/**
+ *  @brief  Callback to process a single sequence of a batch
+ *
+ *  @callback
+ *  @parblock
+ *  This function will be called by vrna_fold_compound_batch() once for each input
+ *  sequence. The #vrna_fold_compound_t passed to it is re-used for subsequent sequences,
+ *  so any data derived from it, e.g. structures or energies, must be processed or copied
+ *  before returning. The callback must not free the fold compound.
+ *  If more than one thread is used, the callback will be executed concurrently and
+ *  sequences are not necessarily processed in input order.
+ *  @endparblock
+ *
+ *  @see vrna_fold_compound_batch()
+ *
+ *  @param fc     The fold compound holding the current sequence
+ *  @param i      The 0-based index of the current sequence in the batch
+ *  @param data   The data pointer passed to vrna_fold_compound_batch()
+ */
+typedef void (*vrna_batch_f)(vrna_fold_compound_t  *fc,
+                             unsigned int          i,
+                             void                  *data);
+
+
 DEPRECATED(typedef void (vrna_callback_recursion_status)(unsigned char status,
                                               void          *data),
            "Use vrna_recursion_status_f instead!");
@@ -480,6 +504,72 @@ vrna_fold_compound(const char       *sequence,
                    unsigned int     options);
 
 
+/**
+ *  @brief  Replace the sequence of a single sequence #vrna_fold_compound_t
+ *
+ *  This function re-initializes the fold compound @p fc for a new @p sequence while
+ *  keeping as much of the previously allocated memory as possible. Energy parameters
+ *  are only re-computed if the model details @p md_p differ from those already in use,
+ *  and DP matrices are only re-allocated if the new sequence is longer than any sequence
+ *  they have been allocated for before. All hard and soft constraints, as well as
+ *  unstructured domains, are removed.
+ *
+ *  This is useful whenever many sequences are processed one after another with the
+ *  same model settings, where the creation of a new #vrna_fold_compound_t for each of
+ *  them would otherwise dominate the total runtime.
+ *
+ *  @note   Only fold compounds of type #VRNA_FC_TYPE_SINGLE for global structure
+ *          prediction are supported. Options #VRNA_OPTION_WINDOW and #VRNA_OPTION_EVAL_ONLY
+ *          are not allowed.
+ *
+ *  @see  vrna_fold_compound(), vrna_fold_compound_batch()
+ *
+ *  @param    fc          The fold compound to re-use
+ *  @param    sequence    A single sequence, or multiple concatenated sequences seperated by an '&' character
+ *  @param    md_p        An optional set of model details
+ *  @param    options     The options for DP matrices memory allocation
+ *  @return               Non-zero on success, 0 if @p fc can not be re-used for @p sequence
+ */
+int
+vrna_fold_compound_reset(vrna_fold_compound_t *fc,
+                         const char           *sequence,
+                         const vrna_md_t      *md_p,
+                         unsigned int         options);
+
+
+/**
+ *  @brief  Process a batch of sequences with a re-used #vrna_fold_compound_t
+ *
+ *  For each of the @p num input @p sequences, this function prepares a #vrna_fold_compound_t
+ *  (see vrna_fold_compound()) and passes it to the callback @p cb that may then perform
+ *  arbitrary computations, e.g. vrna_mfe() or vrna_pf(). Instead of creating a new fold
+ *  compound for each sequence, a single one is re-used via vrna_fold_compound_reset().
+ *  Hence, energy parameters are computed only once, and DP matrices are only re-allocated
+ *  whenever the sequence length grows.
+ *
+ *  If #vrna_md_t.num_threads is larger than 1 and OpenMP is available, the sequences
+ *  are distributed among that many threads, each using its own fold compound. In this
+ *  case, the fold compounds passed to the callback fill their DP matrices serially.
+ *
+ *  @see  vrna_batch_f(), vrna_fold_compound_reset(), vrna_fold_compound()
+ *
+ *  @param    sequences   The input sequences
+ *  @param    num         The number of input sequences
+ *  @param    md_p        An optional set of model details
+ *  @param    options     The options for DP matrices memory allocation
+ *  @param    cb          The callback that processes each single sequence
+ *  @param    data        An arbitrary data pointer passed through to @p cb
+ *  @return               The number of sequences passed to @p cb
+ */
+int
+vrna_fold_compound_batch(const char       **sequences,
+                         unsigned int     num,
+                         const vrna_md_t  *md_p,
+                         unsigned int     options,
+                         vrna_batch_f     cb,
+                         void             *data);
+
+
 /**
  *  @brief  Retrieve a #vrna_fold_compound_t data structure for sequence alignments
  *
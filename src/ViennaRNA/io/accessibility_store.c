@@ -0,0 +1,694 @@
+/*
+ *                io/accessibility_store.c
+ *
+ *  Indexed binary container for opening energies of many sequences
+ *
+ *               Vienna RNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define ACC_STORE_WITH_MMAP
+#endif
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/params/constants.h"
+#include "ViennaRNA/params/basic.h"
+#include "ViennaRNA/part_func_window.h"
+#include "ViennaRNA/io/accessibility_store.h"
+
+#define PRIVATE  static
+#define PUBLIC
+
+/*
+ #################################
+ # PRIVATE MACROS                #
+ #################################
+ */
+
+#define ACC_STORE_MAGIC       "VRNAACC"
+#define ACC_STORE_VERSION     1
+#define ACC_STORE_BYTE_ORDER  0x01020304U
+/* data blocks start at cache line boundaries */
+#define ACC_STORE_ALIGNMENT   64
+/* number of unused entries in front of (10) and behind (10) the sequence in each row */
+#define ACC_STORE_PADDING     20
+
+/*
+ #################################
+ # PRIVATE DATA STRUCTURES       #
+ #################################
+ */
+
+/* file header, padded to the size of the data alignment */
+typedef struct {
+  char      magic[8];
+  uint32_t  version;
+  uint32_t  byte_order;
+  uint32_t  ulength;
+  uint32_t  reserved;
+  uint64_t  num_records;
+  uint64_t  index_offset;
+  uint64_t  checksum;
+  double    temperature;
+  uint64_t  unused[2];
+} acc_store_header;
+
+/* index entry, the identifiers are stored behind the entries */
+typedef struct {
+  uint64_t  offset;
+  uint32_t  length;
+  uint32_t  id_offset;
+} acc_store_entry;
+
+/* index entry of a store opened for writing */
+typedef struct {
+  uint64_t  offset;
+  uint32_t  length;
+  char      *id;
+} acc_store_record;
+
+struct vrna_acc_store_s {
+  acc_store_header  header;
+
+  /* writing */
+  FILE              *fp;
+  uint64_t          offset;
+  acc_store_record  *records;
+  size_t            max_records;
+  double            kT;
+  char              *id;
+  unsigned int      length;
+  int               *data;
+
+  /* reading */
+  unsigned char     *base;
+  size_t            size;
+  int               mapped;
+  const acc_store_entry *index;
+  const char        *index_ids;
+};
+
+/*
+ #################################
+ # PRIVATE FUNCTION DECLARATIONS #
+ #################################
+ */
+PRIVATE uint64_t
+params_checksum(const vrna_md_t *md);
+
+
+PRIVATE int
+write_padding(vrna_acc_store_t *store);
+
+
+PRIVATE int
+write_index(vrna_acc_store_t *store);
+
+
+PRIVATE int
+compare_records(const void  *a,
+                const void  *b);
+
+
+PRIVATE int
+check_index(const unsigned char *base,
+            size_t              size);
+
+
+PRIVATE void
+release_data(unsigned char  *base,
+             size_t         size,
+             int            mapped);
+
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+PUBLIC vrna_acc_store_t *
+vrna_acc_store_create(const char      *filename,
+                      unsigned int    ulength,
+                      const vrna_md_t *md)
+{
+  FILE              *fp;
+  vrna_md_t         md_default;
+  vrna_acc_store_t  *store;
+
+  if (!filename)
+    return NULL;
+
+  if (!md) {
+    vrna_md_set_default(&md_default);
+    md = &md_default;
+  }
+
+  fp = fopen(filename, "wb");
+  if (!fp) {
+    vrna_message_warning("vrna_acc_store_create: "
+                         "Failed to open file \"%s\" for writing",
+                         filename);
+    return NULL;
+  }
+
+  store = (vrna_acc_store_t *)vrna_alloc(sizeof(vrna_acc_store_t));
+
+  memcpy(store->header.magic, ACC_STORE_MAGIC, sizeof(ACC_STORE_MAGIC));
+  store->header.version     = ACC_STORE_VERSION;
+  store->header.byte_order  = ACC_STORE_BYTE_ORDER;
+  store->header.ulength     = ulength;
+  store->header.checksum    = params_checksum(md);
+  store->header.temperature = md->temperature;
+
+  store->fp     = fp;
+  store->kT     = md->betaScale * (md->temperature + K0) * GASCONST; /* in cal/mol */
+  store->offset = sizeof(acc_store_header);
+
+  /* reserve space for the header, it is written when the store is closed */
+  if (fwrite(&(store->header), sizeof(acc_store_header), 1, fp) != 1) {
+    vrna_message_warning("vrna_acc_store_create: "
+                         "Failed to write to file \"%s\"",
+                         filename);
+    fclose(fp);
+    free(store);
+    return NULL;
+  }
+
+  return store;
+}
+
+
+PUBLIC int
+vrna_acc_store_record_begin(vrna_acc_store_t  *store,
+                            const char        *id,
+                            unsigned int      length)
+{
+  size_t  i, num;
+
+  if ((!store) ||
+      (!store->fp) ||
+      (!id))
+    return 0;
+
+  /* discard unfinished record */
+  free(store->id);
+  free(store->data);
+
+  num = (size_t)(store->header.ulength + 1) * (length + ACC_STORE_PADDING);
+
+  store->id     = strdup(id);
+  store->length = length;
+  store->data   = (int *)vrna_alloc(sizeof(int) * num);
+
+  for (i = 0; i < num; i++)
+    store->data[i] = VRNA_ACC_STORE_INF;
+
+  store->data[0]  = (int)store->header.ulength;
+  store->data[1]  = (int)length;
+
+  return 1;
+}
+
+
+PUBLIC void
+vrna_acc_store_probs_window_cb(FLT_OR_DBL   *pr,
+                               int          pr_size,
+                               int          i,
+                               int          max,
+                               unsigned int type,
+                               void         *data)
+{
+  int               u, u_max;
+  double            e;
+  size_t            row_size;
+  vrna_acc_store_t  *store;
+
+  store = (vrna_acc_store_t *)data;
+
+  if ((!store) ||
+      (!store->data) ||
+      (!(type & VRNA_PROBS_WINDOW_UP)) ||
+      ((type & VRNA_ANY_LOOP) != VRNA_ANY_LOOP) ||
+      (i < 1) ||
+      (i > (int)store->length))
+    return;
+
+  row_size  = store->length + ACC_STORE_PADDING;
+  u_max     = MIN2(pr_size, (int)store->header.ulength);
+  u_max     = MIN2(u_max, i);
+
+  for (u = 1; u <= u_max; u++) {
+    /* opening energy in dcal/mol */
+    e = (pr[u] > 0.) ? -log(pr[u]) * store->kT / 10. : (double)VRNA_ACC_STORE_INF;
+    store->data[u * row_size + 10 + i] = (e < (double)VRNA_ACC_STORE_INF) ?
+                                         (int)rint(e) :
+                                         VRNA_ACC_STORE_INF;
+  }
+}
+
+
+PUBLIC int
+vrna_acc_store_record_end(vrna_acc_store_t *store)
+{
+  size_t  num;
+
+  if ((!store) ||
+      (!store->fp) ||
+      (!store->data))
+    return 0;
+
+  if (!write_padding(store))
+    return 0;
+
+  num = (size_t)(store->header.ulength + 1) * (store->length + ACC_STORE_PADDING);
+
+  if (fwrite(store->data, sizeof(int), num, store->fp) != num) {
+    vrna_message_warning("vrna_acc_store_record_end: "
+                         "Failed to write record \"%s\"",
+                         store->id);
+    return 0;
+  }
+
+  if (store->header.num_records == store->max_records) {
+    store->max_records  = 2 * store->max_records + 64;
+    store->records      = (acc_store_record *)vrna_realloc(store->records,
+                                                           sizeof(acc_store_record) *
+                                                           store->max_records);
+  }
+
+  store->records[store->header.num_records].offset  = store->offset;
+  store->records[store->header.num_records].length  = store->length;
+  store->records[store->header.num_records].id      = store->id;
+  store->header.num_records++;
+
+  store->offset += sizeof(int) * num;
+
+  free(store->data);
+  store->id   = NULL;
+  store->data = NULL;
+
+  return 1;
+}
+
+
+PUBLIC vrna_acc_store_t *
+vrna_acc_store_open(const char *filename)
+{
+  unsigned char     *base;
+  size_t            size, index_size;
+  int               mapped;
+  acc_store_header  *header;
+  vrna_acc_store_t  *store;
+
+  if (!filename)
+    return NULL;
+
+  base    = NULL;
+  size    = 0;
+  mapped  = 0;
+
+#ifdef ACC_STORE_WITH_MMAP
+  int         fd;
+  struct stat st;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  if ((fstat(fd, &st) == 0) &&
+      (st.st_size >= (off_t)sizeof(acc_store_header))) {
+    size  = (size_t)st.st_size;
+    base  = (unsigned char *)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+      base = NULL;
+    else
+      mapped = 1;
+  }
+
+  close(fd);
+#endif
+
+  if (!base) {
+    /* fall-back to reading the entire file into memory */
+    FILE  *fp = fopen(filename, "rb");
+    long  file_size;
+
+    if (!fp)
+      return NULL;
+
+    if ((fseek(fp, 0, SEEK_END) == 0) &&
+        ((file_size = ftell(fp)) >= (long)sizeof(acc_store_header))) {
+      size  = (size_t)file_size;
+      base  = (unsigned char *)vrna_alloc(size);
+      rewind(fp);
+      if (fread(base, 1, size, fp) != size) {
+        free(base);
+        base = NULL;
+      }
+    }
+
+    fclose(fp);
+
+    if (!base)
+      return NULL;
+  }
+
+  header = (acc_store_header *)base;
+
+  /* check whether the file actually contains a complete and consistent store */
+  if (!check_index(base, size)) {
+    release_data(base, size, mapped);
+    return NULL;
+  }
+
+  index_size = (size_t)header->num_records * sizeof(acc_store_entry);
+
+  store             = (vrna_acc_store_t *)vrna_alloc(sizeof(vrna_acc_store_t));
+  store->header     = *header;
+  store->base       = base;
+  store->size       = size;
+  store->mapped     = mapped;
+  store->index      = (const acc_store_entry *)(base + header->index_offset);
+  store->index_ids  = (const char *)(base + header->index_offset + index_size);
+
+  return store;
+}
+
+
+PUBLIC const int *
+vrna_acc_store_get(const vrna_acc_store_t *store,
+                   const char             *id,
+                   unsigned int           *length)
+{
+  int     c;
+  size_t  lo, hi, mid;
+
+  if ((!store) ||
+      (!store->base) ||
+      (!id))
+    return NULL;
+
+  /* binary search in the index which is sorted by identifier */
+  lo  = 0;
+  hi  = store->header.num_records;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    c   = strcmp(id, store->index_ids + store->index[mid].id_offset);
+
+    if (c == 0) {
+      if (length)
+        *length = store->index[mid].length;
+
+      return (const int *)(store->base + store->index[mid].offset);
+    } else if (c < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  return NULL;
+}
+
+
+PUBLIC unsigned int
+vrna_acc_store_ulength(const vrna_acc_store_t *store)
+{
+  return (store) ? store->header.ulength : 0;
+}
+
+
+PUBLIC unsigned int
+vrna_acc_store_size(const vrna_acc_store_t *store)
+{
+  return (store) ? (unsigned int)store->header.num_records : 0;
+}
+
+
+PUBLIC double
+vrna_acc_store_temperature(const vrna_acc_store_t *store)
+{
+  return (store) ? store->header.temperature : 0.;
+}
+
+
+PUBLIC int
+vrna_acc_store_params_match(const vrna_acc_store_t  *store,
+                            const vrna_md_t         *md)
+{
+  vrna_md_t md_default;
+
+  if (!store)
+    return 0;
+
+  if (!md) {
+    vrna_md_set_default(&md_default);
+    md = &md_default;
+  }
+
+  return (store->header.temperature == md->temperature) &&
+         (store->header.checksum == params_checksum(md));
+}
+
+
+PUBLIC int
+vrna_acc_store_close(vrna_acc_store_t *store)
+{
+  int     ret;
+  size_t  i;
+
+  if (!store)
+    return 0;
+
+  ret = 1;
+
+  if (store->fp) {
+    ret = write_index(store);
+
+    if (fclose(store->fp) != 0)
+      ret = 0;
+
+    for (i = 0; i < store->header.num_records; i++)
+      free(store->records[i].id);
+
+    free(store->records);
+    free(store->id);
+    free(store->data);
+  } else if (store->base) {
+    release_data(store->base, store->size, store->mapped);
+  }
+
+  free(store);
+
+  return ret;
+}
+
+
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
+
+/* FNV-1a hash of the temperature scaled energy parameters */
+PRIVATE uint64_t
+params_checksum(const vrna_md_t *md)
+{
+  size_t              i, n;
+  uint64_t            hash;
+  const unsigned char *p;
+  vrna_param_t        *P;
+
+  P     = vrna_params((vrna_md_t *)md);
+  p     = (const unsigned char *)&(P->stack);
+  n     = offsetof(vrna_param_t, temperature) - offsetof(vrna_param_t, stack);
+  hash  = 14695981039346656037ULL;
+
+  for (i = 0; i < n; i++) {
+    hash  ^= (uint64_t)p[i];
+    hash  *= 1099511628211ULL;
+  }
+
+  free(P);
+
+  return hash;
+}
+
+
+PRIVATE int
+write_padding(vrna_acc_store_t *store)
+{
+  unsigned char zeros[ACC_STORE_ALIGNMENT] = {
+    0
+  };
+  size_t        pad;
+
+  pad = (ACC_STORE_ALIGNMENT - store->offset % ACC_STORE_ALIGNMENT) % ACC_STORE_ALIGNMENT;
+
+  if ((pad > 0) &&
+      (fwrite(zeros, 1, pad, store->fp) != pad))
+    return 0;
+
+  store->offset += pad;
+
+  return 1;
+}
+
+
+PRIVATE int
+write_index(vrna_acc_store_t *store)
+{
+  size_t          i, n, id_length;
+  uint32_t        id_offset;
+  acc_store_entry entry;
+
+  n = store->header.num_records;
+
+  /* sort records by identifier to allow for binary search */
+  if (n > 1)
+    qsort(store->records, n, sizeof(acc_store_record), compare_records);
+
+  if (!write_padding(store))
+    return 0;
+
+  /* the index must be unique to be searchable */
+  for (i = 1; i < n; i++)
+    if (strcmp(store->records[i - 1].id, store->records[i].id) == 0) {
+      vrna_message_warning("vrna_acc_store_close: "
+                           "Duplicate record \"%s\"",
+                           store->records[i].id);
+      return 0;
+    }
+
+  store->header.index_offset = store->offset;
+
+  for (id_offset = 0, i = 0; i < n; i++) {
+    entry.offset    = store->records[i].offset;
+    entry.length    = store->records[i].length;
+    entry.id_offset = id_offset;
+    id_offset       += strlen(store->records[i].id) + 1;
+
+    if (fwrite(&entry, sizeof(acc_store_entry), 1, store->fp) != 1)
+      return 0;
+  }
+
+  for (i = 0; i < n; i++) {
+    id_length = strlen(store->records[i].id) + 1;
+    if (fwrite(store->records[i].id, 1, id_length, store->fp) != id_length)
+      return 0;
+  }
+
+  /* finally, write the complete header */
+  if ((fseek(store->fp, 0, SEEK_SET) != 0) ||
+      (fwrite(&(store->header), sizeof(acc_store_header), 1, store->fp) != 1))
+    return 0;
+
+  return 1;
+}
+
+
+PRIVATE int
+compare_records(const void  *a,
+                const void  *b)
+{
+  return strcmp(((const acc_store_record *)a)->id,
+                ((const acc_store_record *)b)->id);
+}
+
+
+/*
+ *  Make sure that every access through the index stays within the first
+ *  size bytes at base, i.e. that the header refers to an index within
+ *  the file, each record fits between the header and the index, each
+ *  identifier is terminated within the file, and the identifiers are
+ *  unique and sorted such that vrna_acc_store_get() finds them
+ */
+PRIVATE int
+check_index(const unsigned char *base,
+            size_t              size)
+{
+  const char              *ids, *id, *id_prev;
+  size_t                  i, ids_size, index_size, num;
+  uint64_t                available;
+  const acc_store_header  *header;
+  const acc_store_entry   *index;
+
+  header = (const acc_store_header *)base;
+
+  if ((memcmp(header->magic, ACC_STORE_MAGIC, sizeof(ACC_STORE_MAGIC)) != 0) ||
+      (header->version != ACC_STORE_VERSION) ||
+      (header->byte_order != ACC_STORE_BYTE_ORDER) ||
+      (header->index_offset < sizeof(acc_store_header)) ||
+      (header->index_offset > size) ||
+      (header->index_offset % ACC_STORE_ALIGNMENT) ||
+      (header->num_records > (size - header->index_offset) / sizeof(acc_store_entry)))
+    return 0;
+
+  num         = (size_t)header->num_records;
+  index_size  = num * sizeof(acc_store_entry);
+  index       = (const acc_store_entry *)(base + header->index_offset);
+  ids         = (const char *)(base + header->index_offset + index_size);
+  ids_size    = size - header->index_offset - index_size;
+  id_prev     = NULL;
+
+  for (i = 0; i < num; i++) {
+    /* records are stored aligned between the header and the index */
+    if ((index[i].offset < sizeof(acc_store_header)) ||
+        (index[i].offset % ACC_STORE_ALIGNMENT) ||
+        (index[i].offset > header->index_offset))
+      return 0;
+
+    available = (header->index_offset - index[i].offset) / sizeof(int);
+
+    if ((uint64_t)index[i].length + ACC_STORE_PADDING >
+        available / ((uint64_t)header->ulength + 1))
+      return 0;
+
+    if ((index[i].id_offset >= ids_size) ||
+        (!memchr(ids + index[i].id_offset, '\0', ids_size - index[i].id_offset)))
+      return 0;
+
+    id = ids + index[i].id_offset;
+
+    if ((id_prev) &&
+        (strcmp(id_prev, id) >= 0))
+      return 0;
+
+    id_prev = id;
+  }
+
+  return 1;
+}
+
+
+PRIVATE void
+release_data(unsigned char  *base,
+             size_t         size,
+             int            mapped)
+{
+#ifdef ACC_STORE_WITH_MMAP
+  if (mapped) {
+    munmap(base, size);
+    return;
+  }
+
+#endif
+
+  free(base);
+}
@@ -0,0 +1,190 @@
+#ifndef VIENNA_RNA_PACKAGE_FILE_ACCESSIBILITY_STORE_H
+#define VIENNA_RNA_PACKAGE_FILE_ACCESSIBILITY_STORE_H
+
+/**
+ *  @file     ViennaRNA/io/accessibility_store.h
+ *  @ingroup  file_utils, acc_store
+ *  @brief    An indexed binary container for opening energies of many sequences
+ */
+
+#include <ViennaRNA/datastructures/basic.h>
+#include <ViennaRNA/model.h>
+
+/**
+ *  @addtogroup acc_store
+ *  @{
+ *  @brief  Store opening energies computed by vrna_probs_window() for later use by interaction prediction tools
+ *
+ *  An accessibility store is a single binary file that holds the opening energies, i.e.
+ *  @f$ -RT \ln p^u_k @f$ for the probability @f$ p^u_k @f$ that the segment of length
+ *  @f$ u @f$ that ends at position @f$ k @f$ is unpaired, of an arbitrary number of
+ *  sequences. The file starts with a header that stores the maximum segment length
+ *  @f$ u @f$, the temperature, and a checksum of the energy parameters used for the
+ *  computations. It is followed by one data block per sequence and an index that maps
+ *  sequence identifiers to the data blocks.
+ *
+ *  Each data block consists of @f$ u + 1 @f$ rows of @f$ n + 20 @f$ integers for a
+ *  sequence of length @f$ n @f$, i.e. it uses the same layout as the binary opening
+ *  energy files of RNAplfold. Row @f$ 0 @f$ starts with @f$ u @f$ and @f$ n @f$, the entry
+ *  at index @f$ 10 + k @f$ of row @f$ u > 0 @f$ holds the opening energy in dcal/mol of
+ *  the segment of length @f$ u @f$ that ends at position @f$ k @f$. All other entries are
+ *  set to #VRNA_ACC_STORE_INF.
+ *
+ *  Stores are opened for reading through memory mapping whenever the system supports it.
+ *  The data blocks are then accessed without any copying or parsing.
+ *
+ *  A store is written by first creating it with vrna_acc_store_create(). Then, for each
+ *  sequence, a record is started with vrna_acc_store_record_begin(), filled by passing
+ *  vrna_acc_store_probs_window_cb() to vrna_probs_window() (or by calling it from within
+ *  another callback), and finished with vrna_acc_store_record_end(). Finally,
+ *  vrna_acc_store_close() writes the index.
+ */
+
+/**
+ *  @brief  Value of unavailable entries in an accessibility store
+ */
+#define VRNA_ACC_STORE_INF  1000000
+
+/**
+ *  @brief  An accessibility store, opened for either writing or reading
+ */
+typedef struct vrna_acc_store_s vrna_acc_store_t;
+
+/**
+ *  @brief  Create a new accessibility store
+ *
+ *  @see  vrna_acc_store_record_begin(), vrna_acc_store_close()
+ *
+ *  @param  filename  The name of the file the store is written to
+ *  @param  ulength   The maximum length of unpaired segments
+ *  @param  md        The model details used to compute the unpaired probabilities (maybe NULL)
+ *  @return           The accessibility store, or NULL on any error
+ */
+vrna_acc_store_t *
+vrna_acc_store_create(const char      *filename,
+                      unsigned int    ulength,
+                      const vrna_md_t *md);
+
+
+/**
+ *  @brief  Start a new record in an accessibility store
+ *
+ *  @param  store   The accessibility store as obtained from vrna_acc_store_create()
+ *  @param  id      The identifier of the sequence
+ *  @param  length  The length of the sequence
+ *  @return         1 on success, 0 otherwise
+ */
+int
+vrna_acc_store_record_begin(vrna_acc_store_t  *store,
+                            const char        *id,
+                            unsigned int      length);
+
+
+/**
+ *  @brief  Add unpaired probabilities to the current record of an accessibility store
+ *
+ *  This function is a #vrna_probs_window_f callback that expects the accessibility store
+ *  as its @p data argument. Any data other than unpaired probabilities for
+ *  #VRNA_ANY_LOOP is ignored.
+ *
+ *  @see  vrna_probs_window(), #VRNA_PROBS_WINDOW_UP
+ */
+void
+vrna_acc_store_probs_window_cb(FLT_OR_DBL   *pr,
+                               int          pr_size,
+                               int          i,
+                               int          max,
+                               unsigned int type,
+                               void         *data);
+
+
+/**
+ *  @brief  Finish the current record and write it to the accessibility store
+ *
+ *  @param  store   The accessibility store as obtained from vrna_acc_store_create()
+ *  @return         1 on success, 0 otherwise
+ */
+int
+vrna_acc_store_record_end(vrna_acc_store_t *store);
+
+
+/**
+ *  @brief  Open an existing accessibility store for reading
+ *
+ *  @param  filename  The name of the file that holds the store
+ *  @return           The accessibility store, or NULL if the file is not an accessibility store
+ *                    or its index is inconsistent
+ */
+vrna_acc_store_t *
+vrna_acc_store_open(const char *filename);
+
+
+/**
+ *  @brief  Retrieve the opening energies of a sequence from an accessibility store
+ *
+ *  The returned data block must not be modified and is only valid until the store is
+ *  closed.
+ *
+ *  @param  store   The accessibility store as obtained from vrna_acc_store_open()
+ *  @param  id      The identifier of the sequence
+ *  @param  length  A pointer where the length of the sequence is stored to (maybe NULL)
+ *  @return         The data block of the sequence, or NULL if the identifier is not in the store
+ */
+const int *
+vrna_acc_store_get(const vrna_acc_store_t *store,
+                   const char             *id,
+                   unsigned int           *length);
+
+
+/**
+ *  @brief  Get the maximum length of unpaired segments in an accessibility store
+ */
+unsigned int
+vrna_acc_store_ulength(const vrna_acc_store_t *store);
+
+
+/**
+ *  @brief  Get the number of records in an accessibility store
+ */
+unsigned int
+vrna_acc_store_size(const vrna_acc_store_t *store);
+
+
+/**
+ *  @brief  Get the temperature the data of an accessibility store was computed at
+ */
+double
+vrna_acc_store_temperature(const vrna_acc_store_t *store);
+
+
+/**
+ *  @brief  Check whether an accessibility store was computed with particular energy parameters
+ *
+ *  @param  store   The accessibility store
+ *  @param  md      The model details that determine the energy parameters (maybe NULL)
+ *  @return         1 if temperature and energy parameters match, 0 otherwise
+ */
+int
+vrna_acc_store_params_match(const vrna_acc_store_t  *store,
+                            const vrna_md_t         *md);
+
+
+/**
+ *  @brief  Close an accessibility store
+ *
+ *  Stores opened for writing are completed by adding the index of all records. Any
+ *  unfinished record is discarded. Since records are retrieved by their identifier,
+ *  completing the store fails if two records share the same identifier.
+ *
+ *  @param  store   The accessibility store
+ *  @return         1 on success, 0 otherwise
+ */
+int
+vrna_acc_store_close(vrna_acc_store_t *store);
+
+
+/**
+ *  @}
+ */
+
+#endif
@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <limits.h>
 
@@ -21,18 +22,25 @@
 #include "ViennaRNA/landscape/findpath.h"
 
 
-#ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
-
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+#ifndef INLINE
+#ifdef __GNUC__
+# define INLINE inline
+#else
+# define INLINE
+#endif
 #endif
 
 #define LOOP_EN
 
 #define   PATH_DIRECT_FINDPATH     1U
 
+/* number of moves encoded in a single word of a packed structure */
+#define   KEY_WORD_BITS           64
+
 /**
  *  @brief
  */
@@ -47,13 +55,50 @@ typedef struct move {
  *  @brief
  */
 typedef struct intermediate {
-  short   *pt;      /**<  @brief  pair table */
-  int     Sen;      /**<  @brief  saddle energy so far */
-  int     curr_en;  /**<  @brief  current energy */
-  move_t  *moves;   /**<  @brief  remaining moves to target */
+  short     *pt;      /**<  @brief  pair table */
+  int       Sen;      /**<  @brief  saddle energy so far */
+  int       curr_en;  /**<  @brief  current energy */
+  move_t    *moves;   /**<  @brief  remaining moves to target */
+  uint64_t  *key;     /**<  @brief  packed structure, i.e. the set of moves applied so far */
 } intermediate_t;
 
 
+/*
+ *  Fixed-size slots for the pair tables, move lists, and packed
+ *  structures of the intermediates of an entire distance class
+ */
+typedef struct {
+  size_t    size;   /* number of slots */
+  short     *pt;
+  move_t    *moves;
+  uint64_t  *keys;
+} intermediate_arena_t;
+
+
+/*
+ *  State of a single findpath search. Everything lives here rather than
+ *  in (thread-private) globals, such that the search is re-entrant
+ */
+typedef struct {
+  int                   len;            /* length of the pair tables */
+  int                   BP_dist;        /* base pair distance of start and target */
+  int                   key_words;      /* number of words of a packed structure */
+  int                   num_threads;    /* number of threads to evaluate moves with */
+
+  move_t                *path;          /* moves along the best path found */
+  int                   path_fwd;       /* 1: s1->s2, else s2 -> s1 */
+
+  intermediate_arena_t  arena[2];       /* current and next distance class */
+  intermediate_t        *candidates;    /* candidates of the next distance class */
+  int                   *num_candidates; /* number of candidates generated from each intermediate */
+  intermediate_t        *uniq;          /* unique candidates */
+  size_t                size;           /* capacity of candidates and uniq */
+  int                   max_current;    /* capacity of num_candidates */
+  int                   *table;         /* hash set of packed structures, i.e. indices in uniq */
+  unsigned int          table_size;     /* a power of 2 */
+} findpath_ctx_t;
+
+
 struct vrna_path_options_s {
   unsigned int  type;
   unsigned int  method;
@@ -72,10 +117,6 @@ struct vrna_path_options_s {
  # PRIVATE VARIABLES             #
  #################################
  */
-PRIVATE int                   BP_dist;
-PRIVATE move_t                *path = NULL;
-PRIVATE int                   path_fwd; /* 1: s1->s2, else s2 -> s1 */
-
 
 #ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
 
@@ -85,7 +126,7 @@ PRIVATE vrna_fold_compound_t  *backward_compat_compound = NULL;
 
 /* NOTE: all variables are assumed to be uninitialized if they are declared as threadprivate
  */
-#pragma omp threadprivate(BP_dist, path, path_fwd, backward_compat_compound)
+#pragma omp threadprivate(backward_compat_compound)
 
 #endif
 
@@ -96,13 +137,67 @@ PRIVATE vrna_fold_compound_t  *backward_compat_compound = NULL;
  # PRIVATE FUNCTION DECLARATIONS #
  #################################
  */
-PRIVATE move_t *
-copy_moves(move_t *mvs);
+PRIVATE void
+init_ctx(findpath_ctx_t       *ctx,
+         vrna_fold_compound_t *fc);
+
+
+PRIVATE void
+free_ctx(findpath_ctx_t *ctx);
+
+
+PRIVATE void
+reserve_candidates(findpath_ctx_t *ctx,
+                   int            num_current,
+                   int            stride);
+
+
+PRIVATE void
+reserve_arena(findpath_ctx_t        *ctx,
+              intermediate_arena_t  *arena,
+              size_t                slots);
 
 
 PRIVATE int
-compare_ptable(const void *A,
-               const void *B);
+findpath_saddle(vrna_fold_compound_t  *fc,
+                const char            *s1,
+                const char            *s2,
+                int                   width,
+                int                   maxE,
+                findpath_ctx_t        *ctx);
+
+
+PRIVATE int
+known_saddle(int          *saddles,
+             unsigned int num,
+             unsigned int i,
+             unsigned int j);
+
+
+PRIVATE INLINE int
+get_saddle(int          *saddles,
+           unsigned int num,
+           unsigned int i,
+           unsigned int j);
+
+
+PRIVATE INLINE void
+set_saddle(int          *saddles,
+           unsigned int num,
+           unsigned int i,
+           unsigned int j,
+           int          saddle);
+
+
+PRIVATE int
+unique_candidates(findpath_ctx_t  *ctx,
+                  int             num_current,
+                  int             stride);
+
+
+PRIVATE INLINE unsigned int
+hash_key(const uint64_t *key,
+         int            words);
 
 
 PRIVATE int
@@ -115,10 +210,6 @@ compare_moves_when(const void *A,
                    const void *B);
 
 
-PRIVATE void
-free_intermediate(intermediate_t *i);
-
-
 #ifdef TEST_FINDPATH
 
 /* TEST_FINDPATH, COFOLD */
@@ -130,6 +221,7 @@ usage(void);
 
 PRIVATE int
 find_path_once(vrna_fold_compound_t *vc,
+               findpath_ctx_t       *ctx,
                short                *pt1,
                short                *pt2,
                int                  maxl,
@@ -138,8 +230,11 @@ find_path_once(vrna_fold_compound_t *vc,
 
 PRIVATE int
 try_moves(vrna_fold_compound_t  *vc,
-          intermediate_t        c,
+          findpath_ctx_t        *ctx,
+          intermediate_t        *c,
           int                   maxE,
+          intermediate_arena_t  *arena,
+          size_t                slot,
           intermediate_t        *next,
           int                   dist);
 
@@ -188,38 +283,66 @@ vrna_path_findpath_saddle_ub(vrna_fold_compound_t *vc,
                              const char           *s2,
                              int                  width,
                              int                  maxE)
+{
+  int             saddleE;
+  findpath_ctx_t  ctx;
+
+  if ((!vc) ||
+      (!s1) ||
+      (!s2))
+    return maxE;
+
+  init_ctx(&ctx, vc);
+
+  saddleE = findpath_saddle(vc, s1, s2, width, maxE, &ctx);
+
+  free_ctx(&ctx);
+
+  return saddleE;
+}
+
+
+PRIVATE int
+findpath_saddle(vrna_fold_compound_t  *vc,
+                const char            *s1,
+                const char            *s2,
+                int                   width,
+                int                   maxE,
+                findpath_ctx_t        *ctx)
 {
   int     maxl;
   short   *ptr, *pt1, *pt2;
   move_t  *bestpath = NULL;
   int     dir;
 
-  path_fwd  = dir = 0;
-  pt1       = vrna_ptable(s1);
-  pt2       = vrna_ptable(s2);
+  ctx->path_fwd = dir = 0;
+  pt1           = vrna_ptable(s1);
+  pt2           = vrna_ptable(s2);
 
   maxl = 1;
   do {
     int saddleE;
-    path_fwd = !path_fwd;
+    ctx->path_fwd = !ctx->path_fwd;
     if (maxl > width)
       maxl = width;
 
-    if (path)
-      free(path);
+    if (ctx->path)
+      free(ctx->path);
 
-    saddleE = find_path_once(vc, pt1, pt2, maxl, maxE);
+    ctx->path = NULL;
+
+    saddleE = find_path_once(vc, ctx, pt1, pt2, maxl, maxE);
     if (saddleE < maxE) {
       maxE = saddleE;
       if (bestpath)
         free(bestpath);
 
-      bestpath  = path;
-      path      = NULL;
-      dir       = path_fwd;
+      bestpath  = ctx->path;
+      ctx->path = NULL;
+      dir       = ctx->path_fwd;
     } else {
-      free(path);
-      path = NULL;
+      free(ctx->path);
+      ctx->path = NULL;
     }
 
     ptr   = pt1;
@@ -228,9 +351,9 @@ vrna_path_findpath_saddle_ub(vrna_fold_compound_t *vc,
     maxl  *= 2;
   } while (maxl < 2 * width);
 
-  /* (re)set some globals */
-  path      = bestpath;
-  path_fwd  = dir;
+  /* (re)set the result */
+  ctx->path     = bestpath;
+  ctx->path_fwd = dir;
 
   free(pt1);
   free(pt2);
@@ -239,6 +362,138 @@ vrna_path_findpath_saddle_ub(vrna_fold_compound_t *vc,
 }
 
 
+PUBLIC int *
+vrna_path_findpath_saddle_matrix(vrna_fold_compound_t *fc,
+                                 const char           **structures,
+                                 unsigned int         num,
+                                 int                  width,
+                                 unsigned int         options)
+{
+  unsigned int  i, j, d, n, max_dist, *count, *pairs;
+  int           p, num_pairs, num_threads, *saddles;
+  short         **pt;
+
+  if ((!fc) ||
+      (!structures))
+    return NULL;
+
+  /* we index pairs of structures by int */
+  if ((num > 0) &&
+      ((size_t)num * (num - 1) > INT_MAX)) {
+    vrna_message_warning("vrna_path_findpath_saddle_matrix(): "
+                         "Too many structures (%u)!",
+                         num);
+    return NULL;
+  }
+
+  n   = fc->length;
+  pt  = (short **)vrna_alloc(sizeof(short *) * (num + 1));
+
+  for (i = 0; i < num; i++) {
+    if ((!structures[i]) ||
+        (strlen(structures[i]) != n)) {
+      vrna_message_warning("vrna_path_findpath_saddle_matrix(): "
+                           "Structure %u does not match the length of the sequence!",
+                           i + 1);
+      for (j = 0; j < i; j++)
+        free(pt[j]);
+
+      free(pt);
+      return NULL;
+    }
+
+    pt[i] = vrna_ptable(structures[i]);
+  }
+
+  saddles = (int *)vrna_alloc(sizeof(int) * ((size_t)num * num + 1));
+
+  for (i = 0; i < num; i++)
+    for (j = 0; j < num; j++)
+      saddles[(size_t)i * num + j] = (i == j) ?
+                                     vrna_eval_structure_pt(fc, pt[i]) :
+                                     INT_MAX;
+
+  /*
+   *  Order the pairs by base pair distance (counting sort). Searches
+   *  between close structures are cheap and their saddles provide the
+   *  upper bounds for the more expensive searches between distant ones
+   */
+  num_pairs = (options & VRNA_PATH_SADDLE_MATRIX_SYMMETRIC) ?
+              (int)(((size_t)num * (num - 1)) / 2) :
+              (int)((size_t)num * (num - 1));
+  max_dist  = n;
+  count     = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (max_dist + 2));
+  pairs     = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (num_pairs + 1));
+
+  for (i = 0; i < num; i++)
+    for (j = i + 1; j < num; j++) {
+      d = (unsigned int)vrna_bp_distance_pt(pt[i], pt[j]);
+      count[d + 1] += (options & VRNA_PATH_SADDLE_MATRIX_SYMMETRIC) ? 1 : 2;
+    }
+
+  for (d = 1; d <= max_dist + 1; d++)
+    count[d] += count[d - 1];
+
+  for (i = 0; i < num; i++)
+    for (j = i + 1; j < num; j++) {
+      d                   = (unsigned int)vrna_bp_distance_pt(pt[i], pt[j]);
+      pairs[count[d]++]   = i * num + j;
+      if (!(options & VRNA_PATH_SADDLE_MATRIX_SYMMETRIC))
+        pairs[count[d]++] = j * num + i;
+    }
+
+  free(count);
+
+  for (i = 0; i < num; i++)
+    free(pt[i]);
+
+  free(pt);
+
+  num_threads = 1;
+
+#ifdef _OPENMP
+  /*
+   *  Concurrent searches evaluate moves on the same fold compound, so we
+   *  stay serial for soft constraint callbacks, see also init_ctx()
+   */
+  if ((fc->params->model_details.num_threads > 1) &&
+      (!((fc->type == VRNA_FC_TYPE_SINGLE) &&
+         (fc->sc) &&
+         ((fc->sc->f) || (fc->sc->prepare_data)))))
+    num_threads = fc->params->model_details.num_threads;
+
+#endif
+
+  /*
+   *  The searches take vastly different amounts of time, so threads take
+   *  the next pair from the ordered list as soon as they are done
+   */
+#pragma omp parallel for private(i, j) schedule(dynamic, 1) num_threads(num_threads) \
+  if (num_threads > 1)
+  for (p = 0; p < num_pairs; p++) {
+    int maxE, saddle;
+
+    i     = pairs[p] / num;
+    j     = pairs[p] % num;
+    maxE  = INT_MAX - 1;
+
+    if (options & VRNA_PATH_SADDLE_MATRIX_UPPER_BOUND)
+      maxE = MIN2(maxE, known_saddle(saddles, num, i, j));
+
+    saddle = vrna_path_findpath_saddle_ub(fc, structures[i], structures[j], width, maxE);
+
+    set_saddle(saddles, num, i, j, saddle);
+
+    if (options & VRNA_PATH_SADDLE_MATRIX_SYMMETRIC)
+      set_saddle(saddles, num, j, i, saddle);
+  }
+
+  free(pairs);
+
+  return saddles;
+}
+
+
 PUBLIC vrna_path_t *
 vrna_path_findpath(vrna_fold_compound_t *fc,
                    const char           *s1,
@@ -314,11 +569,18 @@ findpath_method(vrna_fold_compound_t  *fc,
                 int                   maxE,
                 unsigned int          return_type)
 {
-  int         E, d;
-  float       last_E;
-  vrna_path_t *route = NULL;
+  int             E, d, BP_dist, path_fwd;
+  float           last_E;
+  move_t          *path;
+  vrna_path_t     *route = NULL;
+  findpath_ctx_t  ctx;
 
-  E = vrna_path_findpath_saddle_ub(fc, s1, s2, width, maxE);
+  init_ctx(&ctx, fc);
+
+  E         = findpath_saddle(fc, s1, s2, width, maxE, &ctx);
+  BP_dist   = ctx.BP_dist;
+  path      = ctx.path;
+  path_fwd  = ctx.path_fwd;
 
   /* did we find a better path than one with saddle maxE? */
   if (E < maxE) {
@@ -343,11 +605,11 @@ findpath_method(vrna_fold_compound_t  *fc,
         } else {
           last_E = vrna_eval_structure(fc, s2);
           for (d = 0; d < BP_dist; d++) {
-            route[BP_dist - d - 2].type = return_type;
-            route[BP_dist - d - 2].move = vrna_move_init(path[d].i,
+            route[BP_dist - d - 1].type = return_type;
+            route[BP_dist - d - 1].move = vrna_move_init(path[d].i,
                                                          path[d].j);
-            route[BP_dist - d - 2].en = last_E - (path[d].E / 100.0);
-            last_E                    = path[d].E / 100;
+            route[BP_dist - d - 1].en = last_E - (path[d].E / 100.0);
+            last_E                    = path[d].E / 100.0;
           }
 
           route[BP_dist].type = return_type;
@@ -420,8 +682,7 @@ findpath_method(vrna_fold_compound_t  *fc,
 #endif
   }
 
-  free(path);
-  path = NULL;
+  free_ctx(&ctx);
 
   return route;
 }
@@ -476,7 +737,6 @@ PUBLIC void
 print_path(const char *seq,
            const char *struc)
 {
-  int   d;
   char  *s;
 
   s = strdup(struc);
@@ -494,21 +754,6 @@ print_path(const char *seq,
     free(pseq);
   }
 
-  qsort(path, BP_dist, sizeof(move_t), compare_moves_when);
-  for (d = 0; d < BP_dist; d++) {
-    int i, j;
-    i = path[d].i;
-    j = path[d].j;
-    if (i < 0) {
-      /* delete */
-      s[(-i) - 1] = s[(-j) - 1] = '.';
-    } else {
-      s[i - 1]  = '(';
-      s[j - 1]  = ')';
-    }
-
-    /* printf("%s %6.2f - %6.2f\n", s, vrna_eval_structure_simple(seq,s), path[d].E/100.0); */
-  }
   free(s);
 }
 
@@ -556,13 +801,8 @@ main(int  argc,
   E = find_saddle(seq, s1, s2, maxkeep);
   printf("saddle_energy = %6.2f\n", E / 100.);
   if (verbose) {
-    if (path_fwd)
-      print_path(seq, s1);
-    else
-      print_path(seq, s2);
+    print_path(seq, s1);
 
-    free(path);
-    path  = NULL;
     route = get_path(seq, s1, s2, maxkeep);
     for (r = route; r->s; r++) {
       if (cut_point == -1) {
@@ -603,62 +843,175 @@ usage(void)
  # STATIC helper functions below #
  #################################
  */
+PRIVATE void
+init_ctx(findpath_ctx_t       *ctx,
+         vrna_fold_compound_t *fc)
+{
+  memset(ctx, 0, sizeof(findpath_ctx_t));
+
+  ctx->num_threads = 1;
+
+#ifdef _OPENMP
+  /*
+   *  Moves are evaluated concurrently on the same fold compound, so
+   *  we stay serial if user-supplied soft constraint callbacks are
+   *  present that may not be thread-safe. Searches that run in
+   *  parallel already, e.g. for a saddle matrix, stay serial, too
+   */
+  if ((fc->params->model_details.num_threads > 1) &&
+      (!omp_in_parallel()) &&
+      (!((fc->type == VRNA_FC_TYPE_SINGLE) &&
+         (fc->sc) &&
+         ((fc->sc->f) || (fc->sc->prepare_data)))))
+    ctx->num_threads = fc->params->model_details.num_threads;
+
+#endif
+}
+
+
+PRIVATE void
+free_ctx(findpath_ctx_t *ctx)
+{
+  int i;
+
+  for (i = 0; i < 2; i++) {
+    free(ctx->arena[i].pt);
+    free(ctx->arena[i].moves);
+    free(ctx->arena[i].keys);
+  }
+
+  free(ctx->candidates);
+  free(ctx->num_candidates);
+  free(ctx->uniq);
+  free(ctx->table);
+  free(ctx->path);
+}
+
+
+PRIVATE void
+reserve_arena(findpath_ctx_t        *ctx,
+              intermediate_arena_t  *arena,
+              size_t                slots)
+{
+  if (slots > arena->size) {
+    arena->pt = (short *)vrna_realloc(arena->pt,
+                                      sizeof(short) * (ctx->len + 1) * slots);
+    arena->moves = (move_t *)vrna_realloc(arena->moves,
+                                          sizeof(move_t) * (ctx->BP_dist + 1) * slots);
+    arena->keys = (uint64_t *)vrna_realloc(arena->keys,
+                                           sizeof(uint64_t) * ctx->key_words * slots);
+    arena->size = slots;
+  }
+}
+
+
+PRIVATE void
+reserve_candidates(findpath_ctx_t *ctx,
+                   int            num_current,
+                   int            stride)
+{
+  size_t        size;
+  unsigned int  table_size;
+
+  size = (size_t)num_current * stride;
+
+  if (size > ctx->size) {
+    ctx->candidates = (intermediate_t *)vrna_realloc(ctx->candidates,
+                                                     sizeof(intermediate_t) * size);
+    ctx->uniq = (intermediate_t *)vrna_realloc(ctx->uniq,
+                                               sizeof(intermediate_t) * size);
+    ctx->size = size;
+  }
+
+  if (num_current > ctx->max_current) {
+    ctx->num_candidates = (int *)vrna_realloc(ctx->num_candidates,
+                                              sizeof(int) * num_current);
+    ctx->max_current = num_current;
+  }
+
+  /* keep the load factor of the hash set below 1/2 */
+  for (table_size = 16; table_size < 2 * size; table_size <<= 1);
+
+  if (table_size > ctx->table_size) {
+    ctx->table      = (int *)vrna_realloc(ctx->table, sizeof(int) * table_size);
+    ctx->table_size = table_size;
+  }
+}
+
+
 PRIVATE int
 try_moves(vrna_fold_compound_t  *vc,
-          intermediate_t        c,
+          findpath_ctx_t        *ctx,
+          intermediate_t        *c,
           int                   maxE,
+          intermediate_arena_t  *arena,
+          size_t                slot,
           intermediate_t        *next,
           int                   dist)
 {
-  int     *loopidx, len, num_next = 0, en, oldE;
-  move_t  *mv;
-  short   *pt;
-
-  len     = c.pt[0];
-  loopidx = vrna_loopidx_from_ptable(c.pt);
-  oldE    = c.Sen;
-  for (mv = c.moves; mv->i != 0; mv++) {
+  int             *loopidx, len, num_next = 0, en, oldE, m;
+  move_t          *mv;
+  short           *pt;
+  intermediate_t  *n;
+
+  len     = c->pt[0];
+  loopidx = vrna_loopidx_from_ptable(c->pt);
+  oldE    = c->Sen;
+  for (m = 0, mv = c->moves; mv->i != 0; m++, mv++) {
     int i, j;
     if (mv->when > 0)
       continue;
 
-    i   = mv->i;
-    j   = mv->j;
-    pt  = (short *)vrna_alloc(sizeof(short) * (len + 1));
-    memcpy(pt, c.pt, (len + 1) * sizeof(short));
+    i = mv->i;
+    j = mv->j;
+    if ((j > 0) &&
+        ((loopidx[i] != loopidx[j]) ||  /* i and j do not belong to same loop */
+         (c->pt[i] != 0) ||             /* ... or are paired */
+         (c->pt[j] != 0)))
+      continue; /* illegal move, try next; */
+
+#ifdef LOOP_EN
+    en = c->curr_en + vrna_eval_move_pt(vc, c->pt, i, j);
+    if (en >= maxE)
+      continue;
+
+#endif
+
+    /* store the candidate in its arena slot */
+    n         = next + num_next;
+    n->pt     = arena->pt + (slot + num_next) * (len + 1);
+    n->moves  = arena->moves + (slot + num_next) * (ctx->BP_dist + 1);
+    n->key    = arena->keys + (slot + num_next) * ctx->key_words;
+    pt        = n->pt;
+
+    memcpy(pt, c->pt, sizeof(short) * (len + 1));
     if (j < 0) {
       /*it's a delete move */
       pt[-i]  = 0;
       pt[-j]  = 0;
     } else {
       /* insert move */
-      if ((loopidx[i] == loopidx[j]) && /* i and j belong to same loop */
-          (pt[i] == 0) && (pt[j] == 0)  /* ... and are unpaired */
-          ) {
-        pt[i] = j;
-        pt[j] = i;
-      } else {
-        free(pt);
-        continue; /* llegal move, try next; */
-      }
+      pt[i] = j;
+      pt[j] = i;
     }
 
-#ifdef LOOP_EN
-    en = c.curr_en + vrna_eval_move_pt(vc, c.pt, i, j);
-#else
+#ifndef LOOP_EN
     en = vrna_eval_structure_pt(vc, pt);
+    if (en >= maxE)
+      continue;
+
 #endif
-    if (en < maxE) {
-      next[num_next].Sen      = (en > oldE) ? en : oldE;
-      next[num_next].curr_en  = en;
-      next[num_next].pt       = pt;
-      mv->when                = dist;
-      mv->E                   = en;
-      next[num_next++].moves  = copy_moves(c.moves);
-      mv->when                = 0;
-    } else {
-      free(pt);
-    }
+
+    memcpy(n->moves, c->moves, sizeof(move_t) * (ctx->BP_dist + 1));
+    n->moves[m].when  = dist;
+    n->moves[m].E     = en;
+
+    memcpy(n->key, c->key, sizeof(uint64_t) * ctx->key_words);
+    n->key[m / KEY_WORD_BITS] |= (uint64_t)1 << (m % KEY_WORD_BITS);
+
+    n->Sen      = (en > oldE) ? en : oldE;
+    n->curr_en  = en;
+    num_next++;
   }
   free(loopidx);
   return num_next;
@@ -667,27 +1020,27 @@ try_moves(vrna_fold_compound_t  *vc,
 
 PRIVATE int
 find_path_once(vrna_fold_compound_t *vc,
+               findpath_ctx_t       *ctx,
                short                *pt1,
                short                *pt2,
                int                  maxl,
                int                  maxE)
 {
-  move_t          *mlist;
-  int             i, len, d, dist = 0, result;
-  short           *pt;
-  intermediate_t  *current, *next;
+  move_t                *mlist;
+  int                   i, len, d, dist = 0, result, num_current, cur;
+  intermediate_t        *current;
+  intermediate_arena_t  *arena;
 
   len = (int)pt1[0];
-  pt  = vrna_ptable_copy(pt1);
 
-  mlist = (move_t *)vrna_alloc(sizeof(move_t) * len); /* bp_dist < n */
+  mlist = (move_t *)vrna_alloc(sizeof(move_t) * (len + 1)); /* bp_dist <= n */
 
   for (i = 1; i <= len; i++) {
-    if (pt[i] != pt2[i]) {
-      if (i < pt[i]) {
+    if (pt1[i] != pt2[i]) {
+      if (i < pt1[i]) {
         /* need to delete this pair */
         mlist[dist].i       = -i;
-        mlist[dist].j       = -pt[i];
+        mlist[dist].j       = -pt1[i];
         mlist[dist++].when  = 0;
       }
 
@@ -700,85 +1053,201 @@ find_path_once(vrna_fold_compound_t *vc,
     }
   }
 
-  BP_dist           = dist;
-  current           = (intermediate_t *)vrna_alloc(sizeof(intermediate_t) * (maxl + 1));
-  current[0].pt     = pt;
-  current[0].Sen    = current[0].curr_en = vrna_eval_structure_pt(vc, pt);
-  current[0].moves  = mlist;
-  next              = (intermediate_t *)vrna_alloc(sizeof(intermediate_t) * (dist * maxl + 1));
+  /*
+   *  the arenas are re-used by all runs of the same findpath search,
+   *  which share the base pair distance of start and target
+   */
+  ctx->BP_dist    = dist;
+  ctx->key_words  = dist / KEY_WORD_BITS + 1;
+  ctx->len        = len;
+
+  /* the start structure */
+  cur   = 0;
+  arena = &(ctx->arena[cur]);
+  reserve_arena(ctx, arena, 1);
+
+  current           = (intermediate_t *)vrna_alloc(sizeof(intermediate_t) * maxl);
+  current[0].pt     = arena->pt;
+  current[0].moves  = arena->moves;
+  current[0].key    = arena->keys;
+  memcpy(current[0].pt, pt1, sizeof(short) * (len + 1));
+  memcpy(current[0].moves, mlist, sizeof(move_t) * (dist + 1));
+  memset(current[0].key, 0, sizeof(uint64_t) * ctx->key_words);
+  current[0].Sen    = current[0].curr_en = vrna_eval_structure_pt(vc, pt1);
+  num_current       = 1;
+  result            = INT_MAX;
+
+  free(mlist);
 
   for (d = 1; d <= dist; d++) {
     /* go through the distance classes */
-    int             c, u, num_next = 0;
-    intermediate_t  *cc;
+    int c, num_next, stride;
+
+    /* each intermediate may generate at most one candidate per remaining move */
+    stride  = dist - d + 1;
+    cur     = 1 - cur;
+    arena   = &(ctx->arena[cur]);
+
+    reserve_arena(ctx, arena, (size_t)num_current * stride);
+    reserve_candidates(ctx, num_current, stride);
+
+    /*
+     *  each intermediate writes its candidates to a separate
+     *  range of slots, so we can evaluate them concurrently
+     */
+#pragma omp parallel for schedule(dynamic, 1) num_threads(ctx->num_threads) \
+    if ((ctx->num_threads > 1) && (num_current > 1))
+    for (c = 0; c < num_current; c++)
+      ctx->num_candidates[c] = try_moves(vc,
+                                         ctx,
+                                         current + c,
+                                         maxE,
+                                         arena,
+                                         (size_t)c * stride,
+                                         ctx->candidates + (size_t)c * stride,
+                                         d);
+
+    num_next = unique_candidates(ctx, num_current, stride);
 
-    for (c = 0; current[c].pt != NULL; c++)
-      num_next += try_moves(vc, current[c], maxE, next + num_next, d);
     if (num_next == 0) {
-      for (cc = current; cc->pt != NULL; cc++)
-        free_intermediate(cc);
-      current[0].Sen = INT_MAX;
+      num_current = 0;
       break;
     }
 
-    /* remove duplicates via sort|uniq
-     * if this becomes a bottleneck we can use a hash instead */
-    qsort(next, num_next, sizeof(intermediate_t), compare_ptable);
-    for (u = 0, c = 1; c < num_next; c++) {
-      if (memcmp(next[u].pt, next[c].pt, sizeof(short) * len) != 0)
-        next[++u] = next[c];
-      else
-        free_intermediate(next + c);
-    }
-    num_next = u + 1;
-    qsort(next, num_next, sizeof(intermediate_t), compare_energy);
-    /* free the old stuff */
-    for (cc = current; cc->pt != NULL; cc++)
-      free_intermediate(cc);
-    for (u = 0; u < maxl && u < num_next; u++)
-      current[u] = next[u];
-    for (; u < num_next; u++)
-      free_intermediate(next + u);
-    num_next = 0;
+    qsort(ctx->uniq, num_next, sizeof(intermediate_t), compare_energy);
+
+    /* keep the best candidates, they reside in the arena of the current distance class */
+    num_current = MIN2(maxl, num_next);
+    memcpy(current, ctx->uniq, sizeof(intermediate_t) * num_current);
+  }
+
+  if (num_current > 0) {
+    ctx->path = (move_t *)vrna_alloc(sizeof(move_t) * (dist + 1));
+    memcpy(ctx->path, current[0].moves, sizeof(move_t) * (dist + 1));
+    result = current[0].Sen;
   }
-  free(next);
-  path    = current[0].moves;
-  result  = current[0].Sen;
-  free(current[0].pt);
+
   free(current);
   return result;
 }
 
 
-PRIVATE void
-free_intermediate(intermediate_t *i)
+/*
+ *  The lowest saddle of the known paths from structure i to j via any
+ *  other structure k. Unknown saddles are INT_MAX, and since a reversed
+ *  path has the same saddle, we use whichever direction is known
+ */
+PRIVATE int
+known_saddle(int          *saddles,
+             unsigned int num,
+             unsigned int i,
+             unsigned int j)
 {
-  free(i->pt);
-  free(i->moves);
-  i->pt     = NULL;
-  i->moves  = NULL;
-  i->Sen    = INT_MAX;
+  unsigned int  k;
+  int           a, b, best;
+
+  best = INT_MAX;
+
+  for (k = 0; k < num; k++) {
+    a = MIN2(get_saddle(saddles, num, i, k), get_saddle(saddles, num, k, i));
+    if (a >= best)
+      continue;
+
+    b = MIN2(get_saddle(saddles, num, k, j), get_saddle(saddles, num, j, k));
+    if (b >= best)
+      continue;
+
+    best = MAX2(a, b);
+  }
+
+  return best;
 }
 
 
+PRIVATE INLINE int
+get_saddle(int          *saddles,
+           unsigned int num,
+           unsigned int i,
+           unsigned int j)
+{
+  /* other threads may update the matrix concurrently */
+  return __atomic_load_n(&saddles[(size_t)i * num + j], __ATOMIC_RELAXED);
+}
+
+
+PRIVATE INLINE void
+set_saddle(int          *saddles,
+           unsigned int num,
+           unsigned int i,
+           unsigned int j,
+           int          saddle)
+{
+  __atomic_store_n(&saddles[(size_t)i * num + j], saddle, __ATOMIC_RELAXED);
+}
+
+
+/*
+ *  Collect the unique candidates of a distance class. Of all candidates
+ *  with the same structure, we keep the one with lowest saddle energy
+ *  that was generated first. Since all intermediates are obtained from
+ *  the start structure by a subset of the same list of moves, the set
+ *  of applied moves serves as packed representation of the structure.
+ */
 PRIVATE int
-compare_ptable(const void *A,
-               const void *B)
+unique_candidates(findpath_ctx_t  *ctx,
+                  int             num_current,
+                  int             stride)
 {
-  intermediate_t  *a, *b;
-  int             c;
+  int             c, k, u, num_uniq;
+  unsigned int    h, mask;
+  size_t          key_size;
+  intermediate_t  *cand, *uniq;
+
+  uniq      = ctx->uniq;
+  num_uniq  = 0;
+  mask      = ctx->table_size - 1;
+  key_size  = sizeof(uint64_t) * ctx->key_words;
+
+  memset(ctx->table, -1, sizeof(int) * ctx->table_size);
+
+  for (c = 0; c < num_current; c++) {
+    cand = ctx->candidates + (size_t)c * stride;
+    for (k = 0; k < ctx->num_candidates[c]; k++, cand++) {
+      /* linear probing */
+      for (h = hash_key(cand->key, ctx->key_words) & mask;
+           (u = ctx->table[h]) != -1;
+           h = (h + 1) & mask)
+        if (!memcmp(uniq[u].key, cand->key, key_size))
+          break;
+
+      if (u == -1) {
+        ctx->table[h]     = num_uniq;
+        uniq[num_uniq++]  = *cand;
+      } else if (cand->Sen < uniq[u].Sen) {
+        uniq[u] = *cand;
+      }
+    }
+  }
 
-  a = (intermediate_t *)A;
-  b = (intermediate_t *)B;
+  return num_uniq;
+}
 
-  c = memcmp(a->pt, b->pt, a->pt[0] * sizeof(short));
-  if (c != 0)
-    return c;
 
-  if ((a->Sen - b->Sen) != 0)
-    return a->Sen - b->Sen;
+PRIVATE INLINE unsigned int
+hash_key(const uint64_t *key,
+         int            words)
+{
+  int       w;
+  uint64_t  h = 0;
+
+  /* multiplicative hashing, the multiplier is derived from the golden ratio */
+  for (w = 0; w < words; w++) {
+    h ^= key[w];
+    h *= 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 32;
+  }
 
-  return a->curr_en - b->curr_en;
+  return (unsigned int)h;
 }
 
 
@@ -794,7 +1263,11 @@ compare_energy(const void *A,
   if ((a->Sen - b->Sen) != 0)
     return a->Sen - b->Sen;
 
-  return a->curr_en - b->curr_en;
+  if ((a->curr_en - b->curr_en) != 0)
+    return a->curr_en - b->curr_en;
+
+  /* break ties by structure to obtain a deterministic order */
+  return memcmp(a->pt, b->pt, a->pt[0] * sizeof(short));
 }
 
 
@@ -811,17 +1284,6 @@ compare_moves_when(const void *A,
 }
 
 
-PRIVATE move_t *
-copy_moves(move_t *mvs)
-{
-  move_t *new;
-
-  new = (move_t *)vrna_alloc(sizeof(move_t) * (BP_dist + 1));
-  memcpy(new, mvs, sizeof(move_t) * (BP_dist + 1));
-  return new;
-}
-
-
 /*
  *###########################################
  *# deprecated functions below              #
@@ -43,6 +43,11 @@
  * fc = vrna_fold_compound(sequence, NULL, VRNA_OPTION_DEFAULT);
  *  @endcode
  *
+ *  @note   This function is re-entrant, i.e. it may be called concurrently for the same
+ *          #vrna_fold_compound_t from different threads. If the model setting
+ *          #vrna_md_t.num_threads is greater than 1, the moves of each distance class
+ *          are evaluated with multiple threads.
+ *
  *  @see vrna_path_findpath_saddle_ub(), vrna_fold_compound(), #vrna_fold_compound_t, vrna_path_findpath()
  *
  *  @param fc     The #vrna_fold_compound_t with precomputed sequence encoding and model details
@@ -155,6 +160,72 @@ vrna_path_findpath_ub(vrna_fold_compound_t  *fc,
                       int                   maxE);
 
 
+/**
+ *  @brief  Option flag for vrna_path_findpath_saddle_matrix() to compute the saddles of all pairs of structures
+ *
+ *  @see    vrna_path_findpath_saddle_matrix(), #VRNA_PATH_SADDLE_MATRIX_SYMMETRIC, #VRNA_PATH_SADDLE_MATRIX_UPPER_BOUND
+ */
+#define VRNA_PATH_SADDLE_MATRIX_DEFAULT       0U
+
+/**
+ *  @brief  Option flag for vrna_path_findpath_saddle_matrix() to compute the saddle of each unordered pair only once
+ *
+ *  Since the reversed refolding path has the same saddle, the saddle between structures @f$i < j@f$ is then
+ *  also used for the pair @f$(j, i)@f$, which halves the number of findpath searches.
+ *
+ *  @see    vrna_path_findpath_saddle_matrix()
+ */
+#define VRNA_PATH_SADDLE_MATRIX_SYMMETRIC     1U
+
+/**
+ *  @brief  Option flag for vrna_path_findpath_saddle_matrix() to bound each search by the lowest known saddle
+ *
+ *  The lowest saddle of the paths from structure @f$i@f$ to @f$j@f$ via any other structure @f$k@f$,
+ *  as far as the saddles of @f$(i,k)@f$ and @f$(k,j)@f$ are already known, is passed as upper bound
+ *  to vrna_path_findpath_saddle_ub(). Searches that can not improve on this bound are pruned early,
+ *  and the matrix then stores the bound instead of the direct saddle.
+ *
+ *  @see    vrna_path_findpath_saddle_matrix()
+ */
+#define VRNA_PATH_SADDLE_MATRIX_UPPER_BOUND   2U
+
+
+/**
+ *  @brief Find the saddle energies between all pairs of a list of structures
+ *
+ *  This function fills the matrix of saddle energies between each pair of the @p num structures in
+ *  @p structures using vrna_path_findpath_saddle_ub(). Pairs are processed in ascending order of their base
+ *  pair distance and, if the model setting #vrna_md_t.num_threads is greater than 1, distributed dynamically
+ *  among multiple threads. The diagonal of the matrix holds the free energies of the structures.
+ *
+ *  By default, the saddle energies of both, the pair @f$(i,j)@f$ and @f$(j,i)@f$ are computed. Use
+ *  #VRNA_PATH_SADDLE_MATRIX_SYMMETRIC to compute only one of them, and #VRNA_PATH_SADDLE_MATRIX_UPPER_BOUND
+ *  to prune searches that can not improve the lowest saddle known from the other structures.
+ *
+ *  @note   With #VRNA_PATH_SADDLE_MATRIX_UPPER_BOUND, an entry may be the saddle of an indirect path
+ *          through other structures. Which bounds are available for a pair depends on the order
+ *          in which the threads finish their searches, so the result may vary for more than one thread.
+ *
+ *  @see vrna_path_findpath_saddle_ub(), #VRNA_PATH_SADDLE_MATRIX_DEFAULT, #VRNA_PATH_SADDLE_MATRIX_SYMMETRIC,
+ *       #VRNA_PATH_SADDLE_MATRIX_UPPER_BOUND
+ *
+ *  @param fc         The #vrna_fold_compound_t with precomputed sequence encoding and model details
+ *  @param structures The list of structures in dot-bracket notation
+ *  @param num        The number of structures
+ *  @param width      A number specifying how many strutures are being kept at each step during the search
+ *  @param options    A bitwise OR of the @p VRNA_PATH_SADDLE_MATRIX_* option flags
+ *  @returns          The @p num @f$\times@f$ @p num matrix of saddle energies in 10cal/mol in row-major order,
+ *                    where entry @f$i \cdot num + j@f$ is the saddle from structure @f$i@f$ to @f$j@f$,
+ *                    or @em NULL on error
+ */
+int *
+vrna_path_findpath_saddle_matrix(vrna_fold_compound_t *fc,
+                                 const char           **structures,
+                                 unsigned int         num,
+                                 int                  width,
+                                 unsigned int         options);
+
+
 #ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
 
 /**
@@ -144,6 +144,18 @@ vrna_mx_pf_aux_el_t
 vrna_exp_E_ext_fast_init(vrna_fold_compound_t *fc);
 
 
+/**
+ *  @brief  Prepare auxiliary helper arrays that keep all columns
+ *
+ *  Same as vrna_exp_E_ext_fast_init() but every column @f$j@f$ is kept
+ *  such that cells of different columns can be evaluated concurrently,
+ *  e.g. when filling the matrices along diagonals. Not available for
+ *  sliding-window computations.
+ */
+vrna_mx_pf_aux_el_t
+vrna_exp_E_ext_fast_init_full(vrna_fold_compound_t *fc);
+
+
 void
 vrna_exp_E_ext_fast_rotate(vrna_mx_pf_aux_el_t aux_mx);
 
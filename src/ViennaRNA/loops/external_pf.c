@@ -12,6 +12,7 @@
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/higher_order_functions.h"
 #include "ViennaRNA/alphabet.h"
 #include "ViennaRNA/constraints/hard.h"
 #include "ViennaRNA/constraints/soft.h"
@@ -37,6 +38,8 @@ struct vrna_mx_pf_aux_el_s {
 
   int         qqu_size;
   FLT_OR_DBL  **qqu;
+
+  FLT_OR_DBL  **qq_mx;    /* qq_mx[j][i] holds all columns of qq (diagonal fill only) */
 };
 
 /*
@@ -153,6 +156,7 @@ vrna_exp_E_ext_fast_init(vrna_fold_compound_t *fc)
     aux_mx->qq1       = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
     aux_mx->qqu_size  = 0;
     aux_mx->qqu       = NULL;
+    aux_mx->qq_mx     = NULL;
 
     /* pre-processing ligand binding production rule(s) and auxiliary memory */
     if (with_ud) {
@@ -202,10 +206,49 @@ vrna_exp_E_ext_fast_init(vrna_fold_compound_t *fc)
 }
 
 
+PUBLIC struct vrna_mx_pf_aux_el_s *
+vrna_exp_E_ext_fast_init_full(vrna_fold_compound_t *fc)
+{
+  struct vrna_mx_pf_aux_el_s *aux_mx = vrna_exp_E_ext_fast_init(fc);
+
+  if ((aux_mx) &&
+      (fc->hc->type != VRNA_HC_WINDOW)) {
+    int         j, n, u;
+    FLT_OR_DBL  *mem;
+
+    n = (int)fc->length;
+
+    /*
+     *  column j of qq is accessed for rows 0 up to j + 1. This also
+     *  replaces the qqu arrays, since qqu[u] simply refers to column j - u
+     */
+    if (aux_mx->qqu) {
+      for (u = 0; u <= aux_mx->qqu_size; u++)
+        free(aux_mx->qqu[u]);
+
+      free(aux_mx->qqu);
+      aux_mx->qqu       = NULL;
+      aux_mx->qqu_size  = 0;
+    }
+
+    mem           = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((n + 1) * (n + 6) / 2));
+    aux_mx->qq_mx = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+
+    for (j = 0; j <= n; j++) {
+      aux_mx->qq_mx[j]  = mem;
+      mem               += j + 2;
+    }
+  }
+
+  return aux_mx;
+}
+
+
 PUBLIC void
 vrna_exp_E_ext_fast_rotate(struct vrna_mx_pf_aux_el_s *aux_mx)
 {
-  if (aux_mx) {
+  if ((aux_mx) &&
+      (!aux_mx->qq_mx)) {
     int         u;
     FLT_OR_DBL  *tmp;
 
@@ -240,6 +283,11 @@ vrna_exp_E_ext_fast_free(struct vrna_mx_pf_aux_el_s *aux_mx)
       free(aux_mx->qqu);
     }
 
+    if (aux_mx->qq_mx) {
+      free(aux_mx->qq_mx[0]);
+      free(aux_mx->qq_mx);
+    }
+
     free(aux_mx);
   }
 }
@@ -327,7 +375,7 @@ reduce_ext_ext_fast(vrna_fold_compound_t        *fc,
   sc_ext_exp_cb sc_red_ext;
 
   domains_up  = fc->domains_up;
-  qq1         = aux_mx->qq1;
+  qq1         = (aux_mx->qq_mx) ? aux_mx->qq_mx[j - 1] : aux_mx->qq1;
   qqu         = aux_mx->qqu;
   scale       = fc->exp_matrices->scale;
   sc_red_ext  = sc_wrapper->red_ext;
@@ -346,7 +394,7 @@ reduce_ext_ext_fast(vrna_fold_compound_t        *fc,
         u = domains_up->uniq_motif_size[cnt];
         if (j - u >= i) {
           if (evaluate(i, j, i, j - u, VRNA_DECOMP_EXT_EXT, hc_dat_local)) {
-            q_temp2 = qqu[u][i] *
+            q_temp2 = ((aux_mx->qq_mx) ? aux_mx->qq_mx[j - u][i] : qqu[u][i]) *
                       domains_up->exp_energy_cb(fc,
                                                 j - u + 1,
                                                 j,
@@ -500,7 +548,7 @@ split_ext_fast(vrna_fold_compound_t       *fc,
   q   = (fc->hc->type == VRNA_HC_WINDOW) ?
         fc->exp_matrices->q_local[i] :
         fc->exp_matrices->q + idx[i];
-  qq  = aux_mx->qq;
+  qq  = (aux_mx->qq_mx) ? aux_mx->qq_mx[j] : aux_mx->qq;
   qbt = 0.;
 
   /*
@@ -545,11 +593,11 @@ split_ext_fast(vrna_fold_compound_t       *fc,
    *  strands in hard constraints, we have to think of something else...
    */
   if ((evaluate == &hc_ext_cb_def) || (evaluate == &hc_ext_cb_def_window)) {
-    for (k = j; k > i; k--) {
-      qbt += q[ij1] *
-             qqq[k];
-      ij1 -= factor;
-    }
+    /* q is traversed in ascending order for global, but descending order for local folding */
+    if (factor == -1)
+      qbt = vrna_fun_zip_mul_sum_rev(q + ij1, qqq + j, j - i);
+    else
+      qbt = vrna_fun_zip_mul_sum(q + i, qqq + i + 1, j - i);
   } else {
     for (k = j; k > i; k--) {
       if (evaluate(i, j, k - 1, k, VRNA_DECOMP_EXT_EXT_EXT, hc_dat_local))
@@ -594,7 +642,7 @@ exp_E_ext_fast(vrna_fold_compound_t       *fc,
   struct hc_ext_def_dat     hc_dat_local;
   struct sc_ext_exp_dat     sc_wrapper;
 
-  qq          = aux_mx->qq;
+  qq          = (aux_mx->qq_mx) ? aux_mx->qq_mx[j] : aux_mx->qq;
   qqu         = aux_mx->qqu;
   pf_params   = fc->exp_params;
   md          = &(pf_params->model_details);
@@ -630,7 +678,7 @@ exp_E_ext_fast(vrna_fold_compound_t       *fc,
 
   qq[i] = qbt1;
 
-  if (with_ud)
+  if ((with_ud) && (qqu))
     qqu[0][i] = qbt1;
 
   /* the entire stretch [i,j] is unpaired */
@@ -16,7 +16,9 @@
 #include "ViennaRNA/gquad.h"
 #include "ViennaRNA/structured_domains.h"
 #include "ViennaRNA/unstructured_domains.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/loops/internal.h"
+#include "ViennaRNA/loops/internal_intern.h"
 
 
 #ifdef __GNUC__
@@ -28,6 +30,9 @@
 #include "internal_hc.inc"
 #include "internal_sc.inc"
 
+
+typedef int (*proto_int_loop_row)(const vrna_int_loop_row_t *row);
+
 /*
  #################################
  # PRIVATE FUNCTION DECLARATIONS #
@@ -40,6 +45,53 @@ E_internal_loop(vrna_fold_compound_t  *fc,
                 int                   j);
 
 
+PRIVATE int
+E_internal_loop_gathered(vrna_fold_compound_t *fc,
+                         int                  i,
+                         int                  j);
+
+
+PRIVATE INLINE int
+E_internal_loop_row(vrna_fold_compound_t  *fc,
+                    int                   i,
+                    int                   j,
+                    int                   l,
+                    int                   first_k,
+                    int                   last_k,
+                    unsigned int          type,
+                    const int             *e_salt);
+
+
+PRIVATE int
+int_loop_row_dispatcher(const vrna_int_loop_row_t *row);
+
+
+PRIVATE int
+int_loop_row_default(const vrna_int_loop_row_t *row);
+
+
+#if VRNA_WITH_SIMD_AVX512
+int
+vrna_E_int_loop_row_avx512(const vrna_int_loop_row_t *row);
+
+
+#endif
+
+#if VRNA_WITH_SIMD_AVX2
+int
+vrna_E_int_loop_row_avx2(const vrna_int_loop_row_t *row);
+
+
+#endif
+
+#if VRNA_WITH_SIMD_SSE41
+int
+vrna_E_int_loop_row_sse41(const vrna_int_loop_row_t *row);
+
+
+#endif
+
+
 PRIVATE int
 E_ext_internal_loop(vrna_fold_compound_t  *fc,
                     int                   i,
@@ -70,6 +122,9 @@ eval_ext_int_loop(vrna_fold_compound_t  *fc,
                   int                   l);
 
 
+PRIVATE proto_int_loop_row int_loop_row = &int_loop_row_dispatcher;
+
+
 /*
  #################################
  # BEGIN OF FUNCTION DEFINITIONS #
@@ -411,6 +466,21 @@ E_internal_loop(vrna_fold_compound_t  *fc,
   with_ud     = ((domains_up) && (domains_up->energy_cb)) ? 1 : 0;
   with_gquad  = md->gquad;
 
+  /*
+   *  without any of the extensions above, loops of single sequences are
+   *  evaluated by plain table lookups, see E_internal_loop_gathered()
+   */
+  if ((fc->type == VRNA_FC_TYPE_SINGLE) &&
+      (!sliding_window) &&
+      (!with_ud) &&
+      (!with_gquad) &&
+      (!sc_wrapper.pair) &&
+      (!fc->hc->f) &&
+      (sn[i] == sn[j])) {
+    free_sc_int(&sc_wrapper);
+    return E_internal_loop_gathered(fc, i, j);
+  }
+
   hc_decompose = (sliding_window) ? hc_mx_local[i][j - i] : hc_mx[n * i + j];
 
   if (hc_decompose & VRNA_CONSTRAINT_CONTEXT_INT_LOOP) {
@@ -831,6 +901,251 @@ E_internal_loop(vrna_fold_compound_t  *fc,
 }
 
 
+/*
+ *  Minimum of c[k,l] + E_int(i,j,k,l) over all generic (or 1xn) loops with
+ *  fixed l and k in [first_k, last_k]. c, ptype, and the (transposed) hard
+ *  constraints are contiguous along k, the types and terminal mismatches of
+ *  (k,l) are gathered from the parameter tables by the SIMD kernel selected
+ *  at runtime, see int_loop_row_dispatcher(). The mismatch of the enclosing
+ *  pair (i,j) is identical for all k and therefore added after the
+ *  minimization.
+ */
+PRIVATE INLINE int
+E_internal_loop_row(vrna_fold_compound_t  *fc,
+                    int                   i,
+                    int                   j,
+                    int                   l,
+                    int                   first_k,
+                    int                   last_k,
+                    unsigned int          type,
+                    const int             *e_salt)
+{
+  short               *S;
+  unsigned int        n;
+  int                 e, kl, u1, u2, e_mm;
+  int                 (*mm)[5][5];
+  vrna_param_t        *P;
+  vrna_int_loop_row_t row;
+
+  n   = fc->length;
+  P   = fc->params;
+  S   = fc->sequence_encoding;
+  u1  = first_k - i - 1;
+  u2  = j - l - 1;
+  kl  = fc->jindx[l] + first_k;
+
+  if (u2 == 1) {
+    mm    = P->mismatch1nI;
+    e_mm  = P->mismatch1nI[type][S[i + 1]][S[j - 1]];
+  } else {
+    mm    = P->mismatchI;
+    e_mm  = P->mismatchI[type][S[i + 1]][S[j - 1]];
+  }
+
+  /* the hard constraints are symmetric, so we read the contiguous row of l */
+  row.c           = fc->matrices->c + kl;
+  row.ptype       = fc->ptype + kl;
+  row.hc          = fc->hc->mx + n * l + first_k;
+  row.S           = S + first_k - 1;
+  row.mm          = &(mm[0][S[l + 1]][0]);
+  row.rtype       = &(P->model_details.rtype[0]);
+  row.e_loop      = P->internal_loop + u1 + u2;
+  row.e_salt      = e_salt + u1 + u2;
+  row.asym        = u1 - u2;
+  row.ninio       = P->ninio[2];
+  row.max_ninio   = MAX_NINIO;
+  row.noGUclosure = P->model_details.noGUclosure;
+  row.count       = last_k - first_k + 1;
+
+  e = (*int_loop_row)(&row);
+
+  return (e < INF) ? e + e_mm : INF;
+}
+
+
+/*
+ *  Interior loops of single sequences without soft constraints, hard
+ *  constraint callbacks, unstructured domains, and G-Quadruplexes. The
+ *  default hard constraints then reduce to the decomposition flags of
+ *  (k,l), and E_IntLoop() is split up by loop type: Stacks, bulges, and
+ *  the special 1x1, 2x1, 2x2, and 2x3 loops are looked up one by one, all
+ *  other loops of a row with fixed l are processed by E_internal_loop_row().
+ *  The result is identical to the element-wise evaluation in E_internal_loop().
+ */
+PRIVATE int
+E_internal_loop_gathered(vrna_fold_compound_t *fc,
+                         int                  i,
+                         int                  j)
+{
+  unsigned char *hc_mx;
+  char          *ptype;
+  short         *S;
+  unsigned int  n, type, type2;
+  int           e, eee, k, l, kl, u, u2, first_k, last_k, noGUclosure, *c, *idx, *rtype,
+                *hc_up, e_salt[MAXLOOP + 1];
+  vrna_param_t  *P;
+  vrna_md_t     *md;
+
+  n     = fc->length;
+  hc_mx = fc->hc->mx;
+
+  if (!(hc_mx[n * i + j] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP))
+    return INF;
+
+  idx         = fc->jindx;
+  ptype       = fc->ptype;
+  S           = fc->sequence_encoding;
+  c           = fc->matrices->c;
+  hc_up       = fc->hc->up_int;
+  P           = fc->params;
+  md          = &(P->model_details);
+  rtype       = &(md->rtype[0]);
+  noGUclosure = md->noGUclosure;
+  type        = vrna_get_ptype(idx[j] + i, ptype);
+  e           = INF;
+
+  /* stack */
+  k = i + 1;
+  l = j - 1;
+  if (k < l) {
+    kl = idx[l] + k;
+    if ((hc_mx[n * k + l] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC) &&
+        (c[kl] != INF)) {
+      type2 = rtype[vrna_get_ptype(kl, ptype)];
+      e     = c[kl] +
+              E_IntLoop(0, 0, type, type2, S[i + 1], S[j - 1], S[i], S[j], P);
+    }
+  }
+
+  if ((noGUclosure) && (type == 3 || type == 4))
+    return e;
+
+  /* salt corrections only depend on the total number of unpaired nucleotides */
+  for (u = 0; u <= MAXLOOP; u++)
+    e_salt[u] = 0;
+
+  if (md->salt != VRNA_MODEL_DEFAULT_SALT) {
+    for (u = 1; u <= MAXLOOP; u++)
+      e_salt[u] = (u + 2 <= MAXLOOP + 1) ?
+                  P->SaltLoop[u + 2] :
+                  vrna_salt_loop_int(u + 2, md->salt, P->temperature + K0, md->backbone_length);
+  }
+
+  for (u2 = 0, l = j - 1; (u2 <= MAXLOOP) && (l > i + 1); u2++, l--) {
+    if ((u2 > 0) && (u2 > hc_up[l + 1]))
+      break;
+
+    last_k = l - 1;
+
+    if (last_k > i + 1 + MAXLOOP - u2)
+      last_k = i + 1 + MAXLOOP - u2;
+
+    if (last_k > i + 1 + hc_up[i + 1])
+      last_k = i + 1 + hc_up[i + 1];
+
+    /* first k of a generic (or 1xn) loop, i.e. u1 >= 2, 3, or 4 depending on u2 */
+    switch (u2) {
+      case 0:
+        first_k = last_k + 1;
+        break;
+      case 1:
+      /* fall through */
+      case 3:
+        first_k = i + 4;
+        break;
+      case 2:
+        first_k = i + 5;
+        break;
+      default:
+        first_k = i + 3;
+        break;
+    }
+
+    if (first_k > last_k + 1)
+      first_k = last_k + 1;
+
+    /* bulges and special interior loops */
+    for (k = (u2 == 0) ? i + 2 : i + 1; k < first_k; k++) {
+      kl = idx[l] + k;
+      if ((hc_mx[n * k + l] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC) &&
+          (c[kl] != INF)) {
+        type2 = rtype[vrna_get_ptype(kl, ptype)];
+
+        if ((noGUclosure) && (type2 == 3 || type2 == 4))
+          continue;
+
+        eee = c[kl] +
+              E_IntLoop(k - i - 1, u2, type, type2, S[i + 1], S[j - 1], S[k - 1], S[l + 1], P);
+        e = MIN2(e, eee);
+      }
+    }
+
+    if (first_k <= last_k) {
+      eee = E_internal_loop_row(fc, i, j, l, first_k, last_k, type, e_salt);
+      e   = MIN2(e, eee);
+    }
+  }
+
+  return e;
+}
+
+
+/* int_loop_row() dispatcher */
+PRIVATE int
+int_loop_row_dispatcher(const vrna_int_loop_row_t *row)
+{
+  unsigned int features = vrna_cpu_simd_capabilities();
+
+#if VRNA_WITH_SIMD_AVX512
+  if (features & VRNA_CPU_SIMD_AVX512F) {
+    int_loop_row = &vrna_E_int_loop_row_avx512;
+    goto exec_int_loop_row;
+  }
+
+#endif
+
+#if VRNA_WITH_SIMD_AVX2
+  if (features & VRNA_CPU_SIMD_AVX2) {
+    int_loop_row = &vrna_E_int_loop_row_avx2;
+    goto exec_int_loop_row;
+  }
+
+#endif
+
+#if VRNA_WITH_SIMD_SSE41
+  if (features & VRNA_CPU_SIMD_SSE41) {
+    int_loop_row = &vrna_E_int_loop_row_sse41;
+    goto exec_int_loop_row;
+  }
+
+#endif
+
+  int_loop_row = &int_loop_row_default;
+
+#if VRNA_WITH_SIMD_AVX512 || VRNA_WITH_SIMD_AVX2 || VRNA_WITH_SIMD_SSE41
+exec_int_loop_row:
+#endif
+
+  return (*int_loop_row)(row);
+}
+
+
+PRIVATE int
+int_loop_row_default(const vrna_int_loop_row_t *row)
+{
+  int t, e, eee;
+
+  e = INF;
+
+  for (t = 0; t < row->count; t++) {
+    eee = E_int_loop_row_element(row, t);
+    e   = MIN2(e, eee);
+  }
+
+  return e;
+}
+
+
 PRIVATE int
 E_ext_internal_loop(vrna_fold_compound_t  *fc,
                     int                   i,
@@ -0,0 +1,201 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/constraints/hard.h"
+#include "ViennaRNA/loops/internal_intern.h"
+
+#include <immintrin.h>
+
+static int
+horizontal_min_Vec8i(__m256i x);
+
+
+/*
+ *  Eight loops of a row at once. The reversed types of (k,l) are gathered
+ *  from rtype, the terminal mismatches from the mismatch table of the row
+ */
+PUBLIC int
+vrna_E_int_loop_row_avx2(const vrna_int_loop_row_t *row)
+{
+  int     t, e, eee;
+
+  __m256i inf       = _mm256_set1_epi32(INF);
+  __m256i zero      = _mm256_setzero_si256();
+  __m256i seven     = _mm256_set1_epi32(7);
+  __m256i gu        = _mm256_set1_epi32(3);
+  __m256i ug        = _mm256_set1_epi32(4);
+  __m256i nogu      = _mm256_set1_epi32((row->noGUclosure) ? -1 : 0);
+  __m256i enc       = _mm256_set1_epi32(VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC);
+  __m256i stride    = _mm256_set1_epi32(25);
+  __m256i ninio     = _mm256_set1_epi32(row->ninio);
+  __m256i max_ninio = _mm256_set1_epi32(row->max_ninio);
+  __m256i step      = _mm256_set1_epi32(8);
+  __m256i asym      = _mm256_add_epi32(_mm256_set1_epi32(row->asym),
+                                       _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  __m256i res = inf;
+
+  for (t = 0; t < row->count - 7; t += 8) {
+    __m256i c     = _mm256_loadu_si256((__m256i *)&row->c[t]);
+    __m256i type  = _mm256_cvtepi8_epi32(_mm_loadl_epi64((__m128i *)&row->ptype[t]));
+    __m256i s     = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *)&row->S[t]));
+    __m256i hc    = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)&row->hc[t]));
+
+    /* non-canonical pairs are of type 7 */
+    type = _mm256_blendv_epi8(type, seven, _mm256_cmpeq_epi32(type, zero));
+    type = _mm256_i32gather_epi32(row->rtype, type, 4);
+
+    __m256i mm = _mm256_i32gather_epi32(row->mm,
+                                        _mm256_add_epi32(_mm256_mullo_epi32(type, stride), s),
+                                        4);
+    __m256i e_ninio = _mm256_min_epi32(max_ninio,
+                                       _mm256_mullo_epi32(_mm256_abs_epi32(asym), ninio));
+
+    __m256i en = _mm256_add_epi32(_mm256_add_epi32(c, mm),
+                                  _mm256_add_epi32(_mm256_loadu_si256((__m256i *)&row->e_loop[t]),
+                                                   e_ninio));
+    en = _mm256_add_epi32(en, _mm256_loadu_si256((__m256i *)&row->e_salt[t]));
+
+    /* mask of forbidden loops */
+    __m256i forbidden = _mm256_or_si256(_mm256_cmpeq_epi32(c, inf),
+                                        _mm256_cmpeq_epi32(_mm256_and_si256(hc, enc), zero));
+    forbidden = _mm256_or_si256(forbidden,
+                                _mm256_and_si256(nogu,
+                                                 _mm256_or_si256(_mm256_cmpeq_epi32(type, gu),
+                                                                 _mm256_cmpeq_epi32(type, ug))));
+
+    en    = _mm256_blendv_epi8(en, inf, forbidden);
+    res   = _mm256_min_epi32(res, en);
+    asym  = _mm256_add_epi32(asym, step);
+  }
+
+  e = horizontal_min_Vec8i(res);
+
+  for (; t < row->count; t++) {
+    eee = E_int_loop_row_element(row, t);
+    e   = MIN2(e, eee);
+  }
+
+  return e;
+}
+
+
+#ifndef USE_FLOAT_PF
+
+static FLT_OR_DBL
+horizontal_sum_Vec4d(__m256d x);
+
+
+static __m128i
+reverse_Vec4i(__m128i x);
+
+
+/*
+ *  Four loops of a row at once, the Boltzmann weights are multiplied and
+ *  added up in double precision
+ */
+PUBLIC FLT_OR_DBL
+vrna_exp_E_int_loop_row_avx2(const vrna_exp_int_loop_row_t *row)
+{
+  int         t, hc_bytes;
+  FLT_OR_DBL  q;
+
+  __m128i     zero    = _mm_setzero_si128();
+  __m128i     seven   = _mm_set1_epi32(7);
+  __m128i     gu      = _mm_set1_epi32(3);
+  __m128i     ug      = _mm_set1_epi32(4);
+  __m128i     nogu    = _mm_set1_epi32((row->noGUclosure) ? -1 : 0);
+  __m128i     enc     = _mm_set1_epi32(VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC);
+  __m128i     stride  = _mm_set1_epi32(25);
+  __m128i     five    = _mm_set1_epi32(5);
+  __m128i     step    = _mm_set1_epi32(4);
+  __m128i     asym    = _mm_sub_epi32(_mm_set1_epi32(row->asym),
+                                      _mm_setr_epi32(0, 1, 2, 3));
+  __m256d     acc = _mm256_setzero_pd();
+
+  for (t = 0; t < row->count - 3; t += 4) {
+    /* l decreases with t, so all values indexed by l are reversed */
+    __m128i jl    = reverse_Vec4i(_mm_loadu_si128((__m128i *)&row->jindx[-t - 3]));
+    __m128i s     = reverse_Vec4i(_mm_cvtepi16_epi32(_mm_loadl_epi64((__m128i *)&row->S[-t - 3])));
+    __m128i type  = _mm_setr_epi32(row->ptype[_mm_extract_epi32(jl, 0)],
+                                   row->ptype[_mm_extract_epi32(jl, 1)],
+                                   row->ptype[_mm_extract_epi32(jl, 2)],
+                                   row->ptype[_mm_extract_epi32(jl, 3)]);
+
+    memcpy(&hc_bytes, &row->hc[-t - 3], sizeof(int));
+    __m128i hc = reverse_Vec4i(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(hc_bytes)));
+
+    type  = _mm_blendv_epi8(type, seven, _mm_cmpeq_epi32(type, zero));
+    type  = _mm_i32gather_epi32(row->rtype, type, 4);
+
+    __m256d mm = _mm256_i32gather_pd(row->mm,
+                                     _mm_add_epi32(_mm_mullo_epi32(type, stride),
+                                                   _mm_mullo_epi32(s, five)),
+                                     8);
+    __m256d q_ninio = _mm256_i32gather_pd(row->q_ninio, _mm_abs_epi32(asym), 8);
+
+    __m256d qt = _mm256_mul_pd(_mm256_loadu_pd(&row->qb[t]), mm);
+    qt  = _mm256_mul_pd(qt, _mm256_loadu_pd(&row->q_loop[t]));
+    qt  = _mm256_mul_pd(qt, q_ninio);
+    qt  = _mm256_mul_pd(qt, _mm256_loadu_pd(&row->q_salt[t]));
+    qt  = _mm256_mul_pd(qt, _mm256_loadu_pd(&row->scale[t]));
+
+    /* mask of forbidden loops, widened to 64 bit */
+    __m128i forbidden = _mm_or_si128(_mm_cmpeq_epi32(_mm_and_si128(hc, enc), zero),
+                                     _mm_and_si128(nogu,
+                                                   _mm_or_si128(_mm_cmpeq_epi32(type, gu),
+                                                                _mm_cmpeq_epi32(type, ug))));
+
+    qt    = _mm256_andnot_pd(_mm256_castsi256_pd(_mm256_cvtepi32_epi64(forbidden)), qt);
+    acc   = _mm256_add_pd(acc, qt);
+    asym  = _mm_sub_epi32(asym, step);
+  }
+
+  q = horizontal_sum_Vec4d(acc);
+
+  for (; t < row->count; t++)
+    q += exp_E_int_loop_row_element(row, t);
+
+  return q;
+}
+
+
+static FLT_OR_DBL
+horizontal_sum_Vec4d(__m256d x)
+{
+  __m128d lo  = _mm256_castpd256_pd128(x);
+  __m128d hi  = _mm256_extractf128_pd(x, 1);
+  __m128d s   = _mm_add_pd(lo, hi);
+
+  s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+
+  return _mm_cvtsd_f64(s);
+}
+
+
+static __m128i
+reverse_Vec4i(__m128i x)
+{
+  return _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+
+#endif
+
+
+static int
+horizontal_min_Vec8i(__m256i x)
+{
+  __m128i lo    = _mm256_castsi256_si128(x);
+  __m128i hi    = _mm256_extracti128_si256(x, 1);
+  __m128i min1  = _mm_min_epi32(lo, hi);
+  __m128i min2  = _mm_min_epi32(min1, _mm_shuffle_epi32(min1, _MM_SHUFFLE(0, 0, 3, 2)));
+  __m128i min3  = _mm_min_epi32(min2, _mm_shuffle_epi32(min2, _MM_SHUFFLE(0, 0, 0, 1)));
+
+  return _mm_cvtsi128_si32(min3);
+}
@@ -0,0 +1,79 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/constraints/hard.h"
+#include "ViennaRNA/loops/internal_intern.h"
+
+#include <immintrin.h>
+
+
+/*
+ *  Sixteen loops of a row at once, forbidden loops are excluded from the
+ *  minimization by a lane mask
+ */
+PUBLIC int
+vrna_E_int_loop_row_avx512(const vrna_int_loop_row_t *row)
+{
+  int       t, e, eee;
+  __mmask16 allowed;
+
+  __m512i   inf       = _mm512_set1_epi32(INF);
+  __m512i   zero      = _mm512_setzero_si512();
+  __m512i   seven     = _mm512_set1_epi32(7);
+  __m512i   gu        = _mm512_set1_epi32(3);
+  __m512i   ug        = _mm512_set1_epi32(4);
+  __m512i   enc       = _mm512_set1_epi32(VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC);
+  __m512i   stride    = _mm512_set1_epi32(25);
+  __m512i   ninio     = _mm512_set1_epi32(row->ninio);
+  __m512i   max_ninio = _mm512_set1_epi32(row->max_ninio);
+  __m512i   step      = _mm512_set1_epi32(16);
+  __m512i   asym      = _mm512_add_epi32(_mm512_set1_epi32(row->asym),
+                                         _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                                                           8, 9, 10, 11, 12, 13, 14, 15));
+  __m512i   res = inf;
+
+  for (t = 0; t < row->count - 15; t += 16) {
+    __m512i c     = _mm512_loadu_si512((__m512i *)&row->c[t]);
+    __m512i type  = _mm512_cvtepi8_epi32(_mm_loadu_si128((__m128i *)&row->ptype[t]));
+    __m512i s     = _mm512_cvtepi16_epi32(_mm256_loadu_si256((__m256i *)&row->S[t]));
+    __m512i hc    = _mm512_cvtepu8_epi32(_mm_loadu_si128((__m128i *)&row->hc[t]));
+
+    /* non-canonical pairs are of type 7 */
+    type  = _mm512_mask_mov_epi32(type, _mm512_cmpeq_epi32_mask(type, zero), seven);
+    type  = _mm512_i32gather_epi32(type, row->rtype, 4);
+
+    __m512i mm = _mm512_i32gather_epi32(_mm512_add_epi32(_mm512_mullo_epi32(type, stride), s),
+                                        row->mm,
+                                        4);
+    __m512i e_ninio = _mm512_min_epi32(max_ninio,
+                                       _mm512_mullo_epi32(_mm512_abs_epi32(asym), ninio));
+
+    __m512i en = _mm512_add_epi32(_mm512_add_epi32(c, mm),
+                                  _mm512_add_epi32(_mm512_loadu_si512((__m512i *)&row->e_loop[t]),
+                                                   e_ninio));
+    en = _mm512_add_epi32(en, _mm512_loadu_si512((__m512i *)&row->e_salt[t]));
+
+    allowed = _mm512_cmpneq_epi32_mask(c, inf) &
+              _mm512_test_epi32_mask(hc, enc);
+
+    if (row->noGUclosure)
+      allowed &= ~(_mm512_cmpeq_epi32_mask(type, gu) | _mm512_cmpeq_epi32_mask(type, ug));
+
+    res   = _mm512_mask_min_epi32(res, allowed, res, en);
+    asym  = _mm512_add_epi32(asym, step);
+  }
+
+  e = _mm512_reduce_min_epi32(res);
+
+  for (; t < row->count; t++) {
+    eee = E_int_loop_row_element(row, t);
+    e   = MIN2(e, eee);
+  }
+
+  return e;
+}
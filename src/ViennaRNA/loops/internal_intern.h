@@ -0,0 +1,113 @@
+#ifndef VIENNA_RNA_PACKAGE_INTERNAL_INTERN_H
+#define VIENNA_RNA_PACKAGE_INTERNAL_INTERN_H
+
+#include <stdlib.h>
+
+#include "ViennaRNA/datastructures/basic.h"
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/constraints/hard.h"
+
+#ifdef __GNUC__
+# define INLINE inline
+#else
+# define INLINE
+#endif
+
+/*
+ *  A row of generic (or 1xn) interior loops (i,j,k,l) with fixed l and
+ *  consecutive k = k_0, ..., k_0 + count - 1, see E_internal_loop_row().
+ *  All arrays are indexed by the offset t = k - k_0 of k in the row.
+ */
+typedef struct {
+  const int           *c;           /* c[k,l] */
+  const char          *ptype;       /* type of (k,l) */
+  const unsigned char *hc;          /* hard constraints of (l,k), i.e. the transposed entry */
+  const short         *S;           /* S[k - 1] */
+  const int           *mm;          /* mismatch energy of (l,k), mm[25 * type + S[k - 1]] */
+  const int           *rtype;       /* reversed pair types */
+  const int           *e_loop;      /* loop size dependent energy */
+  const int           *e_salt;      /* salt correction */
+  int                 asym;         /* u1 - u2 of k_0 */
+  int                 ninio;        /* ninio energy per unpaired nucleotide of asymmetry */
+  int                 max_ninio;    /* maximum ninio energy */
+  unsigned int        noGUclosure;  /* forbid (k,l) to be a GU pair */
+  int                 count;        /* number of loops in the row */
+} vrna_int_loop_row_t;
+
+
+/*
+ *  A row of generic (or 1xn) interior loops (i,j,k,l) with fixed k and
+ *  consecutive u2 = u2_0, ..., u2_0 + count - 1, i.e. l = l_0 - t, see
+ *  exp_E_int_loop_row(). Arrays marked as reversed are indexed by -t,
+ *  all others by t.
+ */
+typedef struct {
+  const FLT_OR_DBL    *qb;          /* qb[k,l] */
+  const FLT_OR_DBL    *scale;       /* scaling factor of the unpaired nucleotides */
+  const char          *ptype;       /* pair types of column k, ptype[jindx[l]] is the type of (k,l) */
+  const int           *jindx;       /* jindx[l], reversed */
+  const unsigned char *hc;          /* hard constraints of (k,l), reversed */
+  const short         *S;           /* S[l + 1], reversed */
+  const double        *mm;          /* mismatch weight of (l,k), mm[25 * type + 5 * S[l + 1]] */
+  const int           *rtype;       /* reversed pair types */
+  const double        *q_loop;      /* loop size dependent weight */
+  const double        *q_ninio;     /* ninio weight, indexed by |u1 - u2| */
+  const FLT_OR_DBL    *q_salt;      /* salt correction */
+  int                 asym;         /* u1 - u2 of l_0 */
+  unsigned int        noGUclosure;  /* forbid (k,l) to be a GU pair */
+  int                 count;        /* number of loops in the row */
+} vrna_exp_int_loop_row_t;
+
+
+/*
+ *  Energy of the loop at offset t of a row, or INF if the loop is forbidden.
+ *  Used by the row kernels for the elements that do not fill a vector.
+ */
+PRIVATE INLINE int
+E_int_loop_row_element(const vrna_int_loop_row_t  *row,
+                       int                        t)
+{
+  unsigned int type2;
+
+  type2 = (unsigned int)row->ptype[t];
+  type2 = row->rtype[(type2 == 0) ? 7 : type2];
+
+  if ((row->c[t] == INF) ||
+      (!(row->hc[t] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC)) ||
+      ((row->noGUclosure) && (type2 == 3 || type2 == 4)))
+    return INF;
+
+  return row->c[t] +
+         row->mm[25 * type2 + row->S[t]] +
+         row->e_loop[t] +
+         MIN2(row->max_ninio, abs(row->asym + t) * row->ninio) +
+         row->e_salt[t];
+}
+
+
+/*
+ *  Boltzmann weight of the loop at offset t of a row, 0 if the loop is forbidden
+ */
+PRIVATE INLINE FLT_OR_DBL
+exp_E_int_loop_row_element(const vrna_exp_int_loop_row_t  *row,
+                           int                            t)
+{
+  unsigned int type2;
+
+  type2 = (unsigned int)row->ptype[row->jindx[-t]];
+  type2 = row->rtype[(type2 == 0) ? 7 : type2];
+
+  if ((!(row->hc[-t] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC)) ||
+      ((row->noGUclosure) && (type2 == 3 || type2 == 4)))
+    return 0.;
+
+  return row->qb[t] *
+         row->mm[25 * type2 + 5 * row->S[-t]] *
+         row->q_loop[t] *
+         row->q_ninio[abs(row->asym - t)] *
+         row->q_salt[t] *
+         row->scale[t];
+}
+
+
+#endif
@@ -16,7 +16,9 @@
 #include "ViennaRNA/gquad.h"
 #include "ViennaRNA/structured_domains.h"
 #include "ViennaRNA/unstructured_domains.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/loops/internal.h"
+#include "ViennaRNA/loops/internal_intern.h"
 
 
 #ifdef __GNUC__
@@ -28,6 +30,9 @@
 #include "internal_hc.inc"
 #include "internal_sc_pf.inc"
 
+
+typedef FLT_OR_DBL (*proto_exp_int_loop_row)(const vrna_exp_int_loop_row_t *row);
+
 /*
  #################################
  # PRIVATE FUNCTION DECLARATIONS #
@@ -40,6 +45,23 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
                int                  j);
 
 
+PRIVATE FLT_OR_DBL
+exp_E_int_loop_gathered(vrna_fold_compound_t  *fc,
+                        int                   i,
+                        int                   j);
+
+
+PRIVATE INLINE FLT_OR_DBL
+exp_E_int_loop_row(vrna_fold_compound_t *fc,
+                   int                  i,
+                   int                  j,
+                   int                  k,
+                   int                  first_u2,
+                   int                  last_u2,
+                   unsigned int         type,
+                   const FLT_OR_DBL     *q_salt);
+
+
 PRIVATE FLT_OR_DBL
 exp_E_ext_int_loop(vrna_fold_compound_t *fc,
                    int                  p,
@@ -54,6 +76,25 @@ exp_E_interior_loop(vrna_fold_compound_t  *fc,
                     int                   l);
 
 
+PRIVATE FLT_OR_DBL
+exp_int_loop_row_dispatcher(const vrna_exp_int_loop_row_t *row);
+
+
+PRIVATE FLT_OR_DBL
+exp_int_loop_row_default(const vrna_exp_int_loop_row_t *row);
+
+
+#if VRNA_WITH_SIMD_AVX2 && !defined(USE_FLOAT_PF)
+FLT_OR_DBL
+vrna_exp_E_int_loop_row_avx2(const vrna_exp_int_loop_row_t *row);
+
+
+#endif
+
+
+PRIVATE proto_exp_int_loop_row exp_int_loop_row = &exp_int_loop_row_dispatcher;
+
+
 /*
  #################################
  # BEGIN OF FUNCTION DEFINITIONS #
@@ -156,6 +197,21 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
 
   ij = (sliding_window) ? 0 : jindx[j] + i;
 
+  /*
+   *  without any of the extensions above, loops of single sequences are
+   *  evaluated by plain table lookups, see exp_E_int_loop_gathered()
+   */
+  if ((fc->type == VRNA_FC_TYPE_SINGLE) &&
+      (!sliding_window) &&
+      (!with_ud) &&
+      (!with_gquad) &&
+      (!sc_wrapper.pair) &&
+      (!fc->hc->f) &&
+      (sn[i] == sn[j])) {
+    free_sc_int_exp(&sc_wrapper);
+    return exp_E_int_loop_gathered(fc, i, j);
+  }
+
   hc_decompose_ij = (sliding_window) ? hc_mx_local[i][j - i] : hc_mx[n * i + j];
 
   /* CONSTRAINED INTERIOR LOOP start */
@@ -556,6 +612,233 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
 }
 
 
+/*
+ *  Sum of qb[k,l] * exp(-E_int(i,j,k,l)/kT) over all generic (or 1xn) loops
+ *  with fixed k and l = j - 1 - u2 for u2 in [first_u2, last_u2]. qb and the
+ *  hard constraints are contiguous along l, the types and terminal mismatches
+ *  of (k,l) are gathered by the SIMD kernel selected at runtime, see
+ *  exp_int_loop_row_dispatcher(). The mismatch of the enclosing pair (i,j) is
+ *  identical for all l and therefore multiplied after summation.
+ */
+PRIVATE INLINE FLT_OR_DBL
+exp_E_int_loop_row(vrna_fold_compound_t *fc,
+                   int                  i,
+                   int                  j,
+                   int                  k,
+                   int                  first_u2,
+                   int                  last_u2,
+                   unsigned int         type,
+                   const FLT_OR_DBL     *q_salt)
+{
+  short                   *S;
+  int                     u1;
+  FLT_OR_DBL              q_mm;
+  double                  (*mm)[5][5];
+  vrna_exp_param_t        *P;
+  vrna_exp_int_loop_row_t row;
+
+  P   = fc->exp_params;
+  S   = fc->sequence_encoding;
+  u1  = k - i - 1;
+
+  if (u1 == 1) {
+    mm    = P->expmismatch1nI;
+    q_mm  = P->expmismatch1nI[type][S[i + 1]][S[j - 1]];
+  } else {
+    mm    = P->expmismatchI;
+    q_mm  = P->expmismatchI[type][S[i + 1]][S[j - 1]];
+  }
+
+  row.qb          = fc->exp_matrices->qb + fc->iindx[k] - j + 1 + first_u2;
+  row.scale       = fc->exp_matrices->scale + u1 + 2 + first_u2;
+  row.ptype       = fc->ptype + k;
+  row.jindx       = fc->jindx + j - 1 - first_u2;
+  row.hc          = fc->hc->mx + fc->length * k + j - 1 - first_u2;
+  row.S           = S + j - first_u2;
+  row.mm          = &(mm[0][0][S[k - 1]]);
+  row.rtype       = &(P->model_details.rtype[0]);
+  row.q_loop      = P->expinternal + u1 + first_u2;
+  row.q_ninio     = P->expninio[2];
+  row.q_salt      = q_salt + u1 + first_u2;
+  row.asym        = u1 - first_u2;
+  row.noGUclosure = P->model_details.noGUclosure;
+  row.count       = last_u2 - first_u2 + 1;
+
+  return (*exp_int_loop_row)(&row) * q_mm;
+}
+
+
+/*
+ *  Interior loops of single sequences without soft constraints, hard
+ *  constraint callbacks, unstructured domains, and G-Quadruplexes, see
+ *  E_internal_loop_gathered() in internal.c. Stacks, bulges, and the special
+ *  1x1, 2x1, 2x2, and 2x3 loops are looked up one by one, all other loops of
+ *  a row with fixed k are processed by exp_E_int_loop_row(). Up to rounding,
+ *  the result is identical to the element-wise evaluation in exp_E_int_loop().
+ */
+PRIVATE FLT_OR_DBL
+exp_E_int_loop_gathered(vrna_fold_compound_t  *fc,
+                        int                   i,
+                        int                   j)
+{
+  unsigned char     *hc_mx;
+  char              *ptype;
+  short             *S;
+  unsigned int      n, type, type2;
+  int               k, l, u, u1, u2, first_u2, max_u2, last_k, noGUclosure, *jindx, *my_iindx,
+                    *rtype, *hc_up;
+  FLT_OR_DBL        qbt1, q_temp, *qb, *scale, q_salt[MAXLOOP + 1];
+  vrna_exp_param_t  *P;
+  vrna_md_t         *md;
+
+  n     = fc->length;
+  hc_mx = fc->hc->mx;
+
+  if (!(hc_mx[n * i + j] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP))
+    return 0.;
+
+  jindx       = fc->jindx;
+  my_iindx    = fc->iindx;
+  ptype       = fc->ptype;
+  S           = fc->sequence_encoding;
+  qb          = fc->exp_matrices->qb;
+  scale       = fc->exp_matrices->scale;
+  hc_up       = fc->hc->up_int;
+  P           = fc->exp_params;
+  md          = &(P->model_details);
+  rtype       = &(md->rtype[0]);
+  noGUclosure = md->noGUclosure;
+  type        = vrna_get_ptype(jindx[j] + i, ptype);
+  qbt1        = 0.;
+
+  /* stack */
+  k = i + 1;
+  l = j - 1;
+  if (k < l) {
+    if (hc_mx[n * k + l] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC) {
+      type2 = rtype[vrna_get_ptype(jindx[l] + k, ptype)];
+      qbt1  = qb[my_iindx[k] - l] *
+              exp_E_IntLoop(0, 0, type, type2, S[i + 1], S[j - 1], S[k - 1], S[l + 1], P) *
+              scale[2];
+    }
+  }
+
+  if ((noGUclosure) && (type == 3 || type == 4))
+    return qbt1;
+
+  /* salt corrections only depend on the total number of unpaired nucleotides */
+  for (u = 0; u <= MAXLOOP; u++)
+    q_salt[u] = 1.;
+
+  if (md->salt != VRNA_MODEL_DEFAULT_SALT) {
+    for (u = 1; u <= MAXLOOP; u++)
+      q_salt[u] = (u + 2 <= MAXLOOP + 1) ?
+                  P->expSaltLoop[u + 2] :
+                  exp(-vrna_salt_loop_int(u + 2, md->salt, P->temperature + K0,
+                                          md->backbone_length) * 10. / P->kT);
+  }
+
+  /* largest stretch of unpaired nucleotides 5' of j */
+  for (max_u2 = 0;
+       (max_u2 < MAXLOOP) && (max_u2 < j - i - 3) && (max_u2 < hc_up[j - 1 - max_u2]);
+       max_u2++);
+
+  last_k = j - 2;
+
+  if (last_k > i + 1 + MAXLOOP)
+    last_k = i + 1 + MAXLOOP;
+
+  if (last_k > i + 1 + hc_up[i + 1])
+    last_k = i + 1 + hc_up[i + 1];
+
+  for (k = i + 1, u1 = 0; k <= last_k; k++, u1++) {
+    /* loops with (k,l) where l = j - 1 - u2 for u2 in [0, max_u2] */
+    max_u2 = MIN2(max_u2, MAXLOOP - u1);
+    max_u2 = MIN2(max_u2, j - k - 2);
+
+    /* first u2 of a generic (or 1xn) loop, i.e. u2 >= 2, 3, or 4 depending on u1 */
+    switch (u1) {
+      case 0:
+        first_u2 = max_u2 + 1;
+        break;
+      case 1:
+      /* fall through */
+      case 3:
+        first_u2 = 3;
+        break;
+      case 2:
+        first_u2 = 4;
+        break;
+      default:
+        first_u2 = 2;
+        break;
+    }
+
+    if (first_u2 > max_u2 + 1)
+      first_u2 = max_u2 + 1;
+
+    /* bulges and special interior loops */
+    for (u2 = (u1 == 0) ? 1 : 0, l = j - 1 - u2; u2 < first_u2; u2++, l--) {
+      if (hc_mx[n * k + l] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC) {
+        type2 = rtype[vrna_get_ptype(jindx[l] + k, ptype)];
+
+        if ((noGUclosure) && (type2 == 3 || type2 == 4))
+          continue;
+
+        q_temp = qb[my_iindx[k] - l] *
+                 exp_E_IntLoop(u1, u2, type, type2, S[i + 1], S[j - 1], S[k - 1], S[l + 1], P);
+        qbt1 += q_temp *
+                scale[u1 + u2 + 2];
+      }
+    }
+
+    if (first_u2 <= max_u2)
+      qbt1 += exp_E_int_loop_row(fc, i, j, k, first_u2, max_u2, type, q_salt);
+  }
+
+  return qbt1;
+}
+
+
+/* exp_int_loop_row() dispatcher */
+PRIVATE FLT_OR_DBL
+exp_int_loop_row_dispatcher(const vrna_exp_int_loop_row_t *row)
+{
+  unsigned int features = vrna_cpu_simd_capabilities();
+
+#if VRNA_WITH_SIMD_AVX2 && !defined(USE_FLOAT_PF)
+  if (features & VRNA_CPU_SIMD_AVX2) {
+    exp_int_loop_row = &vrna_exp_E_int_loop_row_avx2;
+    goto exec_exp_int_loop_row;
+  }
+
+#endif
+
+  exp_int_loop_row = &exp_int_loop_row_default;
+
+#if VRNA_WITH_SIMD_AVX2 && !defined(USE_FLOAT_PF)
+exec_exp_int_loop_row:
+#endif
+
+  return (*exp_int_loop_row)(row);
+}
+
+
+PRIVATE FLT_OR_DBL
+exp_int_loop_row_default(const vrna_exp_int_loop_row_t *row)
+{
+  int         t;
+  FLT_OR_DBL  q;
+
+  q = 0.;
+
+  for (t = 0; t < row->count; t++)
+    q += exp_E_int_loop_row_element(row, t);
+
+  return q;
+}
+
+
 PRIVATE FLT_OR_DBL
 exp_E_ext_int_loop(vrna_fold_compound_t *fc,
                    int                  i,
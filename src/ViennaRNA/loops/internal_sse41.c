@@ -0,0 +1,112 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/constraints/hard.h"
+#include "ViennaRNA/loops/internal_intern.h"
+
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+static int
+horizontal_min_Vec4i(__m128i x);
+
+
+/*
+ *  Four loops of a row at once. SSE 4.1 lacks gather instructions, so the
+ *  table lookups are done lane by lane while everything else is vectorized
+ */
+PUBLIC int
+vrna_E_int_loop_row_sse41(const vrna_int_loop_row_t *row)
+{
+  int     t, e, eee, bytes;
+
+  __m128i inf       = _mm_set1_epi32(INF);
+  __m128i zero      = _mm_setzero_si128();
+  __m128i seven     = _mm_set1_epi32(7);
+  __m128i gu        = _mm_set1_epi32(3);
+  __m128i ug        = _mm_set1_epi32(4);
+  __m128i nogu      = _mm_set1_epi32((row->noGUclosure) ? -1 : 0);
+  __m128i enc       = _mm_set1_epi32(VRNA_CONSTRAINT_CONTEXT_INT_LOOP_ENC);
+  __m128i stride    = _mm_set1_epi32(25);
+  __m128i ninio     = _mm_set1_epi32(row->ninio);
+  __m128i max_ninio = _mm_set1_epi32(row->max_ninio);
+  __m128i step      = _mm_set1_epi32(4);
+  __m128i asym      = _mm_add_epi32(_mm_set1_epi32(row->asym),
+                                    _mm_setr_epi32(0, 1, 2, 3));
+  __m128i res = inf;
+
+  for (t = 0; t < row->count - 3; t += 4) {
+    __m128i c = _mm_loadu_si128((__m128i *)&row->c[t]);
+    __m128i s = _mm_cvtepi16_epi32(_mm_loadl_epi64((__m128i *)&row->S[t]));
+
+    memcpy(&bytes, &row->ptype[t], sizeof(int));
+    __m128i type = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(bytes));
+
+    memcpy(&bytes, &row->hc[t], sizeof(int));
+    __m128i hc = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+
+    /* non-canonical pairs are of type 7 */
+    type  = _mm_blendv_epi8(type, seven, _mm_cmpeq_epi32(type, zero));
+    type  = _mm_setr_epi32(row->rtype[_mm_extract_epi32(type, 0)],
+                           row->rtype[_mm_extract_epi32(type, 1)],
+                           row->rtype[_mm_extract_epi32(type, 2)],
+                           row->rtype[_mm_extract_epi32(type, 3)]);
+
+    __m128i idx = _mm_add_epi32(_mm_mullo_epi32(type, stride), s);
+    __m128i mm  = _mm_setr_epi32(row->mm[_mm_extract_epi32(idx, 0)],
+                                 row->mm[_mm_extract_epi32(idx, 1)],
+                                 row->mm[_mm_extract_epi32(idx, 2)],
+                                 row->mm[_mm_extract_epi32(idx, 3)]);
+
+    __m128i e_ninio = _mm_min_epi32(max_ninio,
+                                    _mm_mullo_epi32(_mm_abs_epi32(asym), ninio));
+
+    __m128i en = _mm_add_epi32(_mm_add_epi32(c, mm),
+                               _mm_add_epi32(_mm_loadu_si128((__m128i *)&row->e_loop[t]),
+                                             e_ninio));
+    en = _mm_add_epi32(en, _mm_loadu_si128((__m128i *)&row->e_salt[t]));
+
+    /* mask of forbidden loops */
+    __m128i forbidden = _mm_or_si128(_mm_cmpeq_epi32(c, inf),
+                                     _mm_cmpeq_epi32(_mm_and_si128(hc, enc), zero));
+    forbidden = _mm_or_si128(forbidden,
+                             _mm_and_si128(nogu,
+                                           _mm_or_si128(_mm_cmpeq_epi32(type, gu),
+                                                        _mm_cmpeq_epi32(type, ug))));
+
+    en    = _mm_blendv_epi8(en, inf, forbidden);
+    res   = _mm_min_epi32(res, en);
+    asym  = _mm_add_epi32(asym, step);
+  }
+
+  e = horizontal_min_Vec4i(res);
+
+  for (; t < row->count; t++) {
+    eee = E_int_loop_row_element(row, t);
+    e   = MIN2(e, eee);
+  }
+
+  return e;
+}
+
+
+/*
+ *  SSE minimum
+ *  see also: http://stackoverflow.com/questions/9877700/getting-max-value-in-a-m128i-vector-with-sse
+ */
+static int
+horizontal_min_Vec4i(__m128i x)
+{
+  __m128i min1  = _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 0, 3, 2));
+  __m128i min2  = _mm_min_epi32(x, min1);
+  __m128i min3  = _mm_shuffle_epi32(min2, _MM_SHUFFLE(0, 0, 0, 1));
+  __m128i min4  = _mm_min_epi32(min2, min3);
+
+  return _mm_cvtsi128_si32(min4);
+}
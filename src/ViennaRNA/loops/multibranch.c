@@ -1458,12 +1458,13 @@ E_ml_stems_fast(vrna_fold_compound_t  *fc,
       }
     } else {
       int ik;
-      k1j     = indx[j] + i + 2;
       decomp  = INF;
       k       = i + 1;
       if (k >= j)
         k = j - 1;
 
+      k1j = indx[j] + k + 1;
+
       /*
        *  loop over entire range but skip decompositions with in-between strand nick,
        *  this should be faster than evaluating hard constraints callback for each
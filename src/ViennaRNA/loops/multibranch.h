@@ -109,6 +109,19 @@ vrna_mx_pf_aux_ml_t
 vrna_exp_E_ml_fast_init(vrna_fold_compound_t *fc);
 
 
+/**
+ *  @brief  Prepare auxiliary helper arrays that keep all columns
+ *
+ *  In contrast to vrna_exp_E_ml_fast_init(), the returned helper arrays
+ *  store every column @f$j@f$ instead of rotating two of them. This allows
+ *  for filling the matrices along diagonals where cells of different
+ *  columns are evaluated concurrently. vrna_exp_E_ml_fast_rotate()
+ *  has no effect on such helper arrays.
+ */
+vrna_mx_pf_aux_ml_t
+vrna_exp_E_ml_fast_init_full(vrna_fold_compound_t *fc);
+
+
 void
 vrna_exp_E_ml_fast_rotate(vrna_mx_pf_aux_ml_t aux_mx);
 
@@ -125,6 +138,18 @@ const FLT_OR_DBL *
 vrna_exp_E_ml_fast_qqm1(vrna_mx_pf_aux_ml_t aux_mx);
 
 
+/**
+ *  @brief  Get the auxiliary array for column @p j
+ *
+ *  For helper arrays obtained from vrna_exp_E_ml_fast_init_full() this
+ *  returns column @p j, otherwise the current column as returned by
+ *  vrna_exp_E_ml_fast_qqm().
+ */
+const FLT_OR_DBL *
+vrna_exp_E_ml_fast_qqm_column(vrna_mx_pf_aux_ml_t aux_mx,
+                              int                 j);
+
+
 FLT_OR_DBL
 vrna_exp_E_ml_fast(vrna_fold_compound_t *fc,
                    int                  i,
@@ -684,7 +684,7 @@ BT_mb_loop(vrna_fold_compound_t *fc,
         P->MLclosing *
         n_seq;
 
-    if (dangles == 2) {
+    if (dangle_model == 2) {
       switch (fc->type) {
         case VRNA_FC_TYPE_SINGLE:
           e -= E_MLstem(type, s5, s3, P);
@@ -729,7 +729,7 @@ BT_mb_loop(vrna_fold_compound_t *fc,
     }
   }
 
-  if (dangles % 2) {
+  if (dangle_model % 2) {
     /* odd dangles need more special treatment */
     if (evaluate(*i, *j, p + 1, q, VRNA_DECOMP_PAIR_ML, &hc_dat_local)) {
       e = en -
@@ -9,6 +9,7 @@
 #include <ctype.h>
 #include <string.h>
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/higher_order_functions.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/alphabet.h"
 #include "ViennaRNA/params/default.h"
@@ -34,6 +35,8 @@ struct vrna_mx_pf_aux_ml_s {
 
   int         qqmu_size;
   FLT_OR_DBL  **qqmu;
+
+  FLT_OR_DBL  **qqm_mx;   /* qqm_mx[j][i] holds all columns of qqm (diagonal fill only) */
 };
 
 
@@ -113,6 +116,7 @@ vrna_exp_E_ml_fast_init(vrna_fold_compound_t *fc)
     aux_mx->qqm1      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
     aux_mx->qqmu_size = 0;
     aux_mx->qqmu      = NULL;
+    aux_mx->qqm_mx    = NULL;
 
     if (fc->type == VRNA_FC_TYPE_SINGLE) {
       vrna_ud_t *domains_up = fc->domains_up;
@@ -164,10 +168,49 @@ vrna_exp_E_ml_fast_init(vrna_fold_compound_t *fc)
 }
 
 
+PUBLIC struct vrna_mx_pf_aux_ml_s *
+vrna_exp_E_ml_fast_init_full(vrna_fold_compound_t *fc)
+{
+  struct vrna_mx_pf_aux_ml_s *aux_mx = vrna_exp_E_ml_fast_init(fc);
+
+  if ((aux_mx) &&
+      (fc->hc->type != VRNA_HC_WINDOW)) {
+    int         j, n, u;
+    FLT_OR_DBL  *mem;
+
+    n = (int)fc->length;
+
+    /*
+     *  column j of qqm is accessed for rows 0 up to j + 1. This also
+     *  replaces the qqmu arrays, since qqmu[u] simply refers to column j - u
+     */
+    if (aux_mx->qqmu) {
+      for (u = 0; u <= aux_mx->qqmu_size; u++)
+        free(aux_mx->qqmu[u]);
+
+      free(aux_mx->qqmu);
+      aux_mx->qqmu      = NULL;
+      aux_mx->qqmu_size = 0;
+    }
+
+    mem             = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((n + 1) * (n + 6) / 2));
+    aux_mx->qqm_mx  = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n + 1));
+
+    for (j = 0; j <= n; j++) {
+      aux_mx->qqm_mx[j] = mem;
+      mem               += j + 2;
+    }
+  }
+
+  return aux_mx;
+}
+
+
 PUBLIC void
 vrna_exp_E_ml_fast_rotate(struct vrna_mx_pf_aux_ml_s *aux_mx)
 {
-  if (aux_mx) {
+  if ((aux_mx) &&
+      (!aux_mx->qqm_mx)) {
     int         u;
     FLT_OR_DBL  *tmp;
 
@@ -202,6 +245,11 @@ vrna_exp_E_ml_fast_free(struct vrna_mx_pf_aux_ml_s *aux_mx)
       free(aux_mx->qqmu);
     }
 
+    if (aux_mx->qqm_mx) {
+      free(aux_mx->qqm_mx[0]);
+      free(aux_mx->qqm_mx);
+    }
+
     free(aux_mx);
   }
 }
@@ -227,6 +275,21 @@ vrna_exp_E_ml_fast_qqm1(struct vrna_mx_pf_aux_ml_s *aux_mx)
 }
 
 
+PUBLIC const FLT_OR_DBL *
+vrna_exp_E_ml_fast_qqm_column(struct vrna_mx_pf_aux_ml_s  *aux_mx,
+                              int                         j)
+{
+  if (aux_mx) {
+    if (aux_mx->qqm_mx)
+      return (const FLT_OR_DBL *)aux_mx->qqm_mx[j];
+
+    return (const FLT_OR_DBL *)aux_mx->qqm;
+  }
+
+  return NULL;
+}
+
+
 /*
  #####################################
  # BEGIN OF STATIC HELPER FUNCTIONS  #
@@ -251,7 +314,7 @@ exp_E_mb_loop_fast(vrna_fold_compound_t       *fc,
   struct hc_mb_def_dat      hc_dat_local;
   struct sc_mb_exp_dat      sc_wrapper;
 
-  qqm1            = aux_mx->qqm1;
+  qqm1            = (aux_mx->qqm_mx) ? aux_mx->qqm_mx[j - 1] : aux_mx->qqm1;
   sliding_window  = (fc->hc->type == VRNA_HC_WINDOW) ? 1 : 0;
   n_seq           = (fc->type == VRNA_FC_TYPE_SINGLE) ? 1 : fc->n_seq;
   se              = fc->strand_end;
@@ -350,9 +413,11 @@ exp_E_mb_loop_fast(vrna_fold_compound_t       *fc,
         /* limit for-loop to last nucleotide of 5' part strand */
         int stop = MIN2(j - 1, se[sn[k - 1]]);
 
-        for (; k <= stop; k++, kl--)
-          temp += qm[kl] *
-                  qqm1_tmp[k];
+        if (stop >= k) {
+          temp  += vrna_fun_zip_mul_sum_rev(qqm1_tmp + k, qm + kl, stop - k + 1);
+          kl    -= stop - k + 1;
+          k     = stop + 1;
+        }
 
         k++;
         kl--;
@@ -409,8 +474,8 @@ exp_E_ml_fast(vrna_fold_compound_t        *fc,
   S3              = (fc->type == VRNA_FC_TYPE_SINGLE) ? NULL : fc->S3;
   iidx            = (sliding_window) ? NULL : fc->iindx;
   ij              = (sliding_window) ? 0 : iidx[i] - j;
-  qqm             = aux_mx->qqm;
-  qqm1            = aux_mx->qqm1;
+  qqm             = (aux_mx->qqm_mx) ? aux_mx->qqm_mx[j] : aux_mx->qqm;
+  qqm1            = (aux_mx->qqm_mx) ? aux_mx->qqm_mx[j - 1] : aux_mx->qqm1;
   qqmu            = aux_mx->qqmu;
   qm              = (sliding_window) ? NULL : fc->exp_matrices->qm;
   qb              = (sliding_window) ? NULL : fc->exp_matrices->qb;
@@ -454,7 +519,7 @@ exp_E_ml_fast(vrna_fold_compound_t        *fc,
       u = domains_up->uniq_motif_size[cnt];
       if (j - u >= i) {
         if (evaluate(i, j, i, j - u, VRNA_DECOMP_ML_ML, &hc_dat_local)) {
-          q_temp2 = qqmu[u][i] *
+          q_temp2 = ((aux_mx->qqm_mx) ? aux_mx->qqm_mx[j - u][i] : qqmu[u][i]) *
                     domains_up->exp_energy_cb(fc,
                                               j - u + 1,
                                               j,
@@ -515,7 +580,7 @@ exp_E_ml_fast(vrna_fold_compound_t        *fc,
                pow(exp_E_MLstem(0, -1, -1, pf_params), (double)n_seq);
   }
 
-  if (with_ud)
+  if ((with_ud) && (qqmu))
     qqmu[0][i] = qqm[i];
 
   /*
@@ -564,9 +629,11 @@ exp_E_ml_fast(vrna_fold_compound_t        *fc,
     while (1) {
       /* limit for-loop to first nucleotide of 3' part strand */
       int stop = MAX2(i, ss[sn[k]]);
-      for (; k > stop; k--, kl++)
-        temp += qm[kl] *
-                qqm_tmp[k];
+      if (k > stop) {
+        temp  += vrna_fun_zip_mul_sum_rev(qm + kl, qqm_tmp + k, k - stop);
+        kl    += k - stop;
+        k     = stop;
+      }
 
       k--;
       kl++;
@@ -622,12 +689,9 @@ exp_E_ml_fast(vrna_fold_compound_t        *fc,
       qqm_tmp[k] *= sc_wrapper.red_ml(i, j, k, j, &sc_wrapper);
   }
 
-  ii = maxk - i; /* length of unpaired stretch */
-
-  /* finally, decompose segment */
-  for (k = maxk; k > i; k--, ii--)
-    temp += expMLbase[ii] *
-            qqm_tmp[k];
+  /* finally, decompose segment (unpaired stretch [i, k - 1] of length k - i) */
+  if (maxk > i)
+    temp += vrna_fun_zip_mul_sum(expMLbase + 1, qqm_tmp + i + 1, maxk - i);
 
   if (with_ud) {
     ii = maxk - i; /* length of unpaired stretch */
@@ -37,6 +37,10 @@
 #include "ViennaRNA/alphabet.h"
 #include "ViennaRNA/mfe.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #ifdef __GNUC__
 # define INLINE inline
 #else
@@ -86,6 +90,16 @@ fill_arrays(vrna_fold_compound_t  *fc,
             struct ms_helpers     *ms_dat);
 
 
+PRIVATE void
+fill_arrays_wavefront(vrna_fold_compound_t  *fc,
+                      int                   num_threads);
+
+
+PRIVATE void
+fill_arrays_tiled(vrna_fold_compound_t  *fc,
+                  int                   tile);
+
+
 PRIVATE int
 postprocess_circular(vrna_fold_compound_t *fc,
                      sect                 bt_stack[],
@@ -131,6 +145,14 @@ PRIVATE INLINE void
 free_aux_arrays(struct aux_arrays *aux);
 
 
+PRIVATE int **
+get_aux_rows(unsigned int length);
+
+
+PRIVATE void
+free_aux_rows(int **rows);
+
+
 PRIVATE struct ms_helpers *
 get_ms_helpers(vrna_fold_compound_t *fc);
 
@@ -351,7 +373,7 @@ fill_arrays(vrna_fold_compound_t  *fc,
             struct ms_helpers     *ms_dat)
 {
   unsigned int      *sn;
-  int               i, j, ij, length, uniq_ML, *indx, *f5, *c, *fML, *fM1;
+  int               i, j, ij, length, max_span, uniq_ML, wavefront, *indx, *f5, *c, *fML, *fM1;
   vrna_param_t      *P;
   vrna_md_t         *md;
   vrna_mx_mfe_t     *matrices;
@@ -370,6 +392,25 @@ fill_arrays(vrna_fold_compound_t  *fc,
   fM1         = matrices->fM1;
   domains_up  = fc->domains_up;
   sn          = fc->strand_number;
+  wavefront   = 0;
+
+  /* banded matrices only provide memory for subsegments within the band */
+  max_span = (matrices->type == VRNA_MX_BANDED) ? (int)matrices->band : length;
+
+#ifdef _OPENMP
+  /*
+   *  the multi-strand helper arrays are updated row by row,
+   *  so we only fill single-stranded problems by diagonals.
+   *  The full auxiliary triangles of the wavefront fill would
+   *  defeat the purpose of banded matrices, and tiled matrices
+   *  come with their own traversal order
+   */
+  if ((md->num_threads > 1) &&
+      (fc->strands == 1) &&
+      (matrices->type == VRNA_MX_DEFAULT))
+    wavefront = 1;
+
+#endif
 
   /* allocate memory for all helper arrays */
   helper_arrays = get_aux_arrays(length);
@@ -394,12 +435,28 @@ fill_arrays(vrna_fold_compound_t  *fc,
     return 0;
   }
 
+  if (matrices->type == VRNA_MX_TILED) {
+    fill_arrays_tiled(fc, (int)matrices->tile);
+    (void)vrna_E_ext_loop_5(fc);
+    free_aux_arrays(helper_arrays);
+
+    return f5[length];
+  }
+
+  if (wavefront) {
+    fill_arrays_wavefront(fc, md->num_threads);
+    (void)vrna_E_ext_loop_5(fc);
+    free_aux_arrays(helper_arrays);
+
+    return f5[length];
+  }
+
   for (i = length - 1; i >= 1; i--) {
     if ((fc->strands > 1) &&
         (sn[i] != sn[i + 1]))
       update_fms3_arrays(fc, sn[i + 1], ms_dat);
 
-    for (j = i + 1; j <= length; j++) {
+    for (j = i + 1; j <= MIN2(length, i + max_span - 1); j++) {
       ij = indx[j] + i;
 
       /* decompose subsegment [i, j] with pair (i, j) */
@@ -433,6 +490,134 @@ fill_arrays(vrna_fold_compound_t  *fc,
 }
 
 
+/*
+ *  fill DP matrices by diagonals, i.e. all subsegments [i, j] with
+ *  identical span d = j - i. Each cell only depends on cells of
+ *  smaller span, so all cells of a diagonal are processed concurrently.
+ *  Instead of the rotating row arrays of the serial fill, we keep the
+ *  full (row-wise) triangles of the auxiliary arrays and hand over the
+ *  rows of the current cell to the decompositions. This way, the
+ *  resulting matrices are identical to those of the serial fill.
+ */
+PRIVATE void
+fill_arrays_wavefront(vrna_fold_compound_t  *fc,
+                      int                   num_threads)
+{
+  int   d, i, length, uniq_ML, *indx, *c, *fML, *fM1, **Fm, **DML, **cc;
+
+  length  = (int)fc->length;
+  indx    = fc->jindx;
+  uniq_ML = fc->params->model_details.uniq_ML;
+  c       = fc->matrices->c;
+  fML     = fc->matrices->fML;
+  fM1     = fc->matrices->fM1;
+  Fm      = get_aux_rows(length);                                               /* Fm[i][j] holds fML[i,j] row-wise */
+  DML     = get_aux_rows(length);                                               /* DML[i][j] holds MIN(fML[i,k]+fML[k+1,j]) */
+  cc      = (fc->params->model_details.noLP) ? get_aux_rows(length) : NULL;    /* canonical structures */
+
+  for (d = 1; d < length; d++) {
+#ifdef _OPENMP
+#pragma omp parallel for private(i) num_threads(num_threads) schedule(dynamic, 8)
+#endif
+    for (i = 1; i <= length - d; i++) {
+      int               j, ij;
+      struct aux_arrays aux;
+
+      j   = i + d;
+      ij  = indx[j] + i;
+
+      aux.cc    = (cc) ? cc[i] : NULL;
+      aux.cc1   = (cc) ? cc[i + 1] : NULL;
+      aux.Fmi   = Fm[i];
+      aux.DMLi  = DML[i];
+      aux.DMLi1 = DML[i + 1];
+      aux.DMLi2 = DML[i + 2];
+
+      /* decompose subsegment [i, j] with pair (i, j) */
+      c[ij] = decompose_pair(fc, i, j, &aux, NULL);
+
+      /* decompose subsegment [i, j] that is multibranch loop part with at least one branch */
+      fML[ij] = vrna_E_ml_stems_fast(fc, i, j, aux.Fmi, aux.DMLi);
+
+      /* decompose subsegment [i, j] that is multibranch loop part with exactly one branch */
+      if (uniq_ML)
+        fM1[ij] = E_ml_rightmost_stem(i, j, fc);
+
+      if ((fc->aux_grammar) && (fc->aux_grammar->cb_aux))
+        fc->aux_grammar->cb_aux(fc, i, j, fc->aux_grammar->data);
+    }
+  }
+
+  free_aux_rows(Fm);
+  free_aux_rows(DML);
+  free_aux_rows(cc);
+}
+
+
+/*
+ *  fill DP matrices in vertical panels of tile adjacent columns, i.e.
+ *  all subsegments [i, j] with j in the current panel are processed
+ *  before we move on to the next panel. Within a panel, we proceed
+ *  row-wise from the diagonal towards i = 1. Since cell [i, j] only
+ *  depends on cells [p, q] with i <= p and q <= j, all required cells
+ *  are available at that time. As a result, the columns (and the
+ *  corresponding rows of the auxiliary triangles) that are accessed
+ *  by the split point loops of consecutive rows remain in the cache,
+ *  instead of being evicted by a full sweep over the entire row.
+ */
+PRIVATE void
+fill_arrays_tiled(vrna_fold_compound_t  *fc,
+                  int                   tile)
+{
+  int               i, j, ij, jb, je, length, uniq_ML, *indx, *c, *fML, *fM1, **Fm, **DML, **cc;
+  struct aux_arrays aux;
+
+  length  = (int)fc->length;
+  indx    = fc->jindx;
+  uniq_ML = fc->params->model_details.uniq_ML;
+  c       = fc->matrices->c;
+  fML     = fc->matrices->fML;
+  fM1     = fc->matrices->fM1;
+  Fm      = get_aux_rows(length);                                               /* Fm[i][j] holds fML[i,j] row-wise */
+  DML     = get_aux_rows(length);                                               /* DML[i][j] holds MIN(fML[i,k]+fML[k+1,j]) */
+  cc      = (fc->params->model_details.noLP) ? get_aux_rows(length) : NULL;    /* canonical structures */
+
+  for (jb = 2; jb <= length; jb += tile) {
+    je = MIN2(jb + tile - 1, length);
+
+    for (i = je - 1; i >= 1; i--) {
+      aux.cc    = (cc) ? cc[i] : NULL;
+      aux.cc1   = (cc) ? cc[i + 1] : NULL;
+      aux.Fmi   = Fm[i];
+      aux.DMLi  = DML[i];
+      aux.DMLi1 = DML[i + 1];
+      aux.DMLi2 = DML[i + 2];
+
+      for (j = MAX2(i + 1, jb); j <= je; j++) {
+        ij = indx[j] + i;
+
+        /* decompose subsegment [i, j] with pair (i, j) */
+        c[ij] = decompose_pair(fc, i, j, &aux, NULL);
+
+        /* decompose subsegment [i, j] that is multibranch loop part with at least one branch */
+        fML[ij] = vrna_E_ml_stems_fast(fc, i, j, aux.Fmi, aux.DMLi);
+
+        /* decompose subsegment [i, j] that is multibranch loop part with exactly one branch */
+        if (uniq_ML)
+          fM1[ij] = E_ml_rightmost_stem(i, j, fc);
+
+        if ((fc->aux_grammar) && (fc->aux_grammar->cb_aux))
+          fc->aux_grammar->cb_aux(fc, i, j, fc->aux_grammar->data);
+      }
+    }
+  }
+
+  free_aux_rows(Fm);
+  free_aux_rows(DML);
+  free_aux_rows(cc);
+}
+
+
 /* post-processing step for circular RNAs */
 PRIVATE int
 postprocess_circular(vrna_fold_compound_t *fc,
@@ -3531,3 +3716,45 @@ free_aux_arrays(struct aux_arrays *aux)
   free(aux->DMLi2);
   free(aux);
 }
+
+
+/*
+ *  Row-wise triangular auxiliary matrix for the diagonal fill. Row r
+ *  is accessible for columns r - 2 up to length + 1, since the
+ *  multibranch decompositions peek up to two columns left of the
+ *  diagonal in rows i + 1 and i + 2. All entries are initialized
+ *  with INF, and rows[0] keeps track of the memory block.
+ */
+PRIVATE int **
+get_aux_rows(unsigned int length)
+{
+  unsigned int  r;
+  size_t        k, size, offset;
+  int           *mem, **rows;
+
+  size  = ((size_t)(length + 3) * (size_t)(length + 4)) / 2;
+  mem   = (int *)vrna_alloc(sizeof(int) * size);
+  rows  = (int **)vrna_alloc(sizeof(int *) * (length + 3));
+
+  for (k = 0; k < size; k++)
+    mem[k] = INF;
+
+  rows[0] = mem;
+
+  for (offset = 0, r = 1; r <= length + 2; r++) {
+    rows[r] = mem + offset - ((int)r - 2);
+    offset  += length - r + 4;
+  }
+
+  return rows;
+}
+
+
+PRIVATE void
+free_aux_rows(int **rows)
+{
+  if (rows) {
+    free(rows[0]);
+    free(rows);
+  }
+}
@@ -85,6 +85,13 @@
  *  @note This function is polymorphic. It accepts #vrna_fold_compound_t of type
  *        #VRNA_FC_TYPE_SINGLE, and #VRNA_FC_TYPE_COMPARATIVE.
  *
+ *  @note If #vrna_md_t.num_threads of the model settings is larger than 1 (and
+ *        RNAlib was compiled with OpenMP support), the DP matrices of single-stranded
+ *        problems are filled by diagonals using the specified number of threads. The
+ *        resulting matrices are identical to those of the serial fill. In this case,
+ *        any user-provided callbacks, e.g. auxiliary grammar rules or soft constraints,
+ *        must be safe to call concurrently.
+ *
  *  @see #vrna_fold_compound_t, vrna_fold_compound(), vrna_fold(), vrna_circfold(),
  *        vrna_fold_compound_comparative(), vrna_alifold(), vrna_circalifold()
  *
@@ -272,6 +279,59 @@ DEPRECATED(float
  * @}
  */
 
+/**
+ *  @name Lane-parallel global MFE prediction for many short sequences
+ *  @{
+ */
+
+/**
+ *  @brief  Number of sequences that are processed in lock-step by vrna_mfe_lanes()
+ */
+#define VRNA_MFE_LANES  8
+
+
+/**
+ *  @brief Compute the MFE and a corresponding secondary structure for many sequences at once
+ *
+ *  Consecutive sequences of equal length are grouped into chunks of up to #VRNA_MFE_LANES
+ *  sequences whose dynamic programming matrices are stored interleaved, i.e. the entries
+ *  of all sequences for the same pair @f$(i,j)@f$ are adjacent in memory. The recursions
+ *  then operate on all sequences of a chunk simultaneously, such that the compiler can
+ *  map the innermost loops onto vector instructions. This pays off for large sets of
+ *  short sequences, e.g. designed candidates or sgRNAs, where the per-sequence overhead
+ *  of vrna_fold() dominates.
+ *
+ *  Only the default hard constraints and model settings with @p dangles of 0 or 2 are
+ *  supported. For circular RNAs, G-Quadruplexes, lonely pair restrictions, non-default
+ *  salt concentrations, or multiple strands the function silently falls back to
+ *  individual vrna_mfe() calls. If @p md_p requests more than one thread, chunks are
+ *  processed in parallel.
+ *
+ *  @note   Among co-optimal structures, the structure returned may differ from the one
+ *          obtained with vrna_fold().
+ *
+ *  @see vrna_fold(), vrna_fold_compound_batch(), #VRNA_MFE_LANES
+ *
+ *  @param sequences  The RNA sequences
+ *  @param num        The number of sequences
+ *  @param md_p       Model details to use (may be @p NULL for default settings)
+ *  @param structures An array of @p num pre-allocated character arrays the MFE structures are written to (may be @p NULL)
+ *  @param mfe        An array of size @p num where the minimum free energies (in kcal/mol) are stored
+ *  @return           The number of sequences processed
+ */
+int
+vrna_mfe_lanes(const char       **sequences,
+               unsigned int     num,
+               const vrna_md_t  *md_p,
+               char             **structures,
+               float            *mfe);
+
+
+/**
+ * End lane-parallel global MFE interface
+ * @}
+ */
+
 /**
  * End group mfe_global
  * @}
@@ -0,0 +1,690 @@
+/*
+ *                minimum free energy
+ *                lane-parallel RNA secondary structure prediction
+ *                for many sequences of equal length
+ *
+ *                Vienna RNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <ctype.h>
+#include <string.h>
+#include <limits.h>
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/strings.h"
+#include "ViennaRNA/params/default.h"
+#include "ViennaRNA/datastructures/basic.h"
+#include "ViennaRNA/params/basic.h"
+#include "ViennaRNA/alphabet.h"
+#include "ViennaRNA/loops/all.h"
+#include "ViennaRNA/mfe.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define LANES   VRNA_MFE_LANES
+
+/*
+ *  All DP matrices are stored in struct-of-arrays layout, i.e. the
+ *  entries of all lanes for a particular cell (i,j) are adjacent in
+ *  memory: mx[(jindx[j] + i) * LANES + lane]
+ */
+struct lanes_mx {
+  unsigned int  length;       /* sequence length the memory is allocated for */
+  unsigned int  lanes;        /* number of active lanes */
+  char          *seq[LANES];  /* upper-case sequences */
+  short         *S[LANES];    /* sequence encoding (aliased) */
+  short         *S2[LANES];   /* sequence encoding (simple) */
+  int           *jindx;
+  unsigned char *ptype;
+  int           *c;
+  int           *c_mm;        /* c + mismatch of (i,j) as enclosed pair of a generic interior loop */
+  int           *fML;
+  int           *f5;
+};
+
+
+struct lanes_fallback {
+  char  **structures;
+  float *mfe;
+};
+
+
+/*
+ #################################
+ # PRIVATE FUNCTION DECLARATIONS #
+ #################################
+ */
+PRIVATE int
+lanes_supported(const vrna_md_t *md);
+
+
+PRIVATE void
+lanes_mx_prepare(struct lanes_mx  *mx,
+                 const char       **sequences,
+                 unsigned int     num,
+                 vrna_md_t        *md);
+
+
+PRIVATE void
+lanes_mx_free(struct lanes_mx *mx);
+
+
+PRIVATE void
+lanes_fill(struct lanes_mx  *mx,
+           vrna_param_t     *P);
+
+
+PRIVATE void
+lanes_backtrack(struct lanes_mx *mx,
+                unsigned int    lane,
+                vrna_param_t    *P,
+                char            *structure);
+
+
+PRIVATE void
+lanes_fallback_cb(vrna_fold_compound_t  *fc,
+                  unsigned int          i,
+                  void                  *data);
+
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+PUBLIC int
+vrna_mfe_lanes(const char       **sequences,
+               unsigned int     num,
+               const vrna_md_t  *md_p,
+               char             **structures,
+               float            *mfe)
+{
+  int                   multi_strand;
+  unsigned int          i, *chunks, num_chunks, len;
+  vrna_md_t             md;
+  vrna_param_t          *P;
+  struct lanes_fallback fallback;
+
+  if ((!sequences) ||
+      (!mfe))
+    return 0;
+
+  for (i = 0; i < num; i++)
+    if (!sequences[i])
+      return 0;
+
+  if (md_p)
+    md = *md_p;
+  else
+    vrna_md_set_default(&md);
+
+  multi_strand = 0;
+  for (i = 0; i < num; i++)
+    if (strchr(sequences[i], '&'))
+      multi_strand = 1;
+
+  if ((multi_strand) ||
+      (!lanes_supported(&md))) {
+    /* process each sequence separately */
+    fallback.structures = structures;
+    fallback.mfe        = mfe;
+
+    return vrna_fold_compound_batch(sequences,
+                                    num,
+                                    &md,
+                                    VRNA_OPTION_MFE,
+                                    &lanes_fallback_cb,
+                                    (void *)&fallback);
+  }
+
+  /* split input into chunks of at most LANES consecutive sequences of equal length */
+  chunks      = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (num + 1));
+  num_chunks  = 0;
+
+  for (i = 0; i < num; ) {
+    chunks[num_chunks++]  = i;
+    len                   = strlen(sequences[i]);
+
+    for (i++; (i < num) && (i - chunks[num_chunks - 1] < LANES) && (strlen(sequences[i]) == len); i++);
+  }
+
+  chunks[num_chunks] = num;
+
+#ifdef _OPENMP
+  int num_threads = (md.num_threads > 1) ? md.num_threads : 1;
+#endif
+
+  md.num_threads  = 1;
+  P               = vrna_params(&md);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+  {
+    unsigned int    ch, l;
+    struct lanes_mx mx;
+
+    memset(&mx, 0, sizeof(struct lanes_mx));
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (ch = 0; ch < num_chunks; ch++) {
+      lanes_mx_prepare(&mx,
+                       sequences + chunks[ch],
+                       chunks[ch + 1] - chunks[ch],
+                       &md);
+
+      lanes_fill(&mx, P);
+
+      for (l = 0; l < mx.lanes; l++) {
+        mfe[chunks[ch] + l] = (float)mx.f5[mx.length * LANES + l] / 100.;
+
+        if ((structures) &&
+            (structures[chunks[ch] + l]))
+          lanes_backtrack(&mx, l, P, structures[chunks[ch] + l]);
+      }
+    }
+
+    lanes_mx_free(&mx);
+  }
+
+  free(P);
+  free(chunks);
+
+  return (int)num;
+}
+
+
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
+PRIVATE int
+lanes_supported(const vrna_md_t *md)
+{
+  if ((md->circ) ||
+      (md->gquad) ||
+      (md->noLP) ||
+      (md->noGUclosure) ||
+      ((md->dangles != 0) && (md->dangles != 2)) ||
+      (md->salt != VRNA_MODEL_DEFAULT_SALT))
+    return 0;
+
+  return 1;
+}
+
+
+PRIVATE void
+lanes_mx_prepare(struct lanes_mx  *mx,
+                 const char       **sequences,
+                 unsigned int     num,
+                 vrna_md_t        *md)
+{
+  unsigned int  n, l, i, j, size, max_bp_span, turn;
+  int           ij;
+  short         *S2;
+
+  n = strlen(sequences[0]);
+
+  for (l = 0; l < LANES; l++) {
+    free(mx->seq[l]);
+    free(mx->S[l]);
+    free(mx->S2[l]);
+
+    /* unused lanes simply repeat the last sequence */
+    mx->seq[l] = strdup(sequences[(l < num) ? l : num - 1]);
+    vrna_seq_toupper(mx->seq[l]);
+    mx->S[l]  = vrna_seq_encode(mx->seq[l], md);
+    mx->S2[l] = vrna_seq_encode_simple(mx->seq[l], md);
+  }
+
+  mx->lanes = num;
+
+  if (mx->length != n) {
+    size = ((n * (n + 1)) / 2 + 2) * LANES;
+
+    free(mx->jindx);
+    mx->jindx = vrna_idx_col_wise(n);
+    mx->ptype = (unsigned char *)vrna_realloc(mx->ptype, sizeof(unsigned char) * size);
+    mx->c     = (int *)vrna_realloc(mx->c, sizeof(int) * size);
+    mx->c_mm  = (int *)vrna_realloc(mx->c_mm, sizeof(int) * size);
+    mx->fML   = (int *)vrna_realloc(mx->fML, sizeof(int) * size);
+    mx->f5    = (int *)vrna_realloc(mx->f5, sizeof(int) * (n + 2) * LANES);
+
+    mx->length = n;
+  }
+
+  /* pair types according to the default hard constraints */
+  turn        = md->min_loop_size;
+  max_bp_span = ((md->max_bp_span <= 0) || (md->max_bp_span > (int)n)) ? n : (unsigned int)md->max_bp_span;
+
+  for (j = 1; j <= n; j++)
+    for (i = 1; i <= j; i++) {
+      ij = mx->jindx[j] + i;
+      for (l = 0; l < LANES; l++) {
+        S2                          = mx->S2[l];
+        mx->ptype[ij * LANES + l]   = ((j - i > turn) && (j - i < max_bp_span)) ?
+                                      (unsigned char)md->pair[S2[i]][S2[j]] :
+                                      0;
+        if ((md->noGU) &&
+            ((mx->ptype[ij * LANES + l] == 3) || (mx->ptype[ij * LANES + l] == 4)))
+          mx->ptype[ij * LANES + l] = 0;
+      }
+    }
+}
+
+
+PRIVATE void
+lanes_mx_free(struct lanes_mx *mx)
+{
+  unsigned int l;
+
+  for (l = 0; l < LANES; l++) {
+    free(mx->seq[l]);
+    free(mx->S[l]);
+    free(mx->S2[l]);
+  }
+
+  free(mx->jindx);
+  free(mx->ptype);
+  free(mx->c);
+  free(mx->c_mm);
+  free(mx->fML);
+  free(mx->f5);
+}
+
+
+PRIVATE void
+lanes_fill(struct lanes_mx  *mx,
+           vrna_param_t     *P)
+{
+  unsigned char *tp, *ptype;
+  short         **S;
+  int           n, i, j, p, q, u, u1, u2, ij, pq, turn, dangles, any, type, type2,
+                common, max_p, min_q, *jindx, *c, *c_mm, *fML, *f5, *rtype,
+                e[LANES], gen[LANES], dm[LANES];
+
+  n       = (int)mx->length;
+  S       = mx->S;
+  jindx   = mx->jindx;
+  ptype   = mx->ptype;
+  c       = mx->c;
+  c_mm    = mx->c_mm;
+  fML     = mx->fML;
+  f5      = mx->f5;
+  turn    = P->model_details.min_loop_size;
+  dangles = P->model_details.dangles;
+  rtype   = &(P->model_details.rtype[0]);
+
+  for (j = 1; j <= n; j++)
+    for (i = (j > turn) ? (j - turn) : 1; i <= j; i++) {
+      ij = jindx[j] + i;
+      for (int l = 0; l < LANES; l++)
+        c[ij * LANES + l] = c_mm[ij * LANES + l] = fML[ij * LANES + l] = INF;
+    }
+
+  for (i = n - turn - 1; i >= 1; i--) {
+    for (j = i + turn + 1; j <= n; j++) {
+      ij  = jindx[j] + i;
+      tp  = ptype + ij * LANES;
+      any = 0;
+
+      for (int l = 0; l < LANES; l++) {
+        any     |= tp[l];
+        e[l]    = INF;
+        gen[l]  = INF;
+        dm[l]   = INF;
+      }
+
+      if (any) {
+        /* hairpin loops */
+        for (int l = 0; l < LANES; l++)
+          if (tp[l])
+            e[l] = E_Hairpin(j - i - 1, tp[l], S[l][i + 1], S[l][j - 1], mx->seq[l] + i - 1, P);
+
+        /* interior loops */
+        max_p = MIN2(j - turn - 2, i + MAXLOOP + 1);
+        for (p = i + 1; p <= max_p; p++) {
+          u1    = p - i - 1;
+          min_q = MAX2(p + turn + 1, j - 1 - MAXLOOP + u1);
+          for (q = j - 1; q >= min_q; q--) {
+            u2  = j - q - 1;
+            pq  = jindx[q] + p;
+
+            if ((u1 >= 2) && (u2 >= 2) && (u1 + u2 > 5)) {
+              /*
+               *  generic interior loop: everything but the mismatch of the
+               *  closing pair (i,j) is either the same for all lanes, or
+               *  has been pre-computed in c_mm
+               */
+              const int *cm = c_mm + pq * LANES;
+
+              u       = u1 + u2;
+              common  = P->internal_loop[u] +
+                        MIN2(MAX_NINIO, abs(u1 - u2) * P->ninio[2]);
+
+              for (int l = 0; l < LANES; l++) {
+                int en = cm[l] + common;
+                gen[l] = MIN2(gen[l], en);
+              }
+            } else {
+              const int *cpq = c + pq * LANES;
+
+              for (int l = 0; l < LANES; l++) {
+                if ((tp[l]) && (cpq[l] != INF)) {
+                  type2 = rtype[ptype[pq * LANES + l]];
+                  int en = cpq[l] +
+                           E_IntLoop(u1, u2, tp[l], type2,
+                                     S[l][i + 1], S[l][j - 1], S[l][p - 1], S[l][q + 1],
+                                     P);
+                  e[l] = MIN2(e[l], en);
+                }
+              }
+            }
+          }
+        }
+
+        for (int l = 0; l < LANES; l++)
+          if ((tp[l]) && (gen[l] < INF)) {
+            int en = gen[l] + P->mismatchI[tp[l]][S[l][i + 1]][S[l][j - 1]];
+            e[l] = MIN2(e[l], en);
+          }
+
+        /* multibranch loops */
+        for (u = i + turn + 2; u <= j - turn - 3; u++) {
+          const int *a  = fML + (jindx[u] + i + 1) * LANES;
+          const int *b  = fML + (jindx[j - 1] + u + 1) * LANES;
+
+          for (int l = 0; l < LANES; l++) {
+            int en = a[l] + b[l];
+            dm[l] = MIN2(dm[l], en);
+          }
+        }
+
+        for (int l = 0; l < LANES; l++)
+          if ((tp[l]) && (dm[l] < INF)) {
+            type = rtype[tp[l]];
+            int en = dm[l] +
+                     P->MLclosing +
+                     ((dangles == 2) ?
+                      E_MLstem(type, S[l][j - 1], S[l][i + 1], P) :
+                      E_MLstem(type, -1, -1, P));
+            e[l] = MIN2(e[l], en);
+          }
+      }
+
+      for (int l = 0; l < LANES; l++) {
+        c[ij * LANES + l]     = (tp[l]) ? e[l] : INF;
+        c_mm[ij * LANES + l]  = INF;
+
+        if (c[ij * LANES + l] != INF)
+          c_mm[ij * LANES + l] = c[ij * LANES + l] +
+                                 P->mismatchI[rtype[tp[l]]][S[l][j + 1]][S[l][i - 1]];
+      }
+
+      /* multibranch loop components */
+      for (int l = 0; l < LANES; l++) {
+        int en;
+
+        e[l] = INF;
+
+        if (c[ij * LANES + l] != INF) {
+          en = c[ij * LANES + l] +
+               ((dangles == 2) ?
+                E_MLstem(tp[l], S[l][i - 1], S[l][j + 1], P) :
+                E_MLstem(tp[l], -1, -1, P));
+          e[l] = MIN2(e[l], en);
+        }
+
+        if (fML[(jindx[j] + i + 1) * LANES + l] != INF) {
+          en    = fML[(jindx[j] + i + 1) * LANES + l] + P->MLbase;
+          e[l]  = MIN2(e[l], en);
+        }
+
+        if (fML[(jindx[j - 1] + i) * LANES + l] != INF) {
+          en    = fML[(jindx[j - 1] + i) * LANES + l] + P->MLbase;
+          e[l]  = MIN2(e[l], en);
+        }
+      }
+
+      for (u = i + turn + 1; u <= j - turn - 2; u++) {
+        const int *a  = fML + (jindx[u] + i) * LANES;
+        const int *b  = fML + (jindx[j] + u + 1) * LANES;
+
+        for (int l = 0; l < LANES; l++) {
+          int en = a[l] + b[l];
+          e[l] = MIN2(e[l], en);
+        }
+      }
+
+      for (int l = 0; l < LANES; l++)
+        fML[ij * LANES + l] = (e[l] < INF) ? e[l] : INF;
+    }
+  }
+
+  /* exterior loop */
+  for (j = 0; j <= MIN2(turn + 1, n); j++)
+    for (int l = 0; l < LANES; l++)
+      f5[j * LANES + l] = 0;
+
+  for (j = turn + 2; j <= n; j++) {
+    for (int l = 0; l < LANES; l++) {
+      int e5 = f5[(j - 1) * LANES + l];
+
+      for (i = j - turn - 1; i >= 1; i--) {
+        ij = jindx[j] + i;
+        if (c[ij * LANES + l] != INF) {
+          type = ptype[ij * LANES + l];
+          int en = f5[(i - 1) * LANES + l] +
+                   c[ij * LANES + l] +
+                   ((dangles == 2) ?
+                    vrna_E_ext_stem(type, (i > 1) ? S[l][i - 1] : -1, (j < n) ? S[l][j + 1] : -1, P) :
+                    vrna_E_ext_stem(type, -1, -1, P));
+          e5 = MIN2(e5, en);
+        }
+      }
+
+      f5[j * LANES + l] = e5;
+    }
+  }
+}
+
+
+PRIVATE void
+lanes_backtrack(struct lanes_mx *mx,
+                unsigned int    lane,
+                vrna_param_t    *P,
+                char            *structure)
+{
+  char          *seq;
+  short         *S;
+  unsigned char *ptype;
+  int           n, i, j, p, q, u, s, en, type, type2, turn, dangles, max_p, min_q,
+                *jindx, *c, *fML, *f5, *rtype, (*stack)[3];
+
+#define LANE(mx_, ij_) (mx_)[(ij_) * LANES + lane]
+
+  n       = (int)mx->length;
+  seq     = mx->seq[lane];
+  S       = mx->S[lane];
+  jindx   = mx->jindx;
+  ptype   = mx->ptype;
+  c       = mx->c;
+  fML     = mx->fML;
+  f5      = mx->f5;
+  turn    = P->model_details.min_loop_size;
+  dangles = P->model_details.dangles;
+  rtype   = &(P->model_details.rtype[0]);
+
+  memset(structure, '.', sizeof(char) * n);
+  structure[n] = '\0';
+
+  /* (i, j, what): 0 = exterior loop [1:j], 1 = fML[i,j], 2 = base pair (i,j) */
+  stack     = vrna_alloc(sizeof(int[3]) * (2 * n + 4));
+  s         = 0;
+  stack[0][0] = 1;
+  stack[0][1] = n;
+  stack[0][2] = 0;
+  s++;
+
+  while (s > 0) {
+    s--;
+    i = stack[s][0];
+    j = stack[s][1];
+
+    switch (stack[s][2]) {
+      case 0:
+        while ((j > turn + 1) && (LANE(f5, j) == LANE(f5, j - 1)))
+          j--;
+
+        if (j <= turn + 1)
+          break;
+
+        for (i = j - turn - 1; i >= 1; i--) {
+          if (LANE(c, jindx[j] + i) == INF)
+            continue;
+
+          type  = LANE(ptype, jindx[j] + i);
+          en    = LANE(f5, i - 1) +
+                  LANE(c, jindx[j] + i) +
+                  ((dangles == 2) ?
+                   vrna_E_ext_stem(type, (i > 1) ? S[i - 1] : -1, (j < n) ? S[j + 1] : -1, P) :
+                   vrna_E_ext_stem(type, -1, -1, P));
+
+          if (en == LANE(f5, j)) {
+            stack[s][0]   = 1;
+            stack[s][1]   = i - 1;
+            stack[s++][2] = 0;
+            stack[s][0]   = i;
+            stack[s][1]   = j;
+            stack[s++][2] = 2;
+            break;
+          }
+        }
+
+        break;
+
+      case 1:
+        en = LANE(fML, jindx[j] + i);
+
+        if (LANE(fML, jindx[j] + i + 1) + P->MLbase == en) {
+          stack[s][0]   = i + 1;
+          stack[s][1]   = j;
+          stack[s++][2] = 1;
+          break;
+        }
+
+        if (LANE(fML, jindx[j - 1] + i) + P->MLbase == en) {
+          stack[s][0]   = i;
+          stack[s][1]   = j - 1;
+          stack[s++][2] = 1;
+          break;
+        }
+
+        type = LANE(ptype, jindx[j] + i);
+        if ((LANE(c, jindx[j] + i) != INF) &&
+            (LANE(c, jindx[j] + i) +
+             ((dangles == 2) ? E_MLstem(type, S[i - 1], S[j + 1], P) : E_MLstem(type, -1, -1, P)) ==
+             en)) {
+          stack[s][0]   = i;
+          stack[s][1]   = j;
+          stack[s++][2] = 2;
+          break;
+        }
+
+        for (u = i + turn + 1; u <= j - turn - 2; u++)
+          if (LANE(fML, jindx[u] + i) + LANE(fML, jindx[j] + u + 1) == en) {
+            stack[s][0]   = i;
+            stack[s][1]   = u;
+            stack[s++][2] = 1;
+            stack[s][0]   = u + 1;
+            stack[s][1]   = j;
+            stack[s++][2] = 1;
+            break;
+          }
+
+        break;
+
+      case 2:
+        /* walk along the helix and its enclosed loops */
+        while (1) {
+          structure[i - 1]  = '(';
+          structure[j - 1]  = ')';
+
+          en    = LANE(c, jindx[j] + i);
+          type  = LANE(ptype, jindx[j] + i);
+
+          if (en == E_Hairpin(j - i - 1, type, S[i + 1], S[j - 1], seq + i - 1, P))
+            break;
+
+          max_p = MIN2(j - turn - 2, i + MAXLOOP + 1);
+          for (p = i + 1; p <= max_p; p++) {
+            min_q = MAX2(p + turn + 1, j - 1 - MAXLOOP + (p - i - 1));
+            for (q = j - 1; q >= min_q; q--) {
+              if (LANE(c, jindx[q] + p) == INF)
+                continue;
+
+              type2 = rtype[LANE(ptype, jindx[q] + p)];
+              if (en == LANE(c, jindx[q] + p) +
+                  E_IntLoop(p - i - 1, j - q - 1, type, type2,
+                            S[i + 1], S[j - 1], S[p - 1], S[q + 1],
+                            P))
+                goto bt_enclosed_pair;
+            }
+          }
+
+          /* must be a multibranch loop */
+          en -= P->MLclosing +
+                ((dangles == 2) ?
+                 E_MLstem(rtype[type], S[j - 1], S[i + 1], P) :
+                 E_MLstem(rtype[type], -1, -1, P));
+
+          for (u = i + turn + 2; u <= j - turn - 3; u++)
+            if (LANE(fML, jindx[u] + i + 1) + LANE(fML, jindx[j - 1] + u + 1) == en) {
+              stack[s][0]   = i + 1;
+              stack[s][1]   = u;
+              stack[s++][2] = 1;
+              stack[s][0]   = u + 1;
+              stack[s][1]   = j - 1;
+              stack[s++][2] = 1;
+              break;
+            }
+
+          break;
+
+bt_enclosed_pair:
+          i = p;
+          j = q;
+        }
+
+        break;
+    }
+  }
+
+#undef LANE
+
+  free(stack);
+}
+
+
+PRIVATE void
+lanes_fallback_cb(vrna_fold_compound_t  *fc,
+                  unsigned int          i,
+                  void                  *data)
+{
+  struct lanes_fallback *d = (struct lanes_fallback *)data;
+
+  d->mfe[i] = vrna_mfe(fc,
+                       ((d->structures) && (d->structures[i])) ? d->structures[i] : NULL);
+}
@@ -68,6 +68,17 @@ struct aux_arrays {
   int *DMLi2; /*                MIN(fML[i+2,k]+fML[k+1,j])    */
 };
 
+
+/*
+ *  exterior loop decomposition f3[i] = unpaired stretch + outermost
+ *  pair or G-quadruplex [p, q] + f3[next], as found when row i was filled
+ */
+struct ext_decomp {
+  int *p;     /* 5' end of the outermost pair (negative for G-quadruplexes), 0 if none */
+  int *q;     /* 3' end of the outermost pair or G-quadruplex */
+  int *next;  /* position where the exterior loop decomposition continues */
+};
+
 /*
  #################################
  # GLOBAL VARIABLES              #
@@ -96,6 +107,13 @@ backtrack(vrna_fold_compound_t  *vc,
           int                   maxdist);
 
 
+PRIVATE char *
+backtrack_sector(vrna_fold_compound_t *vc,
+                 int                  start,
+                 int                  end,
+                 int                  bt_ml);
+
+
 PRIVATE int
 fill_arrays(vrna_fold_compound_t            *vc,
             int                             *underflow,
@@ -106,6 +124,18 @@ fill_arrays(vrna_fold_compound_t            *vc,
             void                            *data);
 
 
+PRIVATE int
+fill_arrays_ext(vrna_fold_compound_t  *fc,
+                int                   *underflow,
+                struct ext_decomp     *ext);
+
+
+PRIVATE void
+backtrack_ext(vrna_fold_compound_t  *fc,
+              struct ext_decomp     *ext,
+              char                  *structure);
+
+
 PRIVATE void
 default_callback(int        start,
                  int        end,
@@ -125,6 +155,10 @@ make_pscores(vrna_fold_compound_t *fc,
              int                  start);
 
 
+PRIVATE void
+update_ribosum(vrna_fold_compound_t *fc);
+
+
 PRIVATE void
 default_callback_comparative(int        start,
                              int        end,
@@ -249,6 +283,49 @@ vrna_mfe_window_cb(vrna_fold_compound_t     *vc,
 }
 
 
+PUBLIC float
+vrna_mfe_window_global(vrna_fold_compound_t *vc,
+                       char                 *structure)
+{
+  int               energy, underflow, n_seq;
+  float             mfe, e_factor;
+  struct ext_decomp ext;
+
+  if (!vrna_fold_compound_prepare(vc, VRNA_OPTION_MFE | VRNA_OPTION_WINDOW)) {
+    vrna_message_warning("vrna_mfe_window_global@mfe_window.c: Failed to prepare vrna_fold_compound");
+    return (float)(INF / 100.);
+  }
+
+  n_seq     = (vc->type == VRNA_FC_TYPE_COMPARATIVE) ? vc->n_seq : 1;
+  e_factor  = 100. * n_seq;
+
+  if ((vc->type == VRNA_FC_TYPE_COMPARATIVE) &&
+      (vc->params->model_details.ribo))
+    update_ribosum(vc);
+
+  ext.p     = (int *)vrna_alloc(sizeof(int) * (vc->length + 2));
+  ext.q     = (int *)vrna_alloc(sizeof(int) * (vc->length + 2));
+  ext.next  = (int *)vrna_alloc(sizeof(int) * (vc->length + 2));
+
+  /* keep track of how many times we were close to an integer underflow */
+  underflow = 0;
+
+  energy = fill_arrays_ext(vc, &underflow, &ext);
+
+  if (structure)
+    backtrack_ext(vc, &ext, structure);
+
+  free(ext.p);
+  free(ext.q);
+  free(ext.next);
+
+  mfe = (underflow > 0) ? ((float)underflow * (float)(UNDERFLOW_CORRECTION)) / e_factor : 0.;
+  mfe += (float)energy / e_factor;
+
+  return mfe;
+}
+
+
 #ifdef VRNA_WITH_SVM
 
 PUBLIC float
@@ -327,6 +404,7 @@ allocate_dp_matrices(vrna_fold_compound_t *fc)
   for (i = length; (i > length - maxdist - 5) && (i >= 0); i--) {
     c[i]                = (int *)vrna_alloc(sizeof(int) * (maxdist + 5));
     fML[i]              = (int *)vrna_alloc(sizeof(int) * (maxdist + 5));
+    c[i][0]             = fML[i][0] = INF; /* read by exterior stems with 5' dangles */
     hc->matrix_local[i] = (unsigned char *)vrna_alloc(sizeof(unsigned char) * (maxdist + 5));
     if (fc->type == VRNA_FC_TYPE_SINGLE)
       fc->ptype_local[i] = vrna_alloc(sizeof(char) * (maxdist + 5));
@@ -635,26 +713,8 @@ fill_arrays(vrna_fold_compound_t            *vc,
 
 #endif
 
-    if (md->ribo) {
-      float **dm = NULL;
-
-      if (RibosumFile != NULL)
-        dm = readribosum(RibosumFile);
-      else
-        dm = get_ribosum((const char **)vc->sequences, n_seq, length);
-
-      /* update distance matrix */
-      if (dm) {
-        for (i = 0; i < 7; i++) {
-          for (j = 0; j < 7; j++)
-            md->pair_dist[i][j] = dm[i][j];
-
-          free(dm[i]);
-        }
-
-        free(dm);
-      }
-    }
+    if (md->ribo)
+      update_ribosum(vc);
   }
 
   c   = vc->matrices->c_local;
@@ -814,6 +874,212 @@ fill_arrays(vrna_fold_compound_t            *vc,
 }
 
 
+/*
+ *  Same recursions as in fill_arrays(), but instead of reporting locally
+ *  optimal structures we only keep the first step of the exterior loop
+ *  decomposition for each row. This is all that is required to trace
+ *  back the globally optimal structure in linear memory afterwards.
+ */
+PRIVATE int
+fill_arrays_ext(vrna_fold_compound_t  *fc,
+                int                   *underflow,
+                struct ext_decomp     *ext)
+{
+  int               i, j, k, p, q, b, end, length, maxdist, turn, with_gquad,
+                    **c, **fML, *f3;
+  vrna_bp_stack_t   *bp_stack;
+  struct aux_arrays *helper_arrays;
+
+  length      = fc->length;
+  maxdist     = fc->window_size;
+  turn        = fc->params->model_details.min_loop_size;
+  with_gquad  = fc->params->model_details.gquad;
+  c           = fc->matrices->c_local;
+  fML         = fc->matrices->fML_local;
+  f3          = fc->matrices->f3_local;
+  bp_stack    = (vrna_bp_stack_t *)vrna_alloc(sizeof(vrna_bp_stack_t) * (4 * (1 + maxdist / 2)));
+
+  helper_arrays = get_aux_arrays(maxdist);
+
+  allocate_dp_matrices(fc);
+
+  init_constraints(fc);
+
+  if (with_gquad)
+    vrna_gquad_mx_local_update(fc, length - maxdist - 4);
+
+  for (i = length - turn - 1; i >= 1; i--) {
+    for (j = i + 1; j <= MIN2(i + turn, length); j++)
+      c[i][j - i] = fML[i][j - i] = INF;
+
+    for (j = i + turn + 1; j <= length && j <= i + maxdist; j++) {
+      c[i][j - i]   = decompose_pair(fc, i, j, helper_arrays);
+      fML[i][j - i] = vrna_E_ml_stems_fast(fc, i, j, helper_arrays->Fmi, helper_arrays->DMLi);
+
+      if ((fc->aux_grammar) && (fc->aux_grammar->cb_aux))
+        fc->aux_grammar->cb_aux(fc, i, j, fc->aux_grammar->data);
+    }
+
+    f3[i] = vrna_E_ext_loop_3(fc, i);
+
+    if (f3[i] < f3[i + 1]) {
+      /* nucleotide i is not unpaired, so store the outermost pair while row i is still available */
+      end = MIN2(length, i + maxdist);
+      k   = i;
+      p   = q = 0;
+      b   = 0;
+
+      if (!vrna_BT_ext_loop_f3(fc, &k, end, &p, &q, bp_stack, &b))
+        vrna_message_error("backtracking failed in f3, segment [%d,%d]\n", i, end);
+
+      if (p > 0) {
+        ext->p[i] = p;
+        ext->q[i] = q;
+      } else if (k > 0) {
+        /* G-quadruplex [p, k - 1], its positions are on the base pair stack */
+        for (p = k; b > 0; b--)
+          p = MIN2(p, bp_stack[b].i);
+
+        ext->p[i] = -p;
+        ext->q[i] = k - 1;
+      } else {
+        /* no more pairs up to end */
+        k = end;
+      }
+
+      ext->next[i] = k;
+    }
+
+    /* check for values close to integer underflow */
+    if (INT_CLOSE_TO_UNDERFLOW(f3[i])) {
+      /* correct f3 free energies and increase underflow counter */
+      int cnt;
+      for (cnt = i; cnt <= MIN2(i + maxdist + 2, length); cnt++)
+        f3[cnt] -= UNDERFLOW_CORRECTION;
+      (*underflow)++;
+    }
+
+    rotate_aux_arrays(helper_arrays, maxdist);
+    rotate_dp_matrices(fc, i);
+    rotate_constraints(fc, i);
+  }
+
+  free(bp_stack);
+  free_aux_arrays(helper_arrays);
+  free_dp_matrices(fc);
+
+  return f3[1];
+}
+
+
+/*
+ *  Follow the exterior loop decomposition stored by fill_arrays_ext()
+ *  from the 5' end, then re-compute the DP matrices, but only for the
+ *  segments enclosed by the outermost pairs. Each segment is traced
+ *  back as soon as it is complete, i.e. while it is still within the
+ *  window.
+ */
+PRIVATE void
+backtrack_ext(vrna_fold_compound_t  *fc,
+              struct ext_decomp     *ext,
+              char                  *structure)
+{
+  char              *ss;
+  int               i, j, k, s, b, num, length, maxdist, turn, **c, **fML,
+                    *seg_start, *seg_end, *seg_p;
+  vrna_bp_stack_t   *bp_stack;
+  struct aux_arrays *helper_arrays;
+
+  length    = fc->length;
+  maxdist   = fc->window_size;
+  turn      = fc->params->model_details.min_loop_size;
+  c         = fc->matrices->c_local;
+  fML       = fc->matrices->fML_local;
+  seg_start = (int *)vrna_alloc(sizeof(int) * (length / 2 + 2));
+  seg_end   = (int *)vrna_alloc(sizeof(int) * (length / 2 + 2));
+  seg_p     = (int *)vrna_alloc(sizeof(int) * (length / 2 + 2));
+  num       = 0;
+
+  memset(structure, '.', sizeof(char) * length);
+  structure[length] = '\0';
+
+  for (i = 1; i <= length; ) {
+    if (ext->next[i] > i) {
+      if (ext->p[i] != 0) {
+        seg_start[num]  = (ext->p[i] > 0) ? ext->p[i] : -ext->p[i];
+        seg_end[num]    = ext->q[i];
+        seg_p[num++]    = ext->p[i];
+      }
+
+      i = ext->next[i];
+    } else {
+      i++;
+    }
+  }
+
+  if (num > 0) {
+    bp_stack      = (vrna_bp_stack_t *)vrna_alloc(sizeof(vrna_bp_stack_t) * (4 * (1 + maxdist / 2)));
+    helper_arrays = get_aux_arrays(maxdist);
+
+    allocate_dp_matrices(fc);
+
+    init_constraints(fc);
+
+    if (fc->params->model_details.gquad)
+      vrna_gquad_mx_local_update(fc, length - maxdist - 4);
+
+    for (s = num - 1, i = length - turn - 1; i >= 1; i--) {
+      if ((s >= 0) &&
+          (i >= seg_start[s]) &&
+          (i < seg_end[s])) {
+        /* rows outside of the segments are never read from and remain INF */
+        for (j = i + turn + 1; j <= seg_end[s] && j <= i + maxdist; j++) {
+          c[i][j - i]   = decompose_pair(fc, i, j, helper_arrays);
+          fML[i][j - i] = vrna_E_ml_stems_fast(fc, i, j, helper_arrays->Fmi, helper_arrays->DMLi);
+
+          if ((fc->aux_grammar) && (fc->aux_grammar->cb_aux))
+            fc->aux_grammar->cb_aux(fc, i, j, fc->aux_grammar->data);
+        }
+
+        if (i == seg_start[s]) {
+          if (seg_p[s] > 0) {
+            ss = backtrack_sector(fc, seg_start[s], seg_end[s], 2);
+
+            for (k = 0; (ss[k] != '\0') && (k <= seg_end[s] - seg_start[s]); k++)
+              structure[seg_start[s] + k - 1] = ss[k];
+
+            free(ss);
+          } else {
+            b = 0;
+            if (!vrna_BT_gquad_mfe(fc, seg_start[s], seg_end[s], bp_stack, &b))
+              vrna_message_error("backtracking failed for G-quadruplex [%d,%d]\n",
+                                 seg_start[s],
+                                 seg_end[s]);
+
+            for (; b > 0; b--)
+              structure[bp_stack[b].i - 1] = '+';
+          }
+
+          s--;
+        }
+      }
+
+      rotate_aux_arrays(helper_arrays, maxdist);
+      rotate_dp_matrices(fc, i);
+      rotate_constraints(fc, i);
+    }
+
+    free(bp_stack);
+    free_aux_arrays(helper_arrays);
+    free_dp_matrices(fc);
+  }
+
+  free(seg_start);
+  free(seg_end);
+  free(seg_p);
+}
+
+
 #ifdef VRNA_WITH_SVM
 PRIVATE INLINE int
 want_backtrack(vrna_fold_compound_t *fc,
@@ -852,6 +1118,21 @@ PRIVATE char *
 backtrack(vrna_fold_compound_t  *vc,
           int                   start,
           int                   end)
+{
+  int bt_type = vc->params->model_details.backtrack_type;
+
+  return backtrack_sector(vc,
+                          start,
+                          end,
+                          (bt_type == 'M') ? 1 : ((bt_type == 'C') ? 2 : 0));
+}
+
+
+PRIVATE char *
+backtrack_sector(vrna_fold_compound_t *vc,
+                 int                  start,
+                 int                  end,
+                 int                  bt_ml)
 {
   /*------------------------------------------------------------------
    *  trace back through the "c", "f3" and "fML" arrays to get the
@@ -860,7 +1141,7 @@ backtrack(vrna_fold_compound_t  *vc,
    *  ------------------------------------------------------------------*/
   sect sector[MAXSECTORS];            /* backtracking sectors */
   char *structure, **ptype;
-  int i, j, k, length, no_close, type, s, b, bt_type, turn,
+  int i, j, k, length, no_close, type, s, b, turn,
       dangle_model, noLP, noGUclosure, **c, dangle3, ml, cij,
       **pscore, canonical, p, q, comp1, comp2, max3;
   vrna_param_t *P;
@@ -875,7 +1156,6 @@ backtrack(vrna_fold_compound_t  *vc,
   dangle_model  = md->dangles;
   noLP          = md->noLP;
   noGUclosure   = md->noGUclosure;
-  bt_type       = md->backtrack_type;
   turn          = md->min_loop_size;
   c             = vc->matrices->c_local;
 
@@ -885,7 +1165,7 @@ backtrack(vrna_fold_compound_t  *vc,
 
   sector[++s].i = start;
   sector[s].j   = MIN2(length, end);
-  sector[s].ml  = (bt_type == 'M') ? 1 : ((bt_type == 'C') ? 2 : 0);
+  sector[s].ml  = bt_ml;
 
   structure = (char *)vrna_alloc((MIN2(length - start, end) + 3) * sizeof(char));
 
@@ -1179,6 +1459,34 @@ make_pscores(vrna_fold_compound_t *fc,
 }
 
 
+PRIVATE void
+update_ribosum(vrna_fold_compound_t *fc)
+{
+  int       i, j;
+  float     **dm;
+  vrna_md_t *md;
+
+  md = &(fc->params->model_details);
+
+  if (RibosumFile != NULL)
+    dm = readribosum(RibosumFile);
+  else
+    dm = get_ribosum((const char **)fc->sequences, (int)fc->n_seq, (int)fc->length);
+
+  /* update distance matrix */
+  if (dm) {
+    for (i = 0; i < 7; i++) {
+      for (j = 0; j < 7; j++)
+        md->pair_dist[i][j] = dm[i][j];
+
+      free(dm[i]);
+    }
+
+    free(dm);
+  }
+}
+
+
 PRIVATE void
 default_callback(int        start,
                  int        end,
@@ -150,6 +150,38 @@ vrna_mfe_window_cb(vrna_fold_compound_t     *fc,
                    void                     *data);
 
 
+/**
+ *  @brief Global MFE prediction with limited base pair span in linear memory
+ *
+ *  Computes the globally optimal structure of the entire sequence where
+ *  no base pair spans more than #vrna_md_t.window_size nucleotides. The
+ *  result is the same as obtained from vrna_mfe() with the corresponding
+ *  #vrna_md_t.max_bp_span setting. However, only the most recent rows of
+ *  the DP matrices are kept in memory, together with the first step of
+ *  the exterior loop decomposition for each nucleotide. The latter serve
+ *  as checkpoints that identify the outermost base pairs of the optimal
+ *  structure. Subsequently, only the segments enclosed by these pairs are
+ *  re-computed and traced back. Memory consumption thus drops from
+ *  @f$ \mathcal{O}(n^2) @f$ to @f$ \mathcal{O}(n + L^2) @f$ for a
+ *  window size @f$ L @f$ at the cost of at most twice the computation
+ *  time, which makes it possible to fold entire genomes.
+ *
+ *  The #vrna_fold_compound_t must be created using vrna_fold_compound()
+ *  with option #VRNA_OPTION_WINDOW.
+ *
+ *  @see  vrna_mfe_window(), vrna_mfe(), #VRNA_OPTION_WINDOW,
+ *        #vrna_md_t.window_size, #vrna_md_t.max_bp_span
+ *
+ *  @param  fc        The #vrna_fold_compound_t with preallocated memory for the DP matrices
+ *  @param  structure A pointer to the character array where the secondary structure in
+ *                    dot-bracket notation will be written to (maybe NULL)
+ *  @return           The minimum free energy (MFE) in kcal/mol
+ */
+float
+vrna_mfe_window_global(vrna_fold_compound_t *fc,
+                       char                 *structure);
+
+
 #ifdef VRNA_WITH_SVM
 /**
  *  @brief Local MFE prediction using a sliding window approach (with z-score cut-off)
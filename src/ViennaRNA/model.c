@@ -162,7 +162,8 @@ PRIVATE vrna_md_t defaults = {
   VRNA_MODEL_DEFAULT_SALT_DPXINIT,
   VRNA_MODEL_DEFAULT_SALT_DPXINIT_FACT,
   VRNA_MODEL_DEFAULT_HELICAL_RISE,
-  VRNA_MODEL_DEFAULT_BACKBONE_LENGTH
+  VRNA_MODEL_DEFAULT_BACKBONE_LENGTH,
+  VRNA_MODEL_DEFAULT_NUM_THREADS
 };
 
 /*
@@ -374,6 +375,7 @@ vrna_md_defaults_reset(vrna_md_t *md_p)
   defaults.saltDPXInitFact  = VRNA_MODEL_DEFAULT_SALT_DPXINIT_FACT;
   defaults.helical_rise     = VRNA_MODEL_DEFAULT_HELICAL_RISE;
   defaults.backbone_length  = VRNA_MODEL_DEFAULT_BACKBONE_LENGTH;
+  defaults.num_threads      = VRNA_MODEL_DEFAULT_NUM_THREADS;
   if (md_p) {
     /* now try to apply user settings */
     /*
@@ -413,6 +415,7 @@ vrna_md_defaults_reset(vrna_md_t *md_p)
     vrna_md_defaults_saltDPXInitFact(md_p->saltDPXInitFact);
     vrna_md_defaults_helical_rise(md_p->helical_rise);
     vrna_md_defaults_backbone_length(md_p->backbone_length);
+    vrna_md_defaults_num_threads(md_p->num_threads);
     copy_nonstandards(&defaults, &(md_p->nonstandards[0]));
   }
 
@@ -971,6 +974,18 @@ vrna_md_defaults_backbone_length_get(void)
   return defaults.backbone_length;
 }
 
+PUBLIC void
+vrna_md_defaults_num_threads(int num_threads)
+{
+  defaults.num_threads = (num_threads > 1) ? num_threads : 1;
+}
+
+PUBLIC int
+vrna_md_defaults_num_threads_get(void)
+{
+  return defaults.num_threads;
+}
+
 PUBLIC void
 vrna_md_update(vrna_md_t *md)
 {
@@ -1153,6 +1168,7 @@ set_model_details(vrna_md_t *md)
     md->saltDPXInitFact = defaults.saltDPXInitFact;
     md->helical_rise    = defaults.helical_rise;
     md->backbone_length = defaults.backbone_length;
+    md->num_threads     = defaults.num_threads;
 
     if (nonstandards)
       copy_nonstandards(md, nonstandards);
@@ -221,6 +221,13 @@ typedef struct vrna_md_s vrna_md_t;
  */
 #define VRNA_MODEL_DEFAULT_BACKBONE_LENGTH   VRNA_MODEL_BACKBONE_LENGTH_RNA
 
+/**
+ *  @brief  Default number of threads used to fill the dynamic programming matrices
+ *
+ *  @see    #vrna_md_t.num_threads, vrna_md_defaults_reset(), vrna_md_set_default()
+ */
+#define VRNA_MODEL_DEFAULT_NUM_THREADS    1
+
 
 #ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
 
@@ -310,6 +317,24 @@ struct vrna_md_s {
   float   saltDPXInitFact;                  /**<  @brief  */
   float   helical_rise;                     /**<  @brief  */
   float   backbone_length;                  /**<  @brief  */
+  int     num_threads;                      /**<  @brief  Number of threads used to fill the dynamic programming matrices
+                                             *
+                                             *    Values larger than 1 make the (global) recursions compute all
+                                             *    cells of a diagonal, i.e. with identical span @f$ j - i @f$,
+                                             *    concurrently. This requires OpenMP support of RNAlib, otherwise
+                                             *    the setting is silently ignored. Sliding window probability
+                                             *    computations, see vrna_probs_window(), process overlapping
+                                             *    chunks of long sequences concurrently instead. Suboptimal
+                                             *    structures, see vrna_subopt_cb(), are enumerated by multiple
+                                             *    threads as well.
+                                             *
+                                             *    @note   The concurrent fill keeps complete triangles of the
+                                             *            auxiliary arrays that the serial fill only holds as a
+                                             *            few rows. For @f$ n @f$ nucleotides, vrna_mfe() thus
+                                             *            allocates two, or three if #vrna_md_t.noLP is set,
+                                             *            additional @f$ n^2/2 @f$ @p int matrices, and vrna_pf()
+                                             *            two additional @f$ n^2/2 @f$ #FLT_OR_DBL matrices.
+                                             */
 };
 
 
@@ -1009,6 +1034,28 @@ float
 vrna_md_defaults_backbone_length_get(void);
 
 
+/**
+ *  @brief  Set default number of threads for the dynamic programming matrix fill
+ *
+ *  @see vrna_md_defaults_reset(), vrna_md_set_default(), #vrna_md_t, #VRNA_MODEL_DEFAULT_NUM_THREADS
+ *
+ *  @param  num_threads   Number of threads (values below 2 select the serial fill)
+ */
+void
+vrna_md_defaults_num_threads(int num_threads);
+
+
+/**
+ *  @brief  Get default number of threads for the dynamic programming matrix fill
+ *
+ *  @see vrna_md_defaults_num_threads(), vrna_md_defaults_reset(), vrna_md_set_default(), #vrna_md_t, #VRNA_MODEL_DEFAULT_NUM_THREADS
+ *
+ *  @return The global default number of threads used to fill the dynamic programming matrices
+ */
+int
+vrna_md_defaults_num_threads_get(void);
+
+
 #ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
 
 #define model_detailsT        vrna_md_t               /* restore compatibility of struct rename */
@@ -53,6 +53,17 @@ PRIVATE int
 fill_arrays(vrna_fold_compound_t *fc);
 
 
+#ifdef _OPENMP
+PRIVATE int
+fill_arrays_wavefront(vrna_fold_compound_t  *fc,
+                      vrna_mx_pf_aux_el_t   aux_mx_el,
+                      vrna_mx_pf_aux_ml_t   aux_mx_ml,
+                      int                   num_threads);
+
+
+#endif
+
+
 PRIVATE void
 postprocess_circular(vrna_fold_compound_t *fc);
 
@@ -300,7 +311,7 @@ vrna_pf_add(FLT_OR_DBL  dG1,
 PRIVATE int
 fill_arrays(vrna_fold_compound_t *fc)
 {
-  int                 n, i, j, k, ij, *my_iindx, *jindx, with_gquad, with_ud;
+  int                 n, i, j, k, ij, *my_iindx, *jindx, with_gquad, with_ud, wavefront;
   FLT_OR_DBL          temp, Qmax, *q, *qb, *qm, *qm1, *q1k, *qln;
   double              max_real;
   vrna_ud_t           *domains_up;
@@ -325,8 +336,17 @@ fill_arrays(vrna_fold_compound_t *fc)
   md          = &(pf_params->model_details);
   with_gquad  = md->gquad;
 
-  with_ud = (domains_up && domains_up->exp_energy_cb && (!(fc->type == VRNA_FC_TYPE_COMPARATIVE)));
-  Qmax    = 0;
+  with_ud   = (domains_up && domains_up->exp_energy_cb && (!(fc->type == VRNA_FC_TYPE_COMPARATIVE)));
+  Qmax      = 0;
+  wavefront = 0;
+
+#ifdef _OPENMP
+  /* fill by diagonals with multiple threads, see vrna_md_t.num_threads */
+  if ((md->num_threads > 1) &&
+      (fc->strands == 1))
+    wavefront = 1;
+
+#endif
 
   max_real = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
 
@@ -358,8 +378,13 @@ fill_arrays(vrna_fold_compound_t *fc)
   }
 
   /* init auxiliary arrays for fast exterior/multibranch loops */
-  aux_mx_el = vrna_exp_E_ext_fast_init(fc);
-  aux_mx_ml = vrna_exp_E_ml_fast_init(fc);
+  if (wavefront) {
+    aux_mx_el = vrna_exp_E_ext_fast_init_full(fc);
+    aux_mx_ml = vrna_exp_E_ml_fast_init_full(fc);
+  } else {
+    aux_mx_el = vrna_exp_E_ext_fast_init(fc);
+    aux_mx_ml = vrna_exp_E_ml_fast_init(fc);
+  }
 
   /*array initialization ; qb,qm,q
    * qb,qm,q (i,j) are stored as ((n+1-i)*(n-i) div 2 + n+1-j */
@@ -368,7 +393,20 @@ fill_arrays(vrna_fold_compound_t *fc)
     qb[ij]  = 0.0;
   }
 
-  for (j = 2; j <= n; j++) {
+#ifdef _OPENMP
+  if (wavefront) {
+    if (!fill_arrays_wavefront(fc, aux_mx_el, aux_mx_ml, md->num_threads)) {
+      vrna_exp_E_ml_fast_free(aux_mx_ml);
+      vrna_exp_E_ext_fast_free(aux_mx_el);
+
+      return 0; /* failure */
+    }
+  }
+
+#endif
+
+  /* column-wise fill, unless the matrices have been filled by diagonals already */
+  for (j = (wavefront) ? n + 1 : 2; j <= n; j++) {
     for (i = j - 1; i >= 1; i--) {
       ij = my_iindx[i] - j;
 
@@ -473,6 +511,91 @@ decompose_pair(vrna_fold_compound_t *fc,
 }
 
 
+#ifdef _OPENMP
+/*
+ *  Same recursions as in fill_arrays() but processing the matrices
+ *  diagonal by diagonal. All cells (i, i + d) of a diagonal only
+ *  depend on cells of previous diagonals and are therefore computed
+ *  concurrently. Requires auxiliary arrays that keep all columns, i.e.
+ *  vrna_exp_E_ext_fast_init_full() and vrna_exp_E_ml_fast_init_full()
+ */
+PRIVATE int
+fill_arrays_wavefront(vrna_fold_compound_t  *fc,
+                      vrna_mx_pf_aux_el_t   aux_mx_el,
+                      vrna_mx_pf_aux_ml_t   aux_mx_ml,
+                      int                   num_threads)
+{
+  int         n, i, j, d, ij, *my_iindx, *jindx;
+  FLT_OR_DBL  temp, Qmax, *q, *qb, *qm, *qm1;
+  double      max_real;
+
+  n         = fc->length;
+  my_iindx  = fc->iindx;
+  jindx     = fc->jindx;
+  q         = fc->exp_matrices->q;
+  qb        = fc->exp_matrices->qb;
+  qm        = fc->exp_matrices->qm;
+  qm1       = fc->exp_matrices->qm1;
+  Qmax      = 0;
+  max_real  = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
+
+  omp_set_dynamic(0);
+
+  for (d = 1; d < n; d++) {
+#pragma omp parallel for private(i, j, ij, temp) num_threads(num_threads) schedule(dynamic, 8)
+    for (i = 1; i <= n - d; i++) {
+      j   = i + d;
+      ij  = my_iindx[i] - j;
+
+      qb[ij] = decompose_pair(fc, i, j, aux_mx_ml);
+
+      /* Multibranch loop */
+      qm[ij] = vrna_exp_E_ml_fast(fc, i, j, aux_mx_ml);
+
+      if (qm1) {
+        temp = vrna_exp_E_ml_fast_qqm_column(aux_mx_ml, j)[i];
+
+        /* apply auxiliary grammar rule for multibranch loop (M1) case */
+        if ((fc->aux_grammar) && (fc->aux_grammar->cb_aux_exp_m1))
+          temp += fc->aux_grammar->cb_aux_exp_m1(fc, i, j, fc->aux_grammar->data);
+
+        qm1[jindx[j] + i] = temp;
+      }
+
+      /* Exterior loop */
+      q[ij] = vrna_exp_E_ext_fast(fc, i, j, aux_mx_el);
+
+      /* apply auxiliary grammar rule (storage takes place in user-defined data structure */
+      if ((fc->aux_grammar) && (fc->aux_grammar->cb_aux_exp))
+        fc->aux_grammar->cb_aux_exp(fc, i, j, fc->aux_grammar->data);
+    }
+
+    /* overflow checks are done once the entire diagonal is available */
+    for (i = 1; i <= n - d; i++) {
+      j   = i + d;
+      ij  = my_iindx[i] - j;
+
+      if (q[ij] > Qmax) {
+        Qmax = q[ij];
+        if (Qmax > max_real / 10.)
+          vrna_message_warning("Q close to overflow: %d %d %g", i, j, q[ij]);
+      }
+
+      if (q[ij] >= max_real) {
+        vrna_message_warning("overflow while computing partition function for segment q[%d,%d]\n"
+                             "use larger pf_scale", i, j);
+        return 0; /* failure */
+      }
+    }
+  }
+
+  return 1;
+}
+
+
+#endif
+
+
 /*
  * calculate partition function for circular case
  * NOTE: this is the postprocessing step ONLY
@@ -134,6 +134,12 @@ struct vrna_multimer_pf_s {
  *        or numerical over-/underflow. In the latter case, a corresponding warning
  *        will be issued to @p stdout.
  *
+ *  @note With #vrna_md_t.num_threads larger than 1 (and OpenMP support of RNAlib),
+ *        the forward recursions of single-stranded problems are filled by diagonals,
+ *        and the base pair probabilities of single sequences are computed for all
+ *        pairs @f$(k,l)@f$ with identical @f$l@f$ concurrently. Both yield the same
+ *        results as the serial implementation.
+ *
  *  @see  #vrna_fold_compound_t, vrna_fold_compound(), vrna_pf_fold(), vrna_pf_circfold(),
  *        vrna_fold_compound_comparative(), vrna_pf_alifold(), vrna_pf_circalifold(),
  *        vrna_db_from_probs(), vrna_exp_params(), vrna_aln_pinfo()
@@ -69,8 +69,9 @@
 #include "ViennaRNA/params/basic.h"
 #include "ViennaRNA/part_func.h"
 #include "ViennaRNA/loops/all.h"
+#include "ViennaRNA/alphabet.h"
 #include "ViennaRNA/part_func_up.h"
-#include "ViennaRNA/duplex.h"
+#include "ViennaRNA/duplex_intern.h"
 
 
 #define CO_TURN 0
@@ -79,6 +80,7 @@
 #define ISOLATED  256.0
 /* #define NUMERIC 1 */
 
+
 /*
  #################################
  # GLOBAL VARIABLES              #
@@ -90,18 +92,33 @@
  # PRIVATE VARIABLES             #
  #################################
  */
-PRIVATE short             *S = NULL, *S1 = NULL, *SS = NULL, *SS2 = NULL;
-PRIVATE vrna_exp_param_t  *Pf = NULL;                           /* use this structure for all the exp-arrays*/
-PRIVATE FLT_OR_DBL        *qb = NULL, *qm = NULL, *prpr = NULL; /* add arrays for pf_unpaired()*/
-PRIVATE FLT_OR_DBL        *probs = NULL;
-PRIVATE FLT_OR_DBL        *q1k = NULL, *qln = NULL;
-PRIVATE double            *qqm2 = NULL, *qq_1m2 = NULL, *qqm = NULL, *qqm1 = NULL;
-PRIVATE FLT_OR_DBL        *scale = NULL, *expMLbase = NULL;
-PRIVATE char              *ptype = NULL;  /* precomputed array of pair types */
-PRIVATE int               init_length;    /* length in last call to init_pf_fold()*/
-PRIVATE double            init_temp;      /* temperature in last call to scale_pf_params */
-PRIVATE int               *my_iindx = NULL;
-/* make iptypes array for intermolecular constrains (ipidx for indexing)*/
+
+/*
+ * All intermediate data of the unpaired probability and the interaction
+ * computations lives in a workspace object, so that several computations
+ * can run concurrently, each with its own workspace. Buffers are kept
+ * between calls and only grow if a longer sequence comes along.
+ */
+struct vrna_up_workspace_s {
+  vrna_md_t         md;
+  vrna_param_t      *P;                   /* for the duplex estimate of the interaction scale */
+  vrna_exp_param_t  *exp_params;
+
+  unsigned int      length;               /* sequence length the buffers below are allocated for */
+  int               *iindx;
+  FLT_OR_DBL        *prpr;
+  double            *store_M_mlbase;      /* expMLbase[i-p]*dangles_po */
+  double            *store_H;             /* hairpin contributions */
+  double            *store_Io;            /* interior loop contributions, unpaired between ]l,o[ */
+  double            *store_M_qm_o;        /* qm[p+1,i-1]*dangles_po */
+  double            **store_I2o;          /* interior loop contributions, unpaired between ]p,k[ */
+  double            *qqm, *qqm1, *qqm2, *qq_1m2;
+  double            *sum_M;
+
+  unsigned int      scale_length;
+  FLT_OR_DBL        *scale;
+  FLT_OR_DBL        *expMLbase;
+};
 
 
 /*
@@ -123,41 +140,57 @@ plot_free_pu_out(pu_out   *res,
 
 
 PRIVATE void
-scale_stru_pf_params(unsigned int length);
-
-
-PRIVATE void
-init_pf_two(int length);
+prepare_up_arrays(vrna_up_workspace_t *ws,
+                  unsigned int        length);
 
 
 PRIVATE void
-scale_int(const char  *s,
-          const char  *sl,
-          double      *sc_int);
+free_up_arrays(vrna_up_workspace_t *ws);
 
 
 PRIVATE void
-encode_seq(const char *s1,
-           const char *s2);
+scale_stru_pf_params(vrna_up_workspace_t  *ws,
+                     double               expMLbase,
+                     double               pf_scale,
+                     unsigned int         length);
+
+
+PRIVATE pu_contrib *
+unstru(vrna_up_workspace_t  *ws,
+       const char           *sequence,
+       const short          *S,
+       const short          *S1,
+       FLT_OR_DBL           *qb,
+       FLT_OR_DBL           *qm,
+       FLT_OR_DBL           *q1k,
+       FLT_OR_DBL           *qln,
+       FLT_OR_DBL           *probs,
+       vrna_exp_param_t     *Pf,
+       int                  w);
+
+
+PRIVATE interact *
+interaction(vrna_up_workspace_t *ws,
+            const char          *s1,
+            const char          *s2,
+            pu_contrib          *p_c,
+            pu_contrib          *p_c2,
+            int                 w,
+            const char          *cstruc,
+            int                 incr3,
+            int                 incr5);
+
+
+PRIVATE double
+scale_int(vrna_up_workspace_t *ws,
+          const char          *s,
+          const char          *sl);
 
 
 PRIVATE constrain *
-get_ptypes_up(char        *S,
-              const char  *structure);
-
-
-PRIVATE void
-get_up_arrays(unsigned int length);
-
-
-PRIVATE void
-free_up_arrays(void);
-
-
-PRIVATE void
-set_encoded_seq(const char  *sequence,
-                short       **S,
-                short       **S1);
+get_ptypes_up(const char  *S,
+              const char  *structure,
+              vrna_md_t   *md);
 
 
 PRIVATE void
@@ -177,6 +210,115 @@ get_interact_arrays(unsigned int  n1,
  # BEGIN OF FUNCTION DEFINITIONS #
  #################################
  */
+PUBLIC vrna_up_workspace_t *
+vrna_up_workspace(const vrna_md_t *md)
+{
+  vrna_up_workspace_t *ws;
+
+  ws = (vrna_up_workspace_t *)vrna_alloc(sizeof(vrna_up_workspace_t));
+
+  if (md)
+    vrna_md_copy(&(ws->md), md);
+  else
+    vrna_md_set_default(&(ws->md));
+
+  ws->exp_params = vrna_exp_params(&(ws->md));
+
+  return ws;
+}
+
+
+PUBLIC void
+vrna_up_workspace_free(vrna_up_workspace_t *ws)
+{
+  if (ws) {
+    free_up_arrays(ws);
+    free(ws->P);
+    free(ws->exp_params);
+    free(ws);
+  }
+}
+
+
+PUBLIC pu_contrib *
+vrna_pf_unstru(vrna_fold_compound_t *fc,
+               int                  w,
+               vrna_up_workspace_t  *ws)
+{
+  vrna_mx_pf_t        *m;
+  vrna_up_workspace_t *tmp_ws;
+  pu_contrib          *pu;
+
+  if ((!fc) ||
+      (fc->type != VRNA_FC_TYPE_SINGLE) ||
+      (fc->strands > 1) ||
+      (fc->exp_params->model_details.circ)) {
+    vrna_message_warning("vrna_pf_unstru: "
+                         "only available for single, linear sequences");
+    return NULL;
+  }
+
+  m = fc->exp_matrices;
+
+  if ((!m) ||
+      (m->type != VRNA_MX_DEFAULT) ||
+      (!m->probs)) {
+    vrna_message_warning("vrna_pf_unstru: "
+                         "vrna_pf() including base pair probabilities has to be called first");
+    return NULL;
+  }
+
+  tmp_ws = NULL;
+  if (!ws)
+    ws = tmp_ws = vrna_up_workspace(&(fc->exp_params->model_details));
+
+  pu = unstru(ws,
+              fc->sequence,
+              fc->sequence_encoding2,
+              fc->sequence_encoding,
+              m->qb,
+              m->qm,
+              m->q1k,
+              m->qln,
+              m->probs,
+              fc->exp_params,
+              w);
+
+  vrna_up_workspace_free(tmp_ws);
+
+  return pu;
+}
+
+
+PUBLIC interact *
+vrna_pf_interact(const char           *s1,
+                 const char           *s2,
+                 pu_contrib           *p_c,
+                 pu_contrib           *p_c2,
+                 int                  w,
+                 const char           *cstruc,
+                 int                  incr3,
+                 int                  incr5,
+                 vrna_up_workspace_t  *ws)
+{
+  vrna_up_workspace_t *tmp_ws;
+  interact            *Int;
+
+  if ((!s1) || (!s2) || (!p_c))
+    return NULL;
+
+  tmp_ws = NULL;
+  if (!ws)
+    ws = tmp_ws = vrna_up_workspace(NULL);
+
+  Int = interaction(ws, s1, s2, p_c, p_c2, w, cstruc, incr3, incr5);
+
+  vrna_up_workspace_free(tmp_ws);
+
+  return Int;
+}
+
+
 PUBLIC pu_contrib *
 get_pu_contrib_struct(unsigned int  n,
                       unsigned int  w)
@@ -239,23 +381,93 @@ PUBLIC pu_contrib *
 pf_unstru(char  *sequence,
           int   w)
 {
-  int           n, i, j, v, k, l, o, p, ij, kl, po, u, u1, d, type, type_2, tt;
+  short               *S, *S1;
+  char                *ptype;
+  FLT_OR_DBL          *qb, *qm, *q1k, *qln, *probs;
+  vrna_md_t           md;
+  vrna_exp_param_t    *Pf;
+  vrna_up_workspace_t *ws;
+  pu_contrib          *pu;
+
+  /* gets the arrays, that we need, from part_func.c */
+  if (!get_pf_arrays(&S, &S1, &ptype, &qb, &qm, &q1k, &qln))
+    vrna_message_error("init_pf_two: pf_fold() has to be called before calling pf_unstru()\n");
+
+  /* get a pointer to the base pair probs */
+  probs = export_bppm();
+
+  set_model_details(&md);
+  ws  = vrna_up_workspace(&md);
+  Pf  = ws->exp_params;
+
+  /* scaling factors (to avoid overflows) */
+  if (pf_scale == -1) {
+    /* mean energy for random sequences: 184.3*length cal */
+    pf_scale = exp(-(-185 + (Pf->temperature - 37.) * 7.27) / Pf->kT);
+    if (pf_scale < 1)
+      pf_scale = 1;
+  }
+
+  Pf->pf_scale = pf_scale;
+
+  pu = unstru(ws, sequence, S, S1, qb, qm, q1k, qln, probs, Pf, w);
+
+  vrna_up_workspace_free(ws);
+
+  return pu;
+}
+
+
+PRIVATE pu_contrib *
+unstru(vrna_up_workspace_t  *ws,
+       const char           *sequence,
+       const short          *S,
+       const short          *S1,
+       FLT_OR_DBL           *qb,
+       FLT_OR_DBL           *qm,
+       FLT_OR_DBL           *q1k,
+       FLT_OR_DBL           *qln,
+       FLT_OR_DBL           *probs,
+       vrna_exp_param_t     *Pf,
+       int                  w)
+{
+  int           n, i, j, v, k, l, o, p, ij, kl, po, u, u1, d, type, type_2, tt, *my_iindx,
+                *rtype;
   unsigned int  size;
   double        temp, tqm2;
   double        qbt1, *tmp, sum_l, *sum_M;
   double        *store_H, *store_Io, **store_I2o; /* hairp., interior contribs */
   double        *store_M_qm_o, *store_M_mlbase;   /* multiloop contributions */
+  double        *qqm, *qqm1, *qqm2, *qq_1m2;
+  FLT_OR_DBL    *prpr, *scale, *expMLbase;
+  vrna_md_t     *md;
   pu_contrib    *pu_test;
 
   sum_l   = 0.0;
   temp    = 0;
   n       = (int)strlen(sequence);
-  sum_M   = (double *)vrna_alloc((n + 1) * sizeof(double));
   pu_test = get_pu_contrib_struct((unsigned)n, (unsigned)w);
   size    = ((n + 1) * (n + 2)) >> 1;
-
-  get_up_arrays((unsigned)n);
-  init_pf_two(n);
+  md      = &(Pf->model_details);
+  rtype   = &(md->rtype[0]);
+
+  prepare_up_arrays(ws, (unsigned)n);
+  scale_stru_pf_params(ws, Pf->expMLbase, Pf->pf_scale, (unsigned)n);
+
+  my_iindx        = ws->iindx;
+  prpr            = ws->prpr;
+  sum_M           = ws->sum_M;
+  store_H         = ws->store_H;
+  store_Io        = ws->store_Io;
+  store_M_qm_o    = ws->store_M_qm_o;
+  store_I2o       = ws->store_I2o;
+  store_M_mlbase  = ws->store_M_mlbase;
+  qqm             = ws->qqm;
+  qqm1            = ws->qqm1;
+  qqm2            = ws->qqm2;
+  qq_1m2          = ws->qq_1m2;
+  scale           = ws->scale;
+  expMLbase       = ws->expMLbase;
 
   /* init everything */
   for (d = 0; d <= TURN; d++)
@@ -282,33 +494,23 @@ pf_unstru(char  *sequence,
     }
   }
 
-  /* alloc even more memory */
-  store_I2o = (double **)vrna_alloc(sizeof(double *) * (n + 1)); /* for p,k */
-  for (i = 0; i <= n; i++)
-    store_I2o[i] = (double *)vrna_alloc(sizeof(double) * (MAXLOOP + 2));
-
-  /* expMLbase[i-p]*dangles_po */
-  store_M_mlbase = (double *)vrna_alloc(sizeof(double) * (size + 1));
-
   /* 2. exterior bp (p,o) encloses unpaired region [i,i+w[*/
   for (o = TURN + 2; o <= n; o++) {
     double sum_h;
-    /*allocate space for arrays to store different contributions to H, I & M */
-    store_H = (double *)vrna_alloc(sizeof(double) * (o + 2));
-    /* unpaired between ]l,o[ */
-    store_Io = (double *)vrna_alloc(sizeof(double) * (o + 2));
-    /* qm[p+1,i-1]*dangles_po */
-    store_M_qm_o = (double *)vrna_alloc(sizeof(double) * (n + 1));
+    /* reset arrays to store different contributions to H, I & M */
+    memset(store_H, 0, sizeof(double) * (o + 2));
+    memset(store_Io, 0, sizeof(double) * (o + 2));
+    memset(store_M_qm_o, 0, sizeof(double) * (n + 1));
 
     for (p = o - TURN - 1; p >= 1; p--) {
       /* construction of partition function of segment [p,o], given that
        * an unpaired region [i,i+w[ exists within [p,o] */
       u     = o - p - 1;
       po    = my_iindx[p] - o;
-      type  = ptype[po];
+      type  = md->pair[S[p]][S[o]];
       if (type) {
         /*hairpin contribution*/
-        if (((type == 3) || (type == 4)) && no_closingGU)
+        if (((type == 3) || (type == 4)) && md->noGUclosure)
           temp = 0.;
         else
           temp = prpr[po] *
@@ -324,7 +526,7 @@ pf_unstru(char  *sequence,
           sum_l = 0.;
           for (l = MAX2(k + TURN + 1, o - 1 - MAXLOOP + u1); l < o; l++) {
             kl      = my_iindx[k] - l;
-            type_2  = ptype[kl];
+            type_2  = md->pair[S[k]][S[l]];
             if ((l + 1) < o)
               store_Io[l + 1] += sum_l;
 
@@ -426,10 +628,6 @@ pf_unstru(char  *sequence,
     tmp     = qqm2;
     qqm2    = qq_1m2;
     qq_1m2  = tmp;
-
-    free(store_Io);
-    free(store_H);
-    free(store_M_qm_o);
   }/* end for (o=..) */
 
   for (i = 1; i < n; i++) {
@@ -456,10 +654,6 @@ pf_unstru(char  *sequence,
     }
   }
 
-  for (i = 0; i <= n; i++)
-    free(store_I2o[i]);
-  free(store_I2o);
-
   for (i = 1; i <= n; i++)
     /* set auxillary arrays to 0 */
     qqm[i] = qqm1[i] = qqm2[i] = qq_1m2[i] = 0;
@@ -469,19 +663,13 @@ pf_unstru(char  *sequence,
    * that is, we add the one multiloop contribution that we
    * could not calculate before  */
 
-  /* is free'ing plus allocating faster than looping over all entries an setting them to 0? */
-#if 0
-  free(store_M_mlbase);
-  store_M_mlbase = (double *)vrna_alloc(sizeof(double) * (size + 1));
-#else
   /* this should be the fastest way to set everything to 0 */
   memset(store_M_mlbase, 0, sizeof(double) * (size + 1));
-#endif
 
   for (o = n - TURN - 1; o >= 1; o--) {
     for (p = o + TURN + 1; p <= n; p++) {
       po    = my_iindx[o] - p;
-      type  = ptype[po];
+      type  = md->pair[S[o]][S[p]];
       /* recalculate of qqm matrix containing final stem
        * contributions to multiple loop partition function
        * from segment [o,p] */
@@ -536,9 +724,6 @@ pf_unstru(char  *sequence,
     }
   }
 
-  free(sum_M);
-  free(store_M_mlbase);
-  free_up_arrays();
   return pu_test;
 }
 
@@ -590,7 +775,37 @@ pf_interact(const char  *s1,
             int         incr3,
             int         incr5)
 {
-  int         i, j, k, l, n1, n2, add_i5, add_i3, pc_size;
+  vrna_md_t           md;
+  vrna_up_workspace_t *ws;
+  interact            *Int;
+
+  if (fold_constrained && cstruc == NULL)
+    vrna_message_error("option -C selected, but no constrained structure given\n");
+
+  set_model_details(&md);
+  ws  = vrna_up_workspace(&md);
+  Int = interaction(ws, s1, s2, p_c, p_c2, w, (fold_constrained) ? cstruc : NULL, incr3, incr5);
+  vrna_up_workspace_free(ws);
+
+  free_pf_arrays();                   /* for arrays for pf_fold(...) */
+
+  return Int;
+}
+
+
+PRIVATE interact *
+interaction(vrna_up_workspace_t *ws,
+            const char          *s1,
+            const char          *s2,
+            pu_contrib          *p_c,
+            pu_contrib          *p_c2,
+            int                 w,
+            const char          *cstruc,
+            int                 incr3,
+            int                 incr5)
+{
+  int         i, j, k, l, n1, n2, add_i5, add_i3, pc_size, constrained, *rtype;
+  short       *S1, *SS2;
   double      temp, Z, rev_d, E, Z2, **p_c_S, **p_c2_S, int_scale;
   FLT_OR_DBL  ****qint_4, **qint_ik;
   /* PRIVATE double **pint; array for pf_up() output */
@@ -598,10 +813,13 @@ pf_interact(const char  *s1,
   double      G_min, G_is, Gi_min;
   int         gi, gj, gk, gl, ci, cj, ck, cl, prev_k, prev_l;
   FLT_OR_DBL  **int_ik;
-  double      Z_int, temp_int, temppfs;
+  double      Z_int, temp_int;
   double      const_scale, const_T;
+  FLT_OR_DBL  *scale;
+  vrna_md_t   *md;
   constrain   *cc = NULL;                           /* constrains for cofolding */
   char        *Seq, *i_long, *i_short, *pos = NULL; /* short seq appended to long one */
+  vrna_exp_param_t  *Pf;
 
   /* int ***pu_jl; */ /* positions of interaction in the short RNA */
 
@@ -613,6 +831,11 @@ pf_interact(const char  *s1,
   prev_k  = 1;
   prev_l  = n2;
 
+  md          = &(ws->md);
+  rtype       = &(md->rtype[0]);
+  Pf          = ws->exp_params;
+  constrained = (cstruc != NULL) ? 1 : 0;
+
   i_long  = (char *)vrna_alloc(sizeof(char) * (n1 + 1));
   i_short = (char *)vrna_alloc(sizeof(char) * (n2 + 1));
   Seq     = (char *)vrna_alloc(sizeof(char) * (n1 + n2 + 2));
@@ -620,10 +843,10 @@ pf_interact(const char  *s1,
   strcpy(Seq, s1);
   strcat(Seq, s2);
 
-  set_encoded_seq(s1, &S, &S1);
-  set_encoded_seq(s2, &SS, &SS2);
+  S1  = vrna_seq_encode(s1, md);
+  SS2 = vrna_seq_encode(s2, md);
 
-  cc = get_ptypes_up(Seq, cstruc);
+  cc = get_ptypes_up(Seq, cstruc, md);
 
   get_interact_arrays(n1, n2, p_c, p_c2, w, incr5, incr3, &p_c_S, &p_c2_S);
 
@@ -633,16 +856,12 @@ pf_interact(const char  *s1,
   Int->Gi = (double *)vrna_alloc(sizeof(double) * (n1 + 2));
 
   /* use a different scaling for pf_interact*/
-  scale_int(s2, s1, &int_scale);
-
-  /* set the global scale array and the global variable pf_scale to the
-   * values used to scale the interaction, keep their former values !! */
-  temppfs   = pf_scale;
-  pf_scale  = int_scale;
+  int_scale = scale_int(ws, s2, s1);
 
   /* in order to scale expLoopEnergy correctly call*/
   /* we also pass twice the seq-length to avoid bogus access to scale[] array */
-  scale_stru_pf_params((unsigned)2 * n1);
+  scale_stru_pf_params(ws, Pf->expMLbase, int_scale, (unsigned)2 * n1);
+  scale = ws->scale;
 
   qint_ik = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n1 + 1));
   for (i = 1; i <= n1; i++)
@@ -653,16 +872,14 @@ pf_interact(const char  *s1,
     int_ik[i] = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n1 + 1));
   Z_int = 0.;
   /*  Gint = ( -log(int_ik[gk][gi])-( ((int) w/2)*log(pf_scale)) )*((Pf->temperature+K0)*GASCONST/1000.0); */
-  const_scale = ((int)w / 2) * log(pf_scale);
+  const_scale = ((int)w / 2) * log(int_scale);
   const_T     = (Pf->kT / 1000.0);
-  encode_seq(s1, s2);
-  /* static  short *S~S1, *S1~SS1, *SS~S2, *SS2; */
   for (i = 0; i <= n1; i++)
     Int->Pi[i] = Int->Gi[i] = 0.;
   E = 0.;
   Z = 0.;
 
-  if (fold_constrained && cstruc != NULL) {
+  if (constrained) {
     pos = strchr(cstruc, '|');
     if (pos) {
       ci = ck = cl = cj = 0;
@@ -703,11 +920,9 @@ pf_interact(const char  *s1,
         vrna_message_error("pf_interact: could not satisfy all constraints");
       }
     }
-  } else if (fold_constrained && cstruc == NULL) {
-    vrna_message_error("option -C selected, but no constrained structure given\n");
   }
 
-  if (fold_constrained)
+  if (constrained)
     pos = strchr(cstruc, '|');
 
   /*  qint_4[i][j][k][l] contribution that region (k-i) in seq1 (l=n1)
@@ -719,16 +934,16 @@ pf_interact(const char  *s1,
   for (i = 1; i <= n1; i++) {
     int end_k;
     end_k = i - w;
-    if (fold_constrained && pos && ci)
+    if (constrained && pos && ci)
       end_k = MAX2(i - w, ci - w);
 
     /* '|' constrains for long sequence: index i from 1 to n1 (5' to 3')*/
     /* interaction has to include 3' most '|' constrain, ci */
-    if (fold_constrained && pos && ci && i == 1 && i < ci)
+    if (constrained && pos && ci && i == 1 && i < ci)
       i = ci - w + 1 > 1 ? ci - w + 1 : 1;
 
     /* interaction has to include 5' most '|' constrain, ck*/
-    if (fold_constrained && pos && ck && i > ck + w - 1)
+    if (constrained && pos && ck && i > ck + w - 1)
       break;
 
     /* note: qint_4[i] will be freed before we allocate qint_4[i+1] */
@@ -743,16 +958,16 @@ pf_interact(const char  *s1,
     for (j = n2; j > 0; j--) {
       int type, type2, end_l;
       end_l = j + w;
-      if (fold_constrained && pos && ci)
+      if (constrained && pos && ci)
         end_l = MIN2(cj + w, j + w);
 
       /* '|' constrains for short sequence: index j from n2 to 1 (3' to 5')*/
       /* interaction has to include 5' most '|' constrain, cj */
-      if (fold_constrained && pos && cj && j == n2 && j > cj)
+      if (constrained && pos && cj && j == n2 && j > cj)
         j = cj + w - 1 > n2 ? n2 : cj + w - 1;
 
       /* interaction has to include 3' most '|' constrain, cl*/
-      if (fold_constrained && pos && cl && j < cl - w + 1)
+      if (constrained && pos && cl && j < cl - w + 1)
         break;
 
       type                = cc->ptype[cc->indx[i] - (n1 + j)];
@@ -803,7 +1018,7 @@ pf_interact(const char  *s1,
       temp    = 0.;
       prev_l  = n2;
       for (k = i - 1; k > end_k && k > 0; k--) {
-        if (fold_constrained && pos && cstruc[k - 1] == '|' && k > prev_k)
+        if (constrained && pos && cstruc[k - 1] == '|' && k > prev_k)
           prev_k = k;
 
         for (l = j + 1; l < end_l && l <= n2; l++) {
@@ -812,13 +1027,13 @@ pf_interact(const char  *s1,
 
           type2 = cc->ptype[cc->indx[k] - (n1 + l)];
           /* '|' : l HAS TO be paired: not pair (k,x) where x>l allowed */
-          if (fold_constrained && pos && cstruc[n1 + l - 1] == '|' && l < prev_l)
+          if (constrained && pos && cstruc[n1 + l - 1] == '|' && l < prev_l)
             prev_l = l; /*break*/
 
-          if (fold_constrained && pos && (k <= ck || i >= ci) && !type2)
+          if (constrained && pos && (k <= ck || i >= ci) && !type2)
             continue;
 
-          if (fold_constrained && pos && ((cstruc[k - 1] == '|') || (cstruc[n1 + l - 1] == '|')) &&
+          if (constrained && pos && ((cstruc[k - 1] == '|') || (cstruc[n1 + l - 1] == '|')) &&
               !type2)
             break;
 
@@ -874,20 +1089,20 @@ pf_interact(const char  *s1,
 
           /* '|' constrain in long sequence */
           /* collect interactions starting before 5' most '|' constrain */
-          if (fold_constrained && pos && ci && i < ci)
+          if (constrained && pos && ci && i < ci)
             continue;
 
           /* collect interactions ending after 3' most '|' constrain*/
-          if (fold_constrained && pos && ck && k > ck)
+          if (constrained && pos && ck && k > ck)
             continue;
 
           /* '|' constrain in short sequence */
           /* collect interactions starting before 5' most '|' constrain */
-          if (fold_constrained && pos && cj && j > cj)
+          if (constrained && pos && cj && j > cj)
             continue;
 
           /* collect interactions ending after 3' most '|' constrain*/
-          if (fold_constrained && pos && cl && l < cl)
+          if (constrained && pos && cl && l < cl)
             continue;
 
           /* scale everything to w/2*/
@@ -937,10 +1152,10 @@ pf_interact(const char  *s1,
     if (i > w) {
       int bla;
       bla = i - w;
-      if (fold_constrained && pos && ci && i - w < ci - w + 1)
+      if (constrained && pos && ci && i - w < ci - w + 1)
         continue;
 
-      if (fold_constrained && pos && ci)
+      if (constrained && pos && ci)
         bla = MAX2(ci - w + 1, i - w);
 
       for (j = n2; j > 0; j--) {
@@ -964,7 +1179,7 @@ pf_interact(const char  *s1,
         Int->Pi[l] += qint_ik[i][k] / Z;
         /* Int->Gi[l]: minimal delta G at position [l] */
         Int->Gi[l] = MIN2(Int->Gi[l],
-                          (-log(qint_ik[i][k]) - (((int)w / 2) * log(pf_scale))) *
+                          (-log(qint_ik[i][k]) - (((int)w / 2) * log(int_scale))) *
                           (Pf->kT / 1000.0));
       }
     }
@@ -973,7 +1188,7 @@ pf_interact(const char  *s1,
     int start_i, end_i;
     start_i = n1 - w + 1;
     end_i   = n1;
-    if (fold_constrained && pos && ci) {
+    if (constrained && pos && ci) {
       /* a break in the k loop might result in unfreed values */
       start_i = ci - w + 1 < n1 - w + 1 ? ci - w + 1 : n1 - w + 1;
       start_i = start_i > 0 ? start_i : 1;
@@ -997,7 +1212,7 @@ pf_interact(const char  *s1,
     int start_i, end_i;
     start_i = 1;
     end_i   = n1;
-    if (fold_constrained && pos) {
+    if (constrained && pos) {
       start_i = ci - w + 1 > 0 ? ci - w + 1 : 1;
       end_i   = ck + w - 1 > n1 ? n1 : ck + w - 1;
     }
@@ -1013,7 +1228,7 @@ pf_interact(const char  *s1,
     free(qint_4);
   }
 
-  if (fold_constrained && (gi == 0 || gk == 0 || gl == 0 || gj == 0))
+  if (constrained && (gi == 0 || gk == 0 || gl == 0 || gj == 0))
     vrna_message_error("pf_interact: could not satisfy all constraints");
 
   /* fill structure interact */
@@ -1035,21 +1250,6 @@ pf_interact(const char  *s1,
     free(qint_ik[i]);
   free(qint_ik);
 
-  /* reset the global variables pf_scale and scale to their original values */
-  pf_scale = temppfs;                 /* reset pf_scale */
-  scale_stru_pf_params((unsigned)n1); /* reset the scale array */
-  free_pf_arrays();                   /* for arrays for pf_fold(...) */
-
-  if (expMLbase != NULL) {
-    free(expMLbase);
-    expMLbase = NULL;
-  }
-
-  if (scale != NULL) {
-    free(scale);
-    scale = NULL;
-  }
-
   for (i = 1; i <= n1; i++)
     free(p_c_S[i]);
   free(p_c_S);
@@ -1060,6 +1260,8 @@ pf_interact(const char  *s1,
   }
 
   free(Seq);
+  free(S1);
+  free(SS2);
   free(cc->indx);
   free(cc->ptype);
   free(cc);
@@ -1069,144 +1271,121 @@ pf_interact(const char  *s1,
 
 /*------------------------------------------------------------------------*/
 /* use an extra scale for pf_interact, here sl is the longer sequence */
-PRIVATE void
-scale_int(const char  *s,
-          const char  *sl,
-          double      *sc_int)
+PRIVATE double
+scale_int(vrna_up_workspace_t *ws,
+          const char          *s,
+          const char          *sl)
 {
-  int     n, nl;
-  duplexT mfe;
-  double  kT;
-
-  n   = strlen(s);
-  nl  = strlen(sl);
+  int               Emin, i_min, j_min, n;
+  double            kT;
+  vrna_duplex_dat_t dat;
 
-  free(expMLbase);
-  free(scale);
+  /* use the RNAduplex recursions to get a realistic estimate for the best
+   * possible interaction energy between the short RNA s and its target sl */
+  if (!ws->P)
+    ws->P = vrna_params(&(ws->md));
 
-  expMLbase = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((nl + 1) * 2));
-  scale     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((nl + 1) * 2));
+  vrna_duplex_dat_init(&dat, s, sl, ws->P);
+  Emin = vrna_duplex_fill(&dat, &i_min, &j_min);
+  n    = dat.n1;
+  vrna_duplex_dat_free(&dat);
 
-  /* use RNA duplex to get a realistic estimate for the best possible
-   * interaction energy between the short RNA s and its target sl */
-  mfe = duplexfold(s, sl);
-
-  kT = Pf->kT / 1000.0; /* in Kcal */
+  kT = ws->exp_params->kT / 1000.0; /* in Kcal */
 
   /* sc_int is similar to pf_scale: i.e. one time the scale */
-  *sc_int = exp(-(mfe.energy) / kT / n);
-
-  /* free the structure returned by duplexfold */
-  free(mfe.structure);
+  return exp(-((float)Emin / 100.) / kT / n);
 }
 
 
-/*----------------------------------------------------------------------*/
-/* init_pf_two(n) :gets the arrays, that you need, from part_func.c */
-/* get_pf_arrays(&S, &S1, &ptype, &qb, &qm, &q1k, &qln);*/
-/* init_pf_fold(), update_pf_params, encode_char(), make_ptypes() are called by pf_fold() */
 PRIVATE void
-init_pf_two(int length)
+prepare_up_arrays(vrna_up_workspace_t *ws,
+                  unsigned int        length)
 {
-#ifdef SUN4
-  nonstandard_arithmetic();
-#else
-#ifdef HP9
-  fpsetfastmode(1);
-#endif
-#endif
-  make_pair_matrix();
-
-  /* gets the arrays, that we need, from part_func.c */
-  if (!get_pf_arrays(&S, &S1, &ptype, &qb, &qm, &q1k, &qln))
-    vrna_message_error("init_pf_two: pf_fold() has to be called before calling pf_unstru()\n");
-
-  /* get a pointer to the base pair probs */
-  probs = export_bppm();
-
-  scale_stru_pf_params((unsigned)length);
-
-  init_length = length;
-  if (init_temp != Pf->temperature)
-    vrna_message_error("init_pf_two: inconsistency with temperature");
-}
-
-
-PRIVATE void
-get_up_arrays(unsigned int length)
-{
-  unsigned int  l1  = length + 1;
-  unsigned int  l2  = length + 2;
-
-  prpr      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((l1 * l2) >> 1));
-  expMLbase = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * l2);
-  scale     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * l2);
-  qqm2      = (double *)vrna_alloc(sizeof(double) * l2);
-  qq_1m2    = (double *)vrna_alloc(sizeof(double) * l2);
-  qqm       = (double *)vrna_alloc(sizeof(double) * l2);
-  qqm1      = (double *)vrna_alloc(sizeof(double) * l2);
-  my_iindx  = vrna_idx_row_wise(length);
+  unsigned int  i, l1, l2;
+
+  l1  = length + 1;
+  l2  = length + 2;
+
+  if (length > ws->length) {
+    free_up_arrays(ws);
+
+    ws->prpr            = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((l1 * l2) >> 1));
+    ws->store_M_mlbase  = (double *)vrna_alloc(sizeof(double) * (((l1 * l2) >> 1) + 1));
+    ws->store_H         = (double *)vrna_alloc(sizeof(double) * l2);
+    ws->store_Io        = (double *)vrna_alloc(sizeof(double) * l2);
+    ws->store_M_qm_o    = (double *)vrna_alloc(sizeof(double) * l1);
+    ws->store_I2o       = (double **)vrna_alloc(sizeof(double *) * l1);
+    for (i = 0; i <= length; i++)
+      ws->store_I2o[i] = (double *)vrna_alloc(sizeof(double) * (MAXLOOP + 2));
+    ws->qqm2    = (double *)vrna_alloc(sizeof(double) * l2);
+    ws->qq_1m2  = (double *)vrna_alloc(sizeof(double) * l2);
+    ws->qqm     = (double *)vrna_alloc(sizeof(double) * l2);
+    ws->qqm1    = (double *)vrna_alloc(sizeof(double) * l2);
+    ws->sum_M   = (double *)vrna_alloc(sizeof(double) * l1);
+    ws->iindx   = vrna_idx_row_wise(length);
+    ws->length  = length;
+  } else {
+    /* the recursions expect everything but prpr to start at 0 */
+    memset(ws->store_M_mlbase, 0, sizeof(double) * (((l1 * l2) >> 1) + 1));
+    for (i = 0; i <= length; i++)
+      memset(ws->store_I2o[i], 0, sizeof(double) * (MAXLOOP + 2));
+    memset(ws->qqm2, 0, sizeof(double) * l2);
+    memset(ws->qq_1m2, 0, sizeof(double) * l2);
+    memset(ws->qqm, 0, sizeof(double) * l2);
+    memset(ws->qqm1, 0, sizeof(double) * l2);
+    memset(ws->sum_M, 0, sizeof(double) * l1);
+    free(ws->iindx);
+    ws->iindx = vrna_idx_row_wise(length);
+  }
 }
 
 
 PRIVATE void
-free_up_arrays(void)
+free_up_arrays(vrna_up_workspace_t *ws)
 {
-  if (prpr != NULL) {
-    free(prpr);
-    prpr = NULL;
-  }
-
-  if (expMLbase != NULL) {
-    free(expMLbase);
-    expMLbase = NULL;
-  }
-
-  if (scale != NULL) {
-    free(scale);
-    scale = NULL;
-  }
-
-  if (qqm != NULL) {
-    free(qqm);
-    qqm = NULL;
-  }
-
-  if (qqm1 != NULL) {
-    free(qqm1);
-    qqm1 = NULL;
-  }
-
-  if (qqm2 != NULL) {
-    free(qqm2);
-    qqm2 = NULL;
-  }
-
-  if (qq_1m2 != NULL) {
-    free(qq_1m2);
-    qq_1m2 = NULL;
-  }
+  unsigned int i;
 
-  if (my_iindx != NULL) {
-    free(my_iindx);
-    my_iindx = NULL;
-  }
+  if (ws->store_I2o)
+    for (i = 0; i <= ws->length; i++)
+      free(ws->store_I2o[i]);
+
+  free(ws->store_I2o);
+  free(ws->prpr);
+  free(ws->store_M_mlbase);
+  free(ws->store_H);
+  free(ws->store_Io);
+  free(ws->store_M_qm_o);
+  free(ws->qqm);
+  free(ws->qqm1);
+  free(ws->qqm2);
+  free(ws->qq_1m2);
+  free(ws->sum_M);
+  free(ws->iindx);
+  free(ws->scale);
+  free(ws->expMLbase);
+
+  ws->store_I2o       = NULL;
+  ws->prpr            = NULL;
+  ws->store_M_mlbase  = NULL;
+  ws->store_H         = NULL;
+  ws->store_Io        = NULL;
+  ws->store_M_qm_o    = NULL;
+  ws->qqm             = NULL;
+  ws->qqm1            = NULL;
+  ws->qqm2            = NULL;
+  ws->qq_1m2          = NULL;
+  ws->sum_M           = NULL;
+  ws->iindx           = NULL;
+  ws->scale           = NULL;
+  ws->expMLbase       = NULL;
+  ws->length          = 0;
+  ws->scale_length    = 0;
 }
 
 
 PUBLIC void
 free_interact(interact *pin)
 {
-  if (S != NULL && pin != NULL) {
-    free(S);
-    S = NULL;
-  }
-
-  if (S1 != NULL && pin != NULL) {
-    free(S1);
-    S1 = NULL;
-  }
-
   if (pin != NULL) {
     free(pin->Pi);
     free(pin->Gi);
@@ -1216,80 +1395,37 @@ free_interact(interact *pin)
 }
 
 
-/*---------------------------------------------------------------------------*/
-
-PRIVATE void
-encode_seq(const char *s1,
-           const char *s2)
-{
-  unsigned int i, l;
-
-  l = strlen(s1);
-  /* S and S1 are freed by free_pf_arrays(); ! */
-  S   = (short *)vrna_alloc(sizeof(short) * (l + 1));
-  S1  = (short *)vrna_alloc(sizeof(short) * (l + 1));
-  /* S1 exists only for the special X K and I bases and energy_set!=0 */
-  S[0] = l;
-  for (i = 1; i <= l; i++) {
-    /* make numerical encoding of sequence */
-    S[i]  = (short)encode_char(toupper(s1[i - 1]));
-    S1[i] = alias[S[i]]; /* for mismatches of nostandard bases */
-  }
-  if (s2 != NULL) {
-    l = strlen(s2);
-    /* SS2 exists only for the special X K and I bases and energy_set!=0 */
-    SS[0] = l;
-    for (i = 1; i <= l; i++) {
-      /* make numerical encoding of sequence */
-      SS[i]   = (short)encode_char(toupper(s2[i - 1]));
-      SS2[i]  = alias[SS[i]]; /* for mismatches of nostandard bases */
-    }
-  }
-}
-
-
 /*-------------------------------------------------------------------------*/
-/* scale energy parameters and pre-calculate Boltzmann weights:
- * most of this is done in structure Pf see params.c,h (function:
- * get_scaled_pf_parameters(), only arrays scale and expMLbase are handled here*/
+/* pre-calculate the Boltzmann weights of unpaired bases in multiloops
+ * and the scaling factors (to avoid overflows) for segments of up to
+ * length + 1 nucleotides, everything else is done in the exp_params */
 PRIVATE void
-scale_stru_pf_params(unsigned int length)
+scale_stru_pf_params(vrna_up_workspace_t  *ws,
+                     double               expMLbase,
+                     double               pf_scale,
+                     unsigned int         length)
 {
   unsigned int  i;
-  double        kT;
-
-
-  /* Do this only at the first call for get_scaled_pf_parameters()
-   * and/or if temperature has changed*/
-  if (init_temp != temperature) {
-    if (Pf)
-      free(Pf);
-
-    vrna_md_t md;
-    set_model_details(&md);
-    Pf = vrna_exp_params(&md);
+  FLT_OR_DBL    *scale, *expMLb;
+
+  if (length > ws->scale_length) {
+    free(ws->scale);
+    free(ws->expMLbase);
+    ws->scale         = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (length + 2));
+    ws->expMLbase     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (length + 2));
+    ws->scale_length  = length;
   }
 
-  init_temp = Pf->temperature;
-
-  kT = Pf->kT; /* kT in cal/mol  */
-
-  /* scaling factors (to avoid overflows) */
-  if (pf_scale == -1) {
-    /* mean energy for random sequences: 184.3*length cal */
-    pf_scale = exp(-(-185 + (Pf->temperature - 37.) * 7.27) / kT);
-    if (pf_scale < 1)
-      pf_scale = 1;
-  }
+  scale   = ws->scale;
+  expMLb  = ws->expMLbase;
 
-  Pf->pf_scale  = pf_scale;
-  scale[0]      = 1.;
-  scale[1]      = 1. / pf_scale;
-  expMLbase[0]  = 1;
-  expMLbase[1]  = Pf->expMLbase / pf_scale;
+  scale[0]  = 1.;
+  scale[1]  = 1. / pf_scale;
+  expMLb[0] = 1;
+  expMLb[1] = expMLbase / pf_scale;
   for (i = 2; i <= length + 1; i++) {
-    scale[i]      = scale[i / 2] * scale[i - (i / 2)];
-    expMLbase[i]  = pow(Pf->expMLbase, (double)i) * scale[i];
+    scale[i]  = scale[i / 2] * scale[i - (i / 2)];
+    expMLb[i] = pow(expMLbase, (double)i) * scale[i];
   }
 }
 
@@ -1485,7 +1621,11 @@ plot_free_pu_out(pu_out   *res,
   double  dG_u;
   char    nan[4], *time, dg[11];
   FILE    *wastl;
-  double  kT = Pf->kT;
+  double  kT;
+  vrna_md_t md;
+
+  set_model_details(&md);
+  kT = md.betaScale * (md.temperature + K0) * GASCONST; /* kT in cal/mol  */
 
   wastl = fopen(ofile, "a");
   if (wastl == NULL) {
@@ -1619,22 +1759,22 @@ Up_plot(pu_contrib    *p_c,
 /*-------------------------------------------------------------------------*/
 /* copy from part_func_co.c */
 PRIVATE constrain *
-get_ptypes_up(char        *Seq,
-              const char  *structure)
+get_ptypes_up(const char  *Seq,
+              const char  *structure,
+              vrna_md_t   *md)
 {
   int       n, i, j, k, l, length;
   constrain *con;
-  short     *s, *s1;
+  short     *s;
 
   length = strlen(Seq);
-  make_pair_matrix();
   con       = (constrain *)vrna_alloc(sizeof(constrain));
   con->indx = (int *)vrna_alloc(sizeof(int) * (length + 1));
   for (i = 1; i <= length; i++)
     con->indx[i] = ((length + 1 - i) * (length - i)) / 2 + length + 1;
   con->ptype = (char *)vrna_alloc(sizeof(char) * ((length + 1) * (length + 2) / 2));
 
-  set_encoded_seq((const char *)Seq, &s, &s1);
+  s = vrna_seq_encode_simple(Seq, md);
 
   n = s[0];
   for (k = 1; k <= n - CO_TURN - 1; k++)
@@ -1645,12 +1785,12 @@ get_ptypes_up(char        *Seq,
       if (j > n)
         continue;
 
-      type = pair[s[i]][s[j]];
+      type = md->pair[s[i]][s[j]];
       while ((i >= 1) && (j <= n)) {
         if ((i > 1) && (j < n))
-          ntype = pair[s[i - 1]][s[j + 1]];
+          ntype = md->pair[s[i - 1]][s[j + 1]];
 
-        if (noLonelyPairs && (!otype) && (!ntype))
+        if (md->noLP && (!otype) && (!ntype))
           type = 0; /* i.j can only form isolated pairs */
 
         con->ptype[con->indx[i] - j]  = (char)type;
@@ -1661,7 +1801,7 @@ get_ptypes_up(char        *Seq,
       }
     }
 
-  if (fold_constrained && (structure != NULL)) {
+  if (structure != NULL) {
     int   hx, *stack;
     char  type;
     stack = (int *)vrna_alloc(sizeof(int) * (n + 1));
@@ -1704,34 +1844,6 @@ get_ptypes_up(char        *Seq,
   }
 
   free(s);
-  free(s1);
   return con;
 }
 
-
-PRIVATE void
-set_encoded_seq(const char  *sequence,
-                short       **S,
-                short       **S1)
-{
-  unsigned int i, l;
-
-  l = strlen(sequence);
-  if (S != NULL) {
-    *S = (short *)vrna_alloc(sizeof(short) * (l + 2));
-    for (i = 1; i <= l; i++) /* make numerical encoding of sequence */
-      (*S)[i] = (short)encode_char(toupper(sequence[i - 1]));
-    (*S)[l + 1] = (*S)[1];
-    (*S)[0]     = (short)l;
-  }
-
-  /* S1 exists only for the special X K and I bases and energy_set!=0 */
-  if (S1 != NULL) {
-    *S1 = (short *)vrna_alloc(sizeof(short) * (l + 2));
-    for (i = 1; i <= l; i++)                                            /* make numerical encoding of sequence */
-      (*S1)[i] = alias[(short)encode_char(toupper(sequence[i - 1]))];   /* for mismatches of nostandard bases */
-    /* for circular folding add first base at position n+1 and last base at position 0 in S1 */
-    (*S1)[l + 1]  = (*S1)[1];
-    (*S1)[0]      = (*S1)[l];
-  }
-}
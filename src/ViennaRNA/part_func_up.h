@@ -2,12 +2,8 @@
 #define VIENNA_RNA_PACKAGE_PART_FUNC_UP_H
 
 #include <ViennaRNA/datastructures/basic.h>
-
-#ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
-
-#define   RNA_UP_MODE_1   1U
-#define   RNA_UP_MODE_2   2U
-#define   RNA_UP_MODE_3   4U
+#include <ViennaRNA/model.h>
+#include <ViennaRNA/fold_compound.h>
 
 /**
  *  @file     part_func_up.h
@@ -32,6 +28,115 @@
  *  we compute the free energy of an interaction for every possible binding site.
  */
 
+/**
+ *  @brief  A workspace for the computation of unpaired probabilities and interactions
+ *
+ *  The workspace holds all intermediate data of vrna_pf_unstru() and vrna_pf_interact().
+ *  Its buffers are kept between calls and are only enlarged if necessary, so re-using
+ *  a workspace for many sequences saves a lot of memory allocations. Computations that
+ *  use different workspaces are independent of each other and may run concurrently.
+ *
+ *  @see  vrna_up_workspace(), vrna_up_workspace_free()
+ */
+typedef struct vrna_up_workspace_s vrna_up_workspace_t;
+
+/**
+ *  @brief  Create a workspace for the computation of unpaired probabilities and interactions
+ *
+ *  @param  md  The model details that are used for the interaction energies (maybe NULL)
+ *  @return     A new workspace
+ */
+vrna_up_workspace_t *
+vrna_up_workspace(const vrna_md_t *md);
+
+
+/**
+ *  @brief  Free a workspace for the computation of unpaired probabilities and interactions
+ */
+void
+vrna_up_workspace_free(vrna_up_workspace_t *ws);
+
+
+/**
+ *  @brief  Calculate the partition function over all unpaired regions of a maximal length
+ *
+ *  This is the re-entrant counterpart of pf_unstru(). Instead of the global
+ *  partition function arrays, it uses the matrices and base pair probabilities of
+ *  a fold compound, i.e. vrna_pf() has to be called with base pair probability
+ *  computations beforehand. Structure constraints are taken into account through
+ *  the fold compound.
+ *
+ *  @see  pf_unstru(), vrna_pf_interact()
+ *
+ *  @param  fc    The fold compound of a single, linear sequence
+ *  @param  max_w The maximal length of unpaired regions
+ *  @param  ws    A workspace (maybe NULL)
+ *  @return       The contributions to the probabilities of unpaired regions,
+ *                or NULL on error
+ */
+pu_contrib *
+vrna_pf_unstru(vrna_fold_compound_t *fc,
+               int                  max_w,
+               vrna_up_workspace_t  *ws);
+
+
+/**
+ *  @brief  Calculate the probability of a local interaction between two sequences
+ *
+ *  This is the re-entrant counterpart of pf_interact(). Interaction energies are
+ *  evaluated using the model details of the workspace, and the intermolecular
+ *  constraints in @p cstruc are applied whenever it is not NULL.
+ *
+ *  @see  pf_interact(), vrna_pf_unstru()
+ *
+ *  @param  s1      The longer sequence
+ *  @param  s2      The shorter sequence
+ *  @param  p_c     The unpaired probability contributions of @p s1
+ *  @param  p_c2    The unpaired probability contributions of @p s2 (maybe NULL)
+ *  @param  max_w   The maximal length of the interaction
+ *  @param  cstruc  The concatenated constraint strings of both sequences (maybe NULL)
+ *  @param  incr3   The number of unpaired nucleotides 3' of the interaction in @p s1
+ *  @param  incr5   The number of unpaired nucleotides 5' of the interaction in @p s1
+ *  @param  ws      A workspace (maybe NULL)
+ *  @return         The interaction data, or NULL on error
+ */
+interact *
+vrna_pf_interact(const char           *s1,
+                 const char           *s2,
+                 pu_contrib           *p_c,
+                 pu_contrib           *p_c2,
+                 int                  max_w,
+                 const char           *cstruc,
+                 int                  incr3,
+                 int                  incr5,
+                 vrna_up_workspace_t  *ws);
+
+
+/**
+ *  @brief Frees the output of function pf_interact().
+ */
+void free_interact(interact *pin);
+
+/**
+ *  @brief
+ */
+pu_contrib  *get_pu_contrib_struct( unsigned int n,
+                                    unsigned int w);
+
+/**
+ *  @brief Frees the output of function pf_unstru().
+ */
+void        free_pu_contrib_struct(pu_contrib *pu);
+
+void
+free_pu_contrib(pu_contrib *pu);
+
+#ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
+
+#define   RNA_UP_MODE_1   1U
+#define   RNA_UP_MODE_2   2U
+#define   RNA_UP_MODE_3   4U
+
 /**
  *  @brief Calculate the partition function over all unpaired regions
  *  of a maximal length.
@@ -112,11 +217,6 @@ interact *pf_interact(const char *s1,
                       int incr3,
                       int incr5);
 
-/**
- *  @brief Frees the output of function pf_interact().
- */
-void free_interact(interact *pin);
-
 /**
  *  @brief
  */
@@ -129,24 +229,10 @@ int Up_plot(pu_contrib *p_c,
             char *head,
             unsigned int mode);
 
-/**
- *  @brief
- */
-pu_contrib  *get_pu_contrib_struct( unsigned int n,
-                                    unsigned int w);
-
-/**
- *  @brief Frees the output of function pf_unstru().
- */
-void        free_pu_contrib_struct(pu_contrib *pu);
-
-void
-free_pu_contrib(pu_contrib *pu);
+#endif
 
 /**
  * @}
  */
 
 #endif
-
-#endif
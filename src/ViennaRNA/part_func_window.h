@@ -219,6 +219,13 @@ DEPRECATED(typedef void (vrna_probs_window_callback)(FLT_OR_DBL    *pr,
  *
  *  Options may be OR-ed together
  *
+ *  If #vrna_md_t.num_threads is larger than 1 and RNAlib was compiled with OpenMP support,
+ *  long sequences are split into chunks that are scanned concurrently. Each chunk is extended
+ *  upstream by an overlap that covers all windows the probabilities it reports depend on.
+ *  The callback @p cb is still executed by one thread at a time and receives the very same
+ *  data, in the very same order, as in a serial scan. Sequences with hard or soft constraints
+ *  added to @p fc are always processed serially.
+ *
  *  @see  vrna_pfl_fold_cb(), vrna_pfl_fold_up_cb()
  *
  *  @param  fc            The fold compound with sequence data, model settings and precomputed energy parameters
@@ -37,10 +37,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <math.h>
 #include <ctype.h>
 #include <string.h>
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/datastructures/char_stream.h"
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/fold.h"
@@ -90,6 +92,11 @@ PRIVATE void
 update_dfold_params(void);
 
 
+PRIVATE void
+plex_printf(const char *format,
+            ...);
+
+
 /**
 *** duplexfold(_XS)/backtrack(_XS) computes duplex interaction with standard energy and considers extension_cost
 *** find_max(_XS)/plot_max(_XS) find suboptimals and MFE
@@ -271,6 +278,26 @@ PRIVATE short *S1 = NULL, *SS1 = NULL, *S2 = NULL, *SS2 = NULL; /*contains the s
 PRIVATE int   n1, n2;                                           /* sequence lengths */
 PRIVATE int   n3, n4; /*sequence length for the duplex*/;
 
+/**
+*** optional char stream that receives the output of the Lduplexfold*() functions
+*** instead of stdout, see Lduplexfold_set_output()
+**/
+PRIVATE vrna_cstr_t output_stream = NULL;
+
+/**
+*** shift of all reported target coordinates, see Lduplexfold_set_target_offset()
+**/
+PRIVATE int target_offset = 0;
+
+#ifdef _OPENMP
+
+/* NOTE: all variables are assumed to be uninitialized if they are declared as threadprivate
+ */
+#pragma omp threadprivate(P, c, in, bx, by, inx, iny, S1, SS1, S2, SS2, n1, n2, n3, n4, \
+  output_stream, target_offset)
+
+#endif
+
 
 /*-----------------------------------------------------------------------duplexfold_XS---------------------------------------------------------------------------*/
 
@@ -326,7 +353,7 @@ duplexfold_XS(const char  *s1,
   j     = 1 + j_flag;
   type  = pair[S1[i]][S2[j]];
   if (!type) {
-    printf("Error during initialization of the duplex in duplexfold_XS\n");
+    plex_printf("Error during initialization of the duplex in duplexfold_XS\n");
     mfe.structure = NULL;
     mfe.energy    = INF;
     return mfe;
@@ -2399,10 +2426,10 @@ find_max_XS(const int   *position,
         max_pos_j = position_j[pos + delta];
         int max;
         max = position[pos + delta];
-        printf("target upper bound %d: query lower bound %d  (%5.2f) \n",
-               pos - 10,
-               max_pos_j - 10,
-               ((double)max) / 100);
+        plex_printf("target upper bound %d: query lower bound %d  (%5.2f) \n",
+                    pos - 10 + target_offset,
+                    max_pos_j - 10,
+                    ((double)max) / 100);
         pos = MAX2(10, pos + temp_min - delta);
       }
     }
@@ -2455,11 +2482,11 @@ find_max_XS(const int   *position,
                               b_b);
         if (test.energy * 100 < threshold) {
           int l1 = strchr(test.structure, '&') - test.structure;
-          printf(
+          plex_printf(
             " %s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
             test.structure,
-            begin_t - 10 + test.i - l1 - 10,
-            begin_t - 10 + test.i - 1 - 10,
+            begin_t - 10 + test.i - l1 - 10 + target_offset,
+            begin_t - 10 + test.i - 1 - 10 + target_offset,
             begin_q - 10 + test.j - 1 - 10,
             (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
             test.ddG,
@@ -2467,7 +2494,7 @@ find_max_XS(const int   *position,
             test.opening_backtrack_x,
             test.opening_backtrack_y,
             test.energy_backtrack,
-            pos - 10,
+            pos - 10 + target_offset,
             max_pos_j - 10,
             ((double)position[pos + delta]) / 100);
           pos = MAX2(10, pos + temp_min - delta);
@@ -2510,19 +2537,19 @@ find_max_XS(const int   *position,
         test =
           duplexfold_XS(s3, s4, access_s1, access_s2, pos, max_pos_j, threshold, i_flag, j_flag);
         if (test.energy * 100 < threshold) {
-          printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) i:%d,j:%d <%5.2f>\n",
-                 test.structure,
-                 test.tb,
-                 test.te,
-                 test.qb,
-                 test.qe,
-                 test.ddG,
-                 test.energy,
-                 test.dG1,
-                 test.dG2,
-                 pos - 10,
-                 max_pos_j - 10,
-                 ((double)position[pos + delta]) / 100);
+          plex_printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) i:%d,j:%d <%5.2f>\n",
+                      test.structure,
+                      test.tb + target_offset,
+                      test.te + target_offset,
+                      test.qb,
+                      test.qe,
+                      test.ddG,
+                      test.energy,
+                      test.dG1,
+                      test.dG2,
+                      pos - 10 + target_offset,
+                      max_pos_j - 10,
+                      ((double)position[pos + delta]) / 100);
           pos = MAX2(10, pos + temp_min - delta);
         }
 
@@ -2574,8 +2601,10 @@ plot_max_XS(const int   max,
             const int   b_b)
 {
   if (fast == 1) {
-    printf("target upper bound %d: query lower bound %d (%5.2f)\n", max_pos - 3, max_pos_j,
-           ((double)max) / 100);
+    plex_printf("target upper bound %d: query lower bound %d (%5.2f)\n",
+                max_pos - 3 + target_offset,
+                max_pos_j,
+                ((double)max) / 100);
   } else if (fast == 2) {
     int   alignment_length2;
     alignment_length2 = MIN2(n1, n2);
@@ -2596,20 +2625,20 @@ plot_max_XS(const int   max,
     duplexT test;
     test = fduplexfold_XS(s3, s4, access_s1, access_s2, end_t, begin_q, INF, il_a, il_b, b_a, b_b);
     int     l1 = strchr(test.structure, '&') - test.structure;
-    printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
-           test.structure,
-           begin_t - 10 + test.i - l1 - 10,
-           begin_t - 10 + test.i - 1 - 10,
-           begin_q - 10 + test.j - 1 - 10,
-           (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
-           test.ddG,
-           test.energy,
-           test.opening_backtrack_x,
-           test.opening_backtrack_y,
-           test.energy_backtrack,
-           max_pos - 10,
-           max_pos_j - 10,
-           (double)max / 100);
+    plex_printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
+                test.structure,
+                begin_t - 10 + test.i - l1 - 10 + target_offset,
+                begin_t - 10 + test.i - 1 - 10 + target_offset,
+                begin_q - 10 + test.j - 1 - 10,
+                (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
+                test.ddG,
+                test.energy,
+                test.opening_backtrack_x,
+                test.opening_backtrack_y,
+                test.energy_backtrack,
+                max_pos - 10 + target_offset,
+                max_pos_j - 10,
+                (double)max / 100);
 
     free(s3);
     free(s4);
@@ -2632,19 +2661,19 @@ plot_max_XS(const int   max,
     s4[end_q - begin_q + 1] = '\0';
     duplexT test;
     test = duplexfold_XS(s3, s4, access_s1, access_s2, max_pos, max_pos_j, INF, i_flag, j_flag);
-    printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) i:%d,j:%d <%5.2f>\n",
-           test.structure,
-           test.tb,
-           test.te,
-           test.qb,
-           test.qe,
-           test.ddG,
-           test.energy,
-           test.dG1,
-           test.dG2,
-           max_pos - 10,
-           max_pos_j - 10,
-           (double)max / 100);
+    plex_printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) i:%d,j:%d <%5.2f>\n",
+                test.structure,
+                test.tb + target_offset,
+                test.te + target_offset,
+                test.qb,
+                test.qe,
+                test.ddG,
+                test.energy,
+                test.dG1,
+                test.dG2,
+                max_pos - 10 + target_offset,
+                max_pos_j - 10,
+                (double)max / 100);
     free(s3);
     free(s4);
     free(test.structure);
@@ -4162,10 +4191,10 @@ find_max(const int  *position,
         max_pos_j = position_j[pos + delta];
         int max;
         max = position[pos + delta];
-        printf("target upper bound %d: query lower bound %d  (%5.2f) \n",
-               pos - 10,
-               max_pos_j - 10,
-               ((double)max) / 100);
+        plex_printf("target upper bound %d: query lower bound %d  (%5.2f) \n",
+                    pos - 10 + target_offset,
+                    max_pos_j - 10,
+                    ((double)max) / 100);
         pos = MAX2(10, pos + temp_min - delta);
       }
     }
@@ -4208,13 +4237,13 @@ find_max(const int  *position,
         test = fduplexfold(s3, s4, extension_cost, il_a, il_b, b_a, b_b);
         if (test.energy * 100 < threshold) {
           int l1 = strchr(test.structure, '&') - test.structure;
-          printf("%s %3d,%-3d : %3d,%-3d (%5.2f) [%5.2f]  i:%d,j:%d <%5.2f>\n", test.structure,
-                 begin_t - 10 + test.i - l1 - 10,
-                 begin_t - 10 + test.i - 1 - 10,
-                 begin_q - 10 + test.j - 1 - 10,
-                 (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
-                 test.energy, test.energy_backtrack, pos - 10, max_pos_j - 10,
-                 ((double)position[pos + delta]) / 100);
+          plex_printf("%s %3d,%-3d : %3d,%-3d (%5.2f) [%5.2f]  i:%d,j:%d <%5.2f>\n", test.structure,
+                      begin_t - 10 + test.i - l1 - 10 + target_offset,
+                      begin_t - 10 + test.i - 1 - 10 + target_offset,
+                      begin_q - 10 + test.j - 1 - 10,
+                      (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
+                      test.energy, test.energy_backtrack, pos - 10 + target_offset, max_pos_j - 10,
+                      ((double)position[pos + delta]) / 100);
           pos = MAX2(10, pos + temp_min - delta);
         }
 
@@ -4295,17 +4324,17 @@ find_max(const int  *position,
           //          l1=strchr(reverse.structure, '&')-test.structure;
 
 
-          printf("%s %3d,%-3d : %3d,%-3d (%5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
-                 reverseStructure,
-                 begin_t - 10 + test.j - 1 - 10,
-                 (begin_t - 11) + test.j + strlen(test.structure) - l1 - 2 - 10,
-                 begin_q - 10 + test.i - l1 - 10,
-                 begin_q - 10 + test.i - 1 - 10,
-                 test.energy,
-                 test.energy_backtrack,
-                 pos,
-                 max_pos_j,
-                 ((double)position[pos + delta]) / 100);
+          plex_printf("%s %3d,%-3d : %3d,%-3d (%5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
+                      reverseStructure,
+                      begin_t - 10 + test.j - 1 - 10 + target_offset,
+                      (begin_t - 11) + test.j + strlen(test.structure) - l1 - 2 - 10 + target_offset,
+                      begin_q - 10 + test.i - l1 - 10,
+                      begin_q - 10 + test.i - 1 - 10,
+                      test.energy,
+                      test.energy_backtrack,
+                      pos + target_offset,
+                      max_pos_j,
+                      ((double)position[pos + delta]) / 100);
           pos = MAX2(10, pos + temp_min - delta);
         }
 
@@ -4351,12 +4380,13 @@ find_max(const int  *position,
         test = duplexfold(s3, s4, extension_cost);
         if (test.energy * 100 < threshold) {
           int l1 = strchr(test.structure, '&') - test.structure;
-          printf("%s %3d,%-3d : %3d,%-3d (%5.2f)  i:%d,j:%d <%5.2f>\n", test.structure,
-                 begin_t - 10 + test.i - l1,
-                 begin_t - 10 + test.i - 1,
-                 begin_q - 10 + test.j - 1,
-                 (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2,
-                 test.energy, pos - 10, max_pos_j - 10, ((double)position[pos + delta]) / 100);
+          plex_printf("%s %3d,%-3d : %3d,%-3d (%5.2f)  i:%d,j:%d <%5.2f>\n", test.structure,
+                      begin_t - 10 + test.i - l1 + target_offset,
+                      begin_t - 10 + test.i - 1 + target_offset,
+                      begin_q - 10 + test.j - 1,
+                      (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2,
+                      test.energy, pos - 10 + target_offset, max_pos_j - 10,
+                      ((double)position[pos + delta]) / 100);
           pos = MAX2(10, pos + temp_min - delta);
         }
 
@@ -4384,8 +4414,10 @@ plot_max(const int  max,
          const int  b_b)
 {
   if (fast == 1) {
-    printf("target upper bound %d: query lower bound %d (%5.2f)\n", max_pos - 10, max_pos_j - 10,
-           ((double)max) / 100);
+    plex_printf("target upper bound %d: query lower bound %d (%5.2f)\n",
+                max_pos - 10 + target_offset,
+                max_pos_j - 10,
+                ((double)max) / 100);
   } else if (fast == 2) {
     int   alignment_length2;
     alignment_length2 = MIN2(n1, n2);
@@ -4406,12 +4438,13 @@ plot_max(const int  max,
     duplexT test;
     test = fduplexfold(s3, s4, extension_cost, il_a, il_b, b_a, b_b);
     int     l1 = strchr(test.structure, '&') - test.structure;
-    printf("%s %3d,%-3d : %3d,%-3d (%5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n", test.structure,
-           begin_t - 10 + test.i - l1 - 10,
-           begin_t - 10 + test.i - 1 - 10,
-           begin_q - 10 + test.j - 1 - 10,
-           (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
-           test.energy, test.energy_backtrack, max_pos - 10, max_pos_j - 10, ((double)max) / 100);
+    plex_printf("%s %3d,%-3d : %3d,%-3d (%5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n", test.structure,
+                begin_t - 10 + test.i - l1 - 10 + target_offset,
+                begin_t - 10 + test.i - 1 - 10 + target_offset,
+                begin_q - 10 + test.j - 1 - 10,
+                (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
+                test.energy, test.energy_backtrack, max_pos - 10 + target_offset, max_pos_j - 10,
+                ((double)max) / 100);
     free(s3);
     free(s4);
     free(test.structure);
@@ -4431,12 +4464,12 @@ plot_max(const int  max,
     s4[end_q - begin_q + 1] = '\0';
     test                    = duplexfold(s3, s4, extension_cost);
     int l1 = strchr(test.structure, '&') - test.structure;
-    printf("%s %3d,%-3d : %3d,%-3d (%5.2f) i:%d,j:%d <%5.2f>\n", test.structure,
-           begin_t - 10 + test.i - l1,
-           begin_t - 10 + test.i - 1,
-           begin_q - 10 + test.j - 1,
-           (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2,
-           test.energy, max_pos - 10, max_pos_j - 10, ((double)max) / 100);
+    plex_printf("%s %3d,%-3d : %3d,%-3d (%5.2f) i:%d,j:%d <%5.2f>\n", test.structure,
+                begin_t - 10 + test.i - l1 + target_offset,
+                begin_t - 10 + test.i - 1 + target_offset,
+                begin_q - 10 + test.j - 1,
+                (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2,
+                test.energy, max_pos - 10 + target_offset, max_pos_j - 10, ((double)max) / 100);
     free(s3);
     free(s4);
     free(test.structure);
@@ -4444,6 +4477,37 @@ plot_max(const int  max,
 }
 
 
+PUBLIC void
+Lduplexfold_set_output(vrna_cstr_t stream)
+{
+  output_stream = stream;
+}
+
+
+PUBLIC void
+Lduplexfold_set_target_offset(int offset)
+{
+  target_offset = offset;
+}
+
+
+PRIVATE void
+plex_printf(const char  *format,
+            ...)
+{
+  va_list args;
+
+  va_start(args, format);
+
+  if (output_stream)
+    vrna_cstr_vprintf(output_stream, format, args);
+  else
+    vprintf(format, args);
+
+  va_end(args);
+}
+
+
 PRIVATE void
 update_dfold_params(void)
 {
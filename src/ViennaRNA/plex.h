@@ -2,6 +2,7 @@
 #define VIENNA_RNA_PACKAGE_PLEX_H
 
 #include <ViennaRNA/datastructures/basic.h>
+#include <ViennaRNA/datastructures/char_stream.h>
 
 #ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
 
@@ -75,6 +76,19 @@ duplexT** Lduplexfold_CXS(const char*s1,
 
 
 
+/**
+*** Lduplexfold_set_output Redirects the output of the Lduplexfold*() functions
+*** of the calling thread into a char stream. Passing NULL restores stdout.
+**/
+void     Lduplexfold_set_output(vrna_cstr_t stream);
+
+/**
+*** Lduplexfold_set_target_offset Shifts all target coordinates reported by the
+*** Lduplexfold*() functions of the calling thread by offset. This allows one to
+*** scan a window of a larger target and still report positions in the full target.
+**/
+void     Lduplexfold_set_target_offset(int offset);
+
 int      arraySize(duplexT** array);
 void     freeDuplexT(duplexT** array);
 
@@ -0,0 +1,362 @@
+/*
+ *  ViennaRNA/search/seeds.c
+ *
+ *  A k-mer index of target sequences to quickly locate
+ *  target sites that are complementary to a query seed
+ *
+ *  ViennaRNA package
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/search/seeds.h"
+
+#ifndef INLINE
+#ifdef __GNUC__
+# define INLINE inline
+#else
+# define INLINE
+#endif
+#endif
+
+/*
+ #################################
+ # GLOBAL VARIABLES              #
+ #################################
+ */
+
+/*
+ #################################
+ # PRIVATE VARIABLES and STRUCTS #
+ #################################
+ */
+struct vrna_seed_index_s {
+  unsigned int  length;       /* length of the target sequence */
+  unsigned int  seed_length;  /* length of the indexed k-mers */
+  unsigned int  *offsets;     /* start of the position list for each k-mer, 4^k + 1 entries */
+  unsigned int  *positions;   /* 1-based start positions of all k-mers, grouped by k-mer */
+};
+
+/* seed enumeration state */
+struct seed_search {
+  const vrna_seed_index_t *index;
+  const int               *seed;
+  unsigned int            max_gu;
+  unsigned int            *hits;
+  unsigned int            num_hits;
+  unsigned int            size;
+};
+
+/*
+ #################################
+ # PRIVATE FUNCTION DECLARATIONS #
+ #################################
+ */
+PRIVATE INLINE int
+encode_nt(char c);
+
+
+PRIVATE void
+collect_sites(struct seed_search  *search,
+              unsigned int        m,
+              unsigned int        code,
+              unsigned int        gu);
+
+
+PRIVATE int
+compare_positions(const void  *a,
+                  const void  *b);
+
+
+/*
+ #################################
+ # BEGIN OF FUNCTION DEFINITIONS #
+ #################################
+ */
+PUBLIC vrna_seed_index_t *
+vrna_seed_index(const char    *target,
+                unsigned int  seed_length)
+{
+  unsigned int      n, i, k, num_kmers, code, mask, valid, *fill;
+  int               c;
+  vrna_seed_index_t *index;
+
+  if ((!target) ||
+      (seed_length == 0) ||
+      (seed_length > VRNA_SEED_MAX_LENGTH))
+    return NULL;
+
+  n         = (unsigned int)strlen(target);
+  num_kmers = 1U << (2 * seed_length);
+  mask      = num_kmers - 1;
+
+  index               = (vrna_seed_index_t *)vrna_alloc(sizeof(vrna_seed_index_t));
+  index->length       = n;
+  index->seed_length  = seed_length;
+  index->offsets      = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (num_kmers + 1));
+  index->positions    = NULL;
+
+  if (n < seed_length)
+    return index;
+
+  /* first pass, count the occurrences of each k-mer */
+  code = valid = 0;
+  for (i = 0; i < n; i++) {
+    c = encode_nt(target[i]);
+    if (c < 0) {
+      valid = 0;
+      continue;
+    }
+
+    code = ((code << 2) | (unsigned int)c) & mask;
+    if (++valid >= seed_length)
+      index->offsets[code + 1]++;
+  }
+
+  for (k = 1; k <= num_kmers; k++)
+    index->offsets[k] += index->offsets[k - 1];
+
+  index->positions = (unsigned int *)vrna_alloc(sizeof(unsigned int) *
+                                                (index->offsets[num_kmers] + 1));
+
+  /* second pass, store the positions in ascending order */
+  fill = (unsigned int *)vrna_alloc(sizeof(unsigned int) * num_kmers);
+  memcpy(fill, index->offsets, sizeof(unsigned int) * num_kmers);
+
+  code = valid = 0;
+  for (i = 0; i < n; i++) {
+    c = encode_nt(target[i]);
+    if (c < 0) {
+      valid = 0;
+      continue;
+    }
+
+    code = ((code << 2) | (unsigned int)c) & mask;
+    if (++valid >= seed_length)
+      index->positions[fill[code]++] = i + 2 - seed_length;
+  }
+
+  free(fill);
+
+  return index;
+}
+
+
+PUBLIC void
+vrna_seed_index_free(vrna_seed_index_t *index)
+{
+  if (index) {
+    free(index->offsets);
+    free(index->positions);
+    free(index);
+  }
+}
+
+
+PUBLIC unsigned int
+vrna_seed_index_length(const vrna_seed_index_t *index)
+{
+  return (index) ? index->length : 0;
+}
+
+
+PUBLIC unsigned int *
+vrna_seed_hits(const vrna_seed_index_t  *index,
+               const char               *query,
+               unsigned int             seed_start,
+               unsigned int             max_gu,
+               unsigned int             *num_hits)
+{
+  unsigned int        m, k;
+  int                 seed[VRNA_SEED_MAX_LENGTH];
+  struct seed_search  search;
+
+  if (num_hits)
+    *num_hits = 0;
+
+  if ((!index) ||
+      (!query) ||
+      (!index->positions) ||
+      (seed_start == 0) ||
+      (strlen(query) < seed_start + index->seed_length - 1))
+    return NULL;
+
+  k = index->seed_length;
+
+  /*
+   *  the target site is read 5' -> 3', so its m-th nucleotide
+   *  pairs with the (k - 1 - m)-th nucleotide of the seed
+   */
+  for (m = 0; m < k; m++) {
+    seed[m] = encode_nt(query[seed_start - 1 + k - 1 - m]);
+    if (seed[m] < 0)
+      return NULL;
+  }
+
+  search.index    = index;
+  search.seed     = seed;
+  search.max_gu   = max_gu;
+  search.hits     = NULL;
+  search.num_hits = 0;
+  search.size     = 0;
+
+  collect_sites(&search, 0, 0, 0);
+
+  if (search.num_hits == 0) {
+    free(search.hits);
+    return NULL;
+  }
+
+  qsort(search.hits, search.num_hits, sizeof(unsigned int), &compare_positions);
+
+  if (num_hits)
+    *num_hits = search.num_hits;
+
+  return search.hits;
+}
+
+
+PUBLIC unsigned int *
+vrna_seed_windows(const vrna_seed_index_t *index,
+                  const char              *query,
+                  unsigned int            seed_start,
+                  unsigned int            max_gu,
+                  unsigned int            extend_5,
+                  unsigned int            extend_3,
+                  unsigned int            *num_windows)
+{
+  unsigned int  h, num_hits, *hits, *windows, n, w, start, end;
+
+  if (num_windows)
+    *num_windows = 0;
+
+  hits = vrna_seed_hits(index, query, seed_start, max_gu, &num_hits);
+
+  if (!hits)
+    return NULL;
+
+  n       = index->length;
+  windows = (unsigned int *)vrna_alloc(sizeof(unsigned int) * 2 * num_hits);
+  w       = 0;
+
+  for (h = 0; h < num_hits; h++) {
+    start = (hits[h] > extend_5) ? hits[h] - extend_5 : 1;
+    end   = MIN2(n, hits[h] + index->seed_length - 1 + extend_3);
+
+    /* merge with the previous window if they overlap or touch */
+    if ((w > 0) && (start <= windows[2 * w - 1] + 1)) {
+      windows[2 * w - 1] = MAX2(windows[2 * w - 1], end);
+    } else {
+      windows[2 * w]      = start;
+      windows[2 * w + 1]  = end;
+      w++;
+    }
+  }
+
+  free(hits);
+
+  windows = (unsigned int *)vrna_realloc(windows, sizeof(unsigned int) * 2 * w);
+
+  if (num_windows)
+    *num_windows = w;
+
+  return windows;
+}
+
+
+PRIVATE INLINE int
+encode_nt(char c)
+{
+  switch (c) {
+    case 'A':
+    case 'a':
+      return 0;
+    case 'C':
+    case 'c':
+      return 1;
+    case 'G':
+    case 'g':
+      return 2;
+    case 'U':
+    case 'u':
+    case 'T':
+    case 't':
+      return 3;
+    default:
+      return -1;
+  }
+}
+
+
+/*
+ *  enumerate all target k-mers that pair with the seed, where
+ *  A pairs with U, C with G, G with C or U, and U with A or G
+ */
+PRIVATE void
+collect_sites(struct seed_search  *search,
+              unsigned int        m,
+              unsigned int        code,
+              unsigned int        gu)
+{
+  unsigned int            i, start, end;
+  const vrna_seed_index_t *index = search->index;
+
+  if (m == index->seed_length) {
+    start = index->offsets[code];
+    end   = index->offsets[code + 1];
+
+    if (end > start) {
+      if (search->num_hits + end - start > search->size) {
+        search->size  = MAX2(2 * search->size, search->num_hits + end - start);
+        search->hits  = (unsigned int *)vrna_realloc(search->hits,
+                                                     sizeof(unsigned int) * search->size);
+      }
+
+      for (i = start; i < end; i++)
+        search->hits[search->num_hits++] = index->positions[i];
+    }
+
+    return;
+  }
+
+  switch (search->seed[m]) {
+    case 0: /* A-U */
+      collect_sites(search, m + 1, (code << 2) | 3, gu);
+      break;
+    case 1: /* C-G */
+      collect_sites(search, m + 1, (code << 2) | 2, gu);
+      break;
+    case 2: /* G-C, G-U */
+      collect_sites(search, m + 1, (code << 2) | 1, gu);
+      if (gu < search->max_gu)
+        collect_sites(search, m + 1, (code << 2) | 3, gu + 1);
+
+      break;
+    case 3: /* U-A, U-G */
+      collect_sites(search, m + 1, (code << 2) | 0, gu);
+      if (gu < search->max_gu)
+        collect_sites(search, m + 1, (code << 2) | 2, gu + 1);
+
+      break;
+  }
+}
+
+
+PRIVATE int
+compare_positions(const void  *a,
+                  const void  *b)
+{
+  unsigned int p, q;
+
+  p = *((const unsigned int *)a);
+  q = *((const unsigned int *)b);
+
+  return (p > q) - (p < q);
+}
@@ -0,0 +1,137 @@
+#ifndef VIENNA_RNA_PACKAGE_SEARCH_SEEDS_H
+#define VIENNA_RNA_PACKAGE_SEARCH_SEEDS_H
+
+/**
+ *  @file     ViennaRNA/search/seeds.h
+ *  @ingroup  utils, search_utils
+ *  @brief    A k-mer index of target sequences to quickly locate complementary seeds
+ */
+
+/**
+ *  @addtogroup   search_utils
+ *  @{
+ */
+
+/**
+ *  @brief  Default position of the seed within the query, e.g. nucleotides 2-8 of a miRNA
+ */
+#define VRNA_SEED_DEFAULT_START   2
+
+/**
+ *  @brief  Default length of a seed
+ */
+#define VRNA_SEED_DEFAULT_LENGTH  7
+
+/**
+ *  @brief  Maximum length of a seed supported by the seed index
+ */
+#define VRNA_SEED_MAX_LENGTH      12
+
+/**
+ *  @brief  A k-mer index of a target sequence
+ *
+ *  @see    vrna_seed_index(), vrna_seed_index_free(), vrna_seed_hits()
+ */
+typedef struct vrna_seed_index_s vrna_seed_index_t;
+
+
+/**
+ *  @brief  Create a k-mer index of a target sequence
+ *
+ *  All k-mers of length @p seed_length are stored in a compressed table that
+ *  maps each k-mer to the sorted list of its start positions in @p target.
+ *  K-mers that contain other characters than @p A, @p C, @p G, @p U, or @p T
+ *  are not indexed. The index only depends on the target and may be used to
+ *  search for seeds of arbitrary many queries, also from concurrent threads.
+ *
+ *  @see    vrna_seed_index_free(), vrna_seed_hits(), vrna_seed_windows()
+ *
+ *  @param  target        The target sequence
+ *  @param  seed_length   The length of the k-mers (at most #VRNA_SEED_MAX_LENGTH)
+ *  @return               The k-mer index of @p target, or NULL on any error
+ */
+vrna_seed_index_t *
+vrna_seed_index(const char    *target,
+                unsigned int  seed_length);
+
+
+/**
+ *  @brief  Free memory occupied by a seed index
+ *
+ *  @param  index   The seed index
+ */
+void
+vrna_seed_index_free(vrna_seed_index_t *index);
+
+
+/**
+ *  @brief  Get the length of the target sequence of a seed index
+ *
+ *  @param  index   The seed index
+ *  @return         The length of the indexed target sequence
+ */
+unsigned int
+vrna_seed_index_length(const vrna_seed_index_t *index);
+
+
+/**
+ *  @brief  Find all target sites that form a perfect helix with the seed of a query
+ *
+ *  The seed is the substring of @p query of the index' seed length that starts at
+ *  the 1-based position @p seed_start. A target site is admissible if each of its
+ *  nucleotides forms a canonical Watson-Crick or G:U wobble pair with the
+ *  corresponding seed nucleotide of the anti-parallel query, where at most
+ *  @p max_gu wobble pairs are allowed.
+ *
+ *  @see    vrna_seed_index(), vrna_seed_windows()
+ *
+ *  @param  index       The seed index of the target
+ *  @param  query       The query sequence
+ *  @param  seed_start  The 1-based start position of the seed in @p query
+ *  @param  max_gu      The maximum number of G:U wobble pairs within the seed
+ *  @param  num_hits    A pointer to store the number of admissible target sites
+ *  @return             The sorted list of 1-based 5' start positions of all admissible target sites,
+ *                      or NULL if there are none
+ */
+unsigned int *
+vrna_seed_hits(const vrna_seed_index_t  *index,
+               const char               *query,
+               unsigned int             seed_start,
+               unsigned int             max_gu,
+               unsigned int             *num_hits);
+
+
+/**
+ *  @brief  Get the target windows that contain at least one admissible seed
+ *
+ *  Each target site returned by vrna_seed_hits() is extended by @p extend_5 nucleotides
+ *  to its 5' side and @p extend_3 nucleotides to its 3' side. Overlapping or adjacent
+ *  windows are merged.
+ *
+ *  @see    vrna_seed_hits()
+ *
+ *  @param  index       The seed index of the target
+ *  @param  query       The query sequence
+ *  @param  seed_start  The 1-based start position of the seed in @p query
+ *  @param  max_gu      The maximum number of G:U wobble pairs within the seed
+ *  @param  extend_5    The number of nucleotides to add 5' of each target site
+ *  @param  extend_3    The number of nucleotides to add 3' of each target site
+ *  @param  num_windows A pointer to store the number of windows
+ *  @return             A list of @p num_windows pairs of 1-based start and end positions of the
+ *                      target windows in ascending order, or NULL if there are no windows
+ */
+unsigned int *
+vrna_seed_windows(const vrna_seed_index_t *index,
+                  const char              *query,
+                  unsigned int            seed_start,
+                  unsigned int            max_gu,
+                  unsigned int            extend_5,
+                  unsigned int            extend_3,
+                  unsigned int            *num_windows);
+
+
+/**
+ * @}
+ */
+
+#endif
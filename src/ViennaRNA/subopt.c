@@ -22,6 +22,7 @@
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/datastructures/lists.h"
+#include "ViennaRNA/datastructures/stream_output.h"
 #include "ViennaRNA/eval.h"
 #include "ViennaRNA/params/basic.h"
 #include "ViennaRNA/loops/all.h"
@@ -56,6 +57,9 @@
 #define true              1
 #define false             0
 
+/* number of independent branches per thread for parallel enumeration */
+#define SUBOPT_BRANCHES_PER_THREAD  32
+
 typedef struct {
   struct hc_ext_def_dat     hc_dat_ext;
   vrna_hc_eval_f hc_eval_ext;
@@ -85,20 +89,84 @@ typedef struct INTERVAL {
 } INTERVAL;
 
 typedef struct {
-  char  *structure;
-  LIST  *Intervals;
-  int   partial_energy;
-  int   is_duplex;
-  /* int best_energy;   */ /* best attainable energy */
+  char          *structure;
+  LIST          *Intervals;
+  int           partial_energy;
+  int           is_duplex;
+  int           best_energy;    /* best attainable energy */
+  unsigned long order;          /* creation order for best-first enumeration */
 } STATE;
 
 typedef struct {
-  LIST  *Intervals;
-  LIST  *Stack;
-  int   nopush;
+  LIST                  *Intervals;
+  LIST                  *Stack;
+  int                   nopush;
+
+  /* priority queue of states for best-first enumeration */
+  vrna_fold_compound_t  *fc;
+  STATE                 **heap;
+  size_t                heap_size;
+  size_t                heap_max;
+  unsigned long         counter;
+  size_t                memory;     /* approximate memory occupied by all queued states */
 } subopt_env;
 
 
+/* structures of equal energy that await lexicographic sorting */
+struct subopt_group_entry {
+  char  *structure;
+  char  *key;                       /* sort key, compatible with sorting in vrna_subopt() */
+  float energy;
+};
+
+struct subopt_group {
+  struct subopt_group_entry *entries;
+  unsigned long             num;
+  unsigned long             size;
+  int                       energy;
+  int                       compressed;
+};
+
+
+/* energy bounds of an enumeration */
+struct subopt_settings {
+  int     minimal_energy;           /* MFE according to the DP matrices */
+  int     threshold;                /* upper bound for the energy of partial structures */
+  int     logML;
+  int     dangle_model;
+  double  min_en;                   /* (re-evaluated) MFE */
+  double  eprint;                   /* printing threshold */
+  float   correction;
+};
+
+
+#ifdef _OPENMP
+
+/* structures of a branch that await ordered output */
+struct subopt_buffer {
+  char          **structures;
+  float         *energies;
+  unsigned long num;
+  unsigned long size;
+};
+
+struct subopt_output {
+  vrna_subopt_result_f  cb;
+  void                  *data;
+};
+
+/* partial structures shared with threads that ran out of work */
+struct subopt_pool {
+  STATE       **states;
+  size_t      num;
+  int         idle;                 /* number of threads waiting for work */
+  int         num_threads;
+  omp_lock_t  lock;
+};
+
+#endif
+
+
 struct old_subopt_dat {
   unsigned long           max_sol;
   unsigned long           n_sol;
@@ -162,6 +230,129 @@ wrap_subopt(char          *seq,
 
 #endif
 
+PRIVATE unsigned long
+subopt_enumerate(vrna_fold_compound_t *fc,
+                 int                  delta,
+                 int                  sorted,
+                 int                  keep_order,
+                 unsigned long        max_structures,
+                 size_t               max_memory,
+                 vrna_subopt_result_f cb,
+                 void                 *data);
+
+
+PRIVATE void
+init_settings(vrna_fold_compound_t    *fc,
+              int                     delta,
+              struct subopt_settings  *settings);
+
+
+PRIVATE char *
+get_solution(vrna_fold_compound_t   *fc,
+             struct subopt_settings *settings,
+             STATE                  *state,
+             int                    *dos,
+             double                 *energy);
+
+
+PRIVATE void
+merge_density_of_states(const int *dos);
+
+
+#ifdef _OPENMP
+
+PRIVATE STATE **
+split_enumeration(vrna_fold_compound_t    *fc,
+                  struct subopt_settings  *settings,
+                  size_t                  num_branches,
+                  size_t                  *num_tasks);
+
+
+PRIVATE unsigned long
+subopt_enumerate_parallel(vrna_fold_compound_t    *fc,
+                          struct subopt_settings  *settings,
+                          int                     num_threads,
+                          int                     keep_order,
+                          vrna_subopt_result_f    cb,
+                          void                    *data);
+
+
+PRIVATE unsigned long
+process_states(vrna_fold_compound_t   *fc,
+               struct subopt_settings *settings,
+               subopt_env             *env,
+               constraint_helpers     *constraints_dat,
+               int                    *dos,
+               struct subopt_pool     *pool,
+               struct subopt_buffer   *buffer,
+               struct subopt_output   *output);
+
+
+PRIVATE STATE *
+steal_state(struct subopt_pool *pool);
+
+
+PRIVATE void
+share_state(struct subopt_pool  *pool,
+            LIST                *stack);
+
+
+PRIVATE void
+buffer_add(struct subopt_buffer *buffer,
+           char                 *structure,
+           double               energy);
+
+
+PRIVATE void
+flush_buffer(void         *auxdata,
+             unsigned int i,
+             void         *data);
+
+
+PRIVATE subopt_env *
+get_stack_env(vrna_fold_compound_t *fc);
+
+
+PRIVATE void
+free_stack_env(subopt_env *env);
+
+
+#endif
+
+
+PRIVATE int
+num_states(subopt_env *env);
+
+
+PRIVATE void
+push_state(subopt_env *env,
+           STATE      *state);
+
+
+PRIVATE STATE *
+pop_state(subopt_env *env);
+
+
+PRIVATE int
+prune_states(subopt_env *env,
+             int        *threshold);
+
+
+PRIVATE void
+group_add(struct subopt_group *group,
+          char                *structure,
+          double              energy,
+          int                 key);
+
+
+PRIVATE unsigned long
+flush_group(struct subopt_group   *group,
+            unsigned long         max_structures,
+            unsigned long         num_reported,
+            vrna_subopt_result_f  cb,
+            void                  *data);
+
+
 PRIVATE void
 make_pair(int   i,
           int   j,
@@ -322,8 +513,8 @@ free_state_node(STATE *node);
 
 
 PRIVATE void
-push_back(LIST  *Stack,
-          STATE *state);
+push_back(subopt_env  *env,
+          STATE       *state);
 
 
 PRIVATE char *
@@ -454,8 +645,8 @@ vrna_subopt(vrna_fold_compound_t  *fc,
         cb = old_subopt_store_compressed;
     }
 
-    /* call subopt() */
-    vrna_subopt_cb(fc, delta, cb, (void *)&data);
+    /* call subopt(), the order of structures doesn't matter if we sort them anyway */
+    (void)subopt_enumerate(fc, delta, VRNA_UNSORTED, !sorted, 0, 0, cb, (void *)&data);
 
     if (sorted) {
       /* sort structures by energy */
@@ -504,92 +695,135 @@ vrna_subopt_cb(vrna_fold_compound_t *fc,
                vrna_subopt_result_f cb,
                void                 *data)
 {
-  subopt_env          *env;
-  STATE               *state;
-  INTERVAL            *interval;
-  unsigned int        *so, *ss;
-  int                 maxlevel, count, partial_energy, old_dangles, logML, dangle_model, length,
-                      circular,
-                      threshold;
-  double              structure_energy, min_en, eprint;
-  char                *struc, *structure;
-  float               correction;
-  vrna_param_t        *P;
-  vrna_md_t           *md;
-  int                 minimal_energy;
-  int                 Fc;
-  int                 *f5;
-  constraint_helpers  constraints_dat;
-
-  vrna_fold_compound_prepare(fc, VRNA_OPTION_MFE);
-
-  length  = fc->length;
-  so      = fc->strand_order;
-  ss      = fc->strand_start;
-  P       = fc->params;
-  md      = &(P->model_details);
-
-  /*
-   * do mfe folding to get fill arrays and get ground state energy
-   * in case dangles is neither 0 or 2, set dangles=2 while folding
-   */
+  (void)subopt_enumerate(fc, delta, VRNA_UNSORTED, 1, 0, 0, cb, data);
+}
 
-  circular    = md->circ;
-  logML       = md->logML;
-  old_dangles = dangle_model = md->dangles;
 
-  if (md->uniq_ML != 1) /* failsafe mechanism to enforce valid fM1 array */
-    md->uniq_ML = 1;
+PUBLIC unsigned long
+vrna_subopt_sorted_cb(vrna_fold_compound_t  *fc,
+                      int                   delta,
+                      int                   sorted,
+                      unsigned long         max_structures,
+                      size_t                max_memory,
+                      vrna_subopt_result_f  cb,
+                      void                  *data)
+{
+  if ((!fc) || (!cb))
+    return 0;
 
-  /* temporarily set dangles to 2 if necessary */
-  if ((md->dangles != 0) && (md->dangles != 2))
-    md->dangles = 2;
+  if (sorted == VRNA_UNSORTED)
+    sorted = VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC;
 
-  struc = (char *)vrna_alloc(sizeof(char) * (length + 1));
+  return subopt_enumerate(fc, delta, sorted, 1, max_structures, max_memory, cb, data);
+}
 
-  min_en = vrna_mfe(fc, struc);
 
-  /* restore dangle model */
-  md->dangles = old_dangles;
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
 
-  /* re-evaluate in case we're using logML etc */
-  min_en  = vrna_eval_structure(fc, struc);
-  f5      = fc->matrices->f5;
-  Fc      = fc->matrices->Fc;
+/*
+ *  The actual suboptimal structure enumeration. For unsorted output, partial
+ *  structures are processed depth-first from a stack. Otherwise, we process
+ *  them best-first from a priority queue ordered by their best attainable
+ *  energy. Since this energy is a lower bound for all structures that can be
+ *  derived from a partial structure, complete structures leave the queue in
+ *  ascending order of their energy and can be reported right away.
+ */
+PRIVATE unsigned long
+subopt_enumerate(vrna_fold_compound_t *fc,
+                 int                  delta,
+                 int                  sorted,
+                 int                  keep_order,
+                 unsigned long        max_structures,
+                 size_t               max_memory,
+                 vrna_subopt_result_f cb,
+                 void                 *data)
+{
+  subopt_env              *env;
+  STATE                   *state;
+  INTERVAL                *interval;
+  int                     maxlevel, partial_energy, length, pruned;
+  unsigned long           num_reported;
+  double                  structure_energy;
+  int                     *dos;
+  char                    *structure;
+  constraint_helpers      constraints_dat;
+  struct subopt_group     group;
+  struct subopt_settings  settings;
+
+  length = fc->length;
+
+  init_settings(fc, delta, &settings);
 
-  free(struc);
-  eprint = print_energy + min_en;
+#ifdef _OPENMP
+  /*
+   *  Without sorting, branches of the enumeration are independent of each other.
+   *  Energy re-evaluation is only safe for concurrent threads if we don't have
+   *  to (re-)prepare soft constraints though
+   */
+  if ((sorted == VRNA_UNSORTED) &&
+      (fc->params->model_details.num_threads > 1) &&
+      ((!keep_order) || (vrna_ostream_threadsafe())) &&
+      ((!fc->sc) || (!settings.logML && (settings.dangle_model != 1) &&
+                     (settings.dangle_model != 3))))
+    return subopt_enumerate_parallel(fc,
+                                     &settings,
+                                     fc->params->model_details.num_threads,
+                                     keep_order,
+                                     cb,
+                                     data);
 
-  correction = (min_en < 0) ? -0.1 : 0.1;
+#endif
 
   /* Initialize ------------------------------------------------------------ */
   init_constraint_helpers(fc, &constraints_dat);
 
+  /*
+   *  count into a buffer of our own, other enumerations may run
+   *  concurrently on the same global density of states
+   */
+  dos = (int *)vrna_alloc(sizeof(int) * (MAXDOS + 1));
+
   maxlevel        = 0;
-  count           = 0;
   partial_energy  = 0;
+  num_reported    = 0;
+  pruned          = 0;
 
   /* Initialize the stack ------------------------------------------------- */
 
-  minimal_energy  = (circular) ? Fc : f5[length];
-  threshold       = minimal_energy + delta;
-  if (threshold >= INF) {
-    vrna_message_warning("Energy range too high, limiting to reasonable value");
-    threshold = INF - EMAX;
-  }
-
   /* init env data structure */
   env             = (subopt_env *)vrna_alloc(sizeof(subopt_env));
   env->Stack      = NULL;
   env->nopush     = true;
   env->Stack      = make_list();                      /* anchor */
   env->Intervals  = make_list();                      /* initial state: */
+  env->fc         = fc;
+  env->heap       = NULL;
+  env->heap_size  = 0;
+  env->heap_max   = 0;
+  env->counter    = 0;
+  env->memory     = 0;
+
+  if (sorted != VRNA_UNSORTED) {
+    env->heap_max = 1024;
+    env->heap     = (STATE **)vrna_alloc(sizeof(STATE *) * env->heap_max);
+  }
+
+  group.entries     = NULL;
+  group.num         = 0;
+  group.size        = 0;
+  group.energy      = 0;
+  group.compressed  = !(fc->params->model_details.gquad);
+
   interval        = make_interval(1, length, 0);      /* interval [1,length,0] */
   push(env->Intervals, interval);
   env->nopush = false;
   state       = make_state(env->Intervals, NULL, partial_energy, 0, length);
   /* state->best_energy = minimal_energy; */
-  push(env->Stack, state);
+  push_state(env, state);
   env->nopush = false;
 
   /* end initialize ------------------------------------------------------- */
@@ -598,16 +832,21 @@ vrna_subopt_cb(vrna_fold_compound_t *fc,
   while (1) {
     /* forever, til nothing remains on stack */
 
-    maxlevel = (env->Stack->count > maxlevel ? env->Stack->count : maxlevel);
+    maxlevel = (num_states(env) > maxlevel ? num_states(env) : maxlevel);
 
-    if (LST_EMPTY(env->Stack)) {
+    if ((num_states(env) == 0) ||
+        ((max_structures > 0) && (num_reported >= max_structures))) {
       /*
        * we are done! clean up and quit
        * fprintf(stderr, "maxlevel: %d\n", maxlevel);
        */
+      num_reported += flush_group(&group, max_structures, num_reported, cb, data);
 
       lst_kill(env->Stack, free_state_node);
 
+      while (env->heap_size > 0)
+        free_state_node(env->heap[--(env->heap_size)]);
+
       cb(NULL, 0, data);   /* NULL (last time to call callback function */
 
       break;
@@ -615,87 +854,849 @@ vrna_subopt_cb(vrna_fold_compound_t *fc,
 
     /* pop the last element ---------------------------------------------- */
 
-    state = pop(env->Stack);                       /* current state to work with */
+    state = pop_state(env);                        /* current state to work with */
+
+    /*
+     * in best-first mode, all structures with the energy of the current group
+     * have been found as soon as the next state can not reach this energy anymore
+     */
+    if ((group.num > 0) && (state->best_energy > group.energy))
+      num_reported += flush_group(&group, max_structures, num_reported, cb, data);
 
     if (LST_EMPTY(state->Intervals)) {
-      int e;
       /* state has no intervals left: we got a solution */
+      structure = get_solution(fc, &settings, state, dos, &structure_energy);
 
-      count++;
-      structure         = get_structure(state);
-      structure_energy  = state->partial_energy / 100.;
-
-#ifdef CHECK_ENERGY
-      structure_energy = vrna_eval_structure(fc, structure);
-
-      if (!logML) {
-        if ((double)(state->partial_energy / 100.) != structure_energy) {
-          vrna_message_error("%s %6.2f %6.2f",
-                             structure,
-                             state->partial_energy / 100.,
-                             structure_energy);
-          exit(1);
+      if (structure) {
+        if (sorted == VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC) {
+          /* collect structures of equal energy to sort them lexicographically */
+          group_add(&group, structure, structure_energy, state->best_energy);
+        } else {
+          cb((const char *)structure, structure_energy, data);
+          free(structure);
+          num_reported++;
         }
       }
+    } else {
+      /* get (and remove) next interval of state to analyze */
+
+      interval = pop(state->Intervals);
+      scan_interval(fc,
+                    interval->i,
+                    interval->j,
+                    interval->array_flag,
+                    settings.threshold,
+                    state, env,
+                    &constraints_dat);
+
+      free_interval_node(interval);        /* free the current interval */
+
+      /*
+       * drop the partial structures with the highest energies if we exceed
+       * the memory limit. The energy band is reduced accordingly, such that
+       * all structures we report are still the lowest ones
+       */
+      if ((max_memory > 0) &&
+          (env->memory > max_memory) &&
+          (prune_states(env, &(settings.threshold))))
+        pruned = 1;
+    }
+
+    free_state_node(state);                     /* free the current state */
+  } /* end of while (1) */
+
+  if (pruned)
+    vrna_message_warning("vrna_subopt_sorted_cb(): memory limit reached, "
+                         "energy range reduced to %6.2f kcal/mol",
+                         (float)(settings.threshold - settings.minimal_energy) / 100.);
+
+  merge_density_of_states(dos);
+
+  /* cleanup memory */
+  free_constraint_helpers(&constraints_dat);
+
+  free(dos);
+  free(group.entries);
+  free(env->heap);
+  free(env);
+
+  return num_reported;
+}
+
+
+/*
+ *  Fill the DP matrices and determine the energy bounds of the enumeration
+ */
+PRIVATE void
+init_settings(vrna_fold_compound_t    *fc,
+              int                     delta,
+              struct subopt_settings  *settings)
+{
+  int       old_dangles, *f5;
+  char      *struc;
+  vrna_md_t *md;
+
+  vrna_fold_compound_prepare(fc, VRNA_OPTION_MFE);
+
+  md = &(fc->params->model_details);
+
+  /*
+   * do mfe folding to get fill arrays and get ground state energy
+   * in case dangles is neither 0 or 2, set dangles=2 while folding
+   */
+
+  settings->logML         = md->logML;
+  settings->dangle_model  = old_dangles = md->dangles;
+
+  if (md->uniq_ML != 1) /* failsafe mechanism to enforce valid fM1 array */
+    md->uniq_ML = 1;
+
+  /* temporarily set dangles to 2 if necessary */
+  if ((md->dangles != 0) && (md->dangles != 2))
+    md->dangles = 2;
+
+  struc = (char *)vrna_alloc(sizeof(char) * (fc->length + 1));
+
+  settings->min_en = vrna_mfe(fc, struc);
+
+  /* restore dangle model */
+  md->dangles = old_dangles;
+
+  /* re-evaluate in case we're using logML etc */
+  settings->min_en  = vrna_eval_structure(fc, struc);
+  f5                = fc->matrices->f5;
+
+  free(struc);
+  settings->eprint = print_energy + settings->min_en;
+
+  settings->correction = (settings->min_en < 0) ? -0.1 : 0.1;
+
+  settings->minimal_energy  = (md->circ) ? fc->matrices->Fc : f5[fc->length];
+  settings->threshold       = settings->minimal_energy + delta;
+  if (settings->threshold >= INF) {
+    vrna_message_warning("Energy range too high, limiting to reasonable value");
+    settings->threshold = INF - EMAX;
+  }
+}
+
+
+/*
+ *  Get the structure of a complete state, including strand delimiters.
+ *  Returns NULL if its energy exceeds the printing threshold
+ */
+PRIVATE char *
+get_solution(vrna_fold_compound_t   *fc,
+             struct subopt_settings *settings,
+             STATE                  *state,
+             int                    *dos,
+             double                 *energy)
+{
+  int   e;
+  char  *structure, *tmp;
+
+  structure = get_structure(state);
+  *energy   = state->partial_energy / 100.;
+
+#ifdef CHECK_ENERGY
+  *energy = vrna_eval_structure(fc, structure);
+
+  if (!settings->logML) {
+    if ((double)(state->partial_energy / 100.) != *energy) {
+      vrna_message_error("%s %6.2f %6.2f",
+                         structure,
+                         state->partial_energy / 100.,
+                         *energy);
+      exit(1);
+    }
+  }
 
 #endif
-      if (logML || (dangle_model == 1) || (dangle_model == 3)) /* recalc energy */
-        structure_energy = vrna_eval_structure(fc, structure);
+  if (settings->logML || (settings->dangle_model == 1) || (settings->dangle_model == 3)) /* recalc energy */
+    *energy = vrna_eval_structure(fc, structure);
+
+  e = (int)((*energy - settings->min_en) * 10. - settings->correction); /* avoid rounding errors */
+  if (e > MAXDOS)
+    e = MAXDOS;
 
-      e = (int)((structure_energy - min_en) * 10. - correction); /* avoid rounding errors */
-      if (e > MAXDOS)
-        e = MAXDOS;
+  dos[e]++;
 
-      density_of_states[e]++;
+  if (*energy > settings->eprint) {
+    free(structure);
+    return NULL;
+  }
 
-      if (structure_energy <= eprint) {
-        char  *outstruct = NULL;
-        char  *tmp_struct = strdup(structure);
+  for (unsigned int i = 1; i < fc->strands; i++) {
+    tmp = vrna_cut_point_insert(structure, (int)fc->strand_start[i] + (i - 1));
+    free(structure);
+    structure = tmp;
+  }
 
-        if (fc->strands == 1) {
-          outstruct = tmp_struct;
-        } else {
-          for (unsigned int i = 1; i < fc->strands; i++) {
-            outstruct = vrna_cut_point_insert(tmp_struct, (int)fc->strand_start[i] + (i - 1));
-            free(tmp_struct);
-            tmp_struct = outstruct;
-          }
+  return structure;
+}
+
+
+/*
+ *  Add the counts of a single enumeration to the global density of states
+ */
+PRIVATE void
+merge_density_of_states(const int *dos)
+{
+  int k;
+
+  for (k = 0; k <= MAXDOS; k++)
+    if (dos[k])
+      __atomic_fetch_add(&(density_of_states[k]), dos[k], __ATOMIC_RELAXED);
+}
+
+
+#ifdef _OPENMP
+
+/*
+ *  Split the enumeration into independent branches, i.e. partial structures,
+ *  listed in the order a single thread would process them. Branches are
+ *  expanded breadth-first until we have at least num_branches of them.
+ *  Complete structures remain branches of their own.
+ */
+PRIVATE STATE **
+split_enumeration(vrna_fold_compound_t    *fc,
+                  struct subopt_settings  *settings,
+                  size_t                  num_branches,
+                  size_t                  *num_tasks)
+{
+  int                 expanded;
+  size_t              k, n, m, size;
+  STATE               **tasks, **next, *state;
+  INTERVAL            *interval;
+  LIST                *intervals;
+  subopt_env          *env;
+  constraint_helpers  constraints_dat;
+
+  init_constraint_helpers(fc, &constraints_dat);
+  env = get_stack_env(fc);
+
+  intervals = make_list();
+  push(intervals, make_interval(1, fc->length, 0));
+
+  size      = num_branches;
+  tasks     = (STATE **)vrna_alloc(sizeof(STATE *) * size);
+  tasks[0]  = make_state(intervals, NULL, 0, 0, fc->length);
+  n         = 1;
+
+  do {
+    expanded  = 0;
+    next      = (STATE **)vrna_alloc(sizeof(STATE *) * size);
+
+    for (m = k = 0; k < n; k++) {
+      state = tasks[k];
+
+      if ((m + n - k >= num_branches) ||
+          (LST_EMPTY(state->Intervals))) {
+        if (m == size) {
+          size  *= 2;
+          next  = (STATE **)vrna_realloc(next, sizeof(STATE *) * size);
         }
-        cb((const char *)tmp_struct, structure_energy, data);
-        free(tmp_struct);
-      }
 
-      free(structure);
-    } else {
-      /* get (and remove) next interval of state to analyze */
+        next[m++] = state;
+        continue;
+      }
 
       interval = pop(state->Intervals);
       scan_interval(fc,
                     interval->i,
                     interval->j,
                     interval->array_flag,
-                    threshold,
+                    settings->threshold,
                     state, env,
                     &constraints_dat);
+      free_interval_node(interval);
+      free_state_node(state);
+
+      /* the top of the stack is processed first */
+      while (!LST_EMPTY(env->Stack)) {
+        if (m == size) {
+          size  *= 2;
+          next  = (STATE **)vrna_realloc(next, sizeof(STATE *) * size);
+        }
 
-      free_interval_node(interval);        /* free the current interval */
+        next[m++] = (STATE *)pop(env->Stack);
+      }
+
+      expanded = 1;
     }
 
-    free_state_node(state);                     /* free the current state */
-  } /* end of while (1) */
+    free(tasks);
+    tasks = next;
+    n     = m;
+  } while ((expanded) && (n < num_branches));
 
-  /* cleanup memory */
+  free_stack_env(env);
   free_constraint_helpers(&constraints_dat);
 
+  *num_tasks = n;
+
+  return tasks;
+}
+
+
+/*
+ *  Enumerate suboptimal structures with multiple threads. For ordered output,
+ *  each thread processes entire branches as obtained from split_enumeration()
+ *  and the structures of each branch are passed to the callback in the order
+ *  of the branches through an ordered output stream. Otherwise, the branches
+ *  are distributed among the threads right away and threads that run out of
+ *  work steal the oldest partial structure from the stack of another thread.
+ *  In both cases, the callback is never executed concurrently.
+ */
+PRIVATE unsigned long
+subopt_enumerate_parallel(vrna_fold_compound_t    *fc,
+                          struct subopt_settings  *settings,
+                          int                     num_threads,
+                          int                     keep_order,
+                          vrna_subopt_result_f    cb,
+                          void                    *data)
+{
+  size_t                num_tasks;
+  unsigned long         num_reported;
+  STATE                 **tasks;
+  vrna_ostream_t        queue;
+  struct subopt_output  output;
+  struct subopt_pool    pool;
+
+  num_reported  = 0;
+  output.cb     = cb;
+  output.data   = data;
+  queue         = NULL;
+
+  tasks = split_enumeration(fc,
+                            settings,
+                            (size_t)num_threads * SUBOPT_BRANCHES_PER_THREAD,
+                            &num_tasks);
+
+  if (keep_order)
+    queue = vrna_ostream_init(&flush_buffer, (void *)&output);
+
+  pool.states       = (STATE **)vrna_alloc(sizeof(STATE *) * num_threads);
+  pool.num          = 0;
+  pool.idle         = 0;
+  pool.num_threads  = num_threads;
+  omp_init_lock(&(pool.lock));
+
+#pragma omp parallel num_threads(num_threads) reduction(+:num_reported)
+  {
+    int                   t, thread, *dos;
+    subopt_env            *env;
+    constraint_helpers    constraints_dat;
+    struct subopt_buffer  *buffer;
+
+    dos = (int *)vrna_alloc(sizeof(int) * (MAXDOS + 1));
+    env = get_stack_env(fc);
+    init_constraint_helpers(fc, &constraints_dat);
+
+#pragma omp single
+    pool.num_threads = omp_get_num_threads();
+
+    if (keep_order) {
+#pragma omp for schedule(dynamic, 1)
+      for (t = 0; t < (int)num_tasks; t++) {
+        vrna_ostream_request(queue, (unsigned int)t);
+
+        buffer = (struct subopt_buffer *)vrna_alloc(sizeof(struct subopt_buffer));
+        push(env->Stack, tasks[t]);
+        num_reported += process_states(fc, settings, env, &constraints_dat, dos, NULL, buffer, NULL);
+
+        vrna_ostream_provide(queue, (unsigned int)t, (void *)buffer);
+      }
+    } else {
+      /* let each thread start with the first of the branches it is assigned to */
+      thread = omp_get_thread_num();
+      for (t = (int)num_tasks - 1; t >= 0; t--)
+        if (t % pool.num_threads == thread)
+          push(env->Stack, tasks[t]);
+
+      num_reported += process_states(fc, settings, env, &constraints_dat, dos, &pool, NULL, &output);
+    }
+
+    merge_density_of_states(dos);
+
+    free_constraint_helpers(&constraints_dat);
+    free_stack_env(env);
+    free(dos);
+  }
+
+  vrna_ostream_free(queue);
+  omp_destroy_lock(&(pool.lock));
+  free(pool.states);
+  free(tasks);
+
+  cb(NULL, 0, data);   /* NULL (last time to call callback function */
+
+  return num_reported;
+}
+
+
+/*
+ *  Process partial structures from the stack of env until it is empty. If a
+ *  work pool is given, we steal work from other threads as soon as we run out
+ *  of partial structures and hand over our oldest partial structure to other
+ *  threads that run out of work. Complete structures are collected in buffer,
+ *  if given, or passed to the output callback otherwise.
+ */
+PRIVATE unsigned long
+process_states(vrna_fold_compound_t   *fc,
+               struct subopt_settings *settings,
+               subopt_env             *env,
+               constraint_helpers     *constraints_dat,
+               int                    *dos,
+               struct subopt_pool     *pool,
+               struct subopt_buffer   *buffer,
+               struct subopt_output   *output)
+{
+  unsigned long num_reported;
+  double        structure_energy;
+  char          *structure;
+  STATE         *state;
+  INTERVAL      *interval;
+
+  num_reported = 0;
+
+  while (1) {
+    if (!LST_EMPTY(env->Stack))
+      state = (STATE *)pop(env->Stack);
+    else if ((!pool) || (!(state = steal_state(pool))))
+      break;
+
+    if (LST_EMPTY(state->Intervals)) {
+      structure = get_solution(fc, settings, state, dos, &structure_energy);
+
+      if (structure) {
+        if (buffer) {
+          buffer_add(buffer, structure, structure_energy);
+        } else {
+#pragma omp critical (subopt_output)
+          output->cb((const char *)structure, structure_energy, output->data);
+          free(structure);
+        }
+
+        num_reported++;
+      }
+    } else {
+      interval = pop(state->Intervals);
+      scan_interval(fc,
+                    interval->i,
+                    interval->j,
+                    interval->array_flag,
+                    settings->threshold,
+                    state, env,
+                    constraints_dat);
+
+      free_interval_node(interval);
+    }
+
+    free_state_node(state);
+
+    if ((pool) && (env->Stack->count > 1))
+      share_state(pool, env->Stack);
+  }
+
+  return num_reported;
+}
+
+
+PRIVATE STATE *
+steal_state(struct subopt_pool *pool)
+{
+  int   done;
+  STATE *state;
+
+  state = NULL;
+  done  = 0;
+
+  omp_set_lock(&(pool->lock));
+#pragma omp atomic update
+  pool->idle++;
+  omp_unset_lock(&(pool->lock));
+
+  /* wait until another thread shares work, or all threads are out of work */
+  while ((!state) && (!done)) {
+    omp_set_lock(&(pool->lock));
+
+    if (pool->num > 0) {
+      state = pool->states[--(pool->num)];
+#pragma omp atomic update
+      pool->idle--;
+    } else if (pool->idle == pool->num_threads) {
+      done = 1;
+    }
+
+    omp_unset_lock(&(pool->lock));
+  }
+
+  return state;
+}
+
+
+PRIVATE void
+share_state(struct subopt_pool  *pool,
+            LIST                *stack)
+{
+  int   idle, wanted;
+  void  *prev, *node;
+
+#pragma omp atomic read
+  idle = pool->idle;
+
+  if (idle == 0)
+    return;
+
+  omp_set_lock(&(pool->lock));
+  wanted = (pool->num < (size_t)pool->idle);
+  omp_unset_lock(&(pool->lock));
+
+  if (!wanted)
+    return;
+
+  /* the bottom of our stack holds the partial structure with the largest branch */
+  prev = LST_HEAD(stack);
+  for (node = lst_first(stack); lst_next(node); node = lst_next(node))
+    prev = node;
+
+  node = lst_deletenext(stack, prev);
+
+  omp_set_lock(&(pool->lock));
+  pool->states[pool->num++] = (STATE *)node;
+  omp_unset_lock(&(pool->lock));
+}
+
+
+PRIVATE void
+buffer_add(struct subopt_buffer *buffer,
+           char                 *structure,
+           double               energy)
+{
+  if (buffer->num == buffer->size) {
+    buffer->size        = (buffer->size) ? 2 * buffer->size : 16;
+    buffer->structures  = (char **)vrna_realloc(buffer->structures,
+                                                sizeof(char *) * buffer->size);
+    buffer->energies = (float *)vrna_realloc(buffer->energies,
+                                             sizeof(float) * buffer->size);
+  }
+
+  buffer->structures[buffer->num] = structure;
+  buffer->energies[buffer->num++] = (float)energy;
+}
+
+
+PRIVATE void
+flush_buffer(void         *auxdata,
+             unsigned int i,
+             void         *data)
+{
+  unsigned long         k;
+  struct subopt_output  *output = (struct subopt_output *)auxdata;
+  struct subopt_buffer  *buffer = (struct subopt_buffer *)data;
+
+  for (k = 0; k < buffer->num; k++) {
+    output->cb((const char *)buffer->structures[k], buffer->energies[k], output->data);
+    free(buffer->structures[k]);
+  }
+
+  free(buffer->structures);
+  free(buffer->energies);
+  free(buffer);
+}
+
+
+PRIVATE subopt_env *
+get_stack_env(vrna_fold_compound_t *fc)
+{
+  subopt_env *env;
+
+  env         = (subopt_env *)vrna_alloc(sizeof(subopt_env));
+  env->Stack  = make_list();
+  env->nopush = false;
+  env->fc     = fc;
+
+  return env;
+}
+
+
+PRIVATE void
+free_stack_env(subopt_env *env)
+{
+  lst_kill(env->Stack, free_state_node);
   free(env);
 }
 
 
+#endif
+
+
+PRIVATE int
+num_states(subopt_env *env)
+{
+  return (env->heap) ? (int)env->heap_size : env->Stack->count;
+}
+
+
+PRIVATE size_t
+state_memory(STATE *state,
+             int   length)
+{
+  /* approximate memory occupied by a partial structure */
+  return sizeof(STATE) + sizeof(STATE *) + sizeof(LIST) + (size_t)(length + 1) +
+         (size_t)state->Intervals->count * (sizeof(INTERVAL) + 2 * sizeof(void *));
+}
+
+
+PRIVATE INLINE int
+state_less(STATE  *a,
+           STATE  *b)
+{
+  /* prefer the most recent state among those of equal energy to keep the queue short */
+  if (a->best_energy != b->best_energy)
+    return a->best_energy < b->best_energy;
+
+  return a->order > b->order;
+}
+
+
+PRIVATE void
+push_state(subopt_env *env,
+           STATE      *state)
+{
+  size_t  k, p;
+  STATE   **heap;
+
+  if (!env->heap) {
+    push(env->Stack, state);
+    return;
+  }
+
+  state->best_energy  = best_attainable_energy(env->fc, state);
+  state->order        = env->counter++;
+
+  if (env->heap_size == env->heap_max) {
+    env->heap_max *= 2;
+    env->heap     = (STATE **)vrna_realloc(env->heap, sizeof(STATE *) * env->heap_max);
+  }
+
+  heap = env->heap;
+
+  /* sift up */
+  for (k = env->heap_size++; k > 0; k = p) {
+    p = (k - 1) / 2;
+    if (!state_less(state, heap[p]))
+      break;
+
+    heap[k] = heap[p];
+  }
+
+  heap[k] = state;
+
+  env->memory += state_memory(state, (int)env->fc->length);
+}
+
+
+PRIVATE STATE *
+pop_state(subopt_env *env)
+{
+  size_t  k, c, n;
+  STATE   *top, *last, **heap;
+
+  if (!env->heap)
+    return pop(env->Stack);
+
+  heap  = env->heap;
+  top   = heap[0];
+  n     = --(env->heap_size);
+  last  = heap[n];
+
+  /* sift down */
+  for (k = 0; (c = 2 * k + 1) < n; k = c) {
+    if ((c + 1 < n) && (state_less(heap[c + 1], heap[c])))
+      c++;
+
+    if (!state_less(heap[c], last))
+      break;
+
+    heap[k] = heap[c];
+  }
+
+  if (n > 0)
+    heap[k] = last;
+
+  env->memory -= state_memory(top, (int)env->fc->length);
+
+  return top;
+}
+
+
+PRIVATE int
+compare_int(const void  *a,
+            const void  *b)
+{
+  int p = *((const int *)a);
+  int q = *((const int *)b);
+
+  return (p > q) - (p < q);
+}
+
+
 /*
- #####################################
- # BEGIN OF STATIC HELPER FUNCTIONS  #
- #####################################
+ *  Remove (roughly) the upper half of partial structures in terms of their
+ *  best attainable energy from the priority queue and lower the threshold
+ *  such that only structures strictly below the lowest removed energy are
+ *  enumerated further. Returns 0 if nothing could be removed.
  */
+PRIVATE int
+prune_states(subopt_env *env,
+             int        *threshold)
+{
+  size_t  k, n, m;
+  int     *energies, cutoff, lowest;
+  STATE   *state;
+
+  n = env->heap_size;
+  if (n < 2)
+    return 0;
+
+  energies = (int *)vrna_alloc(sizeof(int) * n);
+  for (k = 0; k < n; k++)
+    energies[k] = env->heap[k]->best_energy;
+
+  qsort(energies, n, sizeof(int), &compare_int);
+
+  lowest  = energies[0];
+  cutoff  = energies[n / 2];
+
+  /* we need to keep at least the states of lowest energy */
+  if (cutoff == lowest) {
+    for (k = n / 2; (k < n) && (energies[k] == lowest); k++);
+    cutoff = (k < n) ? energies[k] : lowest;
+  }
+
+  free(energies);
+
+  if (cutoff == lowest)
+    return 0;
+
+  /* remove all states that can not reach an energy below the cutoff */
+  for (k = m = 0; k < n; k++) {
+    state = env->heap[k];
+    if (state->best_energy >= cutoff) {
+      env->memory -= state_memory(state, (int)env->fc->length);
+      free_state_node(state);
+    } else {
+      env->heap[m++] = state;
+    }
+  }
+
+  /* restore heap property */
+  env->heap_size = 0;
+  for (k = 0; k < m; k++) {
+    state = env->heap[k];
+    for (n = env->heap_size++; n > 0; n = (n - 1) / 2) {
+      if (!state_less(state, env->heap[(n - 1) / 2]))
+        break;
+
+      env->heap[n] = env->heap[(n - 1) / 2];
+    }
+    env->heap[n] = state;
+  }
+
+  *threshold = MIN2(*threshold, cutoff - 1);
+
+  return 1;
+}
+
+
+PRIVATE void
+group_add(struct subopt_group *group,
+          char                *structure,
+          double              energy,
+          int                 key)
+{
+  char **tok, *s;
+
+  if (group->num == group->size) {
+    group->size     = (group->size) ? 2 * group->size : 64;
+    group->entries  = (struct subopt_group_entry *)vrna_realloc(group->entries,
+                                                                sizeof(struct subopt_group_entry) *
+                                                                group->size);
+  }
+
+  group->entries[group->num].structure  = structure;
+  group->entries[group->num].key        = NULL;
+  group->entries[group->num].energy     = (float)energy;
+
+  /* vrna_subopt() sorts compressed structures without strand delimiters, so do we */
+  if (group->compressed) {
+    tok = vrna_strsplit(structure, NULL);
+    s   = vrna_strjoin((const char **)tok, NULL);
+
+    for (char **ptr = tok; *ptr != NULL; ptr++)
+      free(*ptr);
+    free(tok);
+
+    group->entries[group->num].key = vrna_db_pack(s);
+    free(s);
+  }
+
+  group->num++;
+  group->energy = key;
+}
+
+
+PRIVATE int
+compare_group_entries(const void  *a,
+                      const void  *b)
+{
+  const struct subopt_group_entry *p, *q;
+
+  p = (const struct subopt_group_entry *)a;
+  q = (const struct subopt_group_entry *)b;
+
+  if (p->energy > q->energy)
+    return 1;
+
+  if (p->energy < q->energy)
+    return -1;
+
+  return strcmp((p->key) ? p->key : p->structure,
+                (q->key) ? q->key : q->structure);
+}
+
+
+PRIVATE unsigned long
+flush_group(struct subopt_group   *group,
+            unsigned long         max_structures,
+            unsigned long         num_reported,
+            vrna_subopt_result_f  cb,
+            void                  *data)
+{
+  unsigned long i, n;
+
+  if (group->num == 0)
+    return 0;
+
+  qsort(group->entries, group->num, sizeof(struct subopt_group_entry), &compare_group_entries);
+
+  for (n = i = 0; i < group->num; i++) {
+    if ((max_structures == 0) || (num_reported + n < max_structures)) {
+      cb((const char *)group->entries[i].structure, group->entries[i].energy, data);
+      n++;
+    }
+
+    free(group->entries[i].structure);
+    free(group->entries[i].key);
+  }
+
+  group->num = 0;
+
+  return n;
+}
+
+
 PRIVATE void
 init_constraint_helpers(vrna_fold_compound_t  *fc,
                         constraint_helpers    *d)
@@ -968,10 +1969,10 @@ best_attainable_energy(vrna_fold_compound_t *fc,
 
 
 PRIVATE void
-push_back(LIST  *Stack,
-          STATE *state)
+push_back(subopt_env  *env,
+          STATE       *state)
 {
-  push(Stack, copy_state(state));
+  push_state(env, copy_state(state));
   return;
 }
 
@@ -1072,7 +2073,7 @@ fork_state(int        i,
 {
   STATE *s_new = derive_new_state(i, j, s, e, flag);
 
-  push(env->Stack, s_new);
+  push_state(env, s_new);
   env->nopush = false;
 }
 
@@ -1090,7 +2091,7 @@ fork_int_state(int        i,
 
   make_pair(i, j, s_new);
   make_pair(p, q, s_new);
-  push(env->Stack, s_new);
+  push_state(env, s_new);
   env->nopush = false;
 }
 
@@ -1107,7 +2108,7 @@ fork_state_pair(int         i,
   new_state = copy_state(s);
   make_pair(i, j, new_state);
   new_state->partial_energy += e;
-  push(env->Stack, new_state);
+  push_state(env, new_state);
   env->nopush = false;
 }
 
@@ -1140,7 +2141,7 @@ fork_two_states_pair(int        i,
   make_pair(i, j, new_state);
   new_state->partial_energy += e;
 
-  push(env->Stack, new_state);
+  push_state(env, new_state);
   env->nopush = false;
 }
 
@@ -1165,7 +2166,7 @@ fork_state_pair_interval(int        i,
   make_pair(i, j, new_state);
   new_state->partial_energy += e;
 
-  push(env->Stack, new_state);
+  push_state(env, new_state);
   env->nopush = false;
 }
 
@@ -1191,7 +2192,7 @@ fork_two_states_pair_ms(int         i,
   make_pair(i, j, new_state);
   new_state->partial_energy += e;
 
-  push(env->Stack, new_state);
+  push_state(env, new_state);
   env->nopush = false;
 }
 
@@ -1224,7 +2225,7 @@ fork_two_states(int         i,
 
   new_state->partial_energy += e;
 
-  push(env->Stack, new_state);
+  push_state(env, new_state);
   env->nopush = false;
 }
 
@@ -1281,7 +2282,7 @@ scan_interval(vrna_fold_compound_t  *fc,
   }
 
   if (env->nopush) {
-    push_back(env->Stack, state);
+    push_back(env, state);
     env->nopush = false;
   }
 }
@@ -1338,7 +2339,7 @@ scan_mb(vrna_fold_compound_t  *fc,
   if ((j < i + 1) &&
       (sn[i] == so[j])) {
     if (env->nopush) {
-      push_back(env->Stack, state);
+      push_back(env, state);
       env->nopush = false;
     }
 
@@ -1540,7 +2541,7 @@ scan_m1(vrna_fold_compound_t  *fc,
   if ((j < i + 1) &&
       (sn[i] == so[j])) {
     if (env->nopush) {
-      push_back(env->Stack, state);
+      push_back(env, state);
       env->nopush = false;
     }
 
@@ -1648,7 +2649,7 @@ scan_pair(vrna_fold_compound_t  *fc,
   if ((j < i + 1) &&
       (sn[i] == sn[j])) {
     if (env->nopush) {
-      push_back(env->Stack, state);
+      push_back(env, state);
       env->nopush = false;
     }
 
@@ -1741,7 +2742,7 @@ scan_ext(vrna_fold_compound_t *fc,
     state->partial_energy += f5[j];
 
     if (env->nopush) {
-      push_back(env->Stack, state);
+      push_back(env, state);
       env->nopush = false;
     }
 
@@ -1969,7 +2970,7 @@ scan_circular(vrna_fold_compound_t  *fc,
     state->partial_energy += Fc;
 
     if (env->nopush) {
-      push_back(env->Stack, state);
+      push_back(env, state);
       env->nopush = false;
     }
 
@@ -1997,7 +2998,7 @@ scan_circular(vrna_fold_compound_t  *fc,
     if (tmp_en <= threshold) {
       new_state                 = derive_new_state(1, 2, state, 0, 0);
       new_state->partial_energy = 0;
-      push(env->Stack, new_state);
+      push_state(env, new_state);
       env->nopush = false;
     }
   }
@@ -2159,7 +3160,7 @@ scan_circular(vrna_fold_compound_t  *fc,
                 /* mmh, we add the energy for closing the multiloop now... */
                 new_state->partial_energy += P->MLclosing;
                 /* next we push our state onto the R stack */
-                push(env->Stack, new_state);
+                push_state(env, new_state);
                 env->nopush = false;
               }
             }
@@ -2231,7 +3232,7 @@ scan_fms5(vrna_fold_compound_t  *fc,
     state->partial_energy += fms5[strand][i];
 
     if (env->nopush) {
-      push_back(env->Stack, state);
+      push_back(env, state);
       env->nopush = false;
     }
 
@@ -2435,7 +3436,7 @@ scan_fms3(vrna_fold_compound_t  *fc,
     state->partial_energy += fms3[strand][i];
 
     if (env->nopush) {
-      push_back(env->Stack, state);
+      push_back(env, state);
       env->nopush = false;
     }
 
@@ -2659,7 +3660,7 @@ repeat_gquad(vrna_fold_compound_t *fc,
         new_state->partial_energy += E_gquad(L[cnt], &(l[3*cnt]), P);
         /* new_state->best_energy =
          * hairpin[unpaired] + element_energy + best_energy; */
-        push(env->Stack, new_state);
+        push_state(env, new_state);
         env->nopush = false;
       }
       free(L);
@@ -2782,7 +3783,7 @@ repeat(vrna_fold_compound_t *fc,
       make_pair(i + 1, j - 1, new_state);
 
       /* new_state->best_energy = new + best_energy; */
-      push(env->Stack, new_state);
+      push_state(env, new_state);
       env->nopush = false;
       if (i == 1 || state->structure[i - 2] != '(' || state->structure[j] != ')')
         /* adding a stack is the only possible structure */
@@ -3021,7 +4022,7 @@ repeat(vrna_fold_compound_t *fc,
           make_pair(i, j, new_state);
 
           /* new_state->best_energy = new + best_energy; */
-          push(env->Stack, new_state);
+          push_state(env, new_state);
           env->nopush = false;
         }
       }
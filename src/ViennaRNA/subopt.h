@@ -161,6 +161,11 @@ vrna_subopt(vrna_fold_compound_t  *fc,
  * vrna_fold_compound_t *fc=vrna_fold_compound("GGGGGGAAAAAACCCCCC", &md, VRNA_OPTION_DEFAULT);
  *        @endcode
  *
+ *  @note If #vrna_md_t.num_threads > 1 and RNAlib was compiled with OpenMP support,
+ *        independent branches of the enumeration are processed by multiple threads.
+ *        The structures are still passed to the callback in the same order as for
+ *        a single thread and the callback is never executed concurrently.
+ *
  *  @see vrna_subopt_result_f, vrna_subopt(), vrna_subopt_zuker()
  *
  *  @param  fc      fold compount with the sequence data
@@ -175,6 +180,57 @@ vrna_subopt_cb(vrna_fold_compound_t *fc,
                void                 *data);
 
 
+/**
+ *  @brief  Generate suboptimal structures within an energy band arround the MFE in ascending order of their energies
+ *
+ *  Identical to vrna_subopt_cb(), this function computes all secondary structures
+ *  within an energy band @p delta arround the MFE and passes them to the callback
+ *  @p cb. However, the structures are enumerated best-first, i.e. partial structures
+ *  are processed in order of the lowest free energy they can attain. Thus, the
+ *  structures are passed to the callback in ascending order of their free energies
+ *  right after they have been backtracked, without storing and sorting all of them
+ *  first. Structures of equal free energy are passed in lexicographic order if
+ *  @p sorted is #VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC.
+ *
+ *  Two limits may be applied to the enumeration. First, @p max_structures stops the
+ *  enumeration as soon as the specified number of structures has been passed to the
+ *  callback, i.e. the @p max_structures structures of lowest free energy within the
+ *  energy band. Second, @p max_memory limits the (approximate) number of bytes occupied
+ *  by the partial structures that still await processing. Whenever this limit is exceeded,
+ *  the partial structures that can attain the highest free energies are discarded and the
+ *  energy band is reduced accordingly, such that all structures passed to the callback
+ *  are still the ones of lowest free energy. A warning that states the reduced energy band
+ *  is issued in that case. A value of 0 disables the respective limit.
+ *
+ *  @ingroup subopt_wuchty
+ *
+ *  @note If the free energies of the structures need to be re-evaluated after
+ *        backtracking, e.g. for the logarithmic multibranch loop model or the
+ *        dangle models 1 and 3, the structures are enumerated in order of their
+ *        free energies according to the dangle model 2 and linear multibranch
+ *        loop energies.
+ *
+ *  @see vrna_subopt_result_f, vrna_subopt_cb(), vrna_subopt()
+ *
+ *  @param  fc              fold compount with the sequence data
+ *  @param  delta           Energy band arround the MFE in 10cal/mol, i.e. deka-calories
+ *  @param  sorted          Order of structures with equal free energy, i.e. #VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC or #VRNA_SORT_BY_ENERGY_ASC
+ *  @param  max_structures  Maximum number of structures to enumerate (0 = unlimited)
+ *  @param  max_memory      Maximum memory in bytes for partial structures (0 = unlimited)
+ *  @param  cb              Pointer to a callback function that handles the backtracked structure and its free energy in kcal/mol
+ *  @param  data            Pointer to some data structure that is passed along to the callback
+ *  @return                 The number of structures passed to the callback
+ */
+unsigned long
+vrna_subopt_sorted_cb(vrna_fold_compound_t  *fc,
+                      int                   delta,
+                      int                   sorted,
+                      unsigned long         max_structures,
+                      size_t                max_memory,
+                      vrna_subopt_result_f  cb,
+                      void                  *data);
+
+
 /**
  *  @brief printing threshold for use with logML
  *
@@ -8,6 +8,7 @@
 
 #include "ViennaRNA/utils/basic.h"
 #include "ViennaRNA/utils/cpu.h"
+#include "ViennaRNA/utils/higher_order_functions.h"
 
 
 typedef int (*proto_fun_zip_reduce)(const int  *a,
@@ -15,6 +16,17 @@ typedef int (*proto_fun_zip_reduce)(const int  *a,
                                     int        size);
 
 
+typedef int (*proto_fun_zip_reduce_arg)(const int  *a,
+                                        const int  *b,
+                                        int        size,
+                                        int        *pos);
+
+
+typedef FLT_OR_DBL (*proto_fun_zip_reduce_pf)(const FLT_OR_DBL  *a,
+                                              const FLT_OR_DBL  *b,
+                                              int               size);
+
+
 /*
  #################################
  # PRIVATE FUNCTION DECLARATIONS #
@@ -26,12 +38,50 @@ zip_add_min_dispatcher(const int  *a,
                        int        size);
 
 
+static int
+zip_add_argmin_dispatcher(const int *a,
+                          const int *b,
+                          int       size,
+                          int       *pos);
+
+
+static FLT_OR_DBL
+zip_mul_sum_dispatcher(const FLT_OR_DBL *a,
+                       const FLT_OR_DBL *b,
+                       int              size);
+
+
+static FLT_OR_DBL
+zip_mul_sum_rev_dispatcher(const FLT_OR_DBL *a,
+                           const FLT_OR_DBL *b,
+                           int              size);
+
+
 static int
 fun_zip_add_min_default(const int *e1,
                         const int *e2,
                         int       count);
 
 
+static int
+fun_zip_add_argmin_default(const int  *e1,
+                           const int  *e2,
+                           int        count,
+                           int        *pos);
+
+
+static FLT_OR_DBL
+fun_zip_mul_sum_default(const FLT_OR_DBL  *e1,
+                        const FLT_OR_DBL  *e2,
+                        int               count);
+
+
+static FLT_OR_DBL
+fun_zip_mul_sum_rev_default(const FLT_OR_DBL  *e1,
+                            const FLT_OR_DBL  *e2,
+                            int               count);
+
+
 #if VRNA_WITH_SIMD_AVX512
 int
 vrna_fun_zip_add_min_avx512(const int *e1,
@@ -39,6 +89,34 @@ vrna_fun_zip_add_min_avx512(const int *e1,
                             int       count);
 
 
+#endif
+
+#if VRNA_WITH_SIMD_AVX2
+int
+vrna_fun_zip_add_min_avx2(const int *e1,
+                          const int *e2,
+                          int       count);
+
+
+int
+vrna_fun_zip_add_argmin_avx2(const int  *e1,
+                             const int  *e2,
+                             int        count,
+                             int        *pos);
+
+
+FLT_OR_DBL
+vrna_fun_zip_mul_sum_avx2(const FLT_OR_DBL  *e1,
+                          const FLT_OR_DBL  *e2,
+                          int               count);
+
+
+FLT_OR_DBL
+vrna_fun_zip_mul_sum_rev_avx2(const FLT_OR_DBL  *e1,
+                              const FLT_OR_DBL  *e2,
+                              int               count);
+
+
 #endif
 
 #if VRNA_WITH_SIMD_SSE41
@@ -51,7 +129,10 @@ vrna_fun_zip_add_min_sse41(const int  *e1,
 #endif
 
 
-static proto_fun_zip_reduce fun_zip_add_min = &zip_add_min_dispatcher;
+static proto_fun_zip_reduce     fun_zip_add_min     = &zip_add_min_dispatcher;
+static proto_fun_zip_reduce_arg fun_zip_add_argmin  = &zip_add_argmin_dispatcher;
+static proto_fun_zip_reduce_pf  fun_zip_mul_sum     = &zip_mul_sum_dispatcher;
+static proto_fun_zip_reduce_pf  fun_zip_mul_sum_rev = &zip_mul_sum_rev_dispatcher;
 
 
 /*
@@ -62,14 +143,20 @@ static proto_fun_zip_reduce fun_zip_add_min = &zip_add_min_dispatcher;
 PUBLIC void
 vrna_fun_dispatch_disable(void)
 {
-  fun_zip_add_min = &fun_zip_add_min_default;
+  fun_zip_add_min     = &fun_zip_add_min_default;
+  fun_zip_add_argmin  = &fun_zip_add_argmin_default;
+  fun_zip_mul_sum     = &fun_zip_mul_sum_default;
+  fun_zip_mul_sum_rev = &fun_zip_mul_sum_rev_default;
 }
 
 
 PUBLIC void
 vrna_fun_dispatch_enable(void)
 {
-  fun_zip_add_min = &zip_add_min_dispatcher;
+  fun_zip_add_min     = &zip_add_min_dispatcher;
+  fun_zip_add_argmin  = &zip_add_argmin_dispatcher;
+  fun_zip_mul_sum     = &zip_mul_sum_dispatcher;
+  fun_zip_mul_sum_rev = &zip_mul_sum_rev_dispatcher;
 }
 
 
@@ -82,6 +169,34 @@ vrna_fun_zip_add_min(const int  *e1,
 }
 
 
+PUBLIC int
+vrna_fun_zip_add_argmin(const int *e1,
+                        const int *e2,
+                        int       count,
+                        int       *pos)
+{
+  return (*fun_zip_add_argmin)(e1, e2, count, pos);
+}
+
+
+PUBLIC FLT_OR_DBL
+vrna_fun_zip_mul_sum(const FLT_OR_DBL *e1,
+                     const FLT_OR_DBL *e2,
+                     int              count)
+{
+  return (*fun_zip_mul_sum)(e1, e2, count);
+}
+
+
+PUBLIC FLT_OR_DBL
+vrna_fun_zip_mul_sum_rev(const FLT_OR_DBL *e1,
+                         const FLT_OR_DBL *e2,
+                         int              count)
+{
+  return (*fun_zip_mul_sum_rev)(e1, e2, count);
+}
+
+
 /*
  #################################
  # STATIC helper functions below #
@@ -104,6 +219,14 @@ zip_add_min_dispatcher(const int  *a,
 
 #endif
 
+#if VRNA_WITH_SIMD_AVX2
+  if (features & VRNA_CPU_SIMD_AVX2) {
+    fun_zip_add_min = &vrna_fun_zip_add_min_avx2;
+    goto exec_fun_zip_add_min;
+  }
+
+#endif
+
 #if VRNA_WITH_SIMD_SSE41
   if (features & VRNA_CPU_SIMD_SSE41) {
     fun_zip_add_min = &vrna_fun_zip_add_min_sse41;
@@ -120,6 +243,85 @@ exec_fun_zip_add_min:
 }
 
 
+/* zip_add_argmin() dispatcher */
+static int
+zip_add_argmin_dispatcher(const int *a,
+                          const int *b,
+                          int       size,
+                          int       *pos)
+{
+  unsigned int features = vrna_cpu_simd_capabilities();
+
+#if VRNA_WITH_SIMD_AVX2
+  if (features & VRNA_CPU_SIMD_AVX2) {
+    fun_zip_add_argmin = &vrna_fun_zip_add_argmin_avx2;
+    goto exec_fun_zip_add_argmin;
+  }
+
+#endif
+
+  fun_zip_add_argmin = &fun_zip_add_argmin_default;
+
+#if VRNA_WITH_SIMD_AVX2
+exec_fun_zip_add_argmin:
+#endif
+
+  return (*fun_zip_add_argmin)(a, b, size, pos);
+}
+
+
+/* zip_mul_sum() dispatcher */
+static FLT_OR_DBL
+zip_mul_sum_dispatcher(const FLT_OR_DBL *a,
+                       const FLT_OR_DBL *b,
+                       int              size)
+{
+  unsigned int features = vrna_cpu_simd_capabilities();
+
+#if VRNA_WITH_SIMD_AVX2
+  if (features & VRNA_CPU_SIMD_AVX2) {
+    fun_zip_mul_sum = &vrna_fun_zip_mul_sum_avx2;
+    goto exec_fun_zip_mul_sum;
+  }
+
+#endif
+
+  fun_zip_mul_sum = &fun_zip_mul_sum_default;
+
+#if VRNA_WITH_SIMD_AVX2
+exec_fun_zip_mul_sum:
+#endif
+
+  return (*fun_zip_mul_sum)(a, b, size);
+}
+
+
+/* zip_mul_sum_rev() dispatcher */
+static FLT_OR_DBL
+zip_mul_sum_rev_dispatcher(const FLT_OR_DBL *a,
+                           const FLT_OR_DBL *b,
+                           int              size)
+{
+  unsigned int features = vrna_cpu_simd_capabilities();
+
+#if VRNA_WITH_SIMD_AVX2
+  if (features & VRNA_CPU_SIMD_AVX2) {
+    fun_zip_mul_sum_rev = &vrna_fun_zip_mul_sum_rev_avx2;
+    goto exec_fun_zip_mul_sum_rev;
+  }
+
+#endif
+
+  fun_zip_mul_sum_rev = &fun_zip_mul_sum_rev_default;
+
+#if VRNA_WITH_SIMD_AVX2
+exec_fun_zip_mul_sum_rev:
+#endif
+
+  return (*fun_zip_mul_sum_rev)(a, b, size);
+}
+
+
 static int
 fun_zip_add_min_default(const int *e1,
                         const int *e2,
@@ -137,3 +339,61 @@ fun_zip_add_min_default(const int *e1,
 
   return decomp;
 }
+
+
+static int
+fun_zip_add_argmin_default(const int  *e1,
+                           const int  *e2,
+                           int        count,
+                           int        *pos)
+{
+  int i, p;
+  int decomp = INF;
+
+  p = -1;
+
+  for (i = 0; i < count; i++) {
+    if ((e1[i] != INF) && (e2[i] != INF)) {
+      const int en = e1[i] + e2[i];
+      if (en < decomp) {
+        decomp  = en;
+        p       = i;
+      }
+    }
+  }
+
+  if (pos)
+    *pos = p;
+
+  return decomp;
+}
+
+
+static FLT_OR_DBL
+fun_zip_mul_sum_default(const FLT_OR_DBL  *e1,
+                        const FLT_OR_DBL  *e2,
+                        int               count)
+{
+  int         i;
+  FLT_OR_DBL  sum = 0.;
+
+  for (i = 0; i < count; i++)
+    sum += e1[i] * e2[i];
+
+  return sum;
+}
+
+
+static FLT_OR_DBL
+fun_zip_mul_sum_rev_default(const FLT_OR_DBL  *e1,
+                            const FLT_OR_DBL  *e2,
+                            int               count)
+{
+  int         i;
+  FLT_OR_DBL  sum = 0.;
+
+  for (i = 0; i < count; i++)
+    sum += e1[i] * e2[-i];
+
+  return sum;
+}
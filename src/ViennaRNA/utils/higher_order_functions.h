@@ -1,6 +1,8 @@
 #ifndef VIENNA_RNA_PACKAGE_UTILS_FUN_H
 #define VIENNA_RNA_PACKAGE_UTILS_FUN_H
 
+#include <ViennaRNA/datastructures/basic.h>
+
 void
 vrna_fun_dispatch_disable(void);
 
@@ -15,4 +17,39 @@ vrna_fun_zip_add_min(const int  *e1,
                      int        count);
 
 
+/**
+ *  @brief  Same as vrna_fun_zip_add_min() but also report the (first) position @p pos
+ *          where the minimum is attained, or -1 if all sums involve #INF
+ */
+int
+vrna_fun_zip_add_argmin(const int *e1,
+                        const int *e2,
+                        int       count,
+                        int       *pos);
+
+
+/**
+ *  @brief  Sum of element-wise products @f$ \sum_{m=0}^{count-1} e_1[m] \cdot e_2[m] @f$
+ *
+ *  @note   Vectorized implementations may sum up the products in a different order
+ *          than the straight-forward loop.
+ */
+FLT_OR_DBL
+vrna_fun_zip_mul_sum(const FLT_OR_DBL *e1,
+                     const FLT_OR_DBL *e2,
+                     int              count);
+
+
+/**
+ *  @brief  Sum of products with @p e2 traversed backwards @f$ \sum_{m=0}^{count-1} e_1[m] \cdot e_2[-m] @f$
+ *
+ *  @note   Vectorized implementations may sum up the products in a different order
+ *          than the straight-forward loop.
+ */
+FLT_OR_DBL
+vrna_fun_zip_mul_sum_rev(const FLT_OR_DBL *e1,
+                         const FLT_OR_DBL *e2,
+                         int              count);
+
+
 #endif
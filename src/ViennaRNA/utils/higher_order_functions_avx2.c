@@ -0,0 +1,275 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "ViennaRNA/utils/basic.h"
+
+#include <immintrin.h>
+
+static int
+horizontal_min_Vec8i(__m256i x);
+
+
+PUBLIC int
+vrna_fun_zip_add_min_avx2(const int *e1,
+                          const int *e2,
+                          int       count)
+{
+  int     i       = 0;
+  int     decomp  = INF;
+
+  __m256i inf = _mm256_set1_epi32(INF);
+  __m256i res = inf;
+
+  for (i = 0; i < count - 7; i += 8) {
+    __m256i a = _mm256_loadu_si256((__m256i *)&e1[i]);
+    __m256i b = _mm256_loadu_si256((__m256i *)&e2[i]);
+    __m256i c = _mm256_add_epi32(a, b);
+
+    /* create mask for non-INF values */
+    __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi32(inf, a),
+                                    _mm256_cmpgt_epi32(inf, b));
+
+    /* replace results by INF where a or b has been INF before */
+    c   = _mm256_blendv_epi8(inf, c, mask);
+    res = _mm256_min_epi32(res, c);
+  }
+
+  decomp = horizontal_min_Vec8i(res);
+
+  for (; i < count; i++) {
+    if ((e1[i] != INF) && (e2[i] != INF)) {
+      const int en = e1[i] + e2[i];
+      decomp = MIN2(decomp, en);
+    }
+  }
+
+  return decomp;
+}
+
+
+PUBLIC int
+vrna_fun_zip_add_argmin_avx2(const int  *e1,
+                             const int  *e2,
+                             int        count,
+                             int        *pos)
+{
+  int     i, l, decomp, p, vals[8], idxs[8];
+
+  __m256i inf     = _mm256_set1_epi32(INF);
+  __m256i step    = _mm256_set1_epi32(8);
+  __m256i cur_idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i min_val = inf;
+  __m256i min_idx = _mm256_set1_epi32(-1);
+
+  for (i = 0; i < count - 7; i += 8) {
+    __m256i a = _mm256_loadu_si256((__m256i *)&e1[i]);
+    __m256i b = _mm256_loadu_si256((__m256i *)&e2[i]);
+    __m256i c = _mm256_add_epi32(a, b);
+
+    __m256i mask = _mm256_and_si256(_mm256_cmpgt_epi32(inf, a),
+                                    _mm256_cmpgt_epi32(inf, b));
+
+    c = _mm256_blendv_epi8(inf, c, mask);
+
+    /* strict comparison keeps the first occurrence within each lane */
+    __m256i better = _mm256_cmpgt_epi32(min_val, c);
+
+    min_val = _mm256_blendv_epi8(min_val, c, better);
+    min_idx = _mm256_blendv_epi8(min_idx, cur_idx, better);
+    cur_idx = _mm256_add_epi32(cur_idx, step);
+  }
+
+  _mm256_storeu_si256((__m256i *)vals, min_val);
+  _mm256_storeu_si256((__m256i *)idxs, min_idx);
+
+  decomp  = INF;
+  p       = -1;
+
+  /* lanes may hold equal minima, so break ties by the smaller index */
+  for (l = 0; l < 8; l++) {
+    if ((vals[l] < decomp) ||
+        ((vals[l] == decomp) && (idxs[l] != -1) && (idxs[l] < p))) {
+      decomp  = vals[l];
+      p       = idxs[l];
+    }
+  }
+
+  for (; i < count; i++) {
+    if ((e1[i] != INF) && (e2[i] != INF)) {
+      const int en = e1[i] + e2[i];
+      if (en < decomp) {
+        decomp  = en;
+        p       = i;
+      }
+    }
+  }
+
+  if (pos)
+    *pos = p;
+
+  return decomp;
+}
+
+
+#ifdef USE_FLOAT_PF
+
+static FLT_OR_DBL
+horizontal_sum_Vec8f(__m256 x);
+
+
+PUBLIC FLT_OR_DBL
+vrna_fun_zip_mul_sum_avx2(const FLT_OR_DBL  *e1,
+                          const FLT_OR_DBL  *e2,
+                          int               count)
+{
+  int         i;
+  FLT_OR_DBL  sum;
+  __m256      acc = _mm256_setzero_ps();
+
+  for (i = 0; i < count - 7; i += 8) {
+    __m256  a = _mm256_loadu_ps(&e1[i]);
+    __m256  b = _mm256_loadu_ps(&e2[i]);
+
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(a, b));
+  }
+
+  sum = horizontal_sum_Vec8f(acc);
+
+  for (; i < count; i++)
+    sum += e1[i] * e2[i];
+
+  return sum;
+}
+
+
+PUBLIC FLT_OR_DBL
+vrna_fun_zip_mul_sum_rev_avx2(const FLT_OR_DBL  *e1,
+                              const FLT_OR_DBL  *e2,
+                              int               count)
+{
+  int         i;
+  FLT_OR_DBL  sum;
+  __m256      acc = _mm256_setzero_ps();
+  __m256i     rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+  for (i = 0; i < count - 7; i += 8) {
+    __m256  a = _mm256_loadu_ps(&e1[i]);
+    /* e2[-i - 7] ... e2[-i] in reverse order */
+    __m256  b = _mm256_permutevar8x32_ps(_mm256_loadu_ps(&e2[-i - 7]), rev);
+
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(a, b));
+  }
+
+  sum = horizontal_sum_Vec8f(acc);
+
+  for (; i < count; i++)
+    sum += e1[i] * e2[-i];
+
+  return sum;
+}
+
+
+static FLT_OR_DBL
+horizontal_sum_Vec8f(__m256 x)
+{
+  __m128  lo  = _mm256_castps256_ps128(x);
+  __m128  hi  = _mm256_extractf128_ps(x, 1);
+  __m128  s   = _mm_add_ps(lo, hi);
+
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+
+  return _mm_cvtss_f32(s);
+}
+
+
+#else
+
+static FLT_OR_DBL
+horizontal_sum_Vec4d(__m256d x);
+
+
+PUBLIC FLT_OR_DBL
+vrna_fun_zip_mul_sum_avx2(const FLT_OR_DBL  *e1,
+                          const FLT_OR_DBL  *e2,
+                          int               count)
+{
+  int         i;
+  FLT_OR_DBL  sum;
+  __m256d     acc = _mm256_setzero_pd();
+
+  for (i = 0; i < count - 3; i += 4) {
+    __m256d a = _mm256_loadu_pd(&e1[i]);
+    __m256d b = _mm256_loadu_pd(&e2[i]);
+
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(a, b));
+  }
+
+  sum = horizontal_sum_Vec4d(acc);
+
+  for (; i < count; i++)
+    sum += e1[i] * e2[i];
+
+  return sum;
+}
+
+
+PUBLIC FLT_OR_DBL
+vrna_fun_zip_mul_sum_rev_avx2(const FLT_OR_DBL  *e1,
+                              const FLT_OR_DBL  *e2,
+                              int               count)
+{
+  int         i;
+  FLT_OR_DBL  sum;
+  __m256d     acc = _mm256_setzero_pd();
+
+  for (i = 0; i < count - 3; i += 4) {
+    __m256d a = _mm256_loadu_pd(&e1[i]);
+    /* e2[-i - 3] ... e2[-i] in reverse order */
+    __m256d b = _mm256_permute4x64_pd(_mm256_loadu_pd(&e2[-i - 3]),
+                                      _MM_SHUFFLE(0, 1, 2, 3));
+
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(a, b));
+  }
+
+  sum = horizontal_sum_Vec4d(acc);
+
+  for (; i < count; i++)
+    sum += e1[i] * e2[-i];
+
+  return sum;
+}
+
+
+static FLT_OR_DBL
+horizontal_sum_Vec4d(__m256d x)
+{
+  __m128d lo  = _mm256_castpd256_pd128(x);
+  __m128d hi  = _mm256_extractf128_pd(x, 1);
+  __m128d s   = _mm_add_pd(lo, hi);
+
+  s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+
+  return _mm_cvtsd_f64(s);
+}
+
+
+#endif
+
+
+static int
+horizontal_min_Vec8i(__m256i x)
+{
+  __m128i lo    = _mm256_castsi256_si128(x);
+  __m128i hi    = _mm256_extracti128_si256(x, 1);
+  __m128i min1  = _mm_min_epi32(lo, hi);
+  __m128i min2  = _mm_min_epi32(min1, _mm_shuffle_epi32(min1, _MM_SHUFFLE(0, 0, 3, 2)));
+  __m128i min3  = _mm_min_epi32(min2, _mm_shuffle_epi32(min2, _MM_SHUFFLE(0, 0, 0, 1)));
+
+  return _mm_cvtsi128_si32(min3);
+}
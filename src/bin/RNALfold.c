@@ -33,6 +33,8 @@
 #include "gengetopt_helpers.h"
 #include "input_id_helpers.h"
 #include "modified_bases_helpers.h"
+#include "parallel_helpers.h"
+#include "record_helpers.h"
 
 #include "ViennaRNA/color_output.inc"
 
@@ -62,53 +64,102 @@ default_callback(int        start,
                  void       *data);
 
 
+struct options {
+  int                 noconv;
+  int                 verbose;
+  int                 backtrack;
+  int                 zsc;
+  int                 zsc_pre;
+  int                 zsc_subsumed;
+  double              min_z;
+  int                 with_shapes;
+  char                *shape_file;
+  char                *shape_method;
+  char                *shape_conversion;
+  int                 tofile;
+  char                *infile;
+  char                *outfile;
+  char                *filename_delim;
+  int                 filename_full;
+  vrna_md_t           md;
+  dataset_id          id_control;
+  vrna_cmd_t          commands;
+  vrna_sc_mod_param_t *mod_params;
+
+  int                 jobs;
+  int                 keep_order;
+  record_queue        output_queue;
+};
+
+
+struct record_data {
+  unsigned int    number;
+  char            *id;
+  char            *sequence;
+  struct options  *options;
+  int             tty;
+};
+
+
+PRIVATE void
+init_default_options(struct options *opt)
+{
+  opt->noconv           = 0;
+  opt->verbose          = 0;
+  opt->backtrack        = 0;
+  opt->zsc              = 0;
+  opt->zsc_pre          = 0;
+  opt->zsc_subsumed     = 0;
+  opt->min_z            = -2.0;
+  opt->with_shapes      = 0;
+  opt->shape_file       = NULL;
+  opt->shape_method     = NULL;
+  opt->shape_conversion = NULL;
+  opt->tofile           = 0;
+  opt->infile           = NULL;
+  opt->outfile          = NULL;
+  opt->filename_delim   = NULL;
+  opt->filename_full    = 0;
+  opt->commands         = NULL;
+  opt->mod_params       = NULL;
+
+  /* apply default model details */
+  vrna_md_set_default(&(opt->md));
+
+  opt->jobs         = 1;
+  opt->keep_order   = 1;
+  opt->output_queue = NULL;
+}
+
+
+PRIVATE void
+process_input(FILE            *input,
+              struct options  *opt);
+
+
+PRIVATE void
+process_record(struct record_data *record);
+
+
 int
 main(int  argc,
      char *argv[])
 {
-  FILE                        *input, *output;
+  FILE                        *input;
   struct  RNALfold_args_info  args_info;
-  char                        *ParamFile, *ns_bases, *rec_sequence, *rec_id, **rec_rest,
-                              *command_file, *orig_sequence, *infile, *outfile, *filename_delim,
-                              *shape_file, *shape_method, *shape_conversion;
-  unsigned int                rec_type, read_opt;
-  int                         length, istty, noconv, maxdist, zsc, tofile, filename_full,
-                              with_shapes, verbose, backtrack, zsc_pre, zsc_subsumed;
-  double                      min_en, min_z;
-  long int                    file_pos_start;
-  vrna_md_t                   md;
-  vrna_cmd_t                  commands;
-  dataset_id                  id_control;
-  vrna_sc_mod_param_t         *mod_params;
-
-  ParamFile           = ns_bases = NULL;
-  do_backtrack        = 1;
-  noconv              = 0;
-  backtrack           = 0;
-  dangles             = 2;
-  maxdist             = 150;
-  zsc                 = 0;
-  zsc_pre             = 0;
-  zsc_subsumed        = 0;
-  min_z               = -2.0;
-  gquad               = 0;
-  rec_type            = read_opt = 0;
-  rec_id              = rec_sequence = orig_sequence = NULL;
-  rec_rest            = NULL;
-  outfile             = NULL;
-  infile              = NULL;
-  input               = NULL;
-  output              = NULL;
-  tofile              = 0;
-  filename_full       = 0;
-  command_file        = NULL;
-  commands            = NULL;
-  file_pos_start      = -1;
-  verbose             = 0;
-  mod_params          = NULL;
+  char                        *ns_bases, *command_file;
+  int                         maxdist;
+  struct options              opt;
 
-  /* apply default model details */
-  vrna_md_set_default(&md);
+  ns_bases      = NULL;
+  do_backtrack  = 1;
+  dangles       = 2;
+  maxdist       = 150;
+  gquad         = 0;
+  input         = NULL;
+  command_file  = NULL;
+
+  init_default_options(&opt);
 
   /*
    #############################################
@@ -119,15 +170,15 @@ main(int  argc,
     exit(1);
 
   /* parse options for ID manipulation */
-  ggo_get_id_control(args_info, id_control, "Sequence", "sequence", "_", 4, 1);
+  ggo_get_id_control(args_info, opt.id_control, "Sequence", "sequence", "_", 4, 1);
 
   /* temperature */
   if (args_info.temp_given)
-    md.temperature = temperature = args_info.temp_arg;
+    opt.md.temperature = temperature = args_info.temp_arg;
 
   /* do not take special tetra loop energies into account */
   if (args_info.noTetra_given)
-    md.special_hp = tetra_loop = 0;
+    opt.md.special_hp = tetra_loop = 0;
 
   /* set dangle model */
   if (args_info.dangles_given) {
@@ -135,7 +186,7 @@ main(int  argc,
       vrna_message_warning(
         "required dangle model not implemented, falling back to default dangles=2");
     else
-      md.dangles = dangles = args_info.dangles_arg;
+      opt.md.dangles = dangles = args_info.dangles_arg;
   }
 
   /* do not allow weak pairs */
@@ -144,38 +195,38 @@ main(int  argc,
       vrna_message_warning(
         "Global mfE structure backtracking not available for odd dangle models yet!"
         " Deactivating global backtracing now...");
-      backtrack = 0;
+      opt.backtrack = 0;
     } else {
-      backtrack = tofile = 1;
+      opt.backtrack = opt.tofile = 1;
     }
   }
 
   /* do not allow weak pairs */
   if (args_info.noLP_given)
-    md.noLP = noLonelyPairs = 1;
+    opt.md.noLP = noLonelyPairs = 1;
 
   /* do not allow wobble pairs (GU) */
   if (args_info.noGU_given)
-    md.noGU = noGU = 1;
+    opt.md.noGU = noGU = 1;
 
   /* do not allow weak closing pairs (AU,GU) */
   if (args_info.noClosingGU_given)
-    md.noGUclosure = no_closingGU = 1;
+    opt.md.noGUclosure = no_closingGU = 1;
 
   /* set salt concentration */
   if (args_info.salt_given)
-    md.salt = args_info.salt_arg;
+    opt.md.salt = args_info.salt_arg;
 
   /* do not convert DNA nucleotide "T" to appropriate RNA "U" */
   if (args_info.noconv_given)
-    noconv = 1;
+    opt.noconv = 1;
 
   /* set energy model */
   if (args_info.energyModel_given)
-    md.energy_set = energy_set = args_info.energyModel_arg;
+    opt.md.energy_set = energy_set = args_info.energyModel_arg;
 
   /* take another energy parameter set */
-  ggo_get_read_paramFile(args_info, &md);
+  ggo_get_read_paramFile(args_info, &(opt.md));
 
   /* Allow other pairs in addition to the usual AU,GC,and GU pairs */
   if (args_info.nsp_given)
@@ -187,16 +238,16 @@ main(int  argc,
 
   if (args_info.zscore_given) {
 #ifdef VRNA_WITH_SVM
-    zsc = 1;
+    opt.zsc = 1;
     if (args_info.zscore_arg != -2)
-      min_z = args_info.zscore_arg;
+      opt.min_z = args_info.zscore_arg;
 
     if ((args_info.zscore_pre_filter_given) ||
-        (backtrack)) /* global backtracing implies hard z-score filter! */
-      zsc_pre = 1;
+        (opt.backtrack)) /* global backtracing implies hard z-score filter! */
+      opt.zsc_pre = 1;
 
     if (args_info.zscore_report_subsumed_given)
-      zsc_subsumed = 1;
+      opt.zsc_subsumed = 1;
 
 #else
     vrna_message_error("\'z\' option is available only if compiled with SVM support!");
@@ -205,39 +256,41 @@ main(int  argc,
 
   /* gquadruplex support */
   if (args_info.gquad_given)
-    md.gquad = gquad = 1;
+    opt.md.gquad = gquad = 1;
 
   if (args_info.verbose_given)
-    verbose = 1;
+    opt.verbose = 1;
 
   /* SHAPE reactivity data */
-  ggo_get_SHAPE(args_info, with_shapes, shape_file, shape_method, shape_conversion);
+  ggo_get_SHAPE(args_info,
+                opt.with_shapes,
+                opt.shape_file,
+                opt.shape_method,
+                opt.shape_conversion);
 
   if (args_info.outfile_given) {
-    tofile = 1;
+    opt.tofile = 1;
     if (args_info.outfile_arg)
-      outfile = strdup(args_info.outfile_arg);
+      opt.outfile = strdup(args_info.outfile_arg);
   }
 
   if (args_info.infile_given)
-    infile = strdup(args_info.infile_arg);
+    opt.infile = strdup(args_info.infile_arg);
 
   /* filename sanitize delimiter */
   if (args_info.filename_delim_given)
-    filename_delim = strdup(args_info.filename_delim_arg);
-  else if (get_id_delim(id_control))
-    filename_delim = strdup(get_id_delim(id_control));
-  else
-    filename_delim = NULL;
-
-  if ((filename_delim) && isspace(*filename_delim)) {
-    free(filename_delim);
-    filename_delim = NULL;
+    opt.filename_delim = strdup(args_info.filename_delim_arg);
+  else if (get_id_delim(opt.id_control))
+    opt.filename_delim = strdup(get_id_delim(opt.id_control));
+
+  if ((opt.filename_delim) && isspace(*(opt.filename_delim))) {
+    free(opt.filename_delim);
+    opt.filename_delim = NULL;
   }
 
   /* full filename from FASTA header support */
   if (args_info.filename_full_given)
-    filename_full = 1;
+    opt.filename_full = 1;
 
   if (args_info.commands_given)
     command_file = strdup(args_info.commands_arg);
@@ -249,10 +302,15 @@ main(int  argc,
   }
 
   ggo_get_modified_base_settings(args_info,
-                                 mod_params,
-                                 &(md));
+                                 opt.mod_params,
+                                 &(opt.md));
 
-  ggo_geometry_settings(args_info, &md);
+  ggo_geometry_settings(args_info, &(opt.md));
+
+  ggo_get_jobs(args_info, opt.jobs, "RNALfold");
+
+  if (args_info.unordered_given)
+    opt.keep_order = 0;
 
   /* free allocated memory of command line data structure */
   RNALfold_cmdline_parser_free(&args_info);
@@ -263,10 +321,17 @@ main(int  argc,
    #############################################
    */
 
-  md.max_bp_span = md.window_size = maxdist;
+  /* global backtracking reads the local structures back from the output file */
+  if ((opt.jobs > 1) && (opt.backtrack)) {
+    vrna_message_warning("Parallel input processing is not available for global backtracking, "
+                         "falling back to serial computation");
+    opt.jobs = 1;
+  }
+
+  opt.md.max_bp_span = opt.md.window_size = maxdist;
 
-  if (infile) {
-    input = fopen((const char *)infile, "r");
+  if (opt.infile) {
+    input = fopen((const char *)opt.infile, "r");
     if (!input)
       vrna_message_error("Could not read input file");
   } else {
@@ -275,35 +340,79 @@ main(int  argc,
 
 
   if (command_file != NULL)
-    commands = vrna_file_commands_read(command_file, VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
+    opt.commands = vrna_file_commands_read(command_file, VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
 
   if (ns_bases != NULL)
-    vrna_md_set_nonstandards(&md, ns_bases);
+    vrna_md_set_nonstandards(&(opt.md), ns_bases);
 
-  istty     = (!infile) && isatty(fileno(stdout)) && isatty(fileno(stdin));
-  read_opt  |= VRNA_INPUT_NO_REST;
-  if (istty) {
-    vrna_message_input_seq_simple();
-    read_opt |= VRNA_INPUT_NOSKIP_BLANK_LINES;
-  }
+  opt.output_queue = record_queue_init(opt.jobs, opt.keep_order);
 
   /*
    #############################################
    # main loop: continue until end of file
    #############################################
    */
+  INIT_PARALLELIZATION(opt.jobs);
+
+  process_input(input, &opt);
+
+  UNINIT_PARALLELIZATION
+
+  /*
+   ################################################
+   # post processing
+   ################################################
+   */
+  record_queue_free(opt.output_queue);
+
+  if (opt.infile && input)
+    fclose(input);
+
+  free(opt.infile);
+  free(opt.outfile);
+  free(opt.shape_file);
+  free(opt.shape_method);
+  free(opt.shape_conversion);
+  free(opt.filename_delim);
+  free(command_file);
+  free(ns_bases);
+  vrna_commands_free(opt.commands);
+
+  if (opt.mod_params) {
+    for (vrna_sc_mod_param_t *ptr = opt.mod_params; *ptr != NULL; ptr++)
+      vrna_sc_mod_parameters_free(*ptr);
+
+    free(opt.mod_params);
+  }
+
+  free_id_data(opt.id_control);
+
+  return EXIT_SUCCESS;
+}
+
+
+PRIVATE void
+process_input(FILE            *input,
+              struct options  *opt)
+{
+  char          *rec_sequence, *rec_id, **rec_rest;
+  unsigned int  rec_type, read_opt;
+  int           istty;
+
+  rec_id    = rec_sequence = NULL;
+  rec_rest  = NULL;
+  read_opt  = VRNA_INPUT_NO_REST;
+  istty     = (!opt->infile) && isatty(fileno(stdout)) && isatty(fileno(stdin));
+
+  if (istty) {
+    vrna_message_input_seq_simple();
+    read_opt |= VRNA_INPUT_NOSKIP_BLANK_LINES;
+  }
+
   while (
     !((rec_type = vrna_file_fasta_read_record(&rec_id, &rec_sequence, &rec_rest, input, read_opt))
       & (VRNA_INPUT_ERROR | VRNA_INPUT_QUIT))) {
-    /*
-     ########################################################
-     # init everything according to the data we've read
-     ########################################################
-     */
-    size_t  **mod_positions, mod_param_sets;
-    char    *SEQ_ID       = NULL;
-    char    *v_file_name  = NULL;
-    char    *tmp_string   = NULL;
+    struct record_data *record;
 
     /*
      ########################################################
@@ -314,184 +423,189 @@ main(int  argc,
       rec_id = memmove(rec_id, rec_id + 1, strlen(rec_id));
 
     /* construct the sequence ID */
-    set_next_id(&rec_id, id_control);
-    SEQ_ID = fileprefix_from_id(rec_id, id_control, filename_full);
+    set_next_id(&rec_id, opt->id_control);
 
-    if (tofile) {
-      /* prepare the file name */
-      if (outfile)
-        v_file_name = vrna_strdup_printf("%s", outfile);
-      else
-        v_file_name = (SEQ_ID) ?
-                      vrna_strdup_printf("%s.lfold", SEQ_ID) :
-                      vrna_strdup_printf("RNALfold_output.lfold");
+    record = (struct record_data *)vrna_alloc(sizeof(struct record_data));
 
-      tmp_string = vrna_filename_sanitize(v_file_name, filename_delim);
-      free(v_file_name);
-      v_file_name = tmp_string;
+    record->number    = record_queue_next(opt->output_queue);
+    record->id        = rec_id;
+    record->sequence  = rec_sequence;
+    record->options   = opt;
+    record->tty       = istty;
 
-      if (infile && !strcmp(infile, v_file_name))
-        vrna_message_error("Input and output file names are identical");
+    RUN_IN_PARALLEL(process_record, record);
 
-      output = fopen((const char *)v_file_name, "a");
-
-      if (!output)
-        vrna_message_error("Failed to open file for writing");
+    rec_id    = rec_sequence = NULL;
+    rec_rest  = NULL;
 
-      file_pos_start = ftell(output);
-    } else {
-      output = stdout;
-    }
+    if (opt->with_shapes)
+      break;
 
-    if (!istty)
-      print_fasta_header(output, rec_id);
+    /* print user help for the next round if we get input from tty */
 
-    length = (int)strlen(rec_sequence);
+    if (istty)
+      vrna_message_input_seq_simple();
+  }
+}
 
-    mod_positions = mod_positions_seq_prepare(rec_sequence,
-                                              mod_params,
-                                              verbose,
-                                              &mod_param_sets);
 
-    /* convert DNA alphabet to RNA if not explicitely switched off */
-    if (!noconv)
-      vrna_seq_toRNA(rec_sequence);
+PRIVATE void
+process_record(struct record_data *record)
+{
+  FILE                  *output;
+  char                  *rec_sequence, *orig_sequence, *SEQ_ID, *v_file_name, *tmp_string,
+                        *msg, *mfe_structure;
+  int                   length;
+  long int              file_pos_start;
+  double                min_en;
+  size_t                **mod_positions, mod_param_sets;
+  struct options        *opt;
+  record_output         o_stream;
+  vrna_fold_compound_t  *vc;
+  hit_data              data;
+
+  opt             = record->options;
+  rec_sequence    = record->sequence;
+  v_file_name     = NULL;
+  file_pos_start  = -1;
+  SEQ_ID          = fileprefix_from_id(record->id, opt->id_control, opt->filename_full);
+
+  if (opt->tofile) {
+    /* prepare the file name */
+    if (opt->outfile)
+      v_file_name = vrna_strdup_printf("%s", opt->outfile);
+    else
+      v_file_name = (SEQ_ID) ?
+                    vrna_strdup_printf("%s.lfold", SEQ_ID) :
+                    vrna_strdup_printf("RNALfold_output.lfold");
 
-    /* store case-unmodified sequence */
-    orig_sequence = strdup(rec_sequence);
+    tmp_string = vrna_filename_sanitize(v_file_name, opt->filename_delim);
+    free(v_file_name);
+    v_file_name = tmp_string;
 
-    /* convert sequence to uppercase letters only */
-    vrna_seq_toupper(rec_sequence);
+    if (opt->infile && !strcmp(opt->infile, v_file_name))
+      vrna_message_error("Input and output file names are identical");
+  }
 
-    if (!tofile && istty)
-      vrna_message_info(output, "length = %d", length);
+  o_stream  = record_output_init(opt->output_queue, v_file_name);
+  output    = record_output_fp(o_stream);
 
-    /*
-     ########################################################
-     # done with 'stdin' handling
-     # begin actual computations
-     ########################################################
-     */
+  if (opt->tofile)
+    file_pos_start = ftell(output);
 
-    vrna_fold_compound_t *vc = vrna_fold_compound((const char *)rec_sequence,
-                                                  &md,
-                                                  VRNA_OPTION_MFE | VRNA_OPTION_WINDOW);
+  if (!record->tty)
+    print_fasta_header(output, record->id);
 
-    if (commands)
-      vrna_commands_apply(vc, commands, VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
+  length = (int)strlen(rec_sequence);
 
-    if (with_shapes) {
-      vrna_constraints_add_SHAPE(vc,
-                                 shape_file,
-                                 shape_method,
-                                 shape_conversion,
-                                 verbose,
-                                 VRNA_OPTION_WINDOW);
-    }
+  mod_positions = mod_positions_seq_prepare(rec_sequence,
+                                            opt->mod_params,
+                                            opt->verbose,
+                                            &mod_param_sets);
 
-    /* apply modified base support if requested */
-    mod_bases_apply(vc,
-                    mod_param_sets,
-                    mod_positions,
-                    mod_params);
+  /* convert DNA alphabet to RNA if not explicitely switched off */
+  if (!opt->noconv)
+    vrna_seq_toRNA(rec_sequence);
 
-#ifdef VRNA_WITH_SVM
-    if (zsc) {
-      unsigned int zsc_options = VRNA_ZSCORE_FILTER_ON;
+  /* store case-unmodified sequence */
+  orig_sequence = strdup(rec_sequence);
 
-      if (zsc_pre)
-        zsc_options |= VRNA_ZSCORE_PRE_FILTER;
+  /* convert sequence to uppercase letters only */
+  vrna_seq_toupper(rec_sequence);
 
-      if (zsc_subsumed)
-        zsc_options |= VRNA_ZSCORE_REPORT_SUBSUMED;
+  if (!opt->tofile && record->tty)
+    vrna_message_info(output, "length = %d", length);
 
-      vrna_zsc_filter_init(vc, min_z, zsc_options);
-    }
+  /*
+   ########################################################
+   # done with 'stdin' handling
+   # begin actual computations
+   ########################################################
+   */
 
-#endif
+  vc = vrna_fold_compound((const char *)rec_sequence,
+                          &(opt->md),
+                          VRNA_OPTION_MFE | VRNA_OPTION_WINDOW);
 
-    hit_data data;
-    data.output       = output;
-    data.dangle_model = md.dangles;
+  if (opt->commands)
+    vrna_commands_apply(vc, opt->commands, VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
 
-#ifdef VRNA_WITH_SVM
-    min_en =
-      (zsc) ? vrna_mfe_window_zscore_cb(vc, min_z, &default_callback_z,
-                                        (void *)&data) : vrna_mfe_window_cb(vc, &default_callback,
-                                                                            (void *)&data);
-#else
-    min_en = vrna_mfe_window_cb(vc, &default_callback, (void *)&data);
-#endif
-    fprintf(output, "%s\n", orig_sequence);
+  if (opt->with_shapes) {
+    vrna_constraints_add_SHAPE(vc,
+                               opt->shape_file,
+                               opt->shape_method,
+                               opt->shape_conversion,
+                               opt->verbose,
+                               VRNA_OPTION_WINDOW);
+  }
 
-    char  *msg            = NULL;
-    char  *mfe_structure  = NULL;
+  /* apply modified base support if requested */
+  mod_bases_apply(vc,
+                  mod_param_sets,
+                  mod_positions,
+                  opt->mod_params);
 
-    if (output)
-      (void)fflush(output);
+#ifdef VRNA_WITH_SVM
+  if (opt->zsc) {
+    unsigned int zsc_options = VRNA_ZSCORE_FILTER_ON;
 
-    if (backtrack) {
-      if (vrna_backtrack_window(vc,
-                                (const char *)v_file_name,
-                                file_pos_start,
-                                &mfe_structure,
-                                min_en))
-        msg = vrna_strdup_printf(" (%6.2f)", min_en);
-    } else {
-      if (!tofile && istty)
-        msg = vrna_strdup_printf(" minimum free energy = %6.2f kcal/mol", min_en);
-      else
-        msg = vrna_strdup_printf(" (%6.2f)", min_en);
-    }
+    if (opt->zsc_pre)
+      zsc_options |= VRNA_ZSCORE_PRE_FILTER;
 
-    print_structure(output, mfe_structure, msg);
-    free(msg);
+    if (opt->zsc_subsumed)
+      zsc_options |= VRNA_ZSCORE_REPORT_SUBSUMED;
 
-    if (output)
-      (void)fflush(output);
+    vrna_zsc_filter_init(vc, opt->min_z, zsc_options);
+  }
 
-    if (tofile && output) {
-      fclose(output);
-      output = NULL;
-    }
+#endif
 
-    /* clean up */
-    vrna_fold_compound_free(vc);
-    free(rec_id);
-    free(SEQ_ID);
-    free(rec_sequence);
-    free(orig_sequence);
-    rec_id    = rec_sequence = orig_sequence = NULL;
-    rec_rest  = NULL;
+  data.output       = output;
+  data.dangle_model = opt->md.dangles;
 
-    free(v_file_name);
+#ifdef VRNA_WITH_SVM
+  min_en =
+    (opt->zsc) ? vrna_mfe_window_zscore_cb(vc, opt->min_z, &default_callback_z,
+                                           (void *)&data) : vrna_mfe_window_cb(vc,
+                                                                               &default_callback,
+                                                                               (void *)&data);
+#else
+  min_en = vrna_mfe_window_cb(vc, &default_callback, (void *)&data);
+#endif
+  fprintf(output, "%s\n", orig_sequence);
 
-    if (with_shapes)
-      break;
+  msg           = NULL;
+  mfe_structure = NULL;
 
-    /* print user help for the next round if we get input from tty */
+  (void)fflush(output);
 
-    if (istty)
-      vrna_message_input_seq_simple();
+  if (opt->backtrack) {
+    if (vrna_backtrack_window(vc,
+                              (const char *)v_file_name,
+                              file_pos_start,
+                              &mfe_structure,
+                              min_en))
+      msg = vrna_strdup_printf(" (%6.2f)", min_en);
+  } else {
+    if (!opt->tofile && record->tty)
+      msg = vrna_strdup_printf(" minimum free energy = %6.2f kcal/mol", min_en);
+    else
+      msg = vrna_strdup_printf(" (%6.2f)", min_en);
   }
 
-  if (infile && input)
-    fclose(input);
-
-  free(filename_delim);
-  free(command_file);
-  vrna_commands_free(commands);
-
-  if (mod_params) {
-    for (vrna_sc_mod_param_t *ptr = mod_params; *ptr != NULL; ptr++)
-      vrna_sc_mod_parameters_free(*ptr);
-
-    free(mod_params);
-  }
+  print_structure(output, mfe_structure, msg);
+  free(msg);
 
-  free_id_data(id_control);
+  record_queue_provide(opt->output_queue, record->number, o_stream);
 
-  return EXIT_SUCCESS;
+  /* clean up */
+  vrna_fold_compound_free(vc);
+  free(record->id);
+  free(SEQ_ID);
+  free(rec_sequence);
+  free(orig_sequence);
+  free(v_file_name);
+  free(record);
 }
 
 
@@ -21,6 +21,7 @@
 #include "ViennaRNA/params/io.h"
 #include "ViennaRNA/subopt.h"
 #include "ViennaRNA/duplex.h"
+#include "ViennaRNA/search/seeds.h"
 
 #include "gengetopt_helpers.h"
 #include "RNAduplex_cmdl.h"
@@ -31,6 +32,26 @@ PRIVATE void
 print_struc(duplexT const *dup);
 
 
+PRIVATE duplexT
+seed_duplexfold(const char          *s1,
+                const char          *s2,
+                const unsigned int  *windows,
+                unsigned int        num_windows);
+
+
+PRIVATE duplexT *
+seed_duplex_subopt(const char         *s1,
+                   const char         *s2,
+                   const unsigned int *windows,
+                   unsigned int       num_windows,
+                   int                delta);
+
+
+PRIVATE int
+compare_duplex(const void *sub1,
+               const void *sub2);
+
+
 /*--------------------------------------------------------------------------*/
 
 int
@@ -40,15 +61,21 @@ main(int  argc,
   struct        RNAduplex_args_info args_info;
   char                              *input_string, *s1, *s2, *orig_s1, *orig_s2,
                                     *c, *ParamFile, *ns_bases;
-  unsigned int                      input_type;
-  int                               i, sym, istty, delta, noconv;
-
-  ParamFile = NULL;
-  ns_bases  = NULL;
-  s1        = s2 = orig_s1 = orig_s2 = NULL;
-  dangles   = 2;
-  delta     = -1;
-  noconv    = 0;
+  unsigned int                      input_type, seed_start, seed_length, seed_gu,
+                                    num_windows, *windows;
+  int                               i, sym, istty, delta, noconv, seed;
+  vrna_seed_index_t                 *seed_index;
+
+  ParamFile   = NULL;
+  ns_bases    = NULL;
+  s1          = s2 = orig_s1 = orig_s2 = NULL;
+  dangles     = 2;
+  delta       = -1;
+  noconv      = 0;
+  seed        = 0;
+  seed_start  = VRNA_SEED_DEFAULT_START;
+  seed_length = VRNA_SEED_DEFAULT_LENGTH;
+  seed_gu     = 1;
 
   /*
    #############################################
@@ -109,6 +136,26 @@ main(int  argc,
   if (args_info.sorted_given)
     subopt_sorted = 1;
 
+  /* seed prefilter */
+  if (args_info.seed_given) {
+    seed = 1;
+
+    if ((args_info.seed_start_arg < 1) ||
+        (args_info.seed_length_arg < 1) ||
+        (args_info.seed_length_arg > VRNA_SEED_MAX_LENGTH)) {
+      vrna_message_warning("Seed must start at a position > 0 and have a length of 1 to %d nt, "
+                           "falling back to default seed %d-%d",
+                           VRNA_SEED_MAX_LENGTH,
+                           VRNA_SEED_DEFAULT_START,
+                           VRNA_SEED_DEFAULT_START + VRNA_SEED_DEFAULT_LENGTH - 1);
+    } else {
+      seed_start  = (unsigned int)args_info.seed_start_arg;
+      seed_length = (unsigned int)args_info.seed_length_arg;
+    }
+
+    seed_gu = (unsigned int)MAX2(0, args_info.seed_gu_arg);
+  }
+
   /* get energy parameter file name */
   ggo_get_read_paramFile(args_info, NULL);
 
@@ -221,7 +268,34 @@ main(int  argc,
      # begin actual computations
      ########################################################
      */
-    if (delta >= 0) {
+    if (seed) {
+      /* restrict the computations to windows around seed sites within s1 */
+      seed_index  = vrna_seed_index(s1, seed_length);
+      windows     = vrna_seed_windows(seed_index,
+                                      s2,
+                                      seed_start,
+                                      seed_gu,
+                                      strlen(s2) + MAXLOOP,
+                                      strlen(s2) + MAXLOOP,
+                                      &num_windows);
+
+      if (delta >= 0) {
+        duplexT *sub;
+        subopt = seed_duplex_subopt(s1, s2, windows, num_windows, delta);
+        for (sub = subopt; sub->i > 0; sub++) {
+          print_struc(sub);
+          free(sub->structure);
+        }
+        free(subopt);
+      } else if (num_windows > 0) {
+        mfe = seed_duplexfold(s1, s2, windows, num_windows);
+        print_struc(&mfe);
+        free(mfe.structure);
+      }
+
+      free(windows);
+      vrna_seed_index_free(seed_index);
+    } else if (delta >= 0) {
       duplexT *sub;
       subopt = duplex_subopt(s1, s2, delta, 5);
       for (sub = subopt; sub->i > 0; sub++) {
@@ -262,3 +336,128 @@ print_struc(duplexT const *dup)
   print_structure(stdout, dup->structure, msg);
   free(msg);
 }
+
+
+/* extract the window [start, end] (1-based) from s */
+PRIVATE char *
+get_window(const char   *s,
+           unsigned int start,
+           unsigned int end)
+{
+  char *w = (char *)vrna_alloc(sizeof(char) * (end - start + 2));
+
+  memcpy(w, s + start - 1, sizeof(char) * (end - start + 1));
+
+  return w;
+}
+
+
+PRIVATE duplexT
+seed_duplexfold(const char          *s1,
+                const char          *s2,
+                const unsigned int  *windows,
+                unsigned int        num_windows)
+{
+  char          *window;
+  unsigned int  w;
+  duplexT       mfe, dup;
+
+  mfe.i         = mfe.j = 0;
+  mfe.energy    = (float)INF;
+  mfe.structure = NULL;
+
+  for (w = 0; w < num_windows; w++) {
+    window  = get_window(s1, windows[2 * w], windows[2 * w + 1]);
+    dup     = duplexfold(window, s2);
+    dup.i   += windows[2 * w] - 1;
+    free(window);
+
+    if ((mfe.structure == NULL) ||
+        (dup.energy < mfe.energy)) {
+      free(mfe.structure);
+      mfe = dup;
+    } else {
+      free(dup.structure);
+    }
+  }
+
+  return mfe;
+}
+
+
+PRIVATE duplexT *
+seed_duplex_subopt(const char         *s1,
+                   const char         *s2,
+                   const unsigned int *windows,
+                   unsigned int       num_windows,
+                   int                delta)
+{
+  char          *window;
+  unsigned int  w, n, k, num_subopt;
+  float         emin;
+  duplexT       *subopt, *sub, *local;
+
+  subopt      = (duplexT *)vrna_alloc(sizeof(duplexT));
+  num_subopt  = 0;
+  emin        = (float)INF;
+
+  for (w = 0; w < num_windows; w++) {
+    window  = get_window(s1, windows[2 * w], windows[2 * w + 1]);
+    local   = duplex_subopt(window, s2, delta, 5);
+    free(window);
+
+    for (n = 0; local[n].i > 0; n++);
+
+    subopt = (duplexT *)vrna_realloc(subopt, sizeof(duplexT) * (num_subopt + n + 1));
+
+    for (sub = local; sub->i > 0; sub++) {
+      sub->i                += windows[2 * w] - 1;
+      subopt[num_subopt++]  = *sub;
+      emin                  = MIN2(emin, sub->energy);
+    }
+
+    free(local);
+  }
+
+  /*
+   *  each window only knows its own mfe, so remove all structures
+   *  outside the energy range of the global optimum
+   */
+  for (n = k = 0; n < num_subopt; n++) {
+    if ((int)(subopt[n].energy * 100. + 0.1) <= (int)(emin * 100. + 0.1) + delta)
+      subopt[k++] = subopt[n];
+    else
+      free(subopt[n].structure);
+  }
+
+  num_subopt = k;
+
+  if (subopt_sorted)
+    qsort(subopt, num_subopt, sizeof(duplexT), compare_duplex);
+
+  subopt[num_subopt].i          = 0;
+  subopt[num_subopt].j          = 0;
+  subopt[num_subopt].structure  = NULL;
+
+  return subopt;
+}
+
+
+PRIVATE int
+compare_duplex(const void *sub1,
+               const void *sub2)
+{
+  int d;
+
+  if (((duplexT *)sub1)->energy > ((duplexT *)sub2)->energy)
+    return 1;
+
+  if (((duplexT *)sub1)->energy < ((duplexT *)sub2)->energy)
+    return -1;
+
+  d = ((duplexT *)sub1)->i - ((duplexT *)sub2)->i;
+  if (d != 0)
+    return d;
+
+  return ((duplexT *)sub1)->j - ((duplexT *)sub2)->j;
+}
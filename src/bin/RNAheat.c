@@ -153,6 +153,9 @@ flush_cstr_callback(void          *auxdata,
 {
   struct output_stream *s = (struct output_stream *)data;
 
+  if (!s)
+    return;
+
   /* flush/free errors first */
   vrna_cstr_free(s->err);
 
@@ -237,32 +240,10 @@ main(int  argc,
 
   ggo_geometry_settings(args_info, &(opt.md));
 
-  if (args_info.jobs_given) {
-#if VRNA_WITH_PTHREADS
-    int thread_max = max_user_threads();
-    if (args_info.jobs_arg == 0) {
-      /* use maximum of concurrent threads */
-      int proc_cores, proc_cores_conf;
-      if (num_proc_cores(&proc_cores, &proc_cores_conf)) {
-        opt.jobs = MIN2(thread_max, proc_cores_conf);
-      } else {
-        vrna_message_warning("Could not determine number of available processor cores!\n"
-                             "Defaulting to serial computation");
-        opt.jobs = 1;
-      }
-    } else {
-      opt.jobs = MIN2(thread_max, args_info.jobs_arg);
-    }
+  ggo_get_jobs(args_info, opt.jobs, "RNAheat");
 
-    opt.jobs = MAX2(1, opt.jobs);
-#else
-    vrna_message_warning(
-      "This version of RNAheat has been built without parallel input processing capabilities");
-#endif
-
-    if (args_info.unordered_given)
-      opt.keep_order = 0;
-  }
+  if (args_info.unordered_given)
+    opt.keep_order = 0;
 
   input_files = collect_unnamed_options(&args_info, &num_input);
   input_files = append_input_files(&args_info, input_files, &num_input);
@@ -445,6 +426,18 @@ process_record(struct record_data *record)
   if (!fc) {
     vrna_message_warning("Skipping computations for \"%s\"",
                          (record->id) ? record->id : "identifier unavailable");
+
+    /* release our slot in the output queue, otherwise any subsequent output stalls */
+    if (opt->output_queue)
+      vrna_ostream_provide(opt->output_queue, record->number, NULL);
+
+    free(o_stream);
+    free(record->id);
+    free(record->SEQ_ID);
+    free(record->sequence);
+    free(rec_sequence);
+    free(record->input_filename);
+    free(record);
     return;
   }
 
@@ -12,6 +12,7 @@
 #include <ctype.h>
 #include <dirent.h>
 #include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,8 +34,13 @@
 #include "ViennaRNA/plotting/alignments.h"
 #include "ViennaRNA/params/io.h"
 #include "ViennaRNA/io/utils.h"
+#include "ViennaRNA/io/accessibility_store.h"
+#include "ViennaRNA/search/seeds.h"
+#include "ViennaRNA/datastructures/char_stream.h"
+#include "ViennaRNA/datastructures/stream_output.h"
 
 #include "gengetopt_helpers.h"
+#include "parallel_helpers.h"
 #include "RNAplex_cmdl.h"
 
 
@@ -73,6 +79,34 @@ average_accessibility_target(char       **names,
                              int        fast);
 
 
+static int **
+read_accessibility(const char *access,
+                   const char *id,
+                   const int  beg,
+                   const int  end,
+                   double     verhaeltnis,
+                   const int  length,
+                   int        binaries,
+                   int        fast,
+                   char       **source);
+
+
+static int **
+read_accessibility_store(const char *id,
+                         const int  beg,
+                         const int  end,
+                         const int  length,
+                         int        fast);
+
+
+static void
+free_accessibility(int **access);
+
+
+/* accessibility store as written by RNAplfold --store */
+static vrna_acc_store_t *acc_store = NULL;
+
+
 /* static int ** average_accessibility_query(char **names, char **ALN, int number, char *access, double verhaeltnis); */
 static int
 get_max_u(const char  *s,
@@ -171,6 +205,98 @@ static int
 convert_plfold_i(char *fname);           /* convert test accessibility into bin accessibility. */
 
 
+/* a query or target sequence together with its accessibility profile */
+struct plex_sequence {
+  char              *id;
+  char              *seq;     /* upper case sequence, padded with 10 N's at both ends */
+  int               length;
+  int               **access; /* accessibility profile, NULL if not available */
+  char              *source;  /* where the accessibility profile was looked up */
+  vrna_seed_index_t *seeds; /* k-mer index of a target for the seed prefilter */
+  unsigned int      users;  /* pending work units that still use this target */
+};
+
+/* settings shared by all query x target work units */
+struct plex_options {
+  int             accessibility;
+  char            *access_dir;
+  double          verhaeltnis;
+  int             binaries;
+  int             noconv;
+  int             threshold;
+  int             extension_cost;
+  int             alignment_length;
+  int             deltaz;
+  int             fast;
+  int             il_a;
+  int             il_b;
+  int             b_a;
+  int             b_b;
+
+  int             seed;
+  unsigned int    seed_start;
+  unsigned int    seed_length;
+  unsigned int    seed_gu;
+
+  int             jobs;
+  int             keep_order;
+  unsigned int    next_record_number;
+  vrna_ostream_t  output_queue;
+};
+
+/* a single query x target work unit */
+struct plex_record {
+  unsigned int          number;
+  struct plex_sequence  *target;
+  struct plex_sequence  *query;
+  struct plex_options   *options;
+};
+
+static int
+plex_targets(const char           *tname,
+             const char           *qname,
+             struct plex_options  *opt);
+
+
+static void
+process_plex_record(struct plex_record *record);
+
+
+static struct plex_sequence *
+read_plex_sequence(FILE *fp,
+                   int  noconv);
+
+
+static void
+free_plex_sequence(struct plex_sequence *s);
+
+
+static void
+plex_window(struct plex_record  *record,
+            unsigned int        start,
+            unsigned int        end);
+
+
+static void
+plex_message(struct plex_options  *opt,
+             const char           *format,
+             ...);
+
+
+static void
+flush_plex_output(void          *auxdata,
+                  unsigned int  i,
+                  void          *data);
+
+
+static void
+acquire_target_slot(unsigned int max_targets);
+
+
+static void
+release_target(struct plex_sequence *target);
+
+
 static char scale[] = "....,....1....,....2....,....3....,....4"
                       "....,....5....,....6....,....7....,....8";
 
@@ -230,6 +356,18 @@ main(int  argc,
   double                          k_concentration     = 0;
   double                          tris_concentration  = 0;
   int                             probe_mode          = 0;
+  /**
+   * Parallel processing of query x target pairs
+   */
+  int                             jobs        = 1;
+  int                             keep_order  = 1;
+  /**
+   * Seed prefilter
+   */
+  int                             seed        = 0;
+  unsigned int                    seed_start  = VRNA_SEED_DEFAULT_START;
+  unsigned int                    seed_length = VRNA_SEED_DEFAULT_LENGTH;
+  unsigned int                    seed_gu     = 1;
   /*
    #############################################
    # check the command line parameters
@@ -264,6 +402,14 @@ main(int  argc,
   if (args_info.accessibility_dir_given)
     access = strdup(args_info.accessibility_dir_arg);
 
+  /*accessibility store*/
+  if (args_info.accessibility_store_given) {
+    acc_store = vrna_acc_store_open(args_info.accessibility_store_arg);
+    if (acc_store == NULL)
+      vrna_message_error("Failed to open accessibility store \"%s\"",
+                         args_info.accessibility_store_arg);
+  }
+
   /*produce ps arg*/
   if (args_info.produce_ps_given) {
     Resultfile  = strdup(args_info.produce_ps_arg);
@@ -312,6 +458,44 @@ main(int  argc,
   /*probe concentration*/
   probe_concentration = args_info.probe_concentration_arg;
 
+  if (args_info.seed_given) {
+    seed = 1;
+
+    if ((args_info.seed_start_arg < 1) ||
+        (args_info.seed_length_arg < 1) ||
+        (args_info.seed_length_arg > VRNA_SEED_MAX_LENGTH)) {
+      vrna_message_warning("Seed must start at a position > 0 and have a length of 1 to %d nt, "
+                           "falling back to default seed %d-%d",
+                           VRNA_SEED_MAX_LENGTH,
+                           VRNA_SEED_DEFAULT_START,
+                           VRNA_SEED_DEFAULT_START + VRNA_SEED_DEFAULT_LENGTH - 1);
+    } else {
+      seed_start  = (unsigned int)args_info.seed_start_arg;
+      seed_length = (unsigned int)args_info.seed_length_arg;
+    }
+
+    seed_gu = (unsigned int)MAX2(0, args_info.seed_gu_arg);
+  }
+
+  ggo_get_jobs(args_info, jobs, "RNAplex");
+
+#ifndef _OPENMP
+  /*
+   *  the Lduplexfold*() functions keep their state in static variables
+   *  that are only thread-local if OpenMP is available
+   */
+  if (jobs > 1) {
+    vrna_message_warning(
+      "This version of RNAplex has been built without OpenMP support, "
+      "falling back to serial computation");
+    jobs = 1;
+  }
+
+#endif
+
+  if (args_info.unordered_given)
+    keep_order = 0;
+
   ggo_get_read_paramFile(args_info, NULL);
   ggo_geometry_settings(args_info, NULL);
 
@@ -340,6 +524,16 @@ main(int  argc,
 
   int il_a, il_b, b_a, b_b;
   linear_fit(&il_a, &il_b, &b_a, &b_b);
+
+  if (acc_store) {
+    vrna_md_t md;
+    set_model_details(&md);
+    if (!vrna_acc_store_params_match(acc_store, &md))
+      vrna_message_warning("The accessibility store was computed with different energy parameters\n"
+                           "or at a different temperature (%g C)!",
+                           vrna_acc_store_temperature(acc_store));
+  }
+
   /**
    * check if we have two input files
    */
@@ -571,384 +765,57 @@ main(int  argc,
         nonstandards[i++] = *c++;
         nonstandards[i++] = *c;
         if ((sym) && (*c != *(c - 1))) {
-          nonstandards[i++] = *c;
-          nonstandards[i++] = *(c - 1);
-        }
-      }
-
-      c++;
-    }
-  }
-
-  int il_a, il_b, b_a, b_b;
-  linear_fit(&il_a, &il_b, &b_a, &b_b);
-#endif
-  /**
-   * check if we have two input files
-   */
-  if ((qname == NULL && tname) || (qname && tname == NULL)) {
-    RNAplex_cmdline_parser_print_help();
-  } else if (qname && tname && !(alignment_mode)) {
-    /*free allocated memory of commandline parser*/
-    RNAplex_cmdline_parser_free(&args_info);
-
-    if (!fold_constrained) {
-      if (access) {
-        char *id_s1 = NULL;
-        mRNA = fopen(tname, "r");
-        if (mRNA == NULL) {
-          printf("%s: Wrong target file name\n", tname);
-          RNAplex_cmdline_parser_free(&args_info);
-          return 0;
-        }
-
-        sRNA = fopen(qname, "r");
-        if (sRNA == NULL) {
-          printf("%s: Wrong quert file name\n", qname);
-          RNAplex_cmdline_parser_free(&args_info);
-          return 0;
-        }
-
-        do {
-          /* main loop: continue until end of file */
-          if ((line_t = vrna_read_line(mRNA)) == NULL)
-            break;
-
-          /*parse line, get id for further accessibility fetching*/
-          while ((*line_t == '*') || (*line_t == '\0') || (*line_t == '>')) {
-            if (*line_t == '>') {
-              if (id_s1) {
-                free(id_s1);
-                id_s1 = NULL;
-              }
-
-              id_s1 = (char *)vrna_alloc(strlen(line_t) + 2);
-              (void)sscanf(line_t, "%s", id_s1);
-              memmove(id_s1, id_s1 + 1, strlen(id_s1));
-              free(line_t);
-              line_t = NULL;
-            }
-
-            if (line_t)
-              free(line_t);
-
-            if ((line_t = vrna_read_line(mRNA)) == NULL)
-              break;
-          }
-          /*append N's to the sequence in order to avoid boundary checking*/
-          if ((line_t == NULL) || (strcmp(line_t, "@") == 0)) {
-            if (id_s1) {
-              free(id_s1);
-              id_s1 = NULL;
-            }
-
-            break;
-          }
-
-          s1 = (char *)vrna_alloc(strlen(line_t) + 1 + 20);
-          strcpy(s1, "NNNNNNNNNN"); /*add NNNNNNNNNN to avoid boundary check*/
-          strcat(s1, line_t);
-          free(line_t);
-          strcat(s1, "NNNNNNNNNN\0");
-          int s1_len;
-          s1_len = strlen(s1);
-          for (l = 0; l < s1_len; l++) {
-            s1[l] = toupper(s1[l]);
-            if (!noconv && s1[l] == 'T')
-              s1[l] = 'U';
-          }
-
-          /*read accessibility*/
-          int   **access_s1;
-          char  *file_s1;
-          file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(id_s1) + strlen(access) + 20));
-          strcpy(file_s1, access);
-          strcat(file_s1, "/");
-          strcat(file_s1, id_s1);
-          strcat(file_s1, "_openen");
-          if (!binaries) {
-            access_s1 = read_plfold_i(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
-          } else {
-            strcat(file_s1, "_bin");
-            access_s1 = read_plfold_i_bin(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
-          }
-
-          if (access_s1 == NULL) {
-            printf("Accessibility file %s not found or corrupt, look at next target RNA\n",
-                   file_s1);
-            free(file_s1);
-            free(s1);
-            free(id_s1);
-            id_s1 = NULL;
-            continue;
-          }
-
-          do {
-            char *id_s2 = NULL;
-            if ((line_q = vrna_read_line(sRNA)) == NULL)
-              break;
-
-            while ((*line_q == '*') || (*line_q == '\0') || (*line_q == '>')) {
-              if (*line_q == '>') {
-                if (id_s2) {
-                  free(id_s2);
-                  id_s2 = NULL;
-                }
-
-                id_s2 = (char *)vrna_alloc(strlen(line_q) + 2);
-                (void)sscanf(line_q, "%s", id_s2);
-                memmove(id_s2, id_s2 + 1, strlen(id_s2));
-                free(line_q);
-                line_q = NULL;
-              }
-
-              if (line_q)
-                free(line_q);
-
-              if ((line_q = vrna_read_line(sRNA)) == NULL)
-                break;
-            }
-            if ((line_q == NULL) || (strcmp(line_q, "@") == 0)) {
-              if (id_s2) {
-                free(id_s2);
-                id_s2 = NULL;
-              }
-
-              break;
-            }
-
-            if (!id_s2) {
-              free(line_q);
-              continue;
-            }
-
-            s2 = (char *)vrna_alloc(strlen(line_q) + 1 + 20);
-            strcpy(s2, "NNNNNNNNNN"); /*add NNNNNNNNNN to avoid boundary check*/
-            strcat(s2, line_q);
-            free(line_q);
-            strcat(s2, "NNNNNNNNNN\0");
-            int s2_len;
-            s2_len = strlen(s2);
-            for (l = 0; l < s2_len; l++) {
-              s2[l] = toupper(s2[l]);
-              if (!noconv && s2[l] == 'T')
-                s2[l] = 'U';
-            }
-            int   **access_s2;
-            char  *file_s2;
-            file_s2 = (char *)vrna_alloc(sizeof(char) * (strlen(id_s2) + strlen(access) + 20));
-            strcpy(file_s2, access);
-            strcat(file_s2, "/");
-            strcat(file_s2, id_s2);
-            strcat(file_s2, "_openen");
-            if (!binaries) {
-              access_s2 = read_plfold_i(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
-            } else {
-              strcat(file_s2, "_bin");
-              access_s2 =
-                read_plfold_i_bin(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
-            }
-
-            if (access_s2 == NULL) {
-              printf("Accessibility file %s not found, look at next target RNA\n", file_s2);
-              free(file_s2);
-              free(s2);
-              free(id_s2);
-              id_s2 = NULL;
-              continue;
-            }
-
-            printf(">%s\n>%s\n", id_s1, id_s2);
-            double begin = BeginTimer();
-            Lduplexfold_XS(s1,
-                           s2,
-                           (const int **)access_s1,
-                           (const int **)access_s2,
-                           delta,
-                           alignment_length,
-                           deltaz,
-                           fast,
-                           il_a,
-                           il_b,
-                           b_a,
-                           b_b);
-            float elapTicks;
-            float elapMilli;
-            elapTicks = (EndTimer(begin) - begin);
-            elapMilli = elapTicks / 1000;
-            /*             printf("Millisecond %.2f\n",elapMilli); */
-            free(id_s2);
-            free(file_s2);
-            free(s2);
-            id_s2 = NULL;
-            i     = access_s2[0][0];
-            while (--i > -1)
-              free(access_s2[i]);
-            free(access_s2);
-          } while (1);
-          free(id_s1);
-          id_s1 = NULL;
-          free(file_s1);
-          free(s1);
-          rewind(sRNA);
-          i = access_s1[0][0];
-          while (--i > -1)
-            free(access_s1[i]);
-          free(access_s1);
-        } while (1);
-        fclose(mRNA);
-        fclose(sRNA);
-      } else if (access == NULL) {
-        /* t and q are defined, but no accessibility is provided */
-        mRNA = fopen(tname, "r");
-        if (mRNA == NULL) {
-          printf("%s: Wrong target file name\n", tname);
-          RNAplex_cmdline_parser_free(&args_info);
-          return 0;
-        }
-
-        sRNA = fopen(qname, "r");
-        if (sRNA == NULL) {
-          printf("%s: Wrong query file name\n", qname);
-          RNAplex_cmdline_parser_free(&args_info);
-          return 0;
-        }
-
-        do {
-          /* main loop: continue until end of file */
-          char *id_s1 = NULL; /* header of the target file  */
-          if ((line_t = vrna_read_line(mRNA)) == NULL)
-            break;
-
-          /*parse line, get id for further accessibility fetching*/
-          while ((*line_t == '*') || (*line_t == '\0') || (*line_t == '>')) {
-            if (*line_t == '>') {
-              if (id_s1) {
-                /* in case we have two header the one after the other */
-                free(id_s1);     /* free the old header, a put the new one instead */
-                id_s1 = NULL;
-              }
-
-              id_s1 = (char *)vrna_alloc(strlen(line_t) + 2);
-              (void)sscanf(line_t, "%s", id_s1);
-              memmove(id_s1, id_s1 + 1, strlen(id_s1));
-              free(line_t);
-              line_t = NULL;
-            }
-
-            if (line_t)
-              free(line_t);
-
-            if ((line_t = vrna_read_line(mRNA)) == NULL)
-              break;
-          }
-          /*append N's to the sequence in order to avoid boundary checking*/
-          if ((line_t == NULL) || (strcmp(line_t, "@") == 0)) {
-            if (id_s1) {
-              free(id_s1);
-              id_s1 = NULL;
-            }
-
-            break;
-          }
-
-          s1 = (char *)vrna_alloc(strlen(line_t) + 1 + 20);
-          strcpy(s1, "NNNNNNNNNN"); /*add NNNNNNNNNN to avoid boundary check*/
-          strcat(s1, line_t);
-          free(line_t);
-          strcat(s1, "NNNNNNNNNN\0");
-          int s1_len;
-          s1_len = strlen(s1);
-          for (l = 0; l < s1_len; l++) {
-            s1[l] = toupper(s1[l]);
-            if (!noconv && s1[l] == 'T')
-              s1[l] = 'U';
-          }
-          do {
-            /*read sRNA files*/
-            char *id_s2 = NULL;
-            if ((line_q = vrna_read_line(sRNA)) == NULL)
-              break;
-
-            while ((*line_q == '*') || (*line_q == '\0') || (*line_q == '>')) {
-              if (*line_q == '>') {
-                if (id_s2) {
-                  free(id_s2);
-                  id_s2 = NULL;
-                }
-
-                id_s2 = (char *)vrna_alloc(strlen(line_q) + 2);
-                (void)sscanf(line_q, "%s", id_s2);
-                memmove(id_s2, id_s2 + 1, strlen(id_s2));
-                free(line_q);
-                line_q = NULL;
-              }
-
-              if (line_q)
-                free(line_q);
-
-              if ((line_q = vrna_read_line(sRNA)) == NULL)
-                break;
-            }
-            if ((line_q == NULL) || (strcmp(line_q, "@") == 0)) {
-              if (id_s2)
-                free(id_s2);
+          nonstandards[i++] = *c;
+          nonstandards[i++] = *(c - 1);
+        }
+      }
 
-              break;
-            }
+      c++;
+    }
+  }
 
-            if (!id_s2) {
-              free(line_q);
-              continue;
-            }
+  int il_a, il_b, b_a, b_b;
+  linear_fit(&il_a, &il_b, &b_a, &b_b);
+#endif
+  /**
+   * check if we have two input files
+   */
+  if ((qname == NULL && tname) || (qname && tname == NULL)) {
+    RNAplex_cmdline_parser_print_help();
+  } else if (qname && tname && !(alignment_mode)) {
+    /*free allocated memory of commandline parser*/
+    RNAplex_cmdline_parser_free(&args_info);
 
-            s2 = (char *)vrna_alloc(strlen(line_q) + 1 + 20);
-            strcpy(s2, "NNNNNNNNNN"); /*add NNNNNNNNNN to avoid boundary check*/
-            strcat(s2, line_q);
-            free(line_q);
-            strcat(s2, "NNNNNNNNNN\0");
-            int s2_len;
-            s2_len = strlen(s2);
-            for (l = 0; l < s2_len; l++) {
-              s2[l] = toupper(s2[l]);
-              if (!noconv && s2[l] == 'T')
-                s2[l] = 'U';
-            }
-            printf(">%s\n>%s\n", id_s1, id_s2);
-            /*             double begin = BeginTimer(); */
-            Lduplexfold(s1,
-                        s2,
-                        delta,
-                        extension_cost,
-                        alignment_length,
-                        deltaz,
-                        fast,
-                        il_a,
-                        il_b,
-                        b_a,
-                        b_b);
-            /*
-             * float elapTicks;
-             * float elapMilli;
-             * elapTicks = (EndTimer(begin) - begin);
-             * elapMilli = elapTicks/1000;
-             * printf("Millisecond %.2f\n",elapMilli);
-             * printf("\n");
-             */
-            free(id_s2);
-            id_s2 = NULL;
-            free(s2);
-          } while (1);
-          free(id_s1);
-          id_s1 = NULL;
-          free(s1);
-          rewind(sRNA);
-        } while (1);
-        fclose(mRNA);
-        fclose(sRNA);
-      }
+    if (!fold_constrained) {
+      struct plex_options opt;
+
+      opt.accessibility       = (access || acc_store) ? 1 : 0;
+      opt.access_dir          = access;
+      opt.verhaeltnis         = verhaeltnis;
+      opt.binaries            = binaries;
+      opt.noconv              = noconv;
+      opt.threshold           = delta;
+      opt.extension_cost      = extension_cost;
+      opt.alignment_length    = alignment_length;
+      opt.deltaz              = deltaz;
+      opt.fast                = fast;
+      opt.il_a                = il_a;
+      opt.il_b                = il_b;
+      opt.b_a                 = b_a;
+      opt.b_b                 = b_b;
+      opt.seed                = seed;
+      opt.seed_start          = seed_start;
+      opt.seed_length         = seed_length;
+      opt.seed_gu             = seed_gu;
+      opt.jobs                = jobs;
+      opt.keep_order          = keep_order;
+      opt.next_record_number  = 0;
+      opt.output_queue        = NULL;
+
+      if (!plex_targets(tname, qname, &opt))
+        return 0;
     } else {
-      if (access) {
+      if (access || acc_store) {
         char *id_s1 = NULL;
         mRNA = fopen(tname, "r");
         if (mRNA == NULL) {
@@ -1017,17 +884,15 @@ main(int  argc,
           /*read accessibility*/
           int   **access_s1;
           char  *file_s1;
-          file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(id_s1) + strlen(access) + 20));
-          strcpy(file_s1, access);
-          strcat(file_s1, "/");
-          strcat(file_s1, id_s1);
-          strcat(file_s1, "_openen");
-          if (!binaries) {
-            access_s1 = read_plfold_i(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
-          } else {
-            strcat(file_s1, "_bin");
-            access_s1 = read_plfold_i_bin(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
-          }
+          access_s1 = read_accessibility(access,
+                                         id_s1,
+                                         1,
+                                         s1_len,
+                                         verhaeltnis,
+                                         alignment_length,
+                                         binaries,
+                                         fast,
+                                         &file_s1);
 
           if (access_s1 == NULL) {
             printf("Accessibility file %s not found, look at next target RNA\n", file_s1);
@@ -1111,18 +976,15 @@ main(int  argc,
 
             int   **access_s2;
             char  *file_s2;
-            file_s2 = (char *)vrna_alloc(sizeof(char) * (strlen(id_s2) + strlen(access) + 20));
-            strcpy(file_s2, access);
-            strcat(file_s2, "/");
-            strcat(file_s2, id_s2);
-            strcat(file_s2, "_openen");
-            if (!binaries) {
-              access_s2 = read_plfold_i(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
-            } else {
-              strcat(file_s2, "_bin");
-              access_s2 =
-                read_plfold_i_bin(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
-            }
+            access_s2 = read_accessibility(access,
+                                           id_s2,
+                                           1,
+                                           s2_len,
+                                           verhaeltnis,
+                                           alignment_length,
+                                           binaries,
+                                           fast,
+                                           &file_s2);
 
             if (access_s2 == NULL) {
               printf("Accessibility file %s not found, look at next target RNA\n", file_s2);
@@ -1149,10 +1011,7 @@ main(int  argc,
             free(id_s2);
             free(file_s2);
             free(s2);
-            i = access_s2[0][0];
-            while (--i > -1)
-              free(access_s2[i]);
-            free(access_s2);
+            free_accessibility(access_s2);
             free(structure);
           } while (1);
           free(id_s1);
@@ -1160,14 +1019,11 @@ main(int  argc,
           free(file_s1);
           free(s1);
           rewind(sRNA);
-          i = access_s1[0][0];
-          while (--i > -1)
-            free(access_s1[i]);
-          free(access_s1);
+          free_accessibility(access_s1);
         } while (1);
         fclose(mRNA);
         fclose(sRNA);
-      } else if (access == NULL) {
+      } else if ((access == NULL) && (acc_store == NULL)) {
         /* t and q are defined, but no accessibility is provided */
         char *id_s1 = NULL;
         mRNA = fopen(tname, "r");
@@ -1457,7 +1313,7 @@ main(int  argc,
       if (alignment_length == 0)
         alignment_length = 40;
 
-      if (access == NULL) {
+      if ((access == NULL) && (acc_store == NULL)) {
         if (!fold_constrained) {
           Lduplexfold(s1,
                       s2,
@@ -1500,42 +1356,37 @@ main(int  argc,
           vrna_message_error(
             "The fasta files has no header information..., cant fetch accessibility file\n");
 
-        file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(id_s1) + strlen(access) + 20));
-        file_s2 = (char *)vrna_alloc(sizeof(char) * (strlen(id_s2) + strlen(access) + 20));
-        strcpy(file_s1, access);
-        strcpy(file_s2, access);
-        strcat(file_s1, "/");
-        strcat(file_s2, "/");
-        strcat(file_s1, id_s1);
-        strcat(file_s2, id_s2);
-        strcat(file_s1, "_openen");
-        strcat(file_s2, "_openen");
-        if (!binaries) {
-          access_s1 = read_plfold_i(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
-        } else {
-          strcat(file_s1, "_bin");
-          access_s1 = read_plfold_i_bin(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
-        }
+        access_s1 = read_accessibility(access,
+                                       id_s1,
+                                       1,
+                                       s1_len,
+                                       verhaeltnis,
+                                       alignment_length,
+                                       binaries,
+                                       fast,
+                                       &file_s1);
 
         if (access_s1 == NULL) {
           free(file_s1);
           free(s1);
           free(s2);
-          free(file_s2);
           free(id_s1);
           free(id_s2);
           continue;
         }
 
-        if (!binaries) {
-          access_s2 = read_plfold_i(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
-        } else {
-          strcat(file_s2, "_bin");
-          access_s2 = read_plfold_i_bin(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
-        }
+        access_s2 = read_accessibility(access,
+                                       id_s2,
+                                       1,
+                                       s2_len,
+                                       verhaeltnis,
+                                       alignment_length,
+                                       binaries,
+                                       fast,
+                                       &file_s2);
 
         if (access_s2 == NULL) {
-          free(access_s1);
+          free_accessibility(access_s1);
           free(file_s1);
           free(s1);
           free(s2);
@@ -1580,14 +1431,8 @@ main(int  argc,
                           b_b);                                                                                                                             /* , target_dead, query_dead); */
         }
 
-        i = access_s1[0][0];
-        while (--i > -1)
-          free(access_s1[i]);
-        i = access_s2[0][0];
-        while (--i > -1)
-          free(access_s2[i]);
-        free(access_s1);
-        free(access_s2);
+        free_accessibility(access_s1);
+        free_accessibility(access_s2);
         free(file_s1);
         free(file_s2);
         free(id_s1);
@@ -1661,7 +1506,7 @@ main(int  argc,
     AS2[n_seq]  = NULL;
 
 
-    if (access == NULL) {
+    if ((access == NULL) && (acc_store == NULL)) {
       aliLduplexfold((const char **)AS1,
                      (const char **)AS2,
                      n_seq * delta,
@@ -1742,6 +1587,11 @@ main(int  argc,
     access = NULL;
   }
 
+  if (acc_store) {
+    vrna_acc_store_close(acc_store);
+    acc_store = NULL;
+  }
+
   if (qname) {
     free(tname);
     access = NULL;
@@ -1757,6 +1607,442 @@ main(int  argc,
 }
 
 
+#if VRNA_WITH_PTHREADS
+static pthread_mutex_t  target_mutex    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   target_released = PTHREAD_COND_INITIALIZER;
+#endif
+static unsigned int     targets_alive = 0;
+
+/*
+ * Scan all targets against all queries. Queries and their accessibility
+ * profiles are read only once and kept in memory. Each target is prepared
+ * only once and then shared among the work units of all queries, which
+ * are processed in parallel. The target is released as soon as the last
+ * of its work units is finished.
+ */
+static int
+plex_targets(const char           *tname,
+             const char           *qname,
+             struct plex_options  *opt)
+{
+  FILE                  *mRNA, *sRNA;
+  unsigned int          i, num_queries, num_usable;
+  struct plex_sequence  *target, *query, **queries;
+  struct plex_record    *record;
+
+  mRNA = fopen(tname, "r");
+  if (mRNA == NULL) {
+    printf("%s: Wrong target file name\n", tname);
+    return 0;
+  }
+
+  sRNA = fopen(qname, "r");
+  if (sRNA == NULL) {
+    printf("%s: Wrong query file name\n", qname);
+    fclose(mRNA);
+    return 0;
+  }
+
+  num_queries = 0;
+  num_usable  = 0;
+  queries     = NULL;
+
+  while ((query = read_plex_sequence(sRNA, opt->noconv))) {
+    /* queries without FASTA header are ignored */
+    if (!query->id) {
+      free_plex_sequence(query);
+      continue;
+    }
+
+    if (opt->accessibility)
+      query->access = read_accessibility(opt->access_dir,
+                                         query->id,
+                                         1,
+                                         query->length,
+                                         opt->verhaeltnis,
+                                         opt->alignment_length,
+                                         opt->binaries,
+                                         opt->fast,
+                                         &(query->source));
+
+    if ((!opt->accessibility) || (query->access))
+      num_usable++;
+
+    queries = (struct plex_sequence **)vrna_realloc(queries,
+                                                    sizeof(struct plex_sequence *) *
+                                                    (num_queries + 1));
+    queries[num_queries++] = query;
+  }
+
+  fclose(sRNA);
+
+  if (opt->keep_order)
+    opt->output_queue = vrna_ostream_init(&flush_plex_output, NULL);
+
+  INIT_PARALLELIZATION(opt->jobs);
+
+  while ((target = read_plex_sequence(mRNA, opt->noconv))) {
+    if (opt->accessibility) {
+      target->access = read_accessibility(opt->access_dir,
+                                          target->id,
+                                          1,
+                                          target->length,
+                                          opt->verhaeltnis,
+                                          opt->alignment_length,
+                                          opt->binaries,
+                                          opt->fast,
+                                          &(target->source));
+
+      if (target->access == NULL) {
+        plex_message(opt,
+                     "Accessibility file %s not found or corrupt, look at next target RNA\n",
+                     target->source);
+        free_plex_sequence(target);
+        continue;
+      }
+    }
+
+    if (opt->seed)
+      target->seeds = vrna_seed_index(target->seq, opt->seed_length);
+
+    /* limit the number of targets kept in memory */
+    acquire_target_slot(2 * opt->jobs);
+
+    /* one reference per work unit, plus one held until all work units are dispatched */
+    target->users = num_usable + 1;
+
+    for (i = 0; i < num_queries; i++) {
+      if ((opt->accessibility) && (queries[i]->access == NULL)) {
+        plex_message(opt,
+                     "Accessibility file %s not found, look at next target RNA\n",
+                     queries[i]->source);
+        continue;
+      }
+
+      record          = (struct plex_record *)vrna_alloc(sizeof(struct plex_record));
+      record->number  = opt->next_record_number;
+      record->target  = target;
+      record->query   = queries[i];
+      record->options = opt;
+
+      if (opt->output_queue)
+        vrna_ostream_request(opt->output_queue, opt->next_record_number++);
+
+      RUN_IN_PARALLEL(process_plex_record, record);
+    }
+
+    release_target(target);
+  }
+
+  UNINIT_PARALLELIZATION
+
+  vrna_ostream_free(opt->output_queue);
+  opt->output_queue = NULL;
+
+  for (i = 0; i < num_queries; i++)
+    free_plex_sequence(queries[i]);
+
+  free(queries);
+  fclose(mRNA);
+
+  return 1;
+}
+
+
+static void
+process_plex_record(struct plex_record *record)
+{
+  unsigned int          w, num_windows, *windows, first, last;
+  vrna_cstr_t           output;
+  struct plex_sequence  *target, *query;
+  struct plex_options   *opt;
+
+  target  = record->target;
+  query   = record->query;
+  opt     = record->options;
+  output  = vrna_cstr(4 * query->length, stdout);
+
+  if (target->seeds) {
+    /* only scan the windows around admissible seeds, skipping the N's at both ends */
+    windows = vrna_seed_windows(target->seeds,
+                                query->seq,
+                                opt->seed_start + 10,
+                                opt->seed_gu,
+                                opt->alignment_length,
+                                opt->alignment_length,
+                                &num_windows);
+
+    if (num_windows > 0)
+      vrna_cstr_printf(output, ">%s\n>%s\n", target->id, query->id);
+
+    Lduplexfold_set_output(output);
+
+    for (w = 0; w < num_windows; w++) {
+      first = MAX2(11, windows[2 * w]);
+      last  = MIN2(target->length - 10, windows[2 * w + 1]);
+      plex_window(record, first, last);
+    }
+
+    Lduplexfold_set_output(NULL);
+    Lduplexfold_set_target_offset(0);
+
+    free(windows);
+  } else {
+    vrna_cstr_printf(output, ">%s\n>%s\n", target->id, query->id);
+
+    Lduplexfold_set_output(output);
+
+    if (opt->accessibility)
+      Lduplexfold_XS(target->seq,
+                     query->seq,
+                     (const int **)target->access,
+                     (const int **)query->access,
+                     opt->threshold,
+                     opt->alignment_length,
+                     opt->deltaz,
+                     opt->fast,
+                     opt->il_a,
+                     opt->il_b,
+                     opt->b_a,
+                     opt->b_b);
+    else
+      Lduplexfold(target->seq,
+                  query->seq,
+                  opt->threshold,
+                  opt->extension_cost,
+                  opt->alignment_length,
+                  opt->deltaz,
+                  opt->fast,
+                  opt->il_a,
+                  opt->il_b,
+                  opt->b_a,
+                  opt->b_b);
+
+    Lduplexfold_set_output(NULL);
+  }
+
+  if (opt->output_queue)
+    vrna_ostream_provide(opt->output_queue, record->number, (void *)output);
+  else
+    ATOMIC_BLOCK(flush_plex_output(NULL, record->number, (void *)output));
+
+  release_target(record->target);
+  free(record);
+}
+
+
+/*
+ * scan the target window [start, end], given in positions of the
+ * padded target sequence, and report positions in the full target
+ */
+static void
+plex_window(struct plex_record  *record,
+            unsigned int        start,
+            unsigned int        end)
+{
+  char                  *window;
+  int                   k, offset, **access;
+  struct plex_sequence  *target, *query;
+  struct plex_options   *opt;
+
+  target  = record->target;
+  query   = record->query;
+  opt     = record->options;
+  offset  = (int)start - 11;
+
+  window = (char *)vrna_alloc(sizeof(char) * (end - start + 1 + 21));
+  strcpy(window, "NNNNNNNNNN"); /*add NNNNNNNNNN to avoid boundary check*/
+  strncat(window, target->seq + start - 1, end - start + 1);
+  strcat(window, "NNNNNNNNNN");
+
+  Lduplexfold_set_target_offset(offset);
+
+  if (opt->accessibility) {
+    /* the rows of the accessibility profile are simply shifted to the window */
+    access    = (int **)vrna_alloc(sizeof(int *) * target->access[0][0]);
+    access[0] = target->access[0];
+    for (k = 1; k < target->access[0][0]; k++)
+      access[k] = target->access[k] + offset;
+
+    Lduplexfold_XS(window,
+                   query->seq,
+                   (const int **)access,
+                   (const int **)query->access,
+                   opt->threshold,
+                   opt->alignment_length,
+                   opt->deltaz,
+                   opt->fast,
+                   opt->il_a,
+                   opt->il_b,
+                   opt->b_a,
+                   opt->b_b);
+
+    free(access);
+  } else {
+    Lduplexfold(window,
+                query->seq,
+                opt->threshold,
+                opt->extension_cost,
+                opt->alignment_length,
+                opt->deltaz,
+                opt->fast,
+                opt->il_a,
+                opt->il_b,
+                opt->b_a,
+                opt->b_b);
+  }
+
+  free(window);
+}
+
+
+static struct plex_sequence *
+read_plex_sequence(FILE *fp,
+                   int  noconv)
+{
+  char                  *line, *id;
+  int                   l;
+  struct plex_sequence  *s;
+
+  id = NULL;
+
+  if ((line = vrna_read_line(fp)) == NULL)
+    return NULL;
+
+  /* skip empty lines and comments, get the id for accessibility fetching */
+  while ((*line == '*') || (*line == '\0') || (*line == '>')) {
+    if (*line == '>') {
+      /* in case we have two headers the one after the other */
+      free(id);
+      id = (char *)vrna_alloc(strlen(line) + 2);
+      (void)sscanf(line, "%s", id);
+      memmove(id, id + 1, strlen(id));
+    }
+
+    free(line);
+
+    if ((line = vrna_read_line(fp)) == NULL)
+      break;
+  }
+
+  if ((line == NULL) || (strcmp(line, "@") == 0)) {
+    free(line);
+    free(id);
+    return NULL;
+  }
+
+  s     = (struct plex_sequence *)vrna_alloc(sizeof(struct plex_sequence));
+  s->id = id;
+
+  /* append N's to the sequence in order to avoid boundary checking */
+  s->seq = (char *)vrna_alloc(strlen(line) + 1 + 20);
+  strcpy(s->seq, "NNNNNNNNNN");
+  strcat(s->seq, line);
+  strcat(s->seq, "NNNNNNNNNN");
+  free(line);
+
+  s->length = (int)strlen(s->seq);
+  for (l = 0; l < s->length; l++) {
+    s->seq[l] = toupper(s->seq[l]);
+    if (!noconv && s->seq[l] == 'T')
+      s->seq[l] = 'U';
+  }
+
+  return s;
+}
+
+
+static void
+free_plex_sequence(struct plex_sequence *s)
+{
+  if (s) {
+    free_accessibility(s->access);
+    vrna_seed_index_free(s->seeds);
+    free(s->source);
+    free(s->seq);
+    free(s->id);
+    free(s);
+  }
+}
+
+
+/* messages are put into the output stream to keep them in order with the results */
+static void
+plex_message(struct plex_options  *opt,
+             const char           *format,
+             ...)
+{
+  va_list     args;
+  vrna_cstr_t output;
+
+  output = vrna_cstr(128, stdout);
+
+  va_start(args, format);
+  vrna_cstr_vprintf(output, format, args);
+  va_end(args);
+
+  if (opt->output_queue) {
+    vrna_ostream_request(opt->output_queue, opt->next_record_number);
+    vrna_ostream_provide(opt->output_queue, opt->next_record_number++, (void *)output);
+  } else {
+    ATOMIC_BLOCK(flush_plex_output(NULL, opt->next_record_number, (void *)output));
+  }
+}
+
+
+static void
+flush_plex_output(void          *auxdata,
+                  unsigned int  i,
+                  void          *data)
+{
+  vrna_cstr_free((vrna_cstr_t)data);
+}
+
+
+static void
+acquire_target_slot(unsigned int max_targets)
+{
+#if VRNA_WITH_PTHREADS
+  pthread_mutex_lock(&target_mutex);
+  while (targets_alive >= max_targets)
+    pthread_cond_wait(&target_released, &target_mutex);
+#endif
+
+  targets_alive++;
+
+#if VRNA_WITH_PTHREADS
+  pthread_mutex_unlock(&target_mutex);
+#endif
+}
+
+
+static void
+release_target(struct plex_sequence *target)
+{
+  unsigned int users;
+
+#if VRNA_WITH_PTHREADS
+  pthread_mutex_lock(&target_mutex);
+#endif
+
+  users = --target->users;
+
+  if (users == 0) {
+    targets_alive--;
+#if VRNA_WITH_PTHREADS
+    pthread_cond_signal(&target_released);
+#endif
+  }
+
+#if VRNA_WITH_PTHREADS
+  pthread_mutex_unlock(&target_mutex);
+#endif
+
+  if (users == 0)
+    free_plex_sequence(target);
+}
+
+
 #if 0
 static int
 print_struc(duplexT const *dup)
@@ -2085,15 +2371,15 @@ average_accessibility_target(char       **names,
   else
     location_flag = 0;
 
-  char *file_s1 = NULL;
+  char        *file_s1 = NULL;
+  const char  *id;
 
   for (i = 0; i < number; i++) {
     /*
      *  be careful!!!! Name should contain all characters from begin till the "/" character
      * char *s1;
      */
-    file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(names[i]) + strlen(access) + 20));
-    begin   = 1;
+    begin = 1;
     int sequence_length = get_sequence_length_from_alignment(ALN[i]);
     end = sequence_length;
     if (sscanf(names[i], "%255[^/]/%lld-%lld", bla, &begin, &end) == 3) {
@@ -2107,19 +2393,12 @@ average_accessibility_target(char       **names,
           sequence_length - 20);
         printf("Please check your input alignments and rerun RNAplex");
         int a = 0;
-        if (master_access != NULL) {
-          for (a = 0; a < i; a++) {
-            int j;
-            j = master_access[a][0][0];
-            while (--j > -1)
-              free(master_access[a][j]);
-            free(master_access[a]);
-          }
-        }
+        if (master_access != NULL)
+          for (a = 0; a < i; a++)
+            free_accessibility(master_access[a]);
 
         free(master_access);
         free(index);
-        free(file_s1);
         return average_access;
       }
 
@@ -2132,9 +2411,7 @@ average_accessibility_target(char       **names,
       }
 
       location_flag = 1;
-      strcpy(file_s1, access);
-      strcat(file_s1, "/");
-      strcat(file_s1, bla);
+      id            = bla;
     } else {
       if (location_flag == 1) {
         vrna_message_warning("\n!! Line %d in your target alignment does not contain location information\n"
@@ -2145,19 +2422,18 @@ average_accessibility_target(char       **names,
       }
 
       location_flag = 0;
-      strcpy(file_s1, access);
-      strcat(file_s1, "/");
-      strcat(file_s1, names[i]);
+      id            = names[i];
     }
 
-    strcat(file_s1, "_openen");
-    if (!binaries) {
-      master_access[i] = read_plfold_i(file_s1, begin, end, verhaeltnis, alignment_length, fast); /* read */
-    } else {
-      strcat(file_s1, "_bin");
-      master_access[i] =
-        read_plfold_i_bin(file_s1, begin, end, verhaeltnis, alignment_length, fast);                  /* read */
-    }
+    master_access[i] = read_accessibility(access,
+                                          id,
+                                          begin,
+                                          end,
+                                          verhaeltnis,
+                                          alignment_length,
+                                          binaries,
+                                          fast,
+                                          &file_s1);                                                  /* read */
 
     free(file_s1);
     file_s1 = NULL;
@@ -2197,19 +2473,120 @@ average_accessibility_target(char       **names,
       average_access[u][i] = (int)rint(average_access[u][i] / (count_j));
   }
   /* free(index); */
-  for (i = 0; i < number; i++) {
-    int j;
-    j = master_access[i][0][0];
-    while (--j > -1)
-      free(master_access[i][j]);
-    free(master_access[i]);
-  }
+  for (i = 0; i < number; i++)
+    free_accessibility(master_access[i]);
   free(master_access);
   free(index);
   return average_access;
 }
 
 
+/*
+ * read the accessibility profile of sequence id, either from the accessibility
+ * store or from the RNAplfold output files located in directory access. The
+ * name of the data source is returned in source and must be free'd by the caller
+ */
+static int **
+read_accessibility(const char *access,
+                   const char *id,
+                   const int  beg,
+                   const int  end,
+                   double     verhaeltnis,
+                   const int  length,
+                   int        binaries,
+                   int        fast,
+                   char       **source)
+{
+  if (acc_store) {
+    *source = strdup(id);
+    return read_accessibility_store(id, beg, end, length, fast);
+  }
+
+  *source = (char *)vrna_alloc(sizeof(char) * (strlen(id) + strlen(access) + 20));
+  strcpy(*source, access);
+  strcat(*source, "/");
+  strcat(*source, id);
+  strcat(*source, "_openen");
+  if (!binaries)
+    return read_plfold_i(*source, beg, end, verhaeltnis, length, fast);
+
+  strcat(*source, "_bin");
+  return read_plfold_i_bin(*source, beg, end, verhaeltnis, length, fast);
+}
+
+
+/*
+ * same as read_plfold_i_bin() but for the accessibility store. Only row 0 is
+ * copied, all other rows point directly into the (memory mapped) store
+ */
+static int **
+read_accessibility_store(const char *id,
+                         const int  beg,
+                         const int  end,
+                         const int  length,
+                         int        fast)
+{
+  unsigned int  seqlength;
+  int           lim_x, count, **access;
+  const int     *data;
+  size_t        row_size;
+
+  data = vrna_acc_store_get(acc_store, id, &seqlength);
+  if (data == NULL) {
+    vrna_message_warning("Sequence ' %s ' not found in accessibility store", id);
+    return NULL;
+  }
+
+  lim_x = data[0];
+  if (length > lim_x && fast == 0) {
+    printf(
+      "Interaction length %d is larger than the length of the largest region %d \nfor which the opening energy was computed (-u parameter of RNAplfold)\n",
+      length,
+      lim_x);
+    printf(
+      "Please recompute your profiles with a larger -u or set -l to a smaller interaction length\n");
+    return NULL;
+  }
+
+  row_size = seqlength + 20;
+  if ((beg < 1) || (end < beg) || ((size_t)end > row_size)) {
+    vrna_message_warning("Range %d-%d exceeds the accessibility profile of ' %s '", beg, end, id);
+    return NULL;
+  }
+
+  access    = (int **)vrna_alloc(sizeof(int *) * (lim_x + 1));
+  access[0] = (int *)vrna_alloc(sizeof(int) * (end - beg + 1));
+  memcpy(access[0], data + beg - 1, sizeof(int) * (end - beg + 1));
+  access[0][0] = lim_x + 1;
+
+  for (count = 1; count < lim_x + 1; count++)
+    access[count] = (int *)(data + count * row_size + beg - 1);
+
+  return access;
+}
+
+
+static void
+free_accessibility(int **access)
+{
+  int i;
+
+  if (access == NULL)
+    return;
+
+  if (acc_store) {
+    /* all rows but the first one belong to the accessibility store */
+    free(access[0]);
+  } else {
+    i = access[0][0];
+    while (--i > -1)
+      free(access[i]);
+  }
+
+  free(access);
+}
+
+
 /**
  * aliprint_struct generate two postscript files.
  * The first one is a structure annotated alignment a la RNAalifold.
@@ -29,12 +29,14 @@
 #include "ViennaRNA/constraints/soft_special.h"
 #include "ViennaRNA/io/file_formats.h"
 #include "ViennaRNA/io/utils.h"
+#include "ViennaRNA/io/accessibility_store.h"
 #include "ViennaRNA/commands.h"
 
 #include "RNAplfold_cmdl.h"
 #include "gengetopt_helpers.h"
 #include "input_id_helpers.h"
 #include "modified_bases_helpers.h"
+#include "parallel_helpers.h"
 
 #include "ViennaRNA/color_output.inc"
 
@@ -87,6 +89,7 @@ typedef struct {
   int       ulength;
   int       n;
   double    kT;
+  vrna_acc_store_t  *store;
 } plfold_data;
 
 int unpaired;
@@ -135,48 +138,95 @@ print_pu_bin(vrna_fold_compound_t *fc,
              int                  ulength);
 
 
+struct options {
+  float               cutoff;
+  int                 winsize;
+  int                 pairdist;
+  int                 unpaired;
+  int                 noconv;
+  int                 plexoutput;
+  int                 simply_putout;
+  int                 openenergies;
+  int                 binaries;
+  int                 verbose;
+  int                 with_shapes;
+  char                *shape_file;
+  char                *shape_method;
+  char                *shape_conversion;
+  char                *filename_delim;
+  int                 filename_full;
+  vrna_md_t           md;
+  dataset_id          id_control;
+  vrna_cmd_t          commands;
+  vrna_sc_mod_param_t *mod_params;
+  vrna_acc_store_t    *store;
+
+  int                 jobs;
+};
+
+
+struct record_data {
+  char            *id;
+  char            *sequence;
+  struct options  *options;
+  int             tty;
+};
+
+
+PRIVATE void
+init_default_options(struct options *opt)
+{
+  opt->cutoff           = 0.01;
+  opt->winsize          = 70;
+  opt->pairdist         = 0;
+  opt->unpaired         = 0;
+  opt->noconv           = 0;
+  opt->plexoutput       = 0;
+  opt->simply_putout    = 0;
+  opt->openenergies     = 0;
+  opt->binaries         = 0;
+  opt->verbose          = 0;
+  opt->with_shapes      = 0;
+  opt->shape_file       = NULL;
+  opt->shape_method     = NULL;
+  opt->shape_conversion = NULL;
+  opt->filename_delim   = NULL;
+  opt->filename_full    = 0;
+  opt->commands         = NULL;
+  opt->mod_params       = NULL;
+  opt->store            = NULL;
+
+  set_model_details(&(opt->md));
+
+  opt->jobs = 1;
+}
+
+
+PRIVATE void
+process_record(struct record_data *record);
+
+
 /*--------------------------------------------------------------------------*/
 int
 main(int  argc,
      char *argv[])
 {
-  FILE                        *pUfp;
   struct RNAplfold_args_info  args_info;
-  char                        *structure, *ParamFile, *ns_bases, *rec_sequence, *rec_id,
-                              **rec_rest, *orig_sequence, *filename_delim, *command_file,
-                              *shape_file, *shape_method, *shape_conversion;
+  char                        *ns_bases, *rec_sequence, *rec_id, **rec_rest, *command_file,
+                              *store_file;
   unsigned int                rec_type, read_opt;
-  int                         length, istty, winsize, pairdist, tempwin, temppair, tempunpaired,
-                              noconv, i, plexoutput, simply_putout, openenergies, binaries,
-                              filename_full, with_shapes, verbose;
-  float                       cutoff;
-  vrna_exp_param_t            *pf_parameters;
-  vrna_md_t                   md;
-  vrna_cmd_t                  commands;
-  dataset_id                  id_control;
-  vrna_sc_mod_param_t         *mod_params;
-
-  pUfp                = NULL;
-  dangles             = 2;
-  cutoff              = 0.01;
-  winsize             = 70;
-  pairdist            = 0;
-  unpaired            = 0;
-  simply_putout       = plexoutput = openenergies = noconv = 0;
-  binaries            = 0;
-  tempwin             = temppair = tempunpaired = 0;
-  structure           = ParamFile = ns_bases = NULL;
-  rec_type            = read_opt = 0;
-  rec_id              = rec_sequence = orig_sequence = NULL;
-  rec_rest            = NULL;
-  pf_parameters       = NULL;
-  filename_full       = 0;
-  command_file        = NULL;
-  commands            = NULL;
-  verbose             = 0;
-  mod_params          = NULL;
-
-  set_model_details(&md);
+  int                         istty;
+  struct options              opt;
+
+  dangles       = 2;
+  ns_bases      = NULL;
+  rec_type      = read_opt = 0;
+  rec_id        = rec_sequence = NULL;
+  rec_rest      = NULL;
+  command_file  = NULL;
+  store_file    = NULL;
+
+  init_default_options(&opt);
 
   /*
    #############################################
@@ -187,23 +237,27 @@ main(int  argc,
     exit(1);
 
   if (args_info.verbose_given)
-    verbose = 1;
+    opt.verbose = 1;
 
   /* SHAPE reactivity data */
-  ggo_get_SHAPE(args_info, with_shapes, shape_file, shape_method, shape_conversion);
+  ggo_get_SHAPE(args_info,
+                opt.with_shapes,
+                opt.shape_file,
+                opt.shape_method,
+                opt.shape_conversion);
 
   /* parse options for ID manipulation */
-  ggo_get_id_control(args_info, id_control, "Sequence", "sequence", "_", 4, 1);
+  ggo_get_id_control(args_info, opt.id_control, "Sequence", "sequence", "_", 4, 1);
 
-  ggo_get_md_part(args_info, md);
+  ggo_get_md_part(args_info, opt.md);
 
   /* temperature */
   if (args_info.temp_given)
-    md.temperature = temperature = args_info.temp_arg;
+    opt.md.temperature = temperature = args_info.temp_arg;
 
   /* do not take special tetra loop energies into account */
   if (args_info.noTetra_given)
-    md.special_hp = tetra_loop = 0;
+    opt.md.special_hp = tetra_loop = 0;
 
   /* set dangle model */
   if (args_info.dangles_given) {
@@ -211,34 +265,34 @@ main(int  argc,
       vrna_message_warning(
         "required dangle model not implemented, falling back to default dangles=2");
     else
-      md.dangles = dangles = args_info.dangles_arg;
+      opt.md.dangles = dangles = args_info.dangles_arg;
   }
 
   /* do not allow weak pairs */
   if (args_info.noLP_given)
-    md.noLP = noLonelyPairs = 1;
+    opt.md.noLP = noLonelyPairs = 1;
 
   /* do not allow wobble pairs (GU) */
   if (args_info.noGU_given)
-    md.noGU = noGU = 1;
+    opt.md.noGU = noGU = 1;
 
   if (args_info.salt_given)
-    md.salt = args_info.salt_arg;
+    opt.md.salt = args_info.salt_arg;
 
   /* do not allow weak closing pairs (AU,GU) */
   if (args_info.noClosingGU_given)
-    md.noGUclosure = no_closingGU = 1;
+    opt.md.noGUclosure = no_closingGU = 1;
 
   /* do not convert DNA nucleotide "T" to appropriate RNA "U" */
   if (args_info.noconv_given)
-    noconv = 1;
+    opt.noconv = 1;
 
   /* set energy model */
   if (args_info.energyModel_given)
-    md.energy_set = energy_set = args_info.energyModel_arg;
+    opt.md.energy_set = energy_set = args_info.energyModel_arg;
 
   /* take another energy parameter set */
-  ggo_get_read_paramFile(args_info, &md);
+  ggo_get_read_paramFile(args_info, &(opt.md));
 
   /* Allow other pairs in addition to the usual AU,GC,and GU pairs */
   if (args_info.nsp_given)
@@ -246,67 +300,75 @@ main(int  argc,
 
   /* set the maximum base pair span */
   if (args_info.span_given)
-    pairdist = args_info.span_arg;
+    opt.pairdist = args_info.span_arg;
 
   /* set the pair probability cutoff */
   if (args_info.cutoff_given)
-    cutoff = args_info.cutoff_arg;
+    opt.cutoff = args_info.cutoff_arg;
 
   /* set the windowsize */
   if (args_info.winsize_given)
-    winsize = args_info.winsize_arg;
+    opt.winsize = args_info.winsize_arg;
 
   /* set the length of unstructured region */
   if (args_info.ulength_given)
-    unpaired = args_info.ulength_arg;
+    opt.unpaired = args_info.ulength_arg;
+
+  /* set the number of threads for chunked processing of long sequences */
+  if (args_info.numThreads_given)
+    opt.md.num_threads = args_info.numThreads_arg;
 
   /* compute opening energies */
   if (args_info.opening_energies_given)
-    openenergies = 1;
+    opt.openenergies = 1;
 
   /* print output on the fly */
   if (args_info.print_onthefly_given)
-    simply_putout = 1;
+    opt.simply_putout = 1;
 
   /* turn on RNAplex output */
   if (args_info.plex_output_given)
-    plexoutput = 1;
+    opt.plexoutput = 1;
 
   /* turn on binary output*/
   if (args_info.binaries_given)
-    binaries = 1;
+    opt.binaries = 1;
+
+  /* write opening energies into an accessibility store */
+  if (args_info.store_given)
+    store_file = strdup(args_info.store_arg);
 
   /* check for errorneous parameter options */
-  if ((pairdist < 0) || (cutoff < 0.) || (unpaired < 0) || (winsize < 0)) {
+  if ((opt.pairdist < 0) || (opt.cutoff < 0.) || (opt.unpaired < 0) || (opt.winsize < 0)) {
     RNAplfold_cmdline_parser_print_help();
     exit(EXIT_FAILURE);
   }
 
   /* filename sanitize delimiter */
   if (args_info.filename_delim_given)
-    filename_delim = strdup(args_info.filename_delim_arg);
-  else if (get_id_delim(id_control))
-    filename_delim = strdup(get_id_delim(id_control));
-  else
-    filename_delim = NULL;
+    opt.filename_delim = strdup(args_info.filename_delim_arg);
+  else if (get_id_delim(opt.id_control))
+    opt.filename_delim = strdup(get_id_delim(opt.id_control));
 
-  if ((filename_delim) && isspace(*filename_delim)) {
-    free(filename_delim);
-    filename_delim = NULL;
+  if ((opt.filename_delim) && isspace(*(opt.filename_delim))) {
+    free(opt.filename_delim);
+    opt.filename_delim = NULL;
   }
 
   /* full filename from FASTA header support */
   if (args_info.filename_full_given)
-    filename_full = 1;
+    opt.filename_full = 1;
 
   if (args_info.commands_given)
     command_file = strdup(args_info.commands_arg);
 
   ggo_get_modified_base_settings(args_info,
-                                 mod_params,
-                                 &(md));
+                                 opt.mod_params,
+                                 &(opt.md));
 
-  ggo_geometry_settings(args_info, &md);
+  ggo_geometry_settings(args_info, &(opt.md));
+
+  ggo_get_jobs(args_info, opt.jobs, "RNAplfold");
 
   /* free allocated memory of command line data structure */
   RNAplfold_cmdline_parser_free(&args_info);
@@ -317,28 +379,44 @@ main(int  argc,
    #############################################
    */
   if (ns_bases != NULL)
-    vrna_md_set_nonstandards(&md, ns_bases);
+    vrna_md_set_nonstandards(&(opt.md), ns_bases);
 
   if (command_file != NULL)
-    commands = vrna_file_commands_read(command_file, VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
+    opt.commands = vrna_file_commands_read(command_file, VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
 
   /* check parameter options again and reset to reasonable values if needed */
-  if (openenergies && !unpaired)
-    unpaired = 31;
+  if ((opt.openenergies || store_file) && !opt.unpaired)
+    opt.unpaired = 31;
 
-  if (pairdist == 0)
-    pairdist = winsize;
+  if (opt.pairdist == 0)
+    opt.pairdist = opt.winsize;
 
-  if (pairdist > winsize) {
+  if (opt.pairdist > opt.winsize) {
     vrna_message_warning("pairdist (-L %d) should be <= winsize (-W %d);"
                          "Setting pairdist=winsize",
-                         pairdist, winsize);
-    pairdist = winsize;
+                         opt.pairdist, opt.winsize);
+    opt.pairdist = opt.winsize;
   }
 
   if (dangles % 2) {
     vrna_message_warning("using default dangles = 2");
-    md.dangles = dangles = 2;
+    opt.md.dangles = dangles = 2;
+  }
+
+  /* keep the global variable in sync for backward compatibility */
+  unpaired = opt.unpaired;
+
+  if (store_file) {
+    /* records of the accessibility store are written one after another */
+    if (opt.jobs > 1) {
+      vrna_message_warning("Parallel input processing is not available for accessibility stores, "
+                           "falling back to serial computation");
+      opt.jobs = 1;
+    }
+
+    opt.store = vrna_acc_store_create(store_file, opt.unpaired, &(opt.md));
+    if (!opt.store)
+      vrna_message_error("Failed to create accessibility store \"%s\"", store_file);
   }
 
   istty     = isatty(fileno(stdout)) && isatty(fileno(stdin));
@@ -353,11 +431,12 @@ main(int  argc,
    # main loop: continue until end of file
    #############################################
    */
+  INIT_PARALLELIZATION(opt.jobs);
+
   while (
     !((rec_type = vrna_file_fasta_read_record(&rec_id, &rec_sequence, &rec_rest, NULL, read_opt))
       & (VRNA_INPUT_ERROR | VRNA_INPUT_QUIT))) {
-    size_t  **mod_positions, mod_param_sets;
-    char    *SEQ_ID = NULL;
+    struct record_data *record;
 
     /*
      ########################################################
@@ -368,309 +447,333 @@ main(int  argc,
       rec_id = memmove(rec_id, rec_id + 1, strlen(rec_id));
 
     /* construct the sequence ID */
-    set_next_id(&rec_id, id_control);
-    SEQ_ID = fileprefix_from_id(rec_id, id_control, filename_full);
+    set_next_id(&rec_id, opt.id_control);
 
-    length    = (int)strlen(rec_sequence);
-    structure = (char *)vrna_alloc(sizeof(char) * (length + 1));
+    record = (struct record_data *)vrna_alloc(sizeof(struct record_data));
 
+    record->id        = rec_id;
+    record->sequence  = rec_sequence;
+    record->options   = &opt;
+    record->tty       = istty;
 
-    mod_positions = mod_positions_seq_prepare(rec_sequence,
-                                              mod_params,
-                                              verbose,
-                                              &mod_param_sets);
+    RUN_IN_PARALLEL(process_record, record);
 
-    /* convert DNA alphabet to RNA if not explicitely switched off */
-    if (!noconv)
-      vrna_seq_toRNA(rec_sequence);
+    rec_id    = rec_sequence = NULL;
+    rec_rest  = NULL;
 
-    /* store case-unmodified sequence */
-    orig_sequence = strdup(rec_sequence);
-    /* convert sequence to uppercase letters only */
-    vrna_seq_toupper(rec_sequence);
+    if (opt.with_shapes)
+      break;
 
+    /* print user help for the next round if we get input from tty */
     if (istty)
-      vrna_message_info(stdout, "length = %d", length);
+      vrna_message_input_seq_simple();
+  }
 
-    /*
-     ########################################################
-     # done with 'stdin' handling
-     ########################################################
-     */
+  UNINIT_PARALLELIZATION
 
-    if (length > 1000000) {
-      if (!simply_putout && !unpaired) {
-        vrna_message_warning("Switched to simple output mode!!!");
-        simply_putout = 1;
-      }
-    }
+  if ((opt.store) &&
+      (!vrna_acc_store_close(opt.store)))
+    vrna_message_warning("Failed to write accessibility store \"%s\"", store_file);
 
-    if ((simply_putout) && (plexoutput)) {
-      vrna_message_warning("plexoutput not available in simple output mode!\n"
-                           "Switching back to full mode instead!");
-      simply_putout = 0;
-    }
+  free(store_file);
+  free(ns_bases);
+  free(opt.filename_delim);
+  free(command_file);
+  free(opt.shape_file);
+  free(opt.shape_method);
+  free(opt.shape_conversion);
+  vrna_commands_free(opt.commands);
 
-    if ((simply_putout) && (binaries)) {
-      vrna_message_warning("binary output not available in simple output mode!\n"
-                           "Switching back to full mode instead!");
-      simply_putout = 0;
-    }
+  if (opt.mod_params) {
+    for (vrna_sc_mod_param_t *ptr = opt.mod_params; *ptr != NULL; ptr++)
+      vrna_sc_mod_parameters_free(*ptr);
 
-    /* restore winsize if altered before */
-    if (tempwin != 0) {
-      winsize = tempwin;
-      tempwin = 0;
-    }
+    free(opt.mod_params);
+  }
 
-    /* restore pairdist if altered before */
-    if (temppair != 0) {
-      pairdist  = temppair;
-      temppair  = 0;
-    }
+  free_id_data(opt.id_control);
 
-    /* restore ulength if altered before */
-    if (tempunpaired != 0) {
-      unpaired      = tempunpaired;
-      tempunpaired  = 0;
-    }
+  return EXIT_SUCCESS;
+}
 
-    /* adjust winsize, pairdist and ulength if necessary */
-    if (length < winsize) {
-      vrna_message_warning("window size %d larger than sequence length %d", winsize, length);
-      tempwin = winsize;
-      winsize = length;
-      if (pairdist > winsize) {
-        temppair  = pairdist;
-        pairdist  = winsize;
-      }
 
-      if (unpaired > winsize) {
-        tempunpaired  = unpaired;
-        unpaired      = winsize;
-      }
+PRIVATE void
+process_record(struct record_data *record)
+{
+  FILE                  *pUfp;
+  char                  *rec_sequence, *orig_sequence, *SEQ_ID;
+  int                   i, length, winsize, pairdist, ulength, simply_putout;
+  size_t                **mod_positions, mod_param_sets;
+  struct options        *opt;
+  vrna_exp_param_t      *pf_parameters;
+  vrna_md_t             md;
+
+  opt           = record->options;
+  rec_sequence  = record->sequence;
+  SEQ_ID        = fileprefix_from_id(record->id, opt->id_control, opt->filename_full);
+
+  /* settings that may be adjusted for the current record only */
+  md            = opt->md;
+  winsize       = opt->winsize;
+  pairdist      = opt->pairdist;
+  ulength       = opt->unpaired;
+  simply_putout = opt->simply_putout;
+
+  length = (int)strlen(rec_sequence);
+
+  mod_positions = mod_positions_seq_prepare(rec_sequence,
+                                            opt->mod_params,
+                                            opt->verbose,
+                                            &mod_param_sets);
+
+  /* convert DNA alphabet to RNA if not explicitely switched off */
+  if (!opt->noconv)
+    vrna_seq_toRNA(rec_sequence);
+
+  /* store case-unmodified sequence */
+  orig_sequence = strdup(rec_sequence);
+  /* convert sequence to uppercase letters only */
+  vrna_seq_toupper(rec_sequence);
+
+  if (record->tty)
+    vrna_message_info(stdout, "length = %d", length);
+
+  /*
+   ########################################################
+   # done with 'stdin' handling
+   ########################################################
+   */
+
+  if (length > 1000000) {
+    if (!simply_putout && !ulength) {
+      vrna_message_warning("Switched to simple output mode!!!");
+      simply_putout = 1;
     }
+  }
 
-    /*
-     ########################################################
-     # begin actual computations
-     ########################################################
-     */
+  if ((simply_putout) && (opt->plexoutput)) {
+    vrna_message_warning("plexoutput not available in simple output mode!\n"
+                         "Switching back to full mode instead!");
+    simply_putout = 0;
+  }
 
-    if (length > 0) {
-      /* construct output file names */
-      char *fname1, *fname2, *fname3, *fname4, *ffname, *tmp_string;
-
-      if (!SEQ_ID)
-        SEQ_ID = strdup("plfold");
-
-      fname1  = vrna_strdup_printf("%s%slunp", SEQ_ID, filename_delim);
-      fname2  = vrna_strdup_printf("%s%sbasepairs", SEQ_ID, filename_delim);
-      fname3  = vrna_strdup_printf("%s%suplex", SEQ_ID, filename_delim);
-      fname4  = (binaries) ?
-                vrna_strdup_printf("%s%sopenen%sbin",
-                                   SEQ_ID,
-                                   filename_delim,
-                                   filename_delim) :
-                vrna_strdup_printf("%s%sopenen",
-                                   SEQ_ID,
-                                   filename_delim);
-      ffname = vrna_strdup_printf("%s%sdp.ps", SEQ_ID, filename_delim);
-
-      /* sanitize filenames */
-      tmp_string = vrna_filename_sanitize(fname1, filename_delim);
-      free(fname1);
-      fname1      = tmp_string;
-      tmp_string  = vrna_filename_sanitize(fname2, filename_delim);
-      free(fname2);
-      fname2      = tmp_string;
-      tmp_string  = vrna_filename_sanitize(fname3, filename_delim);
-      free(fname3);
-      fname3      = tmp_string;
-      tmp_string  = vrna_filename_sanitize(fname4, filename_delim);
-      free(fname4);
-      fname4      = tmp_string;
-      tmp_string  = vrna_filename_sanitize(ffname, filename_delim);
-      free(ffname);
-      ffname = tmp_string;
-
-
-      md.compute_bpp  = 1;
-      md.window_size  = winsize;
-      md.max_bp_span  = pairdist;
-
-      vrna_fold_compound_t *fc = vrna_fold_compound(rec_sequence, &md, VRNA_OPTION_WINDOW);
-
-      if (with_shapes) {
-        vrna_constraints_add_SHAPE(fc,
-                                   shape_file,
-                                   shape_method,
-                                   shape_conversion,
-                                   verbose,
-                                   VRNA_OPTION_DEFAULT | VRNA_OPTION_WINDOW);
-      }
+  if ((simply_putout) && (opt->binaries)) {
+    vrna_message_warning("binary output not available in simple output mode!\n"
+                         "Switching back to full mode instead!");
+    simply_putout = 0;
+  }
 
-      if (commands)
-        vrna_commands_apply(fc, commands, VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
-
-      /* apply modified base support if requested */
-      mod_bases_apply(fc,
-                      mod_param_sets,
-                      mod_positions,
-                      mod_params);
-
-      pf_parameters = vrna_exp_params(&md);
-
-      /* prepare data structure for callback */
-      plfold_data data;
-
-      data.cutoff         = cutoff;
-      data.spup           = (simply_putout) ? fopen(fname2, "w") : NULL;
-      data.plexoutput     = plexoutput;
-      data.simply_putout  = simply_putout;
-      data.openenergies   = openenergies;
-      data.plist          = NULL;
-      data.plist_cnt      = 0;
-      data.ulength        = unpaired;
-      data.n              = length;
-      data.kT             = pf_parameters->kT;
-
-      if (unpaired > 0) {
-        if (simply_putout) {
-          data.pup  = NULL;
-          data.pUfp = fopen(openenergies ? fname4 : fname1, "w");
-          prepare_up_file(&data);
-        } else {
-          /* if we don't print on-the-fly we store unpaired probabilities for later */
-          data.pup        = (double **)vrna_alloc(MAX2(unpaired, length + 1) * sizeof(double *));
-          data.pup[0]     = (double *)vrna_alloc(sizeof(double));   /*I only need entry 0*/
-          data.pup[0][0]  = unpaired;
-          data.pUfp       = NULL;
-        }
-      } else {
+  /* adjust winsize, pairdist and ulength if necessary */
+  if (length < winsize) {
+    vrna_message_warning("window size %d larger than sequence length %d", winsize, length);
+    winsize = length;
+    if (pairdist > winsize)
+      pairdist = winsize;
+
+    if (ulength > winsize)
+      ulength = winsize;
+  }
+
+  /*
+   ########################################################
+   # begin actual computations
+   ########################################################
+   */
+
+  if (length > 0) {
+    /* construct output file names */
+    char          *fname1, *fname2, *fname3, *fname4, *ffname, *tmp_string;
+    char          *filename_delim = opt->filename_delim;
+    unsigned int  plfold_opt;
+    plfold_data   data;
+
+    if (!SEQ_ID)
+      SEQ_ID = strdup("plfold");
+
+    fname1  = vrna_strdup_printf("%s%slunp", SEQ_ID, filename_delim);
+    fname2  = vrna_strdup_printf("%s%sbasepairs", SEQ_ID, filename_delim);
+    fname3  = vrna_strdup_printf("%s%suplex", SEQ_ID, filename_delim);
+    fname4  = (opt->binaries) ?
+              vrna_strdup_printf("%s%sopenen%sbin",
+                                 SEQ_ID,
+                                 filename_delim,
+                                 filename_delim) :
+              vrna_strdup_printf("%s%sopenen",
+                                 SEQ_ID,
+                                 filename_delim);
+    ffname = vrna_strdup_printf("%s%sdp.ps", SEQ_ID, filename_delim);
+
+    /* sanitize filenames */
+    tmp_string = vrna_filename_sanitize(fname1, filename_delim);
+    free(fname1);
+    fname1      = tmp_string;
+    tmp_string  = vrna_filename_sanitize(fname2, filename_delim);
+    free(fname2);
+    fname2      = tmp_string;
+    tmp_string  = vrna_filename_sanitize(fname3, filename_delim);
+    free(fname3);
+    fname3      = tmp_string;
+    tmp_string  = vrna_filename_sanitize(fname4, filename_delim);
+    free(fname4);
+    fname4      = tmp_string;
+    tmp_string  = vrna_filename_sanitize(ffname, filename_delim);
+    free(ffname);
+    ffname = tmp_string;
+
+
+    md.compute_bpp  = 1;
+    md.window_size  = winsize;
+    md.max_bp_span  = pairdist;
+
+    vrna_fold_compound_t *fc = vrna_fold_compound(rec_sequence, &md, VRNA_OPTION_WINDOW);
+
+    if (opt->with_shapes) {
+      vrna_constraints_add_SHAPE(fc,
+                                 opt->shape_file,
+                                 opt->shape_method,
+                                 opt->shape_conversion,
+                                 opt->verbose,
+                                 VRNA_OPTION_DEFAULT | VRNA_OPTION_WINDOW);
+    }
+
+    if (opt->commands)
+      vrna_commands_apply(fc, opt->commands, VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
+
+    /* apply modified base support if requested */
+    mod_bases_apply(fc,
+                    mod_param_sets,
+                    mod_positions,
+                    opt->mod_params);
+
+    pf_parameters = vrna_exp_params(&md);
+
+    /* prepare data structure for callback */
+    data.cutoff         = opt->cutoff;
+    data.spup           = (simply_putout) ? fopen(fname2, "w") : NULL;
+    data.plexoutput     = opt->plexoutput;
+    data.simply_putout  = simply_putout;
+    data.openenergies   = opt->openenergies;
+    data.plist          = NULL;
+    data.plist_cnt      = 0;
+    data.ulength        = ulength;
+    data.n              = length;
+    data.kT             = pf_parameters->kT;
+    data.store          = opt->store;
+
+    if (opt->store) {
+      /* opening energies go directly into the accessibility store */
+      vrna_acc_store_record_begin(opt->store, SEQ_ID, length);
+      data.pup  = NULL;
+      data.pUfp = NULL;
+    } else if (ulength > 0) {
+      if (simply_putout) {
         data.pup  = NULL;
-        data.pUfp = NULL;
+        data.pUfp = fopen(opt->openenergies ? fname4 : fname1, "w");
+        prepare_up_file(&data);
+      } else {
+        /* if we don't print on-the-fly we store unpaired probabilities for later */
+        data.pup        = (double **)vrna_alloc(MAX2(ulength, length + 1) * sizeof(double *));
+        data.pup[0]     = (double *)vrna_alloc(sizeof(double));   /*I only need entry 0*/
+        data.pup[0][0]  = ulength;
+        data.pUfp       = NULL;
       }
+    } else {
+      data.pup  = NULL;
+      data.pUfp = NULL;
+    }
 
-      /* prepare option flags */
-      unsigned int plfold_opt = 0;
-
-      /* always compute base pair probabilities */
-      plfold_opt |= VRNA_PROBS_WINDOW_BPP;
+    /* prepare option flags */
+    plfold_opt = 0;
 
-      if (unpaired > 0)
-        plfold_opt |= VRNA_PROBS_WINDOW_UP;
+    /* always compute base pair probabilities */
+    plfold_opt |= VRNA_PROBS_WINDOW_BPP;
 
-      /* perform recursions */
-      int r = vrna_probs_window(fc, unpaired, plfold_opt, &plfold_callback, (void *)&data);
+    if (ulength > 0)
+      plfold_opt |= VRNA_PROBS_WINDOW_UP;
 
-      if (!r) {
-        vrna_message_warning("Something bad happened while processing the input! "
-                             "Aborting now...");
-        goto rnaplfold_exit;
-      }
+    /* perform recursions */
+    if (!vrna_probs_window(fc, ulength, plfold_opt, &plfold_callback, (void *)&data)) {
+      vrna_message_warning("Something bad happened while processing \"%s\"! "
+                           "Skipping output...",
+                           SEQ_ID);
+    } else {
+      if (opt->store)
+        vrna_acc_store_record_end(opt->store);
 
       if (!simply_putout) {
         /* create dot plot output */
         PS_dot_plot_turn(orig_sequence, data.plist, ffname, pairdist);
 
         /* print unpaired probabilities */
-        if (unpaired > 0) {
-          if (plexoutput) {
+        if ((ulength > 0) && (!opt->store)) {
+          if (opt->plexoutput) {
             pUfp = fopen(fname3, "w");
-            putoutphakim_u(fc, data.pup, length, unpaired, pUfp);
+            putoutphakim_u(fc, data.pup, length, ulength, pUfp);
             fclose(pUfp);
           }
 
           /* print unpaired probabilities to file */
 
-          data.pUfp = fopen(openenergies ? fname4 : fname1, "w");
-          if (binaries) {
-            print_pu_bin(fc, &data, unpaired);
+          data.pUfp = fopen(opt->openenergies ? fname4 : fname1, "w");
+          if (opt->binaries) {
+            print_pu_bin(fc, &data, ulength);
           } else {
             prepare_up_file(&data);
-            if (openenergies) {
+            if (opt->openenergies) {
               for (i = 1; i <= length; i++)
                 print_up_open(data.pUfp,
                               i,
                               data.pup[i],
-                              (i > unpaired) ? unpaired : i,
-                              unpaired,
+                              (i > ulength) ? ulength : i,
+                              ulength,
                               data.kT / 1000.);
             } else {
               for (i = 1; i <= length; i++)
-                print_up(data.pUfp, i, data.pup[i], (i > unpaired) ? unpaired : i, unpaired);
+                print_up(data.pUfp, i, data.pup[i], (i > ulength) ? ulength : i, ulength);
             }
           }
 
           fclose(data.pUfp);
           data.pUfp = NULL;
-
-          for (i = 0; i <= length; i++)
-            free(data.pup[i]);
-          free(data.pup);
         }
       }
-
-      vrna_fold_compound_free(fc);
-
-      free(pf_parameters);
-
-      /* clean up data */
-      if (data.pUfp)
-        fclose(data.pUfp);
-
-      if (data.spup)
-        fclose(data.spup);
-
-      free(data.plist);
-
-
-      free(fname1);
-      free(fname2);
-      free(fname3);
-      free(fname4);
-      free(ffname);
     }
 
-    (void)fflush(stdout);
-
-    /* clean up */
-    free(rec_id);
-    free(rec_sequence);
-    free(orig_sequence);
-    free(structure);
-    free(SEQ_ID);
+    if (data.pup) {
+      for (i = 0; i <= length; i++)
+        free(data.pup[i]);
+      free(data.pup);
+    }
 
-    if (with_shapes)
-      break;
+    vrna_fold_compound_free(fc);
 
-    rec_id    = rec_sequence = orig_sequence = NULL;
-    rec_rest  = NULL;
+    free(pf_parameters);
 
-    /* print user help for the next round if we get input from tty */
-    if (istty)
-      vrna_message_input_seq_simple();
-  }
+    /* clean up data */
+    if (data.pUfp)
+      fclose(data.pUfp);
 
-rnaplfold_exit:
+    if (data.spup)
+      fclose(data.spup);
 
-  free(filename_delim);
-  free(command_file);
-  free(shape_method);
-  free(shape_conversion);
-  vrna_commands_free(commands);
+    free(data.plist);
 
-  if (mod_params) {
-    for (vrna_sc_mod_param_t *ptr = mod_params; *ptr != NULL; ptr++)
-      vrna_sc_mod_parameters_free(*ptr);
 
-    free(mod_params);
+    free(fname1);
+    free(fname2);
+    free(fname3);
+    free(fname4);
+    free(ffname);
   }
 
-  free_id_data(id_control);
+  (void)fflush(stdout);
 
-  return EXIT_SUCCESS;
+  /* clean up */
+  free(record->id);
+  free(rec_sequence);
+  free(orig_sequence);
+  free(SEQ_ID);
+  free(record);
 }
 
 
@@ -790,7 +893,10 @@ plfold_callback(FLT_OR_DBL    *pr,
 
   /* limit output to full unpaired probabilities */
   if ((type & VRNA_PROBS_WINDOW_UP) && ((type & VRNA_ANY_LOOP) == VRNA_ANY_LOOP)) {
-    if (!d->simply_putout) {
+    if (d->store) {
+      /* write opening energies to the accessibility store */
+      vrna_acc_store_probs_window_cb(pr, pr_size, i, max, type, (void *)d->store);
+    } else if (!d->simply_putout) {
       /* store unpaired probabilities in an array */
 
       /* first allocate some memory */
@@ -38,6 +38,8 @@
 #include "gengetopt_helpers.h"
 #include "input_id_helpers.h"
 #include "modified_bases_helpers.h"
+#include "parallel_helpers.h"
+#include "record_helpers.h"
 
 #include "ViennaRNA/color_output.inc"
 
@@ -46,6 +48,12 @@ putoutzuker(FILE                    *output,
             vrna_subopt_solution_t  *zukersolution);
 
 
+PRIVATE void
+print_subopt(const char *structure,
+             float      energy,
+             void       *data);
+
+
 struct nr_en_data {
   FILE                  *output;
   vrna_fold_compound_t  *fc;
@@ -64,49 +72,131 @@ print_samples_en(const char *structure,
                  void       *data);
 
 
+struct options {
+  int                 noconv;
+  int                 verbose;
+  int                 canonicalBPonly;
+  int                 enforceConstraints;
+  int                 batch;
+  char                *constraints_file;
+  int                 with_shapes;
+  char                *shape_file;
+  char                *shape_method;
+  char                *shape_conversion;
+  int                 delta;
+  unsigned long       max_structures;
+  size_t              max_memory;
+  int                 n_back;
+  int                 st_back_en;
+  int                 nonRedundant;
+  int                 dos;
+  int                 zuker;
+  int                 tofile;
+  char                *infile;
+  char                *outfile;
+  char                *filename_delim;
+  int                 filename_full;
+  vrna_md_t           md;
+  dataset_id          id_control;
+  vrna_cmd_t          commands;
+  vrna_sc_mod_param_t *mod_params;
+
+  int                 jobs;
+  int                 keep_order;
+  record_queue        output_queue;
+};
+
+
+struct record_data {
+  unsigned int    number;
+  char            *id;
+  char            *sequence;
+  char            **rest;
+  int             multiline_input;
+  struct options  *options;
+  int             tty;
+};
+
+
+PRIVATE void
+init_default_options(struct options *opt)
+{
+  opt->noconv             = 0;
+  opt->verbose            = 0;
+  opt->canonicalBPonly    = 0;
+  opt->enforceConstraints = 0;
+  opt->batch              = 0;
+  opt->constraints_file   = NULL;
+  opt->with_shapes        = 0;
+  opt->shape_file         = NULL;
+  opt->shape_method       = NULL;
+  opt->shape_conversion   = NULL;
+  opt->delta              = 100;
+  opt->max_structures     = 0;
+  opt->max_memory         = 0;
+  opt->n_back             = 0;
+  opt->st_back_en         = 0;
+  opt->nonRedundant       = 0;
+  opt->dos                = 0;
+  opt->zuker              = 0;
+  opt->tofile             = 0;
+  opt->infile             = NULL;
+  opt->outfile            = NULL;
+  opt->filename_delim     = NULL;
+  opt->filename_full      = 0;
+  opt->commands           = NULL;
+  opt->mod_params         = NULL;
+
+  set_model_details(&(opt->md));
+
+  /* switch on unique multibranch loop decomposition */
+  opt->md.uniq_ML = 1;
+
+  opt->jobs         = 1;
+  opt->keep_order   = 1;
+  opt->output_queue = NULL;
+}
+
+
+PRIVATE void
+print_input_prompt(struct options *opt)
+{
+  if (!opt->zuker)
+    print_comment(stdout, "Use '&' to connect sequences that shall form a complex.");
+
+  if (fold_constrained) {
+    vrna_message_constraint_options(
+      VRNA_CONSTRAINT_DB_DOT | VRNA_CONSTRAINT_DB_X | VRNA_CONSTRAINT_DB_ANG_BRACK |
+      VRNA_CONSTRAINT_DB_RND_BRACK);
+    vrna_message_input_seq("Input sequence (upper or lower case) followed by structure constraint");
+  } else {
+    vrna_message_input_seq_simple();
+  }
+}
+
+
+PRIVATE void
+process_input(FILE            *input,
+              struct options  *opt);
+
+
+PRIVATE void
+process_record(struct record_data *record);
+
+
 int
 main(int  argc,
      char *argv[])
 {
-  FILE                                *input, *output;
+  FILE                                *input;
   struct          RNAsubopt_args_info args_info;
-  char                                *rec_sequence, *rec_id,
-                                      **rec_rest, *orig_sequence, *constraints_file, *cstruc,
-                                      *structure, *shape_file, *shape_method, *shape_conversion,
-                                      *infile, *outfile, *filename_delim;
-  unsigned int                        rec_type, read_opt;
-  int                                 i, length, cl, istty, delta, n_back, noconv, dos, zuker,
-                                      with_shapes, verbose, enforceConstraints, st_back_en, batch,
-                                      tofile, filename_full, canonicalBPonly, nonRedundant;
   double                              deltap;
-  vrna_md_t                           md;
-  dataset_id                          id_control;
-  vrna_cmd_t                          commands;
-  vrna_sc_mod_param_t                 *mod_params;
-
-  do_backtrack        = 1;
-  delta               = 100;
-  deltap              = n_back = noconv = dos = zuker = 0;
-  rec_type            = read_opt = 0;
-  rec_id              = rec_sequence = orig_sequence = NULL;
-  rec_rest            = NULL;
-  cstruc              = structure = NULL;
-  verbose             = 0;
-  st_back_en          = 0;
-  infile              = NULL;
-  outfile             = NULL;
-  output              = NULL;
-  tofile              = 0;
-  filename_full       = 0;
-  canonicalBPonly     = 0;
-  commands            = NULL;
-  nonRedundant        = 0;
-  mod_params          = NULL;
-
-  set_model_details(&md);
+  struct options                      opt;
 
-  /* switch on unique multibranch loop decomposition */
-  md.uniq_ML = 1;
+  do_backtrack  = 1;
+  deltap        = 0;
+
+  init_default_options(&opt);
 
   /*
    #############################################
@@ -117,46 +207,50 @@ main(int  argc,
     exit(1);
 
   /* parse options for ID manipulation */
-  ggo_get_id_control(args_info, id_control, "Sequence", "sequence", "_", 4, 1);
+  ggo_get_id_control(args_info, opt.id_control, "Sequence", "sequence", "_", 4, 1);
 
   /* get basic set of model details */
-  ggo_get_md_eval(args_info, md);
-  ggo_get_md_fold(args_info, md);
-  ggo_get_md_part(args_info, md);
-  ggo_get_circ(args_info, md.circ);
+  ggo_get_md_eval(args_info, opt.md);
+  ggo_get_md_fold(args_info, opt.md);
+  ggo_get_md_part(args_info, opt.md);
+  ggo_get_circ(args_info, opt.md.circ);
 
   /* temperature */
-  ggo_get_temperature(args_info, md.temperature);
+  ggo_get_temperature(args_info, opt.md.temperature);
 
   /* check dangle model */
-  if ((md.dangles < 0) || (md.dangles > 3)) {
+  if ((opt.md.dangles < 0) || (opt.md.dangles > 3)) {
     vrna_message_warning("required dangle model not implemented, falling back to default dangles=2");
-    md.dangles = dangles = 2;
+    opt.md.dangles = dangles = 2;
   }
 
   /* SHAPE reactivity data */
-  ggo_get_SHAPE(args_info, with_shapes, shape_file, shape_method, shape_conversion);
+  ggo_get_SHAPE(args_info,
+                opt.with_shapes,
+                opt.shape_file,
+                opt.shape_method,
+                opt.shape_conversion);
 
   ggo_get_constraints_settings(args_info,
                                fold_constrained,
-                               constraints_file,
-                               enforceConstraints,
-                               batch);
+                               opt.constraints_file,
+                               opt.enforceConstraints,
+                               opt.batch);
 
   if (args_info.verbose_given)
-    verbose = 1;
+    opt.verbose = 1;
 
   /* enforce canonical base pairs in any case? */
   if (args_info.canonicalBPonly_given)
-    canonicalBPonly = 1;
+    opt.canonicalBPonly = 1;
 
   /* do not convert DNA nucleotide "T" to appropriate RNA "U" */
   if (args_info.noconv_given)
-    noconv = 1;
+    opt.noconv = 1;
 
   /* energy range */
   if (args_info.deltaEnergy_given)
-    delta = (int)(0.1 + args_info.deltaEnergy_arg * 100);
+    opt.delta = (int)(0.1 + args_info.deltaEnergy_arg * 100);
 
   /* energy range after post evaluation */
   if (args_info.deltaEnergyPost_given)
@@ -169,95 +263,121 @@ main(int  argc,
       subopt_sorted = VRNA_SORT_BY_ENERGY_ASC;
   }
 
+  /* best-first enumeration with limited number of structures or memory */
+  if (args_info.max_structures_given) {
+    if (args_info.max_structures_arg <= 0)
+      vrna_message_error("Maximum number of structures must be positive");
+
+    opt.max_structures = (unsigned long)args_info.max_structures_arg;
+  }
+
+  if (args_info.max_memory_given) {
+    if (args_info.max_memory_arg <= 0)
+      vrna_message_error("Maximum memory must be positive");
+
+    opt.max_memory = (size_t)args_info.max_memory_arg * 1024 * 1024;
+  }
+
+  if (((opt.max_structures > 0) || (opt.max_memory > 0)) &&
+      (subopt_sorted == VRNA_UNSORTED))
+    subopt_sorted = VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC;
+
+  /* set the number of threads for parallel enumeration */
+  if (args_info.numThreads_given)
+    opt.md.num_threads = args_info.numThreads_arg;
+
   /* stochastic backtracking */
   if (args_info.stochBT_given) {
-    n_back = args_info.stochBT_arg;
+    opt.n_back = args_info.stochBT_arg;
     vrna_init_rand();
-    md.compute_bpp = 0;
+    opt.md.compute_bpp = 0;
   }
 
   if (args_info.stochBT_en_given) {
-    n_back          = args_info.stochBT_en_arg;
-    st_back_en      = 1;
-    md.compute_bpp  = 0;
+    opt.n_back          = args_info.stochBT_en_arg;
+    opt.st_back_en      = 1;
+    opt.md.compute_bpp  = 0;
     vrna_init_rand();
   }
 
   /* density of states */
   if (args_info.dos_given) {
-    dos           = 1;
+    opt.dos       = 1;
     print_energy  = -999999;
   }
 
   /* logarithmic multiloop energies */
   if (args_info.logML_given)
-    md.logML = logML = 1;
+    opt.md.logML = logML = 1;
 
   /* zuker subopts */
   if (args_info.zuker_given)
-    zuker = 1;
+    opt.zuker = 1;
 
-  if (zuker) {
-    if (md.circ) {
+  if (opt.zuker) {
+    if (opt.md.circ) {
       vrna_message_warning("Sorry, zuker subopts not yet implemented for circfold");
       RNAsubopt_cmdline_parser_print_help();
       exit(1);
-    } else if (n_back > 0) {
+    } else if (opt.n_back > 0) {
       vrna_message_warning("Can't do zuker subopts and stochastic subopts at the same time");
       RNAsubopt_cmdline_parser_print_help();
       exit(1);
-    } else if (md.gquad) {
+    } else if (opt.md.gquad) {
       vrna_message_warning("G-quadruplex support for Zuker subopts not implemented yet");
       RNAsubopt_cmdline_parser_print_help();
       exit(1);
     }
   }
 
-  if (md.gquad && (n_back > 0)) {
+  if (opt.md.gquad && (opt.n_back > 0)) {
     vrna_message_warning("G-quadruplex support for stochastic backtracking not implemented yet");
     RNAsubopt_cmdline_parser_print_help();
     exit(1);
   }
 
   if (args_info.infile_given)
-    infile = strdup(args_info.infile_arg);
+    opt.infile = strdup(args_info.infile_arg);
 
   if (args_info.outfile_given) {
-    tofile = 1;
+    opt.tofile = 1;
     if (args_info.outfile_arg)
-      outfile = strdup(args_info.outfile_arg);
+      opt.outfile = strdup(args_info.outfile_arg);
   }
 
   /* filename sanitize delimiter */
   if (args_info.filename_delim_given)
-    filename_delim = strdup(args_info.filename_delim_arg);
-  else if (get_id_delim(id_control))
-    filename_delim = strdup(get_id_delim(id_control));
-  else
-    filename_delim = NULL;
-
-  if ((filename_delim) && isspace(*filename_delim)) {
-    free(filename_delim);
-    filename_delim = NULL;
+    opt.filename_delim = strdup(args_info.filename_delim_arg);
+  else if (get_id_delim(opt.id_control))
+    opt.filename_delim = strdup(get_id_delim(opt.id_control));
+
+  if ((opt.filename_delim) && isspace(*(opt.filename_delim))) {
+    free(opt.filename_delim);
+    opt.filename_delim = NULL;
   }
 
   /* full filename from FASTA header support */
   if (args_info.filename_full_given)
-    filename_full = 1;
+    opt.filename_full = 1;
 
   /* non-redundant backtracing */
   if (args_info.nonRedundant_given)
-    nonRedundant = 1;
+    opt.nonRedundant = 1;
 
   if (args_info.commands_given)
-    commands = vrna_file_commands_read(args_info.commands_arg,
-                                       VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
+    opt.commands = vrna_file_commands_read(args_info.commands_arg,
+                                           VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
 
   ggo_get_modified_base_settings(args_info,
-                                 mod_params,
-                                 &(md));
+                                 opt.mod_params,
+                                 &(opt.md));
+
+  ggo_geometry_settings(args_info, &(opt.md));
 
-  ggo_geometry_settings(args_info, &md);
+  ggo_get_jobs(args_info, opt.jobs, "RNAsubopt");
+
+  if (args_info.unordered_given)
+    opt.keep_order = 0;
 
   /* free allocated memory of command line data structure */
   RNAsubopt_cmdline_parser_free(&args_info);
@@ -268,31 +388,112 @@ main(int  argc,
    #############################################
    */
 
-  if (infile) {
-    input = fopen((const char *)infile, "r");
+  /*
+   *  the density of states and the random number generator for
+   *  stochastic backtracking are global, so process one record
+   *  at a time in these cases
+   */
+  if ((opt.jobs > 1) && ((opt.dos) || (opt.n_back > 0))) {
+    vrna_message_warning("Parallel input processing is not available for %s, "
+                         "falling back to serial computation",
+                         (opt.dos) ? "density of states" : "stochastic backtracking");
+    opt.jobs = 1;
+  }
+
+  if ((opt.dos) && ((opt.max_structures > 0) || (opt.max_memory > 0))) {
+    vrna_message_warning("The density of states requires all structures within the energy range, "
+                         "ignoring --max-structures and --max-memory");
+    opt.max_structures  = 0;
+    opt.max_memory      = 0;
+  }
+
+  /* best-first enumeration follows energies without re-evaluation */
+  if ((logML != 0 || opt.md.dangles == 1 || opt.md.dangles == 3) &&
+      ((opt.max_structures > 0) || (opt.max_memory > 0))) {
+    vrna_message_warning("Energies are re-evaluated for --logML and dangle models 1 and 3, "
+                         "ignoring --max-structures and --max-memory");
+    opt.max_structures  = 0;
+    opt.max_memory      = 0;
+  }
+
+  /* energy range for printing in case energies are re-evaluated */
+  if ((logML != 0 || opt.md.dangles == 1 || opt.md.dangles == 3) && opt.dos == 0)
+    if (deltap <= 0)
+      deltap = opt.delta / 100. + 0.001;
+
+  if (deltap > 0)
+    print_energy = deltap;
+
+  if (opt.infile) {
+    input = fopen((const char *)opt.infile, "r");
     if (!input)
       vrna_message_error("Could not read input file");
   } else {
     input = stdin;
   }
 
-  istty = (!infile) && isatty(fileno(stdout)) && isatty(fileno(stdin));
+  opt.output_queue = record_queue_init(opt.jobs, opt.keep_order);
 
-  /* print user help if we get input from tty */
-  if (istty) {
-    if (!zuker)
-      print_comment(stdout, "Use '&' to connect sequences that shall form a complex.");
-
-    if (fold_constrained) {
-      vrna_message_constraint_options(
-        VRNA_CONSTRAINT_DB_DOT | VRNA_CONSTRAINT_DB_X | VRNA_CONSTRAINT_DB_ANG_BRACK |
-        VRNA_CONSTRAINT_DB_RND_BRACK);
-      vrna_message_input_seq("Input sequence (upper or lower case) followed by structure constraint");
-    } else {
-      vrna_message_input_seq_simple();
-    }
+  /*
+   #############################################
+   # main loop: continue until end of file
+   #############################################
+   */
+  INIT_PARALLELIZATION(opt.jobs);
+
+  process_input(input, &opt);
+
+  UNINIT_PARALLELIZATION
+
+  /*
+   ################################################
+   # post processing
+   ################################################
+   */
+  record_queue_free(opt.output_queue);
+
+  if (opt.infile && input)
+    fclose(input);
+
+  free(opt.infile);
+  free(opt.outfile);
+  free(opt.constraints_file);
+  free(opt.shape_file);
+  free(opt.shape_method);
+  free(opt.shape_conversion);
+  free(opt.filename_delim);
+  vrna_commands_free(opt.commands);
+
+  if (opt.mod_params) {
+    for (vrna_sc_mod_param_t *ptr = opt.mod_params; *ptr != NULL; ptr++)
+      vrna_sc_mod_parameters_free(*ptr);
+
+    free(opt.mod_params);
   }
 
+  free_id_data(opt.id_control);
+
+  return EXIT_SUCCESS;
+}
+
+
+PRIVATE void
+process_input(FILE            *input,
+              struct options  *opt)
+{
+  char          *rec_sequence, *rec_id, **rec_rest;
+  unsigned int  rec_type, read_opt;
+  int           istty;
+
+  rec_id    = rec_sequence = NULL;
+  rec_rest  = NULL;
+  read_opt  = 0;
+  istty     = (!opt->infile) && isatty(fileno(stdout)) && isatty(fileno(stdin));
+
+  /* print user help if we get input from tty */
+  if (istty)
+    print_input_prompt(opt);
+
   /* set options we wanna pass to vrna_file_fasta_read_record() */
   if (istty)
     read_opt |= VRNA_INPUT_NOSKIP_BLANK_LINES;
@@ -300,19 +501,11 @@ main(int  argc,
   if (!fold_constrained)
     read_opt |= VRNA_INPUT_NO_REST;
 
-  /*
-   #############################################
-   # main loop: continue until end of file
-   #############################################
-   */
   while (
     !((rec_type = vrna_file_fasta_read_record(&rec_id, &rec_sequence, &rec_rest, input, read_opt))
       & (VRNA_INPUT_ERROR | VRNA_INPUT_QUIT))) {
-    size_t  **mod_positions, mod_param_sets;
-    char    *SEQ_ID         = NULL;
-    char    *v_file_name    = NULL;
-    char    *tmp_string     = NULL;
-    int     maybe_multiline = 0;
+    struct record_data  *record;
+    int                 maybe_multiline = 0;
 
     /*
      ########################################################
@@ -326,290 +519,293 @@ main(int  argc,
     }
 
     /* construct the sequence ID */
-    set_next_id(&rec_id, id_control);
-    SEQ_ID = fileprefix_from_id(rec_id, id_control, filename_full);
-
-    if (tofile) {
-      /* prepare the file name */
-      if (outfile)
-        v_file_name = vrna_strdup_printf("%s", outfile);
-      else
-        v_file_name = (SEQ_ID) ?
-                      vrna_strdup_printf("%s.sub", SEQ_ID) :
-                      vrna_strdup_printf("RNAsubopt_output.sub");
-
-      tmp_string = vrna_filename_sanitize(v_file_name, filename_delim);
-      free(v_file_name);
-      v_file_name = tmp_string;
-
-      if (infile && !strcmp(infile, v_file_name))
-        vrna_message_error("Input and output file names are identical");
-
-      output = fopen((const char *)v_file_name, "a");
-      if (!output)
-        vrna_message_error("Failed to open file for writing");
-    } else {
-      output = stdout;
-    }
+    set_next_id(&rec_id, opt->id_control);
 
-    /* convert DNA alphabet to RNA if not explicitely switched off */
-    if (!noconv)
-      vrna_seq_toRNA(rec_sequence);
-
-    /* store case-unmodified sequence */
-    orig_sequence = strdup(rec_sequence);
-
-    mod_positions = mod_positions_seq_prepare(rec_sequence,
-                                              mod_params,
-                                              verbose,
-                                              &mod_param_sets);
-
-    /* convert sequence to uppercase letters only */
-    vrna_seq_toupper(rec_sequence);
-
-    vrna_fold_compound_t *vc = vrna_fold_compound(rec_sequence, &md, VRNA_OPTION_DEFAULT);
-    length = vc->length;
-
-    structure = (char *)vrna_alloc(sizeof(char) * (length + 1));
-
-    /* parse the rest of the current dataset to obtain a structure constraint */
-    if (fold_constrained) {
-      if (constraints_file) {
-        vrna_constraints_add(vc, constraints_file, VRNA_OPTION_DEFAULT);
-      } else {
-        cstruc = NULL;
-        int           cp        = -1;
-        unsigned int  coptions  = (maybe_multiline) ? VRNA_OPTION_MULTILINE : 0;
-        cstruc  = vrna_extract_record_rest_structure((const char **)rec_rest, 0, coptions);
-        cstruc  = vrna_cut_point_remove(cstruc, &cp);
-        if (vc->cutpoint != cp) {
-          vrna_message_error("Sequence and Structure have different cut points.\n"
-                             "sequence: %d, structure: %d",
-                             vc->cutpoint, cp);
-        }
-
-        cl = (cstruc) ? (int)strlen(cstruc) : 0;
-
-        if (cl == 0)
-          vrna_message_warning("Structure constraint is missing");
-        else if (cl < length)
-          vrna_message_warning("Structure constraint is shorter than sequence");
-        else if (cl > length)
-          vrna_message_error("Structure constraint is too long");
-
-        if (cstruc) {
-          /* convert pseudo-dot-bracket to actual hard constraints */
-          unsigned int constraint_options = VRNA_CONSTRAINT_DB_DEFAULT;
-
-          if (enforceConstraints)
-            constraint_options |= VRNA_CONSTRAINT_DB_ENFORCE_BP;
-
-          if (canonicalBPonly)
-            constraint_options |= VRNA_CONSTRAINT_DB_CANONICAL_BP;
-
-          vrna_constraints_add(vc, (const char *)cstruc, constraint_options);
-        }
-      }
-    }
+    record = (struct record_data *)vrna_alloc(sizeof(struct record_data));
 
-    if (with_shapes) {
-      vrna_constraints_add_SHAPE(vc,
-                                 shape_file,
-                                 shape_method,
-                                 shape_conversion,
-                                 verbose,
-                                 VRNA_OPTION_MFE | ((n_back > 0) ? VRNA_OPTION_PF : 0));
-    }
+    record->number          = record_queue_next(opt->output_queue);
+    record->id              = rec_id;
+    record->sequence        = rec_sequence;
+    record->rest            = rec_rest;
+    record->multiline_input = maybe_multiline;
+    record->options         = opt;
+    record->tty             = istty;
 
-    if (commands)
-      vrna_commands_apply(vc,
-                          commands,
-                          VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
-
-    /* apply modified base support if requested */
-    mod_bases_apply(vc,
-                    mod_param_sets,
-                    mod_positions,
-                    mod_params);
-
-    if (istty) {
-      if (cut_point == -1) {
-        vrna_message_info(stdout, "length = %d", length);
-      } else {
-        vrna_message_info(stdout,
-                          "length1 = %d\nlength2 = %d",
-                          cut_point - 1,
-                          length - cut_point + 1);
-      }
-    }
+    RUN_IN_PARALLEL(process_record, record);
 
-    /*
-     ########################################################
-     # begin actual computations
-     ########################################################
-     */
+    rec_id    = rec_sequence = NULL;
+    rec_rest  = NULL;
 
-    if ((logML != 0 || md.dangles == 1 || md.dangles == 3) && dos == 0)
-      if (deltap <= 0)
-        deltap = delta / 100. + 0.001;
+    if (opt->with_shapes || (opt->constraints_file && (!opt->batch)))
+      break;
 
-    if (deltap > 0)
-      print_energy = deltap;
+    /* print user help for the next round if we get input from tty */
+    if (istty)
+      print_input_prompt(opt);
+  }
+}
 
-    /* stochastic backtracking */
-    if (n_back > 0) {
-      double        mfe, kT, ens_en;
-      unsigned int  options = (nonRedundant) ?
-                              VRNA_PBACKTRACK_NON_REDUNDANT :
-                              VRNA_PBACKTRACK_DEFAULT;
 
-      if (vc->cutpoint != -1)
-        vrna_message_error(
-          "Boltzmann sampling for multiple interacting sequences not implemented (yet)!");
+PRIVATE void
+process_record(struct record_data *record)
+{
+  FILE                  *output;
+  char                  *rec_sequence, *orig_sequence, *cstruc, *structure, *SEQ_ID,
+                        *v_file_name, *tmp_string;
+  int                   i, length, cl;
+  size_t                **mod_positions, mod_param_sets;
+  struct options        *opt;
+  record_output         o_stream;
+  vrna_fold_compound_t  *vc;
+
+  opt           = record->options;
+  rec_sequence  = record->sequence;
+  cstruc        = NULL;
+  v_file_name   = NULL;
+  SEQ_ID        = fileprefix_from_id(record->id, opt->id_control, opt->filename_full);
+
+  if (opt->tofile) {
+    /* prepare the file name */
+    if (opt->outfile)
+      v_file_name = vrna_strdup_printf("%s", opt->outfile);
+    else
+      v_file_name = (SEQ_ID) ?
+                    vrna_strdup_printf("%s.sub", SEQ_ID) :
+                    vrna_strdup_printf("RNAsubopt_output.sub");
+
+    tmp_string = vrna_filename_sanitize(v_file_name, opt->filename_delim);
+    free(v_file_name);
+    v_file_name = tmp_string;
 
-      print_fasta_header(output, rec_id);
+    if (opt->infile && !strcmp(opt->infile, v_file_name))
+      vrna_message_error("Input and output file names are identical");
+  }
 
-      fprintf(output, "%s\n", orig_sequence);
+  o_stream  = record_output_init(opt->output_queue, v_file_name);
+  output    = record_output_fp(o_stream);
 
-      mfe = vrna_mfe(vc, structure);
-      /* rescale Boltzmann factors according to predicted MFE */
-      vrna_exp_params_rescale(vc, &mfe);
+  /* convert DNA alphabet to RNA if not explicitely switched off */
+  if (!opt->noconv)
+    vrna_seq_toRNA(rec_sequence);
 
-      vrna_mx_mfe_free(vc);
+  /* store case-unmodified sequence */
+  orig_sequence = strdup(rec_sequence);
 
-      /* ignore return value, we are not interested in the free energy */
-      ens_en  = vrna_pf(vc, structure);
-      kT      = vc->exp_params->kT / 1000.;
-
-      if (st_back_en) {
-        struct nr_en_data dat;
-        dat.output  = output;
-        dat.fc      = vc;
-        dat.kT      = kT;
-        dat.ens_en  = ens_en;
-
-        vrna_pbacktrack_cb(vc,
-                           n_back,
-                           &print_samples_en,
-                           (void *)&dat,
-                           options);
-      } else {
-        vrna_pbacktrack_cb(vc,
-                           n_back,
-                           &print_samples,
-                           (void *)output,
-                           options);
-      }
-    }
-    /* normal subopt */
-    else if (!zuker) {
-      /* first lines of output (suitable  for sort +1n) */
-      if (rec_id) {
-        char *head = vrna_strdup_printf("%s [%d]", rec_id, delta);
-        print_fasta_header(output, head);
-        free(head);
-      }
+  mod_positions = mod_positions_seq_prepare(rec_sequence,
+                                            opt->mod_params,
+                                            opt->verbose,
+                                            &mod_param_sets);
 
-      vrna_subopt(vc, delta, subopt_sorted, output);
+  /* convert sequence to uppercase letters only */
+  vrna_seq_toupper(rec_sequence);
 
-      if (dos) {
-        int i;
-        for (i = 0; i <= MAXDOS && i <= delta / 10; i++) {
-          char *tline = vrna_strdup_printf("%4d %6d", i, density_of_states[i]);
-          print_table(output, NULL, tline);
-          free(tline);
-        }
+  vc      = vrna_fold_compound(rec_sequence, &(opt->md), VRNA_OPTION_DEFAULT);
+  length  = vc->length;
+
+  structure = (char *)vrna_alloc(sizeof(char) * (length + 1));
+
+  /* parse the rest of the current dataset to obtain a structure constraint */
+  if (fold_constrained) {
+    if (opt->constraints_file) {
+      vrna_constraints_add(vc, opt->constraints_file, VRNA_OPTION_DEFAULT);
+    } else {
+      int           cp        = -1;
+      unsigned int  coptions  = (record->multiline_input) ? VRNA_OPTION_MULTILINE : 0;
+      cstruc  = vrna_extract_record_rest_structure((const char **)record->rest, 0, coptions);
+      cstruc  = vrna_cut_point_remove(cstruc, &cp);
+      if (vc->cutpoint != cp) {
+        vrna_message_error("Sequence and Structure have different cut points.\n"
+                           "sequence: %d, structure: %d",
+                           vc->cutpoint, cp);
       }
-    }
-    /* Zuker suboptimals */
-    else {
-      vrna_subopt_solution_t  *zr;
 
-      if (vc->strands > 1)
-        vrna_message_error("Sorry, zuker subopts not yet implemented for cofold");
+      cl = (cstruc) ? (int)strlen(cstruc) : 0;
 
-      int                     i;
-      print_fasta_header(output, rec_id);
+      if (cl == 0)
+        vrna_message_warning("Structure constraint is missing");
+      else if (cl < length)
+        vrna_message_warning("Structure constraint is shorter than sequence");
+      else if (cl > length)
+        vrna_message_error("Structure constraint is too long");
 
-      fprintf(output, "%s\n", orig_sequence);
+      if (cstruc) {
+        /* convert pseudo-dot-bracket to actual hard constraints */
+        unsigned int constraint_options = VRNA_CONSTRAINT_DB_DEFAULT;
 
-      zr = vrna_subopt_zuker(vc);
+        if (opt->enforceConstraints)
+          constraint_options |= VRNA_CONSTRAINT_DB_ENFORCE_BP;
 
-      putoutzuker(output, zr);
-      (void)fflush(output);
-      for (i = 0; zr[i].structure; i++)
-        free(zr[i].structure);
-      free(zr);
-    }
+        if (opt->canonicalBPonly)
+          constraint_options |= VRNA_CONSTRAINT_DB_CANONICAL_BP;
 
-    (void)fflush(output);
+        vrna_constraints_add(vc, (const char *)cstruc, constraint_options);
+      }
+    }
+  }
 
-    /* clean up */
-    vrna_fold_compound_free(vc);
+  if (opt->with_shapes) {
+    vrna_constraints_add_SHAPE(vc,
+                               opt->shape_file,
+                               opt->shape_method,
+                               opt->shape_conversion,
+                               opt->verbose,
+                               VRNA_OPTION_MFE | ((opt->n_back > 0) ? VRNA_OPTION_PF : 0));
+  }
 
-    free(cstruc);
+  if (opt->commands)
+    vrna_commands_apply(vc,
+                        opt->commands,
+                        VRNA_CMD_PARSE_HC | VRNA_CMD_PARSE_SC);
 
-    free(rec_id);
-    free(SEQ_ID);
-    free(rec_sequence);
-    free(orig_sequence);
-    free(structure);
+  /* apply modified base support if requested */
+  mod_bases_apply(vc,
+                  mod_param_sets,
+                  mod_positions,
+                  opt->mod_params);
 
-    /* free the rest of current dataset */
-    if (rec_rest) {
-      for (i = 0; rec_rest[i]; i++)
-        free(rec_rest[i]);
-      free(rec_rest);
+  if (record->tty) {
+    if (cut_point == -1) {
+      vrna_message_info(stdout, "length = %d", length);
+    } else {
+      vrna_message_info(stdout,
+                        "length1 = %d\nlength2 = %d",
+                        cut_point - 1,
+                        length - cut_point + 1);
     }
+  }
 
-    rec_id    = rec_sequence = orig_sequence = structure = cstruc = NULL;
-    rec_rest  = NULL;
+  /*
+   ########################################################
+   # begin actual computations
+   ########################################################
+   */
 
-    if (tofile && output) {
-      fclose(output);
-      output = NULL;
+  /* stochastic backtracking */
+  if (opt->n_back > 0) {
+    double        mfe, kT, ens_en;
+    unsigned int  options = (opt->nonRedundant) ?
+                            VRNA_PBACKTRACK_NON_REDUNDANT :
+                            VRNA_PBACKTRACK_DEFAULT;
+
+    if (vc->cutpoint != -1)
+      vrna_message_error(
+        "Boltzmann sampling for multiple interacting sequences not implemented (yet)!");
+
+    print_fasta_header(output, record->id);
+
+    fprintf(output, "%s\n", orig_sequence);
+
+    mfe = vrna_mfe(vc, structure);
+    /* rescale Boltzmann factors according to predicted MFE */
+    vrna_exp_params_rescale(vc, &mfe);
+
+    vrna_mx_mfe_free(vc);
+
+    /* ignore return value, we are not interested in the free energy */
+    ens_en  = vrna_pf(vc, structure);
+    kT      = vc->exp_params->kT / 1000.;
+
+    if (opt->st_back_en) {
+      struct nr_en_data dat;
+      dat.output  = output;
+      dat.fc      = vc;
+      dat.kT      = kT;
+      dat.ens_en  = ens_en;
+
+      vrna_pbacktrack_cb(vc,
+                         opt->n_back,
+                         &print_samples_en,
+                         (void *)&dat,
+                         options);
+    } else {
+      vrna_pbacktrack_cb(vc,
+                         opt->n_back,
+                         &print_samples,
+                         (void *)output,
+                         options);
+    }
+  }
+  /* normal subopt */
+  else if (!opt->zuker) {
+    /* first lines of output (suitable  for sort +1n) */
+    if (record->id) {
+      char *head = vrna_strdup_printf("%s [%d]", record->id, opt->delta);
+      print_fasta_header(output, head);
+      free(head);
     }
 
-    free(v_file_name);
+    if ((opt->max_structures > 0) || (opt->max_memory > 0)) {
+      char  *SeQ, *energies;
+      float min_en = vrna_mfe(vc, NULL);
 
-    if (with_shapes || (constraints_file && (!batch)))
-      break;
+      SeQ       = vrna_cut_point_insert(vc->sequence, vc->cutpoint);
+      energies  = vrna_strdup_printf(" %6.2f %6.2f", min_en, (float)opt->delta / 100.);
+      print_structure(output, SeQ, energies);
+      free(SeQ);
+      free(energies);
 
-    /* print user help for the next round if we get input from tty */
-    if (istty) {
-      if (!zuker)
-        print_comment(stdout, "Use '&' to connect sequences that shall form a complex.");
-
-      if (fold_constrained) {
-        vrna_message_constraint_options(
-          VRNA_CONSTRAINT_DB_DOT | VRNA_CONSTRAINT_DB_X | VRNA_CONSTRAINT_DB_ANG_BRACK |
-          VRNA_CONSTRAINT_DB_RND_BRACK);
-        vrna_message_input_seq(
-          "Input sequence (upper or lower case) followed by structure constraint");
-      } else {
-        vrna_message_input_seq_simple();
+      vrna_mx_mfe_free(vc);
+
+      (void)vrna_subopt_sorted_cb(vc,
+                                  opt->delta,
+                                  subopt_sorted,
+                                  opt->max_structures,
+                                  opt->max_memory,
+                                  &print_subopt,
+                                  (void *)output);
+    } else {
+      vrna_subopt(vc, opt->delta, subopt_sorted, output);
+    }
+
+    if (opt->dos) {
+      for (i = 0; i <= MAXDOS && i <= opt->delta / 10; i++) {
+        char *tline = vrna_strdup_printf("%4d %6d", i, density_of_states[i]);
+        print_table(output, NULL, tline);
+        free(tline);
       }
     }
   }
+  /* Zuker suboptimals */
+  else {
+    vrna_subopt_solution_t *zr;
 
-  if (infile && input)
-    fclose(input);
+    if (vc->strands > 1)
+      vrna_message_error("Sorry, zuker subopts not yet implemented for cofold");
 
-  free(shape_method);
-  free(shape_conversion);
-  free(filename_delim);
-  vrna_commands_free(commands);
+    print_fasta_header(output, record->id);
 
-  if (mod_params) {
-    for (vrna_sc_mod_param_t *ptr = mod_params; *ptr != NULL; ptr++)
-      vrna_sc_mod_parameters_free(*ptr);
+    fprintf(output, "%s\n", orig_sequence);
+
+    zr = vrna_subopt_zuker(vc);
 
-    free(mod_params);
+    putoutzuker(output, zr);
+    for (i = 0; zr[i].structure; i++)
+      free(zr[i].structure);
+    free(zr);
   }
 
-  free_id_data(id_control);
+  record_queue_provide(opt->output_queue, record->number, o_stream);
 
-  return EXIT_SUCCESS;
+  /* clean up */
+  vrna_fold_compound_free(vc);
+
+  free(cstruc);
+
+  free(record->id);
+  free(SEQ_ID);
+  free(rec_sequence);
+  free(orig_sequence);
+  free(structure);
+  free(v_file_name);
+
+  /* free the rest of current dataset */
+  if (record->rest) {
+    for (i = 0; record->rest[i]; i++)
+      free(record->rest[i]);
+    free(record->rest);
+  }
+
+  free(record);
 }
 
 
@@ -644,6 +840,19 @@ print_samples_en(const char *structure,
 }
 
 
+PRIVATE void
+print_subopt(const char *structure,
+             float      energy,
+             void       *data)
+{
+  if (structure) {
+    char *e_string = vrna_strdup_printf(" %6.2f", energy);
+    print_structure((FILE *)data, structure, e_string);
+    free(e_string);
+  }
+}
+
+
 PRIVATE void
 putoutzuker(FILE                    *output,
             vrna_subopt_solution_t  *zukersolution)
@@ -19,8 +19,8 @@
 #include <unistd.h>
 #include <string.h>
 #include <float.h>
-#include "ViennaRNA/fold.h"
 #include "ViennaRNA/fold_vars.h"
+#include "ViennaRNA/mfe.h"
 #include "ViennaRNA/params/io.h"
 #include "ViennaRNA/plotting/probabilities.h"
 #include "ViennaRNA/utils/basic.h"
@@ -33,14 +33,81 @@
 #include "ViennaRNA/constraints/basic.h"
 #include "ViennaRNA/constraints/hard.h"
 #include "ViennaRNA/constraints/soft.h"
+#include "ViennaRNA/datastructures/char_stream.h"
+#include "ViennaRNA/datastructures/stream_output.h"
 
 #include "gengetopt_helpers.h"
+#include "parallel_helpers.h"
 #include "RNAup_cmdl.h"
 
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 #define EQUAL(A, B) (fabs((A)-(B)) < 1000 * DBL_EPSILON)
 
+struct options {
+  vrna_md_t       md;
+  int             w;
+  int             incr3;
+  int             incr5;
+  int             header;
+  int             output;
+  int             max_u;
+  int             **unpaired_values;
+  char            *my_contrib;
+  char            *cmdl_parameters;
+
+  /* the target of the --interaction_first mode */
+  char            *s_target;
+  char            *orig_target;
+  char            *cstruc_target;
+  char            *fname_target;
+  int             length_target;
+  pu_contrib      *unstr_target;
+
+  int             jobs;
+  int             keep_order;
+  unsigned int    next_record_number;
+  vrna_ostream_t  output_queue;
+};
+
+struct record_data {
+  unsigned int    number;
+  unsigned int    up_mode;
+  char            *headers;
+  char            *s1;
+  char            *s2;
+  char            *orig_s1;
+  char            *orig_s2;
+  char            *cstruc1;
+  char            *cstruc2;
+  char            fname1[FILENAME_MAX_LENGTH];
+  char            fname2[FILENAME_MAX_LENGTH];
+  struct options  *options;
+};
+
+struct output_stream {
+  vrna_cstr_t     data;
+  unsigned int    up_mode;
+  pu_contrib      *contrib1;
+  pu_contrib      *contrib2;
+  interact        *inter;
+  char            *plot_file;
+  char            *head;
+  struct options  *options;
+};
+
+PRIVATE void
+process_record(struct record_data *record);
+
+
+PRIVATE pu_contrib *
+unpaired_contributions(const char           *sequence,
+                       const char           *constraint,
+                       int                  w,
+                       vrna_md_t            *md,
+                       vrna_up_workspace_t  *ws);
+
+
 PRIVATE void
 tokenize(char *line,
          char **seq1,
@@ -55,7 +122,8 @@ seperate_bp(char  **inter,
 
 
 PRIVATE void
-print_interaction(interact    *Int,
+print_interaction(vrna_cstr_t buf,
+                  interact    *Int,
                   char        *s1,
                   char        *s2,
                   pu_contrib  *p_c,
@@ -66,8 +134,9 @@ print_interaction(interact    *Int,
 
 
 PRIVATE void
-print_unstru(pu_contrib *p_c,
-             int        w);
+print_unstru(vrna_cstr_t  buf,
+             pu_contrib   *p_c,
+             int          w);
 
 
 PRIVATE int
@@ -89,28 +158,63 @@ PRIVATE int     default_u; /* -u options for plotting: plot pr_unpaired for 4 nu
 PRIVATE double  RT;
 
 /*--------------------------------------------------------------------------*/
+void
+flush_cstr_callback(void          *auxdata,
+                    unsigned int  i,
+                    void          *data)
+{
+  struct output_stream  *s = (struct output_stream *)data;
+  struct options        *opt;
+
+  if (s) {
+    opt = s->options;
+
+    /* flush/free data[k] */
+    vrna_cstr_free(s->data);
+
+    if (s->plot_file)
+      Up_plot(s->contrib1,
+              s->contrib2,
+              s->inter,
+              s->plot_file,
+              opt->unpaired_values,
+              opt->my_contrib,
+              s->head,
+              s->up_mode);
+
+    /* we keep the pu contribution structure of the target sequence for all records */
+    if (s->contrib1 != opt->unstr_target)
+      free_pu_contrib_struct(s->contrib1);
+
+    if (s->contrib2 != opt->unstr_target)
+      free_pu_contrib_struct(s->contrib2);
+
+    free_interact(s->inter);
+    free(s->plot_file);
+    free(s->head);
+    free(s);
+  }
+}
+
+
 int
 main(int  argc,
      char *argv[])
 {
   struct RNAup_args_info  args_info;
+  struct options          opt;
   unsigned int            input_type, up_mode;
-  char                    my_contrib[10], *up_out, *name, fname1[FILENAME_MAX_LENGTH],
+  char                    my_contrib[10], fname1[FILENAME_MAX_LENGTH],
                           fname2[FILENAME_MAX_LENGTH], fname_target[FILENAME_MAX_LENGTH],
                           *ParamFile,
-                          *ns_bases, *c, *structure, *head, *input_string, *s1, *s2, *s3, *s_target,
+                          *ns_bases, *c, *headers, *input_string, *s1, *s2, *s3, *s_target,
                           *cstruc1,
-                          *cstruc2, *cstruc_target, *cstruc_combined, *cmdl_parameters, *orig_s1,
+                          *cstruc2, *cstruc_target, *cmdl_parameters, *orig_s1,
                           *orig_s2,
                           *orig_target;
-  int         i, j, length1, length2, length_target, sym, istty,
+  int         i, length1, length2, length_target, sym, istty,
               noconv, max_u, **unpaired_values, ulength_num;
-  double      min_en, sfact;
-
-  /* variables for output */
-  pu_contrib  *unstr_out, *unstr_short, *unstr_target, *contrib1, *contrib2;
-  interact    *inter_out;
-  /* pu_out *longer; */
+  double      sfact;
 
   /* commandline parameters */
   int         w       = 25;             /* length of region of interaction */
@@ -133,14 +237,14 @@ main(int  argc,
   sfact         = 1.07;
   dangles       = 2;
   do_backtrack  = 1;
-  input_string  = s1 = s2 = s3 = s_target = cstruc1 = cstruc2 = cstruc_target = cstruc_combined =
-    NULL;
+  input_string  = s1 = s2 = s3 = s_target = cstruc1 = cstruc2 = cstruc_target = NULL;
   length1         = length2 = length_target = 0;
-  inter_out       = NULL;
-  unstr_out       = unstr_short = unstr_target = contrib1 = contrib2 = NULL;
-  structure       = ParamFile = ns_bases = head = orig_s1 = orig_s2 = orig_target = NULL;
-  up_out          = NULL;
+  ParamFile       = ns_bases = headers = orig_s1 = orig_s2 = orig_target = NULL;
   fname_target[0] = '\0';
+
+  memset(&opt, 0, sizeof(struct options));
+  opt.jobs        = 1;
+  opt.keep_order  = 1;
   /* allocate init length for commandline parameter string */
 
   cmdl_parameters = NULL;
@@ -315,6 +419,11 @@ main(int  argc,
       vrna_strcat_printf(&cmdl_parameters, "-c %s ", my_contrib);
   }
 
+  ggo_get_jobs(args_info, opt.jobs, "RNAup");
+
+  if (args_info.unordered_given)
+    opt.keep_order = 0;
+
   /* set length(s) of unpaired (unstructured) region(s) */
   int min, max, tmp;
 
@@ -421,6 +530,26 @@ main(int  argc,
   }
 
   RT = ((temperature + K0) * GASCONST / 1000.0);
+
+  /* collect everything the records are processed with */
+  set_model_details(&(opt.md));
+  opt.md.sfact          = sfact;
+  opt.w                 = w;
+  opt.incr3             = incr3;
+  opt.incr5             = incr5;
+  opt.header            = header;
+  opt.output            = output;
+  opt.max_u             = max_u;
+  opt.unpaired_values   = unpaired_values;
+  opt.my_contrib        = my_contrib;
+  opt.cmdl_parameters   = cmdl_parameters;
+  opt.fname_target      = fname_target;
+
+  if (opt.keep_order)
+    opt.output_queue = vrna_ostream_init(&flush_cstr_callback, NULL);
+
+  INIT_PARALLELIZATION(opt.jobs);
+
   /*
    #############################################
    # main loop: continue until end of file
@@ -465,7 +594,7 @@ main(int  argc,
     /* extract filename from fasta header if available */
     while ((input_type = get_input_line(&input_string, 0)) & VRNA_INPUT_FASTA_HEADER) {
       (void)sscanf(input_string, "%" XSTR(FILENAME_ID_LENGTH) "s", fname1);
-      printf(">%s\n", input_string); /* print fasta header if available */
+      vrna_strcat_printf(&headers, ">%s\n", input_string); /* print fasta header if available */
       free(input_string);
     }
 
@@ -517,7 +646,7 @@ main(int  argc,
       /* extract filename from fasta header if available */
       while ((input_type = get_input_line(&input_string, 0)) & VRNA_INPUT_FASTA_HEADER) {
         (void)sscanf(input_string, "%" XSTR(FILENAME_ID_LENGTH) "s", fname2);
-        printf(">%s\n", input_string); /* print fasta header if available */
+        vrna_strcat_printf(&headers, ">%s\n", input_string); /* print fasta header if available */
         free(input_string);
       }
       /* break on any error, EOF or quit request */
@@ -666,249 +795,332 @@ main(int  argc,
      ########################################################
      */
 
-    /* compose file names */
+    /* the probabilities to be unstructured for the target are computed only once */
+    if ((up_mode & RNA_UP_MODE_3) && (opt.unstr_target == NULL)) {
+      int wplus = w + incr3 + incr5;
+      if (max_u > wplus)
+        wplus = max_u;
 
-    /* first file name */
-    if (fname1[0] != '\0') {
-      up_out = vrna_strdup_printf("%s", fname1);
-      if (up_mode & (RNA_UP_MODE_2 | RNA_UP_MODE_3)) {
-        if (fname2[0] != '\0')
-          vrna_strcat_printf(&up_out, "_%s", fname2);
-        else if (fname_target[0] != '\0')
-          vrna_strcat_printf(&up_out, "_%s", fname_target);
-      }
-    } else {
-      up_out = vrna_strdup_printf("RNA");
+      if (length_target < wplus)
+        wplus = length_target;
+
+      opt.s_target      = s_target;
+      opt.orig_target   = orig_target;
+      opt.cstruc_target = cstruc_target;
+      opt.length_target = length_target;
+      opt.unstr_target  = unpaired_contributions(s_target,
+                                                 cstruc_target,
+                                                 wplus,
+                                                 &(opt.md),
+                                                 NULL);
     }
 
-    if (!(up_mode & RNA_UP_MODE_1))
-      vrna_strcat_printf(&up_out, "_w%d", w);
+    struct record_data *record = (struct record_data *)vrna_alloc(sizeof(struct record_data));
 
-    structure =
-      (char *)vrna_alloc(sizeof(char) * (MAX2(length_target, MAX2(length1, length2)) + 1));
+    record->number  = opt.next_record_number;
+    record->up_mode = up_mode;
+    record->headers = headers;
+    record->s1      = s1;
+    record->s2      = s2;
+    record->orig_s1 = orig_s1;
+    record->orig_s2 = orig_s2;
+    record->cstruc1 = cstruc1;
+    record->cstruc2 = cstruc2;
+    record->options = &opt;
+    strcpy(record->fname1, fname1);
+    strcpy(record->fname2, fname2);
 
+    if (opt.output_queue)
+      vrna_ostream_request(opt.output_queue, opt.next_record_number++);
 
-    /* begin actual computations */
-    update_fold_params();
+    RUN_IN_PARALLEL(process_record, record);
 
-    /* calc mfe of first sequence */
-    if (cstruc1 != NULL)
-      strncpy(structure, cstruc1, length1 + 1);
+    /* the record now owns the input data */
+    headers = s1 = s2 = orig_s1 = orig_s2 = cstruc1 = cstruc2 = NULL;
+  } while (1);
 
-    min_en = fold(s1, structure);
+  UNINIT_PARALLELIZATION
 
-    (void)fflush(stdout);
+  vrna_ostream_free(opt.output_queue);
 
-    /* calc probability to be unstructured for 1st sequence (in upmode=3 this is not the target!) */
+  free_pu_contrib_struct(opt.unstr_target);
+  free(s_target);
+  free(orig_target);
+  free(cstruc_target);
+  free(headers);
+  free(cmdl_parameters);
 
-    int wplus = w;
-    if (!(up_mode & RNA_UP_MODE_3)) {
-      wplus += incr3 + incr5;
-      /* reset window size if maximum unstructured region is exceeds it */
-      if (max_u > wplus)
-        wplus = max_u;
-    }
+  return EXIT_SUCCESS;
+}
 
-    /* reset window size if sequence length is shorter */
-    if (length1 < wplus)
-      wplus = length1;
 
-    /* calc mfe for first sequence (2nd if upmode = 3) */
-    if (cstruc1 != NULL)
-      strncpy(structure, cstruc1, length1 + 1);
+PRIVATE void
+process_record(struct record_data *record)
+{
+  unsigned int          up_mode;
+  char                  *s1, *s2, *orig_s1, *orig_s2, *cstruc1, *cstruc2, *up_out, *head,
+                        *cstruc_combined;
+  int                   i, j, length1, length2, wplus;
+  pu_contrib            *unstr_out, *contrib1, *contrib2;
+  interact              *inter_out;
+  vrna_up_workspace_t   *ws;
+  struct options        *opt;
+  struct output_stream  *o_stream;
+
+  opt             = record->options;
+  up_mode         = record->up_mode;
+  s1              = record->s1;
+  s2              = record->s2;
+  orig_s1         = record->orig_s1;
+  orig_s2         = record->orig_s2;
+  cstruc1         = record->cstruc1;
+  cstruc2         = record->cstruc2;
+  length1         = (int)strlen(s1);
+  length2         = (s2) ? (int)strlen(s2) : 0;
+  head            = NULL;
+  cstruc_combined = NULL;
+  contrib1        = contrib2 = NULL;
+  inter_out       = NULL;
 
-    min_en    = fold(s1, structure);
-    pf_scale  = exp(-(sfact * min_en) / RT / length1);
-    if (length1 > 2000)
-      vrna_message_info(stderr, "scaling factor %f", pf_scale);
+  o_stream            = (struct output_stream *)vrna_alloc(sizeof(struct output_stream));
+  o_stream->data      = vrna_cstr(4 * (length1 + length2), stdout);
+  o_stream->up_mode   = up_mode;
+  o_stream->options   = opt;
 
-    if (cstruc1 != NULL)
-      strncpy(structure, cstruc1, length1 + 1);
+  if (record->headers)
+    vrna_cstr_printf(o_stream->data, "%s", record->headers);
 
-    (void)pf_fold(s1, structure);
-    unstr_out = pf_unstru(s1, wplus);
-    free_pf_arrays();
+  /* compose file names */
 
-    if (fold_constrained) {
-      if (up_mode & RNA_UP_MODE_2) {
-        cstruc_combined = (char *)vrna_alloc(sizeof(char) * (length1 + length2 + 1));
-        strncpy(cstruc_combined, cstruc1, length1 + 1);
-        strcat(cstruc_combined, cstruc2);
-      } else if (up_mode & RNA_UP_MODE_3) {
-        cstruc_combined = (char *)vrna_alloc(sizeof(char) * (length_target + length1 + 1));
-        strncpy(cstruc_combined, cstruc_target, length_target + 1);
-        strcat(cstruc_combined, cstruc1);
-      }
+  /* first file name */
+  if (record->fname1[0] != '\0') {
+    up_out = vrna_strdup_printf("%s", record->fname1);
+    if (up_mode & (RNA_UP_MODE_2 | RNA_UP_MODE_3)) {
+      if (record->fname2[0] != '\0')
+        vrna_strcat_printf(&up_out, "_%s", record->fname2);
+      else if (opt->fname_target[0] != '\0')
+        vrna_strcat_printf(&up_out, "_%s", opt->fname_target);
     }
+  } else {
+    up_out = vrna_strdup_printf("RNA");
+  }
 
-    contrib1  = contrib2 = NULL;
-    inter_out = NULL;
-
-    switch (up_mode) {
-      case RNA_UP_MODE_1:
-        for (i = 1; i <= unpaired_values[0][0]; i++) {
-          j = unpaired_values[i][0];
-          do
-            print_unstru(unstr_out, j);
-          while (++j <= unpaired_values[i][1]);
-        }
-        if (output && header)
-          head =
-            vrna_strdup_printf("# %s\n# %d %s\n# %s", cmdl_parameters, length1, fname1, orig_s1);
+  if (!(up_mode & RNA_UP_MODE_1))
+    vrna_strcat_printf(&up_out, "_w%d", opt->w);
 
-        contrib1 = unstr_out;
-        break;
-      case RNA_UP_MODE_2:
-        inter_out = pf_interact(s1, s2, unstr_out, NULL, w, cstruc_combined, incr3, incr5);
-        print_interaction(inter_out, orig_s1, orig_s2, unstr_out, NULL, w, incr3, incr5);
-        if (output && header)
-          head = vrna_strdup_printf("# %s\n# %d %s\n# %s\n# %d %s\n# %s",
-                                    cmdl_parameters,
-                                    length1,
-                                    fname1,
-                                    orig_s1,
-                                    length2,
-                                    fname2,
-                                    orig_s2);
-
-        contrib1 = unstr_out;
-        break;
-      case RNA_UP_MODE_3:   /* calculate prob. unstruct. for target seq */
-        if (unstr_target == NULL) {
-          wplus = w + incr3 + incr5;
-          if (max_u > wplus)
-            wplus = max_u;
+  /* each record uses its own workspace so that records can be processed concurrently */
+  ws = vrna_up_workspace(&(opt->md));
 
-          if (length_target < wplus)
-            wplus = length_target;
+  /* calc probability to be unstructured for 1st sequence (in upmode=3 this is not the target!) */
+  wplus = opt->w;
+  if (!(up_mode & RNA_UP_MODE_3)) {
+    wplus += opt->incr3 + opt->incr5;
+    /* reset window size if maximum unstructured region is exceeds it */
+    if (opt->max_u > wplus)
+      wplus = opt->max_u;
+  }
 
-          if (cstruc_target != NULL)
-            strncpy(structure, cstruc_target, length_target + 1);
+  /* reset window size if sequence length is shorter */
+  if (length1 < wplus)
+    wplus = length1;
+
+  unstr_out = unpaired_contributions(s1, cstruc1, wplus, &(opt->md), ws);
+
+  if (cstruc1) {
+    if (up_mode & RNA_UP_MODE_2) {
+      cstruc_combined = (char *)vrna_alloc(sizeof(char) * (length1 + length2 + 1));
+      strncpy(cstruc_combined, cstruc1, length1 + 1);
+      strcat(cstruc_combined, cstruc2);
+    } else if (up_mode & RNA_UP_MODE_3) {
+      cstruc_combined = (char *)vrna_alloc(sizeof(char) * (opt->length_target + length1 + 1));
+      strncpy(cstruc_combined, opt->cstruc_target, opt->length_target + 1);
+      strcat(cstruc_combined, cstruc1);
+    }
+  }
 
-          min_en    = fold(s_target, structure);
-          pf_scale  = exp(-(sfact * min_en) / RT / length_target);
-          if (length_target > 2000)
-            vrna_message_info(stderr, "scaling factor %f", pf_scale);
+  switch (up_mode) {
+    case RNA_UP_MODE_1:
+      for (i = 1; i <= opt->unpaired_values[0][0]; i++) {
+        j = opt->unpaired_values[i][0];
+        do
+          print_unstru(o_stream->data, unstr_out, j);
+        while (++j <= opt->unpaired_values[i][1]);
+      }
+      if (opt->output && opt->header)
+        head = vrna_strdup_printf("# %s\n# %d %s\n# %s",
+                                  opt->cmdl_parameters,
+                                  length1,
+                                  record->fname1,
+                                  orig_s1);
+
+      contrib1 = unstr_out;
+      break;
+    case RNA_UP_MODE_2:
+      inter_out = vrna_pf_interact(s1,
+                                   s2,
+                                   unstr_out,
+                                   NULL,
+                                   opt->w,
+                                   cstruc_combined,
+                                   opt->incr3,
+                                   opt->incr5,
+                                   ws);
+      print_interaction(o_stream->data,
+                        inter_out,
+                        orig_s1,
+                        orig_s2,
+                        unstr_out,
+                        NULL,
+                        opt->w,
+                        opt->incr3,
+                        opt->incr5);
+      if (opt->output && opt->header)
+        head = vrna_strdup_printf("# %s\n# %d %s\n# %s\n# %d %s\n# %s",
+                                  opt->cmdl_parameters,
+                                  length1,
+                                  record->fname1,
+                                  orig_s1,
+                                  length2,
+                                  record->fname2,
+                                  orig_s2);
+
+      contrib1 = unstr_out;
+      break;
+    case RNA_UP_MODE_3:
+      /* check if target sequence is actually longer than query, if not rotate both sequences */
+      if (opt->length_target < length1) {
+        inter_out = vrna_pf_interact(s1,
+                                     opt->s_target,
+                                     unstr_out,
+                                     opt->unstr_target,
+                                     opt->w,
+                                     cstruc_combined,
+                                     opt->incr3,
+                                     opt->incr5,
+                                     ws);
+        print_interaction(o_stream->data,
+                          inter_out,
+                          orig_s1,
+                          opt->orig_target,
+                          unstr_out,
+                          opt->unstr_target,
+                          opt->w,
+                          opt->incr3,
+                          opt->incr5);
+        contrib1  = unstr_out;
+        contrib2  = opt->unstr_target;
+      } else {
+        inter_out = vrna_pf_interact(opt->s_target,
+                                     s1,
+                                     opt->unstr_target,
+                                     unstr_out,
+                                     opt->w,
+                                     cstruc_combined,
+                                     opt->incr3,
+                                     opt->incr5,
+                                     ws);
+        print_interaction(o_stream->data,
+                          inter_out,
+                          opt->orig_target,
+                          orig_s1,
+                          opt->unstr_target,
+                          unstr_out,
+                          opt->w,
+                          opt->incr3,
+                          opt->incr5);
+        contrib1  = opt->unstr_target;
+        contrib2  = unstr_out;
+      }
 
-          if (cstruc_target != NULL)
-            strncpy(structure, cstruc_target, length_target + 1);
+      if (opt->output && opt->header)
+        head = vrna_strdup_printf("# %s\n# %d %s\n# %s\n# %d %s\n# %s",
+                                  opt->cmdl_parameters,
+                                  opt->length_target,
+                                  opt->fname_target,
+                                  opt->orig_target,
+                                  length1,
+                                  record->fname1,
+                                  orig_s1);
+
+      break;
+  }
 
-          (void)pf_fold(s_target, structure);
-          unstr_target = pf_unstru(s_target, wplus);
-          free_pf_arrays();                     /* for arrays for pf_fold(...) */
-        }
+  /* create additional output */
+  if (opt->output) {
+    /* since we do not limit the amount of ulength values anymore we just put
+     * the maximum length into the filename, the actual printed lengths
+     * should be somewhere in the output itself */
+    o_stream->plot_file = vrna_strdup_printf("%s_u%d.out", up_out, opt->unpaired_values[0][0]);
+    vrna_cstr_printf(o_stream->data, "RNAup output in file: %s\n", o_stream->plot_file);
+  }
 
-        /* check if target sequence is actually longer than query, if not rotate both sequences */
-        if (length_target < length1) {
-          inter_out = pf_interact(s1,
-                                  s_target,
-                                  unstr_out,
-                                  unstr_target,
-                                  w,
-                                  cstruc_combined,
-                                  incr3,
-                                  incr5);
-          print_interaction(inter_out,
-                            orig_s1,
-                            orig_target,
-                            unstr_out,
-                            unstr_target,
-                            w,
-                            incr3,
-                            incr5);
-          contrib1  = unstr_out;
-          contrib2  = unstr_target;
-        } else {
-          inter_out = pf_interact(s_target,
-                                  s1,
-                                  unstr_target,
-                                  unstr_out,
-                                  w,
-                                  cstruc_combined,
-                                  incr3,
-                                  incr5);
-          print_interaction(inter_out,
-                            orig_target,
-                            orig_s1,
-                            unstr_target,
-                            unstr_out,
-                            w,
-                            incr3,
-                            incr5);
-          contrib1  = unstr_target;
-          contrib2  = unstr_out;
-        }
+  /* the output file is written together with the collected output in charstream */
+  o_stream->contrib1  = contrib1;
+  o_stream->contrib2  = contrib2;
+  o_stream->inter     = inter_out;
+  o_stream->head      = head;
 
-        if (output && header)
-          head = vrna_strdup_printf("# %s\n# %d %s\n# %s\n# %d %s\n# %s",
-                                    cmdl_parameters,
-                                    length_target,
-                                    fname_target,
-                                    orig_target,
-                                    length1,
-                                    fname1,
-                                    orig_s1);
+  if (opt->output_queue)
+    vrna_ostream_provide(opt->output_queue, record->number, (void *)o_stream);
+  else
+    ATOMIC_BLOCK(flush_cstr_callback(NULL, record->number, (void *)o_stream));
 
-        break;
-    }
+  /*
+   ########################################################
+   # clean up
+   ########################################################
+   */
+  vrna_up_workspace_free(ws);
+  free(s1);
+  free(s2);
+  free(orig_s1);
+  free(orig_s2);
+  free(cstruc1);
+  free(cstruc2);
+  free(cstruc_combined);
+  free(up_out);
+  free(record->headers);
+  free(record);
+}
 
-    /* create additional output */
-    if (output) {
-      /* how to best compose a reasonable filename */
-      printf("RNAup output in file: ");
-      /* since we do not limit the amount of ulength values anymore we just put
-       * the maximum length into the filename, the actual printed lengths
-       * should be somewhere in the output itself */
-      name = vrna_strdup_printf("%s_u%d.out", up_out, unpaired_values[0][0]);
-      printf("%s\n", name);
-
-      Up_plot(contrib1, contrib2, inter_out, name, unpaired_values, my_contrib, head, up_mode);
-    }
 
-    /*
-     ########################################################
-     # clean up
-     ########################################################
-     */
+PRIVATE pu_contrib *
+unpaired_contributions(const char           *sequence,
+                       const char           *constraint,
+                       int                  w,
+                       vrna_md_t            *md,
+                       vrna_up_workspace_t  *ws)
+{
+  unsigned int          constraint_options;
+  double                min_en;
+  pu_contrib            *p_c;
+  vrna_fold_compound_t  *fc;
+
+  fc = vrna_fold_compound(sequence, md, VRNA_OPTION_DEFAULT);
+
+  if (constraint) {
+    constraint_options = VRNA_CONSTRAINT_DB
+                         | VRNA_CONSTRAINT_DB_PIPE
+                         | VRNA_CONSTRAINT_DB_DOT
+                         | VRNA_CONSTRAINT_DB_X
+                         | VRNA_CONSTRAINT_DB_ANG_BRACK
+                         | VRNA_CONSTRAINT_DB_RND_BRACK;
+
+    vrna_constraints_add(fc, constraint, constraint_options);
+  }
 
-    /* we can save the pu contribution structure of the target sequence for the next run */
-    if (unstr_target != NULL) {
-      if (length_target < length1)
-        free_pu_contrib_struct(contrib1);
-      else
-        free_pu_contrib_struct(contrib2);
-    } else {
-      if (contrib1 != NULL)
-        free_pu_contrib_struct(contrib1);
+  /* calc mfe to get a reasonable scaling factor for the partition function */
+  min_en = (double)vrna_mfe(fc, NULL);
+  vrna_exp_params_rescale(fc, &min_en);
+  if (fc->length > 2000)
+    vrna_message_info(stderr, "scaling factor %f", fc->exp_params->pf_scale);
 
-      if (contrib2 != NULL)
-        free_pu_contrib_struct(contrib2);
-    }
+  (void)vrna_pf(fc, NULL);
+  p_c = vrna_pf_unstru(fc, w, ws);
 
-    if (inter_out != NULL)
-      free_interact(inter_out);
-
-    /* free all unnecessary character arrays */
-    free(structure);
-    free(s1);
-    free(s2);
-    free(orig_s1);
-    free(orig_s2);
-    free(cstruc1);
-    free(cstruc2);
-    free(head);
-    free(cstruc_combined);
-    free(up_out);
-    free(name);
-
-    structure = s1 = s2 = orig_s1 = orig_s2 = cstruc1 = cstruc2 = head = cstruc_combined = NULL;
-    up_out    = name = NULL;
-
-    free_arrays(); /* for arrays for fold(...) */
-  } while (1);
-  free(cmdl_parameters);
+  vrna_fold_compound_free(fc);
 
-  return EXIT_SUCCESS;
+  return p_c;
 }
 
 
@@ -1180,7 +1392,8 @@ seperate_bp(char  **inter,
 
 
 PRIVATE void
-print_interaction(interact    *Int,
+print_interaction(vrna_cstr_t buf,
+                  interact    *Int,
                   char        *s1,
                   char        *s2,
                   pu_contrib  *p_c,
@@ -1211,7 +1424,8 @@ print_interaction(interact    *Int,
   strncpy(i_short, &s2[Int->j - 1], l_s);
   i_short[l_s] = '\0';
 
-  mfe = duplexfold(i_long, i_short);
+  /* duplexfold() uses global memory, so we must not run it concurrently */
+  ATOMIC_BLOCK(mfe = duplexfold(i_long, i_short));
 
   i_min = mfe.i;
   j_min = mfe.j;
@@ -1265,9 +1479,9 @@ print_interaction(interact    *Int,
     G_sum = Gi_min + Gul;
 
     /* printf("dG = dGint + dGu_l\n"); */
-    printf("%s %3d,%-3d : %3d,%-3d (%.2f = %.2f + %.2f)\n",
-           struc, Int->k, Int->i, Int->j, Int->l, G_min, Gi_min, Gul);
-    printf("%s&%s\n", i_long, i_short);
+    vrna_cstr_printf(buf, "%s %3d,%-3d : %3d,%-3d (%.2f = %.2f + %.2f)\n",
+                     struc, Int->k, Int->i, Int->j, Int->l, G_min, Gi_min, Gul);
+    vrna_cstr_printf(buf, "%s&%s\n", i_long, i_short);
   } else {
     p_c_S = p_c2->H[Int->j][(Int->l) - (Int->j)] +
             p_c2->I[Int->j][(Int->l) - (Int->j)] +
@@ -1279,15 +1493,15 @@ print_interaction(interact    *Int,
 
     G_sum = Gi_min + Gul + Gus;
     /* printf("dG = dGint + dGu_l + dGu_s\n"); */
-    printf("%s %3d,%-3d : %3d,%-3d (%.2f = %.2f + %.2f + %.2f)\n",
-           struc, Int->k, Int->i, Int->j, Int->l, G_min, Gi_min, Gul, Gus);
-    printf("%s&%s\n", i_long, i_short);
+    vrna_cstr_printf(buf, "%s %3d,%-3d : %3d,%-3d (%.2f = %.2f + %.2f + %.2f)\n",
+                     struc, Int->k, Int->i, Int->j, Int->l, G_min, Gi_min, Gul, Gus);
+    vrna_cstr_printf(buf, "%s&%s\n", i_long, i_short);
   }
 
   if (!EQUAL(G_min, G_sum)) {
-    printf("ERROR\n");
+    vrna_cstr_printf(buf, "ERROR\n");
     diff = fabs((G_min) - (G_sum));
-    printf("diff %.18f\n", diff);
+    vrna_cstr_printf(buf, "diff %.18f\n", diff);
   }
 
   if (nix_up)
@@ -1303,8 +1517,9 @@ print_interaction(interact    *Int,
 
 /* print coordinates and free energy for the region of highest accessibility */
 PRIVATE void
-print_unstru(pu_contrib *p_c,
-             int        w)
+print_unstru(vrna_cstr_t  buf,
+             pu_contrib   *p_c,
+             int          w)
 {
   int     i, j, len, min_i, min_j;
   double  dG_u, min_gu;
@@ -1330,7 +1545,7 @@ print_unstru(pu_contrib *p_c,
         }
       }
     }
-    printf("%4d,%4d \t (%.3f) \t for u=%3d\n", min_i, min_j, min_gu, w);
+    vrna_cstr_printf(buf, "%4d,%4d \t (%.3f) \t for u=%3d\n", min_i, min_j, min_gu, w);
   } else {
     vrna_message_error("error with prob unpaired");
   }
@@ -361,4 +361,38 @@ set_salt_DNA(vrna_md_t *md);
   } \
 })
 
+
+/*
+ *  Parse the --jobs option. This requires the declarations
+ *  in parallel_helpers.h to be available.
+ */
+#if VRNA_WITH_PTHREADS
+#define ggo_get_jobs(ggostruct, jobs, program_name) ({ \
+    if (ggostruct.jobs_given) { \
+      int thread_max = max_user_threads(); \
+      if (ggostruct.jobs_arg == 0) { \
+        /* use maximum of concurrent threads */ \
+        int proc_cores, proc_cores_conf; \
+        if (num_proc_cores(&proc_cores, &proc_cores_conf)) { \
+          jobs = MIN2(thread_max, proc_cores_conf); \
+        } else { \
+          vrna_message_warning("Could not determine number of available processor cores!\n" \
+                               "Defaulting to serial computation"); \
+          jobs = 1; \
+        } \
+      } else { \
+        jobs = MIN2(thread_max, ggostruct.jobs_arg); \
+      } \
+      jobs = MAX2(1, jobs); \
+    } \
+  })
+#else
+#define ggo_get_jobs(ggostruct, jobs, program_name) ({ \
+    if (ggostruct.jobs_given) { \
+      vrna_message_warning( \
+        "This version of " program_name " has been built without parallel input processing capabilities"); \
+    } \
+  })
+#endif
+
 #endif
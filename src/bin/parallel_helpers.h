@@ -41,13 +41,24 @@ threadpool      worker_pool;
     } \
 }
 
-#define INIT_PARALLELIZATION(a) { \
+/*
+ *  Number of jobs that may wait in the queue of the thread pool. Once the
+ *  queue is full, RUN_IN_PARALLEL() blocks until a worker takes a job
+ */
+#ifndef PARALLELIZATION_QUEUE_DEPTH
+#define PARALLELIZATION_QUEUE_DEPTH(a)  (4 * (a))
+#endif
+
+#define INIT_PARALLELIZATION(a) \
+  INIT_PARALLELIZATION_QUEUE((a), PARALLELIZATION_QUEUE_DEPTH(((a) > 1) ? (int)(a) : 1))
+
+#define INIT_PARALLELIZATION_QUEUE(a, depth) { \
     max_threads = ((a) > 1) ? (unsigned int)(a) : 1; \
     /* initialize semaphores and thread pool */ \
     if (max_threads > 1) { \
       pthread_mutex_init(&output_mutex, NULL); \
       pthread_mutex_init(&output_file_mutex, NULL); \
-      worker_pool = thpool_init(max_threads); \
+      worker_pool = thpool_init_bounded(max_threads, (depth)); \
     } \
 }
 
@@ -65,11 +76,9 @@ threadpool      worker_pool;
     else { fun(data); } \
 }
 
-#define WAIT_FOR_FREE_SLOT(a) { \
-    if (max_threads > 1) { \
-      while (thpool_num_threads_working(worker_pool) == (a)) \
-        sleep(1); \
-    } \
+#define WAIT_FOR_FREE_SLOT { \
+    if (max_threads > 1) \
+      thpool_wait_for_space(worker_pool); \
 }
 
 #else
@@ -78,9 +87,10 @@ threadpool      worker_pool;
 #define THREADSAFE_FILE_OUTPUT(a)   { (a); }
 #define THREADSAFE_STREAM_OUTPUT(a)   { (a); }
 #define INIT_PARALLELIZATION(a)
+#define INIT_PARALLELIZATION_QUEUE(a, depth)
 #define UNINIT_PARALLELIZATION
 #define RUN_IN_PARALLEL(fun, data)  { fun(data); }
-#define WAIT_FOR_FREE_SLOT(a)
+#define WAIT_FOR_FREE_SLOT
 
 #endif
 
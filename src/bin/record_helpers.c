@@ -0,0 +1,207 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if VRNA_WITH_PTHREADS
+# include <pthread.h>
+#endif
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/datastructures/stream_output.h"
+
+#include "record_helpers.h"
+
+
+struct record_queue_s {
+  unsigned int    next_number;
+  int             buffered;     /* whether records write to memory rather than their destination */
+  vrna_ostream_t  ordered;      /* ordered output stream, NULL for unordered output */
+#if VRNA_WITH_PTHREADS
+  pthread_mutex_t mtx;          /* serializes unordered output */
+#endif
+};
+
+
+struct record_output_s {
+  FILE    *fp;                  /* file handle the record writes to */
+  char    *filename;            /* final destination, NULL for stdout */
+  int     buffered;             /* whether fp is a memory backed file */
+#ifdef HAVE_OPEN_MEMSTREAM
+  char    *buffer;
+  size_t  size;
+#endif
+};
+
+
+static void
+flush_record_output(void          *auxdata,
+                    unsigned int  i,
+                    void          *data);
+
+
+record_queue
+record_queue_init(int jobs,
+                  int keep_order)
+{
+  record_queue queue = (record_queue)vrna_alloc(sizeof(struct record_queue_s));
+
+  queue->next_number  = 0;
+  queue->buffered     = (jobs > 1) ? 1 : 0;
+  queue->ordered      = ((queue->buffered) && (keep_order)) ?
+                        vrna_ostream_init(&flush_record_output, NULL) :
+                        NULL;
+
+#if VRNA_WITH_PTHREADS
+  pthread_mutex_init(&(queue->mtx), NULL);
+#endif
+
+  return queue;
+}
+
+
+void
+record_queue_free(record_queue queue)
+{
+  if (queue) {
+    vrna_ostream_free(queue->ordered);
+#if VRNA_WITH_PTHREADS
+    pthread_mutex_destroy(&(queue->mtx));
+#endif
+    free(queue);
+  }
+}
+
+
+unsigned int
+record_queue_next(record_queue queue)
+{
+  unsigned int number = queue->next_number++;
+
+  if (queue->ordered)
+    vrna_ostream_request(queue->ordered, number);
+
+  return number;
+}
+
+
+void
+record_queue_provide(record_queue   queue,
+                     unsigned int   number,
+                     record_output  output)
+{
+  if (queue->ordered) {
+    vrna_ostream_provide(queue->ordered, number, (void *)output);
+  } else {
+#if VRNA_WITH_PTHREADS
+    pthread_mutex_lock(&(queue->mtx));
+#endif
+    flush_record_output(NULL, number, (void *)output);
+#if VRNA_WITH_PTHREADS
+    pthread_mutex_unlock(&(queue->mtx));
+#endif
+  }
+}
+
+
+record_output
+record_output_init(record_queue queue,
+                   const char   *filename)
+{
+  record_output output = (record_output)vrna_alloc(sizeof(struct record_output_s));
+
+  output->filename  = (filename) ? strdup(filename) : NULL;
+  output->buffered  = queue->buffered;
+
+  if (!output->buffered) {
+    output->fp = stdout;
+    if (filename) {
+      output->fp = fopen(filename, "a");
+      if (!output->fp)
+        vrna_message_error("Failed to open file \"%s\" for writing", filename);
+    }
+
+    return output;
+  }
+
+#ifdef HAVE_OPEN_MEMSTREAM
+  output->buffer  = NULL;
+  output->size    = 0;
+  output->fp      = open_memstream(&(output->buffer), &(output->size));
+#else
+  output->fp = tmpfile();
+#endif
+
+  if (!output->fp)
+    vrna_message_error("Failed to create temporary output stream");
+
+  return output;
+}
+
+
+FILE *
+record_output_fp(record_output output)
+{
+  return output->fp;
+}
+
+
+static void
+flush_record_output(void          *auxdata,
+                    unsigned int  i,
+                    void          *data)
+{
+  FILE          *target;
+  record_output output = (record_output)data;
+
+  if (!output)
+    return;
+
+  if (!output->buffered) {
+    if (output->filename)
+      fclose(output->fp);
+    else
+      fflush(output->fp);
+
+    free(output->filename);
+    free(output);
+    return;
+  }
+
+  target = stdout;
+
+  if (output->filename) {
+    target = fopen(output->filename, "a");
+    if (!target)
+      vrna_message_error("Failed to open file \"%s\" for writing", output->filename);
+  }
+
+#ifdef HAVE_OPEN_MEMSTREAM
+  /* closing the memory stream finalizes its buffer */
+  fclose(output->fp);
+  if (output->size > 0)
+    fwrite(output->buffer, sizeof(char), output->size, target);
+
+  free(output->buffer);
+#else
+  char    buf[4096];
+  size_t  n;
+
+  rewind(output->fp);
+  while ((n = fread(buf, sizeof(char), sizeof(buf), output->fp)) > 0)
+    fwrite(buf, sizeof(char), n, target);
+
+  fclose(output->fp);
+#endif
+
+  if (output->filename)
+    fclose(target);
+  else
+    fflush(target);
+
+  free(output->filename);
+  free(output);
+}
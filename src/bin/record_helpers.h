@@ -0,0 +1,70 @@
+#ifndef VRNA_RECORD_HELPERS_H
+#define VRNA_RECORD_HELPERS_H
+
+#include <stdio.h>
+
+/*
+ *  Shared infrastructure for programs that process their input records
+ *  in parallel (see parallel_helpers.h). Each record writes its results
+ *  into the file handle obtained from record_output_fp(). For parallel
+ *  processing, this is a memory backed file and record_queue_provide()
+ *  hands the output over to the record queue that prints it in the order
+ *  of the input records to its final destination, i.e. stdout or a file.
+ *  For serial processing, records write to their destination directly.
+ */
+
+typedef struct record_queue_s *record_queue;
+
+typedef struct record_output_s *record_output;
+
+
+/*
+ *  Create a new record queue for 'jobs' parallel jobs. If keep_order is 0,
+ *  the output of each record is printed as soon as it is provided.
+ */
+record_queue
+record_queue_init(int jobs,
+                  int keep_order);
+
+
+/*
+ *  Print any pending output and release the queue
+ */
+void
+record_queue_free(record_queue queue);
+
+
+/*
+ *  Obtain the number of the next input record. This must be called in input
+ *  order and prior to dispatching the record to a worker thread.
+ */
+unsigned int
+record_queue_next(record_queue queue);
+
+
+/*
+ *  Provide the output of record 'number' and release the record output
+ */
+void
+record_queue_provide(record_queue   queue,
+                     unsigned int   number,
+                     record_output  output);
+
+
+/*
+ *  Create a new record output that will finally be appended to the file
+ *  'filename', or printed to stdout if 'filename' is NULL
+ */
+record_output
+record_output_init(record_queue queue,
+                   const char   *filename);
+
+
+/*
+ *  Get the file handle a record writes its output to
+ */
+FILE *
+record_output_fp(record_output output);
+
+
+#endif
@@ -82,6 +82,8 @@ typedef struct jobqueue{
 	job  *rear;                          /* pointer to rear  of queue */
 	bsem *has_jobs;                      /* flag as binary semaphore  */
 	int   len;                           /* number of jobs in queue   */
+	int   max_len;                       /* max. jobs in queue, 0=inf */
+	pthread_cond_t has_space;            /* signal to blocked pushers */
 } jobqueue;
 
 
@@ -116,9 +118,10 @@ static int  thread_init(thpool_* thpool_p, struct thread** thread_p, int id);
 static void* thread_do(struct thread* thread_p);
 static void  thread_destroy(struct thread* thread_p);
 
-static int   jobqueue_init(jobqueue* jobqueue_p);
+static int   jobqueue_init(jobqueue* jobqueue_p, int max_len);
 static void  jobqueue_clear(jobqueue* jobqueue_p);
 static void  jobqueue_push(jobqueue* jobqueue_p, struct job* newjob_p);
+static void  jobqueue_wait_for_space(jobqueue* jobqueue_p);
 static struct job* jobqueue_pull(jobqueue* jobqueue_p);
 static void  jobqueue_destroy(jobqueue* jobqueue_p);
 
@@ -137,6 +140,12 @@ static void  bsem_wait(struct bsem *bsem_p);
 
 /* Initialise thread pool */
 struct thpool_* thpool_init(int num_threads){
+	return thpool_init_bounded(num_threads, 0);
+}
+
+
+/* Initialise thread pool with a limited number of queued jobs */
+struct thpool_* thpool_init_bounded(int num_threads, int max_queued){
 
 	threads_on_hold   = 0;
 	threads_keepalive = 1;
@@ -145,6 +154,10 @@ struct thpool_* thpool_init(int num_threads){
 		num_threads = 0;
 	}
 
+	if (max_queued < 0){
+		max_queued = 0;
+	}
+
 	/* Make new thread pool */
 	thpool_* thpool_p;
 	thpool_p = (struct thpool_*)malloc(sizeof(struct thpool_));
@@ -158,7 +171,7 @@ struct thpool_* thpool_init(int num_threads){
 	thpool_p->num_jobs_done = 0;
 
 	/* Initialise the job queue */
-	if (jobqueue_init(&thpool_p->jobqueue) == -1){
+	if (jobqueue_init(&thpool_p->jobqueue, max_queued) == -1){
 		err("thpool_init(): Could not allocate memory for job queue\n");
 		free(thpool_p);
 		return NULL;
@@ -216,6 +229,12 @@ int thpool_add_work(thpool_* thpool_p, void (*function_p)(void*), void* arg_p){
 }
 
 
+/* Wait until the job queue can take another job */
+void thpool_wait_for_space(thpool_* thpool_p){
+	jobqueue_wait_for_space(&thpool_p->jobqueue);
+}
+
+
 /* Wait until all jobs have finished */
 void thpool_wait(thpool_* thpool_p){
 	pthread_mutex_lock(&thpool_p->thcount_lock);
@@ -269,6 +288,16 @@ int thpool_num_threads_working(thpool_* thpool_p){
 	return thpool_p->num_threads_working;
 }
 
+int thpool_num_jobs_queued(thpool_* thpool_p){
+	int len;
+
+	pthread_mutex_lock(&thpool_p->jobqueue.rwmutex);
+	len = thpool_p->jobqueue.len;
+	pthread_mutex_unlock(&thpool_p->jobqueue.rwmutex);
+
+	return len;
+}
+
 long thpool_num_jobs_placed(thpool_* thpool_p){
 	return thpool_p->num_jobs_placed;
 }
@@ -392,8 +421,9 @@ static void thread_destroy (thread* thread_p){
 
 
 /* Initialize queue */
-static int jobqueue_init(jobqueue* jobqueue_p){
+static int jobqueue_init(jobqueue* jobqueue_p, int max_len){
 	jobqueue_p->len = 0;
+	jobqueue_p->max_len = max_len;
 	jobqueue_p->front = NULL;
 	jobqueue_p->rear  = NULL;
 
@@ -403,6 +433,7 @@ static int jobqueue_init(jobqueue* jobqueue_p){
 	}
 
 	pthread_mutex_init(&(jobqueue_p->rwmutex), NULL);
+	pthread_cond_init(&(jobqueue_p->has_space), NULL);
 	bsem_init(jobqueue_p->has_jobs, 0);
 
 	return 0;
@@ -425,10 +456,16 @@ static void jobqueue_clear(jobqueue* jobqueue_p){
 
 
 /* Add (allocated) job to queue
+ *
+ * Blocks while a bounded queue is full
  */
 static void jobqueue_push(jobqueue* jobqueue_p, struct job* newjob){
 
 	pthread_mutex_lock(&jobqueue_p->rwmutex);
+	while (jobqueue_p->max_len && jobqueue_p->len >= jobqueue_p->max_len) {
+		pthread_cond_wait(&jobqueue_p->has_space, &jobqueue_p->rwmutex);
+	}
+
 	newjob->prev = NULL;
 
 	switch(jobqueue_p->len){
@@ -478,14 +515,31 @@ static struct job* jobqueue_pull(jobqueue* jobqueue_p){
 
 	}
 
+	/* wake up a thread waiting for space in a bounded queue */
+	if (job_p && jobqueue_p->max_len) {
+		pthread_cond_signal(&jobqueue_p->has_space);
+	}
+
 	pthread_mutex_unlock(&jobqueue_p->rwmutex);
 	return job_p;
 }
 
 
+/* Wait until a bounded queue has space for another job */
+static void jobqueue_wait_for_space(jobqueue* jobqueue_p){
+
+	pthread_mutex_lock(&jobqueue_p->rwmutex);
+	while (jobqueue_p->max_len && jobqueue_p->len >= jobqueue_p->max_len) {
+		pthread_cond_wait(&jobqueue_p->has_space, &jobqueue_p->rwmutex);
+	}
+	pthread_mutex_unlock(&jobqueue_p->rwmutex);
+}
+
+
 /* Free all queue resources back to the system */
 static void jobqueue_destroy(jobqueue* jobqueue_p){
 	jobqueue_clear(jobqueue_p);
+	pthread_cond_destroy(&jobqueue_p->has_space);
 	free(jobqueue_p->has_jobs);
 }
 
@@ -37,6 +37,30 @@ typedef struct thpool_* threadpool;
 threadpool thpool_init(int num_threads);
 
 
+/**
+ * @brief  Initialize threadpool with a bounded job queue
+ *
+ * Same as thpool_init() but at most max_queued jobs may wait in the job
+ * queue. Once the queue is full, thpool_add_work() blocks until a thread
+ * has taken a job from the queue. This allows for back-pressure if jobs
+ * are added faster than they can be processed.
+ *
+ * @example
+ *
+ *    ..
+ *    threadpool thpool;
+ *    thpool = thpool_init_bounded(4, 16);   //4 threads, at most 16 waiting jobs
+ *    ..
+ *
+ * @param  num_threads   number of threads to be created in the threadpool
+ * @param  max_queued    maximum number of jobs waiting in the queue,
+ *                       0 for an unbounded queue
+ * @return threadpool    created threadpool on success,
+ *                       NULL on error
+ */
+threadpool thpool_init_bounded(int num_threads, int max_queued);
+
+
 /**
  * @brief Add work to the job queue
  *
@@ -67,6 +91,19 @@ threadpool thpool_init(int num_threads);
 int thpool_add_work(threadpool, void (*function_p)(void*), void* arg_p);
 
 
+/**
+ * @brief Wait until the job queue has space for another job
+ *
+ * Blocks the calling thread until a bounded job queue, see
+ * thpool_init_bounded(), can take another job without blocking.
+ * Returns immediately for unbounded queues.
+ *
+ * @param threadpool     the threadpool to wait for
+ * @return nothing
+ */
+void thpool_wait_for_space(threadpool);
+
+
 /**
  * @brief Wait for all queued jobs to finish
  *
@@ -140,6 +177,15 @@ void thpool_destroy(threadpool);
 int thpool_num_threads_working(threadpool);
 
 
+/**
+ * @brief Show number of jobs waiting in the job queue
+ *
+ * @param threadpool     the threadpool of interest
+ * @return integer       number of jobs that have not been taken by a thread yet
+ */
+int thpool_num_jobs_queued(threadpool);
+
+
 /**
  * @brief Show the total number of jobs placed, including finished and ongoing
  *
@@ -1,5 +1,8 @@
 #include <stdio.h>      /* printf, scanf, NULL */
 #include <stdlib.h>     /* malloc, free, rand */
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
 
 #include <ViennaRNA/fold_vars.h>
 #include <ViennaRNA/data_structures.h>
@@ -7,7 +10,229 @@
 #include <ViennaRNA/utils/structures.h>
 #include <ViennaRNA/constraints/basic.h>
 #include <ViennaRNA/fold.h>
+#include <ViennaRNA/mfe.h>
+#include <ViennaRNA/mfe_window.h>
 #include <ViennaRNA/part_func.h>
+#include <ViennaRNA/part_func_window.h>
+#include <ViennaRNA/part_func_up.h>
+#include <ViennaRNA/io/accessibility_store.h>
+#include <ViennaRNA/eval.h>
+#include <ViennaRNA/subopt.h>
+#include <ViennaRNA/plex.h>
+#include <ViennaRNA/datastructures/char_stream.h>
+
+static void
+batch_mfe(vrna_fold_compound_t  *fc,
+          unsigned int          i,
+          void                  *data)
+{
+  char  **structures = (char **)data;
+
+  structures[i] = (char *)vrna_alloc(sizeof(char) * (fc->length + 1));
+  (void)vrna_mfe(fc, structures[i]);
+}
+
+
+static void
+batch_pf(vrna_fold_compound_t *fc,
+         unsigned int         i,
+         void                 *data)
+{
+  double  *energies = (double *)data;
+  char    *structure;
+  double  mfe;
+
+  structure = (char *)vrna_alloc(sizeof(char) * (fc->length + 1));
+  mfe       = (double)vrna_mfe(fc, structure);
+  vrna_exp_params_rescale(fc, &mfe);
+  energies[i] = (double)vrna_pf(fc, structure);
+  free(structure);
+}
+
+
+typedef struct {
+  double  *values;
+  size_t  num;
+  size_t  max_num;
+} probs_stream;
+
+
+static void
+append_value(probs_stream *stream,
+             double       value)
+{
+  if (stream->num == stream->max_num) {
+    stream->max_num = 2 * stream->max_num + 1024;
+    stream->values  = (double *)vrna_realloc(stream->values, sizeof(double) * stream->max_num);
+  }
+
+  stream->values[stream->num++] = value;
+}
+
+
+static void
+collect_probs(FLT_OR_DBL    *pr,
+              int           size,
+              int           i,
+              int           max,
+              unsigned int  type,
+              void          *data)
+{
+  int           k, first, last;
+  probs_stream  *stream = (probs_stream *)data;
+
+  if (type & VRNA_PROBS_WINDOW_UP) {
+    first = 0;
+    last  = size;
+  } else {
+    first = i;
+    last  = size;
+  }
+
+  append_value(stream, (double)type);
+  append_value(stream, (double)size);
+  append_value(stream, (double)i);
+
+  for (k = first; k <= last; k++)
+    append_value(stream, (double)pr[k]);
+}
+
+
+typedef struct {
+  char    **structures;
+  float   *energies;
+  size_t  num;
+  size_t  max_num;
+} subopt_stream;
+
+
+static void
+collect_subopt(const char *structure,
+               float      energy,
+               void       *data)
+{
+  subopt_stream *stream = (subopt_stream *)data;
+
+  if (!structure)
+    return;
+
+  if (stream->num == stream->max_num) {
+    stream->max_num     = 2 * stream->max_num + 1024;
+    stream->structures  = (char **)vrna_realloc(stream->structures,
+                                                sizeof(char *) * stream->max_num);
+    stream->energies    = (float *)vrna_realloc(stream->energies, sizeof(float) * stream->max_num);
+  }
+
+  stream->structures[stream->num] = strdup(structure);
+  stream->energies[stream->num++] = energy;
+}
+
+
+static void
+free_subopt_stream(subopt_stream *stream)
+{
+  size_t i;
+
+  for (i = 0; i < stream->num; i++)
+    free(stream->structures[i]);
+
+  free(stream->structures);
+  free(stream->energies);
+}
+
+
+static unsigned char
+hc_allow_all(int            i,
+             int            j,
+             int            k,
+             int            l,
+             unsigned char  d,
+             void           *data)
+{
+  return (unsigned char)1;
+}
+
+
+static int
+sc_zero(int           i,
+        int           j,
+        int           k,
+        int           l,
+        unsigned char d,
+        void          *data)
+{
+  return 0;
+}
+
+
+static FLT_OR_DBL
+sc_exp_one(int            i,
+           int            j,
+           int            k,
+           int            l,
+           unsigned char  d,
+           void           *data)
+{
+  return (FLT_OR_DBL)1.;
+}
+
+
+static void
+int_loop_md(vrna_md_t *md,
+            int       variant)
+{
+  vrna_md_set_default(md);
+
+  switch (variant) {
+    case 1:
+      md->noGUclosure = 1;
+      break;
+    case 2:
+      md->salt = 0.3;
+      break;
+    case 3:
+      md->dangles     = 0;
+      md->special_hp  = 0;
+      md->noLP        = 1;
+      break;
+  }
+}
+
+
+/* the output of Lduplexfold() for a target shifted by offset */
+static char *
+lduplexfold_output(const char *target,
+                   const char *query,
+                   int        offset)
+{
+  char        *buf;
+  long        size;
+  FILE        *fp;
+  vrna_cstr_t stream;
+
+  fp      = tmpfile();
+  stream  = vrna_cstr(128, fp);
+
+  Lduplexfold_set_output(stream);
+  Lduplexfold_set_target_offset(offset);
+  Lduplexfold(target, query, -1000, 0, 40, 0, 0, 10, 150, 30, 280);
+  Lduplexfold_set_output(NULL);
+  Lduplexfold_set_target_offset(0);
+
+  vrna_cstr_fflush(stream);
+  vrna_cstr_free(stream);
+
+  size  = ftell(fp);
+  buf   = (char *)vrna_alloc(sizeof(char) * (size + 1));
+  rewind(fp);
+  if (fread(buf, 1, size, fp) != (size_t)size)
+    buf[0] = '\0';
+
+  fclose(fp);
+
+  return buf;
+}
+
 
 #suite  MFE_Prediction
 
@@ -24,6 +249,571 @@
   free(structure);
 }
 
+#tcase  Parallel_Fill
+
+#test test_mfe_num_threads
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc_serial, *fc_parallel;
+  const char            sequence[] =
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  const int             length = sizeof(sequence) - 1;
+  char                  structure_serial[length + 1];
+  char                  structure_parallel[length + 1];
+  int                   dangles, i, j, ij;
+
+  for (dangles = 0; dangles <= 3; dangles++) {
+    vrna_md_set_default(&md);
+    md.dangles  = dangles;
+    md.uniq_ML  = 1;
+
+    fc_serial = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+
+    md.num_threads  = 4;
+    fc_parallel     = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+
+    ck_assert(vrna_mfe(fc_serial, structure_serial) == vrna_mfe(fc_parallel, structure_parallel));
+    ck_assert_str_eq(structure_serial, structure_parallel);
+
+    for (i = 1; i <= length; i++) {
+      ck_assert_int_eq(fc_serial->matrices->f5[i], fc_parallel->matrices->f5[i]);
+      for (j = i; j <= length; j++) {
+        ij = fc_serial->jindx[j] + i;
+        ck_assert_int_eq(fc_serial->matrices->c[ij], fc_parallel->matrices->c[ij]);
+        ck_assert_int_eq(fc_serial->matrices->fML[ij], fc_parallel->matrices->fML[ij]);
+        ck_assert_int_eq(fc_serial->matrices->fM1[ij], fc_parallel->matrices->fM1[ij]);
+      }
+    }
+
+    vrna_fold_compound_free(fc_serial);
+    vrna_fold_compound_free(fc_parallel);
+  }
+}
+
+#tcase  Interior_Loops
+
+#test test_mfe_int_loops
+{
+  /*
+   *  without hard constraint callbacks and soft constraints, interior loops of
+   *  single sequences are evaluated by table lookups. The element-wise
+   *  evaluation enforced by neutral callbacks must yield identical matrices
+   */
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc_fast, *fc_hc, *fc_sc;
+  const char            *sequences[] = {
+    "GGGAGCAUCCGAUAGCUAACGGUCGAUCCC",
+    "GCGUAGCUGACAUGCUACGUCAAGCUCGAUUCCGCUACGUGAUCGCGAGCUGCA",
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    NULL
+  };
+  const char            **seq;
+  char                  *structure_fast, *structure_hc, *structure_sc;
+  float                 mfe_fast;
+  int                   variant, length, i, j, ij;
+
+  for (seq = sequences; *seq; seq++) {
+    length          = (int)strlen(*seq);
+    structure_fast  = (char *)vrna_alloc(sizeof(char) * (length + 1));
+    structure_hc    = (char *)vrna_alloc(sizeof(char) * (length + 1));
+    structure_sc    = (char *)vrna_alloc(sizeof(char) * (length + 1));
+
+    for (variant = 0; variant < 4; variant++) {
+      int_loop_md(&md, variant);
+
+      fc_fast = vrna_fold_compound(*seq, &md, VRNA_OPTION_MFE);
+      fc_hc   = vrna_fold_compound(*seq, &md, VRNA_OPTION_MFE);
+      fc_sc   = vrna_fold_compound(*seq, &md, VRNA_OPTION_MFE);
+
+      vrna_hc_add_f(fc_hc, &hc_allow_all);
+      vrna_sc_add_f(fc_sc, &sc_zero);
+
+      mfe_fast = vrna_mfe(fc_fast, structure_fast);
+      ck_assert(mfe_fast == vrna_mfe(fc_hc, structure_hc));
+      ck_assert(mfe_fast == vrna_mfe(fc_sc, structure_sc));
+      ck_assert_str_eq(structure_fast, structure_hc);
+      ck_assert_str_eq(structure_fast, structure_sc);
+
+      for (i = 1; i < length; i++)
+        for (j = i + 1; j <= length; j++) {
+          ij = fc_fast->jindx[j] + i;
+          ck_assert_int_eq(fc_fast->matrices->c[ij], fc_hc->matrices->c[ij]);
+          ck_assert_int_eq(fc_fast->matrices->c[ij], fc_sc->matrices->c[ij]);
+        }
+
+      vrna_fold_compound_free(fc_fast);
+      vrna_fold_compound_free(fc_hc);
+      vrna_fold_compound_free(fc_sc);
+    }
+
+    free(structure_fast);
+    free(structure_hc);
+    free(structure_sc);
+  }
+}
+
+#tcase  Banded_Matrices
+
+#test test_mfe_banded
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc_default, *fc_banded;
+  const char            sequence[] =
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  const int             length = sizeof(sequence) - 1;
+  char                  structure_default[length + 1];
+  char                  structure_banded[length + 1];
+  int                   dangles, i, j;
+
+  for (dangles = 0; dangles <= 3; dangles++) {
+    vrna_md_set_default(&md);
+    md.dangles      = dangles;
+    md.max_bp_span  = 40;
+
+    fc_default  = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+    fc_banded   = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+
+    ck_assert_int_eq(vrna_mx_add(fc_banded, VRNA_MX_BANDED, VRNA_OPTION_MFE), 1);
+    ck_assert_int_eq(fc_banded->matrices->type, VRNA_MX_BANDED);
+
+    ck_assert(vrna_mfe(fc_default, structure_default) == vrna_mfe(fc_banded, structure_banded));
+    ck_assert_str_eq(structure_default, structure_banded);
+
+    for (i = 1; i <= length; i++) {
+      ck_assert_int_eq(fc_default->matrices->f5[i], fc_banded->matrices->f5[i]);
+      for (j = i; (j <= length) && (j - i < md.max_bp_span); j++) {
+        ck_assert_int_eq(fc_default->matrices->c[fc_default->jindx[j] + i],
+                         fc_banded->matrices->c[fc_banded->jindx[j] + i]);
+        ck_assert_int_eq(fc_default->matrices->fML[fc_default->jindx[j] + i],
+                         fc_banded->matrices->fML[fc_banded->jindx[j] + i]);
+      }
+    }
+
+    vrna_fold_compound_free(fc_default);
+    vrna_fold_compound_free(fc_banded);
+  }
+}
+
+
+#test test_mfe_tiled
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc_default, *fc_tiled;
+  const char            sequence[] =
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  const int             length = sizeof(sequence) - 1;
+  char                  structure_default[length + 1];
+  char                  structure_tiled[length + 1];
+  int                   dangles, i, j;
+
+  for (dangles = 0; dangles <= 3; dangles++) {
+    vrna_md_set_default(&md);
+    md.dangles  = dangles;
+    md.noLP     = dangles % 2;
+
+    fc_default  = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+    fc_tiled    = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+
+    ck_assert_int_eq(vrna_mx_add(fc_tiled, VRNA_MX_TILED, VRNA_OPTION_MFE), 1);
+    ck_assert_int_eq(fc_tiled->matrices->type, VRNA_MX_TILED);
+
+    ck_assert(vrna_mfe(fc_default, structure_default) == vrna_mfe(fc_tiled, structure_tiled));
+    ck_assert_str_eq(structure_default, structure_tiled);
+
+    for (j = 1; j <= length; j++) {
+      ck_assert_int_eq(fc_default->matrices->f5[j], fc_tiled->matrices->f5[j]);
+      for (i = 1; i <= j; i++) {
+        ck_assert_int_eq(fc_default->matrices->c[fc_default->jindx[j] + i],
+                         fc_tiled->matrices->c[fc_tiled->jindx[j] + i]);
+        ck_assert_int_eq(fc_default->matrices->fML[fc_default->jindx[j] + i],
+                         fc_tiled->matrices->fML[fc_tiled->jindx[j] + i]);
+      }
+    }
+
+    vrna_fold_compound_free(fc_default);
+    vrna_fold_compound_free(fc_tiled);
+  }
+}
+
+
+#test test_mfe_window_global
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc_default, *fc_window;
+  const char            sequence[] =
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  const int             length = sizeof(sequence) - 1;
+  char                  structure_default[length + 1];
+  char                  structure_window[length + 1];
+  int                   dangles;
+  float                 mfe_default, mfe_window;
+
+  for (dangles = 0; dangles <= 3; dangles++) {
+    vrna_md_set_default(&md);
+    md.dangles      = dangles;
+    md.max_bp_span  = 40;
+    md.window_size  = 40;
+
+    fc_default  = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+    fc_window   = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE | VRNA_OPTION_WINDOW);
+
+    mfe_default = vrna_mfe(fc_default, structure_default);
+    mfe_window  = vrna_mfe_window_global(fc_window, structure_window);
+
+    ck_assert(mfe_default == mfe_window);
+    ck_assert_int_eq(strlen(structure_window), length);
+
+    /* energy evaluation is only exact for even dangle models */
+    if (dangles % 2 == 0)
+      ck_assert(vrna_eval_structure(fc_default, structure_window) == mfe_window);
+
+    vrna_fold_compound_free(fc_default);
+    vrna_fold_compound_free(fc_window);
+  }
+}
+
+#tcase  Batch_Processing
+
+#test test_mfe_batch
+{
+  const char  *sequences[] = {
+    "CGCAGGGAUACCCGCG",
+    "GGGGAAAACCCCAUGCAUGCAUGGGGAAAACCCC",
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    "GGGAGGGAGGGAGGGAAAAACCCUCC",
+    "CGCAGGGAUACCCGCG"
+  };
+  const unsigned int  num = sizeof(sequences) / sizeof(sequences[0]);
+  unsigned int        i, t;
+  char                *structures[5], *structure;
+  vrna_md_t           md;
+
+  vrna_md_set_default(&md);
+  md.gquad = 1;
+
+  for (t = 1; t <= 2; t++) {
+    md.num_threads = t;
+    ck_assert_int_eq(vrna_fold_compound_batch(sequences, num, &md, VRNA_OPTION_DEFAULT, &batch_mfe,
+                                              (void *)structures), num);
+
+    for (i = 0; i < num; i++) {
+      vrna_fold_compound_t *fc = vrna_fold_compound(sequences[i], &md, VRNA_OPTION_DEFAULT);
+      structure = (char *)vrna_alloc(sizeof(char) * (fc->length + 1));
+      (void)vrna_mfe(fc, structure);
+      ck_assert_str_eq(structures[i], structure);
+      vrna_fold_compound_free(fc);
+      free(structure);
+      free(structures[i]);
+    }
+  }
+}
+
+#test test_pf_batch
+{
+  const char  *sequences[] = {
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    "CGCAGGGAUACCCGCG",
+    "GGGGAAAACCCCAUGCAUGCAUGGGGAAAACCCC",
+    "GGGAGGGAGGGAGGGAAAAACCCUCC",
+    "CGCAGGGAUACCCGCG"
+  };
+  const unsigned int  num = sizeof(sequences) / sizeof(sequences[0]);
+  unsigned int        i, t;
+  double              energies[5], energy;
+  vrna_md_t           md;
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  for (t = 1; t <= 2; t++) {
+    md.num_threads = t;
+    ck_assert_int_eq(vrna_fold_compound_batch(sequences, num, &md,
+                                              VRNA_OPTION_MFE | VRNA_OPTION_PF,
+                                              &batch_pf,
+                                              (void *)energies), num);
+
+    for (i = 0; i < num; i++) {
+      vrna_fold_compound_t *fc = vrna_fold_compound(sequences[i], &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+      batch_pf(fc, 0, (void *)&energy);
+      ck_assert(fabs(energies[i] - energy) < 1e-9);
+      vrna_fold_compound_free(fc);
+    }
+  }
+}
+
+#test test_fold_compound_reset
+{
+  const char            *seq1 = "GGGGAAAACCCCAUGCAUGCAUGGGGAAAACCCC";
+  const char            *seq2 = "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUG";
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc, *fc_new;
+  double                energy, energy_new;
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  fc = vrna_fold_compound(seq1, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+  batch_pf(fc, 0, (void *)&energy);
+
+  /* identical model details keep the energy parameters */
+  fc->params->id = -1;
+  ck_assert_int_eq(vrna_fold_compound_reset(fc, seq2, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF), 1);
+  ck_assert_int_eq(fc->params->id, -1);
+
+  batch_pf(fc, 0, (void *)&energy);
+  fc_new = vrna_fold_compound(seq2, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+  batch_pf(fc_new, 0, (void *)&energy_new);
+  ck_assert(fabs(energy - energy_new) < 1e-9);
+  vrna_fold_compound_free(fc_new);
+
+  /* different ones replace them */
+  md.temperature = 42.;
+  ck_assert_int_eq(vrna_fold_compound_reset(fc, seq1, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF), 1);
+  ck_assert_int_ne(fc->params->id, -1);
+  ck_assert(fc->params->temperature == 42.);
+
+  batch_pf(fc, 0, (void *)&energy);
+  fc_new = vrna_fold_compound(seq1, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+  batch_pf(fc_new, 0, (void *)&energy_new);
+  ck_assert(fabs(energy - energy_new) < 1e-9);
+  vrna_fold_compound_free(fc_new);
+
+  vrna_fold_compound_free(fc);
+}
+
+#test test_mfe_lanes
+{
+  const char  *sequences[] = {
+    "CGCAGGGAUACCCGCG",
+    "GGGGAAAACCCCAUGC",
+    "AUGCAUGCAUGCAUGC",
+    "CGCAGGGAUACCCGCG",
+    "GGGAGGGAGGGAGGGAAAAACCCUCC",
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU"
+  };
+  const unsigned int  num = sizeof(sequences) / sizeof(sequences[0]);
+  unsigned int        i, d;
+  char                *structures[6], *structure;
+  float               mfe[6], en;
+  vrna_md_t           md;
+
+  vrna_md_set_default(&md);
+
+  for (i = 0; i < num; i++)
+    structures[i] = (char *)vrna_alloc(sizeof(char) * (strlen(sequences[i]) + 1));
+
+  for (d = 0; d <= 2; d++) {
+    md.dangles = d;
+    ck_assert_int_eq(vrna_mfe_lanes(sequences, num, &md, structures, mfe), num);
+
+    for (i = 0; i < num; i++) {
+      vrna_fold_compound_t *fc = vrna_fold_compound(sequences[i], &md, VRNA_OPTION_DEFAULT);
+      structure = (char *)vrna_alloc(sizeof(char) * (fc->length + 1));
+      en        = vrna_mfe(fc, structure);
+      ck_assert(fabs(en - mfe[i]) < 1e-5);
+      ck_assert(fabs(vrna_eval_structure(fc, structures[i]) - mfe[i]) < 1e-5);
+      vrna_fold_compound_free(fc);
+      free(structure);
+    }
+  }
+
+  for (i = 0; i < num; i++)
+    free(structures[i]);
+}
+
+#tcase  Duplexes
+
+#test test_lduplexfold_output
+{
+  /* both sequences are padded with 10 N's at either end, as done by RNAplex */
+  const char  *target =
+    "NNNNNNNNNNGGGAAAUCCCAGCUAGCUAGCUAGGGAUUUCCCAAGCGCGAUUAGCGAAUCGAUCGAUCGAAAGCUAGCUAGGGAUCNNNNNNNNNN";
+  const char  *query  = "NNNNNNNNNNGAUCGAUCGAUUCGCUAAUCGCNNNNNNNNNN";
+  char        *reference[2], *output[8];
+  int         k;
+
+  reference[0]  = lduplexfold_output(target, query, 0);
+  reference[1]  = lduplexfold_output(target, query, 100);
+
+  /* the best hit pairs target positions 37 to 60 with the entire query */
+  ck_assert(strstr(reference[0], " 37,60  :   1,22 ") != NULL);
+  ck_assert(strstr(reference[1], "137,160 :   1,22 ") != NULL);
+
+  /* concurrent calls write to their own stream with their own offset */
+#pragma omp parallel for
+  for (k = 0; k < 8; k++)
+    output[k] = lduplexfold_output(target, query, 100 * (k % 2));
+
+  for (k = 0; k < 8; k++) {
+    ck_assert_str_eq(output[k], reference[k % 2]);
+    free(output[k]);
+  }
+
+  free(reference[0]);
+  free(reference[1]);
+}
+
+#tcase  Suboptimals
+
+#test test_subopt_sorted
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *vc;
+  const char            sequence[] =
+    "GGGGAAAACCCCAUCGAUCGAUCGAUGCAUGCAUGCUAGCUAGCUAGUCGAUCGAUGCUAGCUAGCUAGC";
+  unsigned long         num;
+  size_t                i;
+  subopt_stream         all     = { NULL, NULL, 0, 0 };
+  subopt_stream         sorted  = { NULL, NULL, 0, 0 };
+  subopt_stream         capped  = { NULL, NULL, 0, 0 };
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_DEFAULT);
+
+  vrna_subopt_cb(vc, 500, &collect_subopt, (void *)&all);
+
+  /* best-first enumeration yields the same structures in ascending order of their energies */
+  num = vrna_subopt_sorted_cb(vc, 500, VRNA_SORT_BY_ENERGY_ASC, 0, 0, &collect_subopt,
+                              (void *)&sorted);
+  ck_assert_int_eq(num, all.num);
+  ck_assert_int_eq(sorted.num, all.num);
+
+  for (i = 1; i < sorted.num; i++)
+    ck_assert(sorted.energies[i - 1] <= sorted.energies[i]);
+
+  /* limiting the number of structures yields the lowest ones */
+  num = vrna_subopt_sorted_cb(vc, 500, VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC, 50, 0,
+                              &collect_subopt, (void *)&capped);
+  ck_assert_int_eq(num, 50);
+  ck_assert_int_eq(capped.num, 50);
+
+  for (i = 0; i < capped.num; i++)
+    ck_assert(fabs(capped.energies[i] - sorted.energies[i]) < 1e-5);
+
+  free_subopt_stream(&all);
+  free_subopt_stream(&sorted);
+  free_subopt_stream(&capped);
+
+  vrna_fold_compound_free(vc);
+}
+
+#test test_subopt_max_memory
+{
+  vrna_md_t               md;
+  vrna_fold_compound_t    *vc;
+  vrna_subopt_solution_t  *sol;
+  const char              sequence[] =
+    "GGGGAAAACCCCAUCGAUCGAUCGAUGCAUGCAUGCUAGCUAGCUAGUCGAUCGAUGCUAGCUAGCUAGC";
+  size_t                  i, num;
+  subopt_stream           capped = { NULL, NULL, 0, 0 };
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  vc  = vrna_fold_compound(sequence, &md, VRNA_OPTION_DEFAULT);
+  sol = vrna_subopt(vc, 500, VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC, NULL);
+
+  for (num = 0; sol[num].structure; num++);
+
+  /* a memory limit drops the highest structures but keeps the order */
+  (void)vrna_subopt_sorted_cb(vc, 500, VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC, 0, 16384,
+                              &collect_subopt, (void *)&capped);
+  ck_assert(capped.num > 0);
+  ck_assert(capped.num < num);
+
+  for (i = 0; i < capped.num; i++)
+    ck_assert(fabs(capped.energies[i] - sol[i].energy) < 1e-5);
+
+  for (i = 0; i < num; i++)
+    free(sol[i].structure);
+
+  free(sol);
+  free_subopt_stream(&capped);
+
+  vrna_fold_compound_free(vc);
+}
+
+#test test_subopt_num_threads
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *vc;
+  const char            sequence[] =
+    "GGGGAAAACCCCAUCGAUCGAUCGAUGCAUGCAUGCUAGCUAGCUAGUCGAUCGAUGCUAGCUAGCUAGC";
+  size_t                i;
+  subopt_stream         serial    = { NULL, NULL, 0, 0 };
+  subopt_stream         parallel  = { NULL, NULL, 0, 0 };
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_DEFAULT);
+  vrna_subopt_cb(vc, 500, &collect_subopt, (void *)&serial);
+  vrna_fold_compound_free(vc);
+
+  /* multiple threads report the same structures in the same order */
+  md.num_threads = 4;
+
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_DEFAULT);
+  vrna_subopt_cb(vc, 500, &collect_subopt, (void *)&parallel);
+  vrna_fold_compound_free(vc);
+
+  ck_assert_int_eq(parallel.num, serial.num);
+
+  for (i = 0; i < serial.num; i++) {
+    ck_assert_str_eq(parallel.structures[i], serial.structures[i]);
+    ck_assert(parallel.energies[i] == serial.energies[i]);
+  }
+
+  free_subopt_stream(&serial);
+  free_subopt_stream(&parallel);
+}
+
+#test test_subopt_num_threads_unordered
+{
+  vrna_md_t               md;
+  vrna_fold_compound_t    *vc;
+  vrna_subopt_solution_t  *serial, *parallel;
+  const char              sequence[] =
+    "GGGGAAAACCCCAUCGAUCGAUCGAUGCAUGCAUGCUAGCUAGCUAGUCGAUCGAUGCUAGCUAGCUAGC";
+  size_t                  i;
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  vc      = vrna_fold_compound(sequence, &md, VRNA_OPTION_DEFAULT);
+  serial  = vrna_subopt(vc, 500, VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC, NULL);
+  vrna_fold_compound_free(vc);
+
+  /*
+   *  sorted output doesn't require the order of the enumeration, so threads
+   *  steal branches from each other. Still, we must obtain the same set of
+   *  structures
+   */
+  md.num_threads = 4;
+
+  vc        = vrna_fold_compound(sequence, &md, VRNA_OPTION_DEFAULT);
+  parallel  = vrna_subopt(vc, 500, VRNA_SORT_BY_ENERGY_LEXICOGRAPHIC_ASC, NULL);
+  vrna_fold_compound_free(vc);
+
+  for (i = 0; serial[i].structure; i++) {
+    ck_assert(parallel[i].structure != NULL);
+    ck_assert_str_eq(parallel[i].structure, serial[i].structure);
+    ck_assert(parallel[i].energy == serial[i].energy);
+  }
+
+  ck_assert(parallel[i].structure == NULL);
+
+  for (i = 0; serial[i].structure; i++) {
+    free(serial[i].structure);
+    free(parallel[i].structure);
+  }
+
+  free(serial);
+  free(parallel);
+}
+
 #suite  Partition_Function
 
 #tcase Stochastic_Backtracking
@@ -55,6 +845,417 @@
   vrna_fold_compound_free(vc);
 }
 
+#tcase Interior_Loops
+
+#test test_pf_int_loops
+{
+  /* same as test_mfe_int_loops() for the partition function */
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc_fast, *fc_hc, *fc_sc;
+  const char            *sequences[] = {
+    "GGGAGCAUCCGAUAGCUAACGGUCGAUCCC",
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU",
+    NULL
+  };
+  const char            **seq;
+  FLT_OR_DBL            qb;
+  int                   variant, length, i, j, ij;
+
+  for (seq = sequences; *seq; seq++) {
+    length = (int)strlen(*seq);
+
+    for (variant = 0; variant < 4; variant++) {
+      int_loop_md(&md, variant);
+      md.compute_bpp = 0;
+
+      fc_fast = vrna_fold_compound(*seq, &md, VRNA_OPTION_PF);
+      fc_hc   = vrna_fold_compound(*seq, &md, VRNA_OPTION_PF);
+      fc_sc   = vrna_fold_compound(*seq, &md, VRNA_OPTION_PF);
+
+      vrna_hc_add_f(fc_hc, &hc_allow_all);
+      vrna_sc_add_exp_f(fc_sc, &sc_exp_one);
+
+      (void)vrna_pf(fc_fast, NULL);
+      (void)vrna_pf(fc_hc, NULL);
+      (void)vrna_pf(fc_sc, NULL);
+
+      for (i = 1; i < length; i++)
+        for (j = i + 1; j <= length; j++) {
+          ij  = fc_fast->iindx[i] - j;
+          qb  = fc_fast->exp_matrices->qb[ij];
+          ck_assert(fabs(qb - fc_hc->exp_matrices->qb[ij]) <= 1e-12 * qb);
+          ck_assert(fabs(qb - fc_sc->exp_matrices->qb[ij]) <= 1e-12 * qb);
+        }
+
+      vrna_fold_compound_free(fc_fast);
+      vrna_fold_compound_free(fc_hc);
+      vrna_fold_compound_free(fc_sc);
+    }
+  }
+}
+
+#tcase Parallel_Fill
+
+#test test_pf_num_threads
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc_serial, *fc_parallel;
+  const char            sequence[] =
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  const int             length = sizeof(sequence) - 1;
+  int                   i, j, ij;
+
+  vrna_md_set_default(&md);
+  md.uniq_ML = 1;
+
+  fc_serial = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+
+  md.num_threads  = 4;
+  fc_parallel     = vrna_fold_compound(sequence, &md, VRNA_OPTION_PF);
+
+  ck_assert(vrna_pf(fc_serial, NULL) == vrna_pf(fc_parallel, NULL));
+
+  for (i = 1; i <= length; i++)
+    for (j = i; j <= length; j++) {
+      ij = fc_serial->iindx[i] - j;
+      ck_assert(fc_serial->exp_matrices->q[ij] == fc_parallel->exp_matrices->q[ij]);
+      ck_assert(fc_serial->exp_matrices->qb[ij] == fc_parallel->exp_matrices->qb[ij]);
+      ck_assert(fc_serial->exp_matrices->qm[ij] == fc_parallel->exp_matrices->qm[ij]);
+      ck_assert(fc_serial->exp_matrices->probs[ij] == fc_parallel->exp_matrices->probs[ij]);
+    }
+
+  vrna_fold_compound_free(fc_serial);
+  vrna_fold_compound_free(fc_parallel);
+}
+
+#tcase Interaction
+
+#test test_pf_interact_workspace
+{
+  const char          *target   = "GGGAAAUCCCAGCUAGCUAGCUAGGGAUUUCCCAAGCGCGAUUAGCGAAUCGAUCGAUCG";
+  const char          *query    = "AUCGAUCGCUAAUCGC";
+  char                *structure;
+  double              a, b;
+  int                 i, s, u, w;
+  pu_contrib          *p_target, *p_query, *p_target_ws, *p_query_ws, *p[2], *p_ws[2];
+  interact            *pint, *pint_ws;
+  vrna_md_t           md;
+  vrna_exp_param_t    *pf;
+  vrna_fold_compound_t *fc;
+  vrna_up_workspace_t *ws;
+
+  /* both interfaces have to use the same scaling factor */
+  w         = 8;
+  pf_scale  = 1.5;
+
+  /* legacy interface on global arrays */
+  structure = (char *)vrna_alloc(sizeof(char) * (strlen(query) + 1));
+  pf_fold(query, structure);
+  p_query = pf_unstru((char *)query, w);
+  free(structure);
+
+  structure = (char *)vrna_alloc(sizeof(char) * (strlen(target) + 1));
+  pf_fold(target, structure);
+  p_target = pf_unstru((char *)target, w);
+  free(structure);
+
+  pint = pf_interact(target, query, p_target, p_query, w, NULL, 0, 0);
+
+  /* re-entrant interface with a workspace */
+  set_model_details(&md);
+  ws            = vrna_up_workspace(&md);
+  pf            = vrna_exp_params(&md);
+  pf->pf_scale  = pf_scale;
+
+  fc = vrna_fold_compound(query, &md, VRNA_OPTION_PF);
+  vrna_exp_params_subst(fc, pf);
+  vrna_pf(fc, NULL);
+  p_query_ws = vrna_pf_unstru(fc, w, ws);
+  vrna_fold_compound_free(fc);
+
+  fc = vrna_fold_compound(target, &md, VRNA_OPTION_PF);
+  vrna_exp_params_subst(fc, pf);
+  vrna_pf(fc, NULL);
+  p_target_ws = vrna_pf_unstru(fc, w, ws);
+  vrna_fold_compound_free(fc);
+
+  pint_ws = vrna_pf_interact(target, query, p_target_ws, p_query_ws, w, NULL, 0, 0, ws);
+
+  ck_assert(p_query_ws != NULL);
+  ck_assert(p_target_ws != NULL);
+  ck_assert(pint_ws != NULL);
+
+  p[0]    = p_query;
+  p[1]    = p_target;
+  p_ws[0] = p_query_ws;
+  p_ws[1] = p_target_ws;
+
+  for (s = 0; s < 2; s++) {
+    ck_assert_int_eq(p[s]->length, p_ws[s]->length);
+    for (i = 1; i <= p[s]->length; i++)
+      for (u = 0; u < w; u++) {
+        a = p[s]->H[i][u] + p[s]->I[i][u] + p[s]->M[i][u] + p[s]->E[i][u];
+        b = p_ws[s]->H[i][u] + p_ws[s]->I[i][u] + p_ws[s]->M[i][u] + p_ws[s]->E[i][u];
+        ck_assert(fabs(a - b) <= 1e-9 * MAX2(fabs(a), 1.));
+        ck_assert(fabs(p[s]->E[i][u] - p_ws[s]->E[i][u]) <= 1e-9 * MAX2(fabs(a), 1.));
+      }
+  }
+
+  ck_assert_int_eq(pint->length, pint_ws->length);
+  ck_assert_int_eq(pint->i, pint_ws->i);
+  ck_assert_int_eq(pint->k, pint_ws->k);
+  ck_assert_int_eq(pint->j, pint_ws->j);
+  ck_assert_int_eq(pint->l, pint_ws->l);
+  ck_assert(fabs(pint->Gikjl - pint_ws->Gikjl) < 1e-6);
+  ck_assert(fabs(pint->Gikjl_wo - pint_ws->Gikjl_wo) < 1e-6);
+
+  for (i = 1; i <= pint->length; i++) {
+    ck_assert(fabs(pint->Pi[i] - pint_ws->Pi[i]) < 1e-9);
+    ck_assert(fabs(pint->Gi[i] - pint_ws->Gi[i]) < 1e-6);
+  }
+
+  free_interact(pint);
+  free_interact(pint_ws);
+  free_pu_contrib(p_query);
+  free_pu_contrib(p_target);
+  free_pu_contrib(p_query_ws);
+  free_pu_contrib(p_target_ws);
+  vrna_up_workspace_free(ws);
+  free(pf);
+  pf_scale = -1;
+}
+
+#tcase Sliding_Window
+
+#test test_probs_window_num_threads
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc_serial, *fc_parallel;
+  probs_stream          serial = {
+    NULL, 0, 0
+  }, parallel = {
+    NULL, 0, 0
+  };
+  const int             length = 2000;
+  char                  sequence[length + 1];
+  unsigned int          i, seed, options;
+
+  /* pseudo-random sequence that is long enough to be split into chunks */
+  for (seed = 42, i = 0; i < length; i++) {
+    seed        = seed * 1103515245 + 12345;
+    sequence[i] = "ACGU"[(seed >> 16) % 4];
+  }
+  sequence[length] = '\0';
+
+  options = VRNA_PROBS_WINDOW_BPP | VRNA_PROBS_WINDOW_UP | VRNA_PROBS_WINDOW_UP_SPLIT |
+            VRNA_PROBS_WINDOW_PF;
+
+  vrna_md_set_default(&md);
+  md.window_size  = 40;
+  md.max_bp_span  = 30;
+
+  fc_serial = vrna_fold_compound(sequence, &md, VRNA_OPTION_WINDOW);
+
+  md.num_threads  = 4;
+  fc_parallel     = vrna_fold_compound(sequence, &md, VRNA_OPTION_WINDOW);
+
+  ck_assert_int_eq(vrna_probs_window(fc_serial, 10, options, &collect_probs, (void *)&serial), 1);
+  ck_assert_int_eq(vrna_probs_window(fc_parallel, 10, options, &collect_probs, (void *)&parallel), 1);
+
+  /* identical data must be reported in identical order */
+  ck_assert_int_eq(serial.num, parallel.num);
+  for (i = 0; i < serial.num; i++)
+    ck_assert(serial.values[i] == parallel.values[i]);
+
+  free(serial.values);
+  free(parallel.values);
+  vrna_fold_compound_free(fc_serial);
+  vrna_fold_compound_free(fc_parallel);
+}
+
+#test test_probs_window_acc_store
+{
+  char                  filename[L_tmpnam];
+  const char            *sequences[] = {
+    "GGGAAAUCCCAGCUAGCUAGCUAGGGAUUUCCCAAGCGCGAUUAGCGAAUCGAUCGAUCG",
+    "ACGUACGUAGCUAGCUAGGGGAAACCCCUUUAAAGGGCCAUUGG"
+  };
+  const char            *ids[] = {
+    "target", "query"
+  };
+  const int             *data, *data_copy;
+  unsigned int          n, n_copy, i, k, u, ulength;
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc;
+  vrna_acc_store_t      *store;
+
+  ulength = 8;
+  vrna_md_set_default(&md);
+  md.window_size  = 30;
+  md.max_bp_span  = 25;
+
+  ck_assert(tmpnam(filename) != NULL);
+  store = vrna_acc_store_create(filename, ulength, &md);
+  ck_assert(store != NULL);
+
+  /* store the second sequence twice under different IDs */
+  for (i = 0; i < 3; i++) {
+    fc = vrna_fold_compound(sequences[(i < 2) ? i : 1], &md, VRNA_OPTION_WINDOW);
+    ck_assert_int_eq(vrna_acc_store_record_begin(store,
+                                                 (i < 2) ? ids[i] : "query_copy",
+                                                 fc->length), 1);
+    ck_assert_int_eq(vrna_probs_window(fc,
+                                       ulength,
+                                       VRNA_PROBS_WINDOW_UP,
+                                       &vrna_acc_store_probs_window_cb,
+                                       (void *)store), 1);
+    ck_assert_int_eq(vrna_acc_store_record_end(store), 1);
+    vrna_fold_compound_free(fc);
+  }
+
+  ck_assert_int_eq(vrna_acc_store_close(store), 1);
+
+  store = vrna_acc_store_open(filename);
+  ck_assert(store != NULL);
+  ck_assert_int_eq(vrna_acc_store_size(store), 3);
+  ck_assert_int_eq(vrna_acc_store_ulength(store), ulength);
+  ck_assert_int_eq(vrna_acc_store_params_match(store, &md), 1);
+
+  md.temperature = 25.;
+  ck_assert_int_eq(vrna_acc_store_params_match(store, &md), 0);
+
+  for (i = 0; i < 2; i++) {
+    data = vrna_acc_store_get(store, ids[i], &n);
+    ck_assert(data != NULL);
+    ck_assert_int_eq(n, strlen(sequences[i]));
+    ck_assert_int_eq(data[0], ulength);
+    ck_assert_int_eq(data[1], n);
+
+    /* opening energies are available for all segments within the sequence */
+    for (u = 1; u <= ulength; u++)
+      for (k = 1; k <= n; k++) {
+        if (u > k)
+          ck_assert_int_eq(data[u * (n + 20) + 10 + k], VRNA_ACC_STORE_INF);
+        else
+          ck_assert(data[u * (n + 20) + 10 + k] >= 0);
+      }
+  }
+
+  data      = vrna_acc_store_get(store, "query", &n);
+  data_copy = vrna_acc_store_get(store, "query_copy", &n_copy);
+  ck_assert(data_copy != NULL);
+  ck_assert_int_eq(n, n_copy);
+  ck_assert(memcmp(data, data_copy, sizeof(int) * (ulength + 1) * (n + 20)) == 0);
+
+  ck_assert(vrna_acc_store_get(store, "unknown", NULL) == NULL);
+
+  ck_assert_int_eq(vrna_acc_store_close(store), 1);
+  remove(filename);
+}
+
+
+#test test_acc_store_corrupt
+{
+  char              filename[L_tmpnam], corrupt[L_tmpnam];
+  unsigned char     *buf, *entry;
+  long              size;
+  uint64_t          num_records, index_offset, v64;
+  uint32_t          v32;
+  unsigned int      i;
+  FILE              *fp;
+  vrna_acc_store_t  *store;
+
+  ck_assert(tmpnam(filename) != NULL);
+  ck_assert(tmpnam(corrupt) != NULL);
+
+  /* duplicate identifiers are refused by the writer */
+  store = vrna_acc_store_create(filename, 2, NULL);
+  ck_assert(store != NULL);
+  for (i = 0; i < 2; i++) {
+    ck_assert_int_eq(vrna_acc_store_record_begin(store, "same", 10), 1);
+    ck_assert_int_eq(vrna_acc_store_record_end(store), 1);
+  }
+  ck_assert_int_eq(vrna_acc_store_close(store), 0);
+
+  store = vrna_acc_store_create(filename, 2, NULL);
+  ck_assert(store != NULL);
+  ck_assert_int_eq(vrna_acc_store_record_begin(store, "a", 10), 1);
+  ck_assert_int_eq(vrna_acc_store_record_end(store), 1);
+  ck_assert_int_eq(vrna_acc_store_record_begin(store, "b", 12), 1);
+  ck_assert_int_eq(vrna_acc_store_record_end(store), 1);
+  ck_assert_int_eq(vrna_acc_store_close(store), 1);
+
+  fp = fopen(filename, "rb");
+  ck_assert(fp != NULL);
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  rewind(fp);
+  buf = (unsigned char *)vrna_alloc(size);
+  ck_assert_int_eq(fread(buf, 1, size, fp), size);
+  fclose(fp);
+
+  /* header: magic[8], 4 x uint32_t, num_records, index_offset, ... */
+  memcpy(&num_records, buf + 24, sizeof(uint64_t));
+  memcpy(&index_offset, buf + 32, sizeof(uint64_t));
+  ck_assert_int_eq(num_records, 2);
+
+  /* index entries: uint64_t offset, uint32_t length, uint32_t id_offset */
+  entry = buf + index_offset;
+
+  for (i = 0; i < 7; i++) {
+    unsigned char *copy = (unsigned char *)vrna_alloc(size);
+
+    memcpy(copy, buf, size);
+
+    switch (i) {
+      case 0: /* unmodified */
+        break;
+      case 1: /* number of records exceeds the file */
+        v64 = ((uint64_t)1 << 62) + 1;
+        memcpy(copy + 24, &v64, sizeof(uint64_t));
+        break;
+      case 2: /* record behind the index */
+        v64 = index_offset;
+        memcpy(copy + index_offset + 16, &v64, sizeof(uint64_t));
+        break;
+      case 3: /* record length exceeds the file */
+        v32 = 0xFFFFFFFFU;
+        memcpy(copy + index_offset + 8, &v32, sizeof(uint32_t));
+        break;
+      case 4: /* identifier outside the file */
+        v32 = 1000;
+        memcpy(copy + index_offset + 16 + 12, &v32, sizeof(uint32_t));
+        break;
+      case 5: /* last identifier not terminated */
+        copy[size - 1] = 'x';
+        break;
+      case 6: /* index not sorted */
+        memcpy(copy + index_offset, entry + 16, 16);
+        memcpy(copy + index_offset + 16, entry, 16);
+        break;
+    }
+
+    fp = fopen(corrupt, "wb");
+    ck_assert(fp != NULL);
+    ck_assert_int_eq(fwrite(copy, 1, size, fp), size);
+    fclose(fp);
+    free(copy);
+
+    store = vrna_acc_store_open(corrupt);
+    if (i == 0) {
+      ck_assert(store != NULL);
+      ck_assert(vrna_acc_store_get(store, "b", NULL) != NULL);
+      vrna_acc_store_close(store);
+    } else {
+      ck_assert(store == NULL);
+    }
+  }
+
+  free(buf);
+  remove(corrupt);
+  remove(filename);
+}
+
 #suite  Constraints_Implementation
 
 #tcase  Soft_Constraints
@@ -1,11 +1,15 @@
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include <ViennaRNA/model.h>
 #include <ViennaRNA/utils/basic.h>
 #include <ViennaRNA/utils/strings.h>
 #include <ViennaRNA/alphabet.h>
 #include <ViennaRNA/mfe.h>
+#include <ViennaRNA/utils/higher_order_functions.h>
+#include <ViennaRNA/search/seeds.h>
+#include <ViennaRNA/datastructures/stream_output.h>
 
 static int
 compare_str(const void  *a,
@@ -14,6 +18,28 @@ compare_str(const void  *a,
   return strcmp(*((const char **)a), *((const char **)b));
 }
 
+struct stream_check {
+  unsigned int  next;   /* index expected next */
+  unsigned int  errors; /* number of indices out of order or with wrong data */
+};
+
+
+static void
+stream_check_cb(void          *auxdata,
+                unsigned int  i,
+                void          *data)
+{
+  struct stream_check *check = (struct stream_check *)auxdata;
+
+  if ((i != check->next) ||
+      (*((unsigned int *)data) != i))
+    check->errors++;
+
+  check->next++;
+  free(data);
+}
+
+
 #suite Utilities
 
 #tcase Sequence_Utils
@@ -299,6 +325,126 @@ compare_str(const void  *a,
 }
 
 
+#tcase Higher_Order_Functions
+
+#test test_fun_zip_dispatch
+{
+  int         i, n, e1[67], e2[67], m1, m2, p1, p2;
+  FLT_OR_DBL  q1[67], q2[67], s1, s2, r1, r2;
+
+  for (i = 0; i < 67; i++) {
+    e1[i] = (i % 5 == 0) ? INF : (i * 37) % 23 - 11;
+    e2[i] = (i % 7 == 3) ? INF : (i * 13) % 17 - 8;
+    q1[i] = 1. / (FLT_OR_DBL)(i + 1);
+    q2[i] = (FLT_OR_DBL)((i * 7) % 11) / 10.;
+  }
+
+  for (n = 0; n <= 67; n++) {
+    vrna_fun_dispatch_enable();
+    m1  = vrna_fun_zip_add_argmin(e1, e2, n, &p1);
+    s1  = vrna_fun_zip_mul_sum(q1, q2, n);
+    r1  = vrna_fun_zip_mul_sum_rev(q1, q2 + 66, n);
+
+    ck_assert_int_eq(m1, vrna_fun_zip_add_min(e1, e2, n));
+
+    vrna_fun_dispatch_disable();
+    m2  = vrna_fun_zip_add_argmin(e1, e2, n, &p2);
+    s2  = vrna_fun_zip_mul_sum(q1, q2, n);
+    r2  = vrna_fun_zip_mul_sum_rev(q1, q2 + 66, n);
+
+    ck_assert_int_eq(m1, m2);
+    ck_assert_int_eq(p1, p2);
+    ck_assert(fabs(s1 - s2) < 1e-6);
+    ck_assert(fabs(r1 - r2) < 1e-6);
+  }
+
+  vrna_fun_dispatch_enable();
+}
+
+
+#tcase Search_Utils
+
+#test test_seed_index
+{
+  const char        *target = "AAAAACUACCUCAAAAAAAAACUACCUCAAAAAUUACCUCAA";
+  const char        *query  = "UGAGGUAGUAGGUUGUAUAGUU";
+  unsigned int      n, *hits, *windows;
+  vrna_seed_index_t *index;
+
+  index = vrna_seed_index(target, 7);
+  ck_assert(index != NULL);
+  ck_assert_int_eq(vrna_seed_index_length(index), 42);
+
+  /* two perfect Watson-Crick sites */
+  hits = vrna_seed_hits(index, query, 2, 0, &n);
+  ck_assert_int_eq(n, 2);
+  ck_assert_int_eq(hits[0], 6);
+  ck_assert_int_eq(hits[1], 22);
+  free(hits);
+
+  /* one more site with a single G:U wobble pair */
+  hits = vrna_seed_hits(index, query, 2, 1, &n);
+  ck_assert_int_eq(n, 3);
+  ck_assert_int_eq(hits[2], 34);
+  free(hits);
+
+  windows = vrna_seed_windows(index, query, 2, 1, 2, 2, &n);
+  ck_assert_int_eq(n, 3);
+  ck_assert_int_eq(windows[0], 4);
+  ck_assert_int_eq(windows[1], 14);
+  ck_assert_int_eq(windows[4], 32);
+  ck_assert_int_eq(windows[5], 42);
+  free(windows);
+
+  /* overlapping windows are merged */
+  windows = vrna_seed_windows(index, query, 2, 1, 5, 5, &n);
+  ck_assert_int_eq(n, 1);
+  ck_assert_int_eq(windows[0], 1);
+  ck_assert_int_eq(windows[1], 42);
+  free(windows);
+
+  ck_assert(vrna_seed_hits(index, "CCCCCCCCCC", 2, 0, &n) == NULL);
+  ck_assert_int_eq(n, 0);
+
+  vrna_seed_index_free(index);
+}
+
+
+#tcase Stream_Output
+
+#test test_ostream_concurrent
+{
+  unsigned int        i, n, *data;
+  volatile double     x;
+  struct stream_check check = {
+    0, 0
+  };
+  vrna_ostream_t      queue;
+
+  n     = 5000;
+  queue = vrna_ostream_init_bounded(&stream_check_cb, (void *)&check, 8);
+
+  ck_assert_int_eq(vrna_ostream_max_in_flight(queue), 8);
+
+  /* indices are provided out of order, due to varying amounts of work */
+#pragma omp parallel for schedule(dynamic) num_threads(4) private(data, x)
+  for (i = 0; i < n; i++) {
+    vrna_ostream_request(queue, i);
+
+    for (x = 0; x < (double)((i * 7919) % 13) * 100; x++);
+
+    data  = (unsigned int *)vrna_alloc(sizeof(unsigned int));
+    *data = i;
+    vrna_ostream_provide(queue, i, (void *)data);
+  }
+
+  vrna_ostream_free(queue);
+
+  ck_assert_int_eq(check.next, n);
+  ck_assert_int_eq(check.errors, 0);
+}
+
+
 //@TODO: extend alphabeth
 //@TODO: details.noLP = 1
 //@TODO: idx_type = 1
@@ -1,9 +1,37 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ViennaRNA/landscape/walk.h>
+#include <ViennaRNA/landscape/findpath.h>
+#include <ViennaRNA/eval.h>
+#include <ViennaRNA/utils/basic.h>
 #include <ViennaRNA/model.h>
 #include <ViennaRNA/utils/structures.h>
 #include <ViennaRNA/data_structures.h>
+#include <ViennaRNA/constraints/soft.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+/* soft constraint callback that records whether it is called from a parallel region */
+static int
+sc_in_parallel(int            i,
+               int            j,
+               int            k,
+               int            l,
+               unsigned char  d,
+               void           *data)
+{
+#ifdef _OPENMP
+  if (omp_in_parallel())
+    __atomic_store_n((int *)data, 1, __ATOMIC_RELAXED);
+
+#endif
+
+  return 0;
+}
+
 
 #suite Walks
 
@@ -50,5 +78,166 @@
 }
 
 
+#test Findpath_Threads
+{
+  char                  *sequence = "GGGCGCAAGCCUUAGCGAUUAGCUAGCUAGGCGCUUAAGCCAUCG";
+  char                  *s1       = ".(((..((((((((((.........)))))).))))..)))....";
+  char                  *s2       = "((((((.(((..((((.....)))))))..)))))).........";
+  char                  *s[2];
+  int                   t, k, d, n, saddle[2], bp_dist;
+  float                 en;
+  vrna_md_t             md;
+  vrna_fold_compound_t  *vc;
+  vrna_path_t           *path, *r;
+  vrna_path_options_t   options;
+
+  bp_dist = vrna_bp_distance(s1, s2);
+
+  for (t = 0; t < 2; t++) {
+    vrna_md_set_default(&md);
+    md.num_threads = (t == 0) ? 1 : 4;
+    vrna_fold_compound_t *fc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
+    saddle[t] = vrna_path_findpath_saddle(fc, s1, s2, 10);
+    vrna_fold_compound_free(fc);
+  }
+
+  /* the saddle must not depend on the number of threads */
+  ck_assert_int_eq(saddle[0], saddle[1]);
+
+  vrna_md_set_default(&md);
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
+
+  path = vrna_path_findpath(vc, s1, s2, 10);
+  ck_assert(path != NULL);
+
+  for (n = 0, en = path[0].en, r = path; r->s; r++, n++)
+    if (r->en > en)
+      en = r->en;
+
+  ck_assert_int_eq(n, bp_dist + 1);
+  ck_assert_str_eq(path[0].s, s1);
+  ck_assert_str_eq(path[bp_dist].s, s2);
+  ck_assert_int_eq((int)(en * 100. + (en < 0 ? -0.5 : 0.5)), saddle[0]);
+
+  vrna_path_free(path);
+
+  /* paths of moves in either direction lead from start to target */
+  s[0]    = s1;
+  s[1]    = s2;
+  options = vrna_path_options_findpath(10, VRNA_PATH_TYPE_MOVES);
+
+  for (k = 0; k < 2; k++) {
+    path = vrna_path_direct(vc, s[k], s[1 - k], options);
+    ck_assert(path != NULL);
+
+    for (d = 0, en = 0., r = path; r->move.pos_5 != 0; r++, d++)
+      en += r->en;
+
+    ck_assert_int_eq(d, bp_dist);
+    en -= vrna_eval_structure(vc, s[1 - k]) - vrna_eval_structure(vc, s[k]);
+    ck_assert(abs((int)(100. * en)) <= 1);
+    vrna_path_free(path);
+  }
+
+  vrna_path_options_free(options);
+  vrna_fold_compound_free(vc);
+}
+
+
+#test Findpath_Saddle_Matrix
+{
+  const char            *sequence = "GGGCGCAAGCCUUAGCGAUUAGCUAGCUAGGCGCUUAAGCCAUCG";
+  const char            *structures[4] = {
+    ".(((..((((((((((.........)))))).))))..)))....",
+    "((((((.(((..((((.....)))))))..)))))).........",
+    ".(((....((((((((.........)))))).))....)))....",
+    "............................................."
+  };
+  unsigned int          i, j, num = 4;
+  int                   *saddles, *sym, *ub;
+  vrna_md_t             md;
+  vrna_fold_compound_t  *vc;
+
+  vrna_md_set_default(&md);
+  md.num_threads = 2;
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
+
+  saddles = vrna_path_findpath_saddle_matrix(vc, structures, num, 10, VRNA_PATH_SADDLE_MATRIX_DEFAULT);
+  sym     = vrna_path_findpath_saddle_matrix(vc, structures, num, 10, VRNA_PATH_SADDLE_MATRIX_SYMMETRIC);
+  ub      = vrna_path_findpath_saddle_matrix(vc,
+                                             structures,
+                                             num,
+                                             10,
+                                             VRNA_PATH_SADDLE_MATRIX_SYMMETRIC |
+                                             VRNA_PATH_SADDLE_MATRIX_UPPER_BOUND);
+
+  ck_assert(saddles != NULL);
+  ck_assert(sym != NULL);
+  ck_assert(ub != NULL);
+
+  for (i = 0; i < num; i++)
+    for (j = 0; j < num; j++) {
+      if (i == j) {
+        ck_assert_int_eq(saddles[i * num + j],
+                         (int)(vrna_eval_structure(vc, structures[i]) * 100. +
+                               (vrna_eval_structure(vc, structures[i]) < 0 ? -0.5 : 0.5)));
+        continue;
+      }
+
+      ck_assert_int_eq(saddles[i * num + j],
+                       vrna_path_findpath_saddle(vc, structures[i], structures[j], 10));
+      ck_assert_int_eq(sym[i * num + j],
+                       sym[j * num + i]);
+      ck_assert_int_eq(sym[i * num + j],
+                       saddles[MIN2(i, j) * num + MAX2(i, j)]);
+      /* bounded searches never report a higher saddle */
+      ck_assert(ub[i * num + j] <= sym[i * num + j]);
+    }
+
+  free(saddles);
+  free(sym);
+  free(ub);
+  vrna_fold_compound_free(vc);
+}
+
+
+#test Findpath_Saddle_Matrix_Soft_Constraints
+{
+  const char            *sequence = "GGGCGCAAGCCUUAGCGAUUAGCUAGCUAGGCGCUUAAGCCAUCG";
+  const char            *structures[4] = {
+    ".(((..((((((((((.........)))))).))))..)))....",
+    "((((((.(((..((((.....)))))))..)))))).........",
+    ".(((....((((((((.........)))))).))....)))....",
+    "............................................."
+  };
+  unsigned int          i, j, num = 4;
+  int                   *saddles, in_parallel = 0;
+  vrna_md_t             md;
+  vrna_fold_compound_t  *vc;
+
+  vrna_md_set_default(&md);
+  md.num_threads = 4;
+  vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
+
+  vrna_sc_add_f(vc, &sc_in_parallel);
+  vrna_sc_add_data(vc, (void *)&in_parallel, NULL);
+
+  /* callbacks may not be thread-safe, so all searches must run serially */
+  saddles = vrna_path_findpath_saddle_matrix(vc, structures, num, 10, VRNA_PATH_SADDLE_MATRIX_DEFAULT);
+
+  ck_assert(saddles != NULL);
+  ck_assert_int_eq(in_parallel, 0);
+
+  for (i = 0; i < num; i++)
+    for (j = 0; j < num; j++)
+      if (i != j)
+        ck_assert_int_eq(saddles[i * num + j],
+                         vrna_path_findpath_saddle(vc, structures[i], structures[j], 10));
+
+  free(saddles);
+  vrna_fold_compound_free(vc);
+}
+
+
 #main-pre
     srunner_set_tap(sr, "-");